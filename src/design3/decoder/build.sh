@@ -26,10 +26,73 @@ LD=$CC
 OBJCOPY=${PREFIX}-objcopy
 FORMAT=clang-format
 
+# Build options
+# DECODER_ICACHE=0 runs everything from flash with the instruction cache off
+DECODER_ICACHE=${DECODER_ICACHE:-1}
+# DECODER_RAMFUNC=1 runs the hottest crypto routines from SRAM_RX, next to .flashprog
+DECODER_RAMFUNC=${DECODER_RAMFUNC:-0}
+# DECODER_EDDSA_PRECOMPUTED=1 checks signatures against tables precomputed for the encoder key
+# (src/eddsa_verify.c) instead of with Monocypher's crypto_eddsa_check()
+DECODER_EDDSA_PRECOMPUTED=${DECODER_EDDSA_PRECOMPUTED:-0}
+# DECODER_BENCH_KDF=1 times both key tree KDF versions at boot and reports them as a debug message
+DECODER_BENCH_KDF=${DECODER_BENCH_KDF:-0}
+# DECODER_FAST_BOOT=1 accepts the first message header as soon as the lockout is served and the
+# board is up, and finishes the rest of the startup around it, see src/boot.c
+DECODER_FAST_BOOT=${DECODER_FAST_BOOT:-1}
+# DECODER_BENCH_MEM=1 times the memory routines of libdesign3.c per length at boot and reports them
+# as a debug message
+DECODER_BENCH_MEM=${DECODER_BENCH_MEM:-0}
+# DECODER_BENCH_KEY_CACHE=1 times channel 0's frame keys with and without the key path cache at boot
+# and reports them as a debug message
+DECODER_BENCH_KEY_CACHE=${DECODER_BENCH_KEY_CACHE:-0}
+# DECODER_BENCH_EDDSA=1 times a signature check with the precomputed tables and with
+# crypto_eddsa_check() at boot and reports them as a debug message
+DECODER_BENCH_EDDSA=${DECODER_BENCH_EDDSA:-0}
+# DECODER_BENCH_ICACHE=1 times channel 0 decodes with the instruction cache off and on at boot and
+# reports them as a debug message (board builds only, the host and QEMU builds have no cache)
+DECODER_BENCH_ICACHE=${DECODER_BENCH_ICACHE:-0}
+# DECODER_EXPANSION_BITS=n pre-derives the key tree n bits above the leaves for every subscription
+# (64 turns it off), see ppp_common/expansion_budget.py
+DECODER_EXPANSION_BITS=${DECODER_EXPANSION_BITS:-16}
+# DECODER_PROFILE=1 counts the cycles of every decode and subscribe stage, read out with
+# python -m ectf25.utils.perf
+DECODER_PROFILE=${DECODER_PROFILE:-0}
+# DECODER_HOT_LAYOUT=flash clusters the functions of DECODER_HOT_PROFILE among the shuffled ones,
+# sram puts the hottest of them in SRAM_RX (next to DECODER_RAMFUNC's), off shuffles them all
+DECODER_HOT_LAYOUT=${DECODER_HOT_LAYOUT:-flash}
+DECODER_HOT_PROFILE=${DECODER_HOT_PROFILE:-hot_functions.txt}
+# DECODER_STACK_REPORT=1 writes the worst-case stack per call path of the image to
+# stack_report.txt next to it, see ppp_common/stack_report.py and stack_indirect.txt
+DECODER_STACK_REPORT=${DECODER_STACK_REPORT:-0}
+# DECODER_JOBS=n runs up to n compilers or linkers at once
+DECODER_JOBS=${DECODER_JOBS:-$(nproc)}
+
+# Fleet build (./build.sh fleet): an image for every ID of DECODER_IDS (separated by spaces or
+# commas) in build/fleet/<id>, from objects compiled once. See ppp_common/fleet.py
+DECODER_IDS=${DECODER_IDS:-}
+
+# Host build (./build.sh host): the decoder as an x86-64 Linux program, see
+# host/src/hardware_init.c. Run it from build/host, the host tools take --port build/host/uart
+HOST_CC=gcc
+
+# QEMU build (./build.sh qemu): the Thumb-2 image on qemu-system-arm's mps2-an386, see
+# qemu/src/hardware_init.c. Instruction counts come from its profile, so it always profiles, read out
+# with python -m ectf25.utils.icount
+if [[ $1 == qemu ]]; then
+    DECODER_PROFILE=1
+fi
+
 # Misc configuration
 DOCKER_IMAGE=build-decoder
 GLOBAL_SECRETS=/global.secrets
 SECRETS_C="$BUILD_DIR"/secrets.c
+TREE_CONFIG_H="$BUILD_DIR"/tree_config.h
+HOST_BUILD_DIR="$BUILD_DIR"/host
+# Host tests (./build.sh test): every host/test/test_*.c linked with the host build's objects but
+# main.o, and run from build/host/test, see host/test/harness.h
+HOST_TEST_DIR="$HOST_BUILD_DIR"/test
+QEMU_BUILD_DIR="$BUILD_DIR"/qemu
+FLEET_BUILD_DIR="$BUILD_DIR"/fleet
 
 ##########################
 # Enter docker container #
@@ -46,6 +109,22 @@ if [[ -z $IN_CONTAINER ]]; then
               -v ./decoder:/decoder \
               -v ./global.secrets:"$GLOBAL_SECRETS":ro \
               -e DECODER_ID="$DECODER_ID" \
+              -e DECODER_ICACHE="$DECODER_ICACHE" \
+              -e DECODER_RAMFUNC="$DECODER_RAMFUNC" \
+              -e DECODER_EDDSA_PRECOMPUTED="$DECODER_EDDSA_PRECOMPUTED" \
+              -e DECODER_BENCH_KDF="$DECODER_BENCH_KDF" \
+              -e DECODER_BENCH_MEM="$DECODER_BENCH_MEM" \
+              -e DECODER_BENCH_KEY_CACHE="$DECODER_BENCH_KEY_CACHE" \
+              -e DECODER_BENCH_EDDSA="$DECODER_BENCH_EDDSA" \
+              -e DECODER_BENCH_ICACHE="$DECODER_BENCH_ICACHE" \
+              -e DECODER_FAST_BOOT="$DECODER_FAST_BOOT" \
+              -e DECODER_EXPANSION_BITS="$DECODER_EXPANSION_BITS" \
+              -e DECODER_PROFILE="$DECODER_PROFILE" \
+              -e DECODER_HOT_LAYOUT="$DECODER_HOT_LAYOUT" \
+              -e DECODER_HOT_PROFILE="$DECODER_HOT_PROFILE" \
+              -e DECODER_STACK_REPORT="$DECODER_STACK_REPORT" \
+              -e DECODER_JOBS="$DECODER_JOBS" \
+              -e DECODER_IDS="$DECODER_IDS" \
               -e IN_CONTAINER=1 \
               "$DOCKER_IMAGE" \
               bear \
@@ -79,6 +158,7 @@ PROJ_INCPATH+=(inc)
 
 SRCPATH+=("${PROJ_SRCPATH[@]}")
 INCPATH+=("${PROJ_INCPATH[@]}")
+INCPATH+=("$BUILD_DIR") # generated headers
 
 # Libraries
 SRCPATH+=(lib/msdk-lib/ICC)
@@ -89,13 +169,15 @@ SRCPATH+=(lib/msdk-lib/FLC)
 SRCPATH+=(lib/msdk-lib/TMR)
 SRCPATH+=(lib/msdk-lib/TRNG)
 
-INCPATH+=(lib/msdk-lib)
-INCPATH+=(lib/msdk-lib/Include)
-INCPATH+=(lib/msdk-lib/IncludeMAX78000)
-INCPATH+=(lib/msdk-lib/PeriphDriversMAX78000/)
+LIB_INCPATH+=(lib/msdk-lib)
+LIB_INCPATH+=(lib/msdk-lib/Include)
+LIB_INCPATH+=(lib/msdk-lib/IncludeMAX78000)
+LIB_INCPATH+=(lib/msdk-lib/PeriphDriversMAX78000/)
 
 SRCPATH+=(lib/monocypher)
-INCPATH+=(lib/monocypher)
+LIB_INCPATH+=(lib/monocypher)
+
+INCPATH+=("${LIB_INCPATH[@]}")
 
 # Resolve sources from paths
 # Glob everything twice to appease the ghosts
@@ -111,6 +193,11 @@ _=(${PROJ_SRCPATH[@]/%/\/*.c})
 PROJ_FILES+=(${PROJ_SRCPATH[@]/%/\/*.c})
 _=(${PROJ_INCPATH[@]/%/\/*.h})
 PROJ_FILES+=(${PROJ_INCPATH[@]/%/\/*.h})
+PROJ_FILES+=(host/src/*.c host/inc/*.h host/test/*.c host/test/*.h)
+PROJ_FILES+=(qemu/src/*.c qemu/inc/*.h)
+
+# Everything but secrets.c is the same for every decoder ID, see fleet
+COMMON_SRCS=("${SRCS[@]}")
 
 # Auto-generated source files (add manually, since they are not found in the paths)
 SRCS+=("$SECRETS_C")
@@ -150,6 +237,16 @@ CFLAGS=(--std=c23
         -D__unused='[[gnu::unused]]'
         -DTARGET="$TARGET"
         -DTARGET_REV="$TARGET_REV"
+        -DENABLE_ICACHE="$DECODER_ICACHE"
+        -DEDDSA_PRECOMPUTED="$DECODER_EDDSA_PRECOMPUTED"
+        -DBENCH_TREE_KDF="$DECODER_BENCH_KDF"
+        -DBENCH_MEM="$DECODER_BENCH_MEM"
+        -DBENCH_KEY_CACHE="$DECODER_BENCH_KEY_CACHE"
+        -DBENCH_EDDSA="$DECODER_BENCH_EDDSA"
+        -DBENCH_ICACHE="$DECODER_BENCH_ICACHE"
+        -DFAST_BOOT="$DECODER_FAST_BOOT"
+        -DEXPANSION_FRAME_BITS="$DECODER_EXPANSION_BITS"
+        -DENABLE_PROFILE="$DECODER_PROFILE"
         -falign-functions=64
         -falign-loops=64
         -ffreestanding)
@@ -159,16 +256,81 @@ LDFLAGS=(-mthumb
          -mfloat-abi="$MFLOAT_ABI"
          -mfpu="$MFPU"
          '-Wl,--gc-sections'
-         "-Wl,-Map=${BUILD_DIR}/${PROJECT}.map"
          -nostartfiles
          -nostdlib
          -ffreestanding)
 
+# Function sections moved to SRAM_RX by DECODER_RAMFUNC=1 (8kB shared with .flashprog)
+RAMFUNC_SECTIONS=(.text.blake2b_compress
+                  .text.blake2s_compress
+                  .text.fe_mul
+                  .text.fe_sq)
+
+SHIMMY_FLAGS=()
+if [[ $DECODER_RAMFUNC == 1 ]]; then
+    SHIMMY_FLAGS+=("${RAMFUNC_SECTIONS[@]/#/--ramfunc=}")
+fi
+case "$DECODER_HOT_LAYOUT" in
+    flash ) SHIMMY_FLAGS+=(--hot "$DECODER_HOT_PROFILE")            ;;
+    sram  ) SHIMMY_FLAGS+=(--hot "$DECODER_HOT_PROFILE" --hot-sram) ;;
+    off   )                                                         ;;
+    * )
+        echo "unknown DECODER_HOT_LAYOUT $DECODER_HOT_LAYOUT"
+        exit 1
+    ;;
+esac
+
+# Frame sizes and calls of every function, in a .ci next to its object
+if [[ $DECODER_STACK_REPORT == 1 ]]; then
+    CFLAGS+=(-fcallgraph-info=su)
+fi
+
+# QEMU build: the board's flags with flash where qemu/memory.ld puts it. Sources in qemu/src replace
+# the ones of the same name in src, headers in qemu/inc come first and the MSDK's drivers are left out
+QEMU_INCPATH=(qemu/inc
+              "${PROJ_INCPATH[@]}"
+              "$QEMU_BUILD_DIR"
+              "${LIB_INCPATH[@]}")
+
+QEMU_CFLAGS=("${CFLAGS[@]}"
+             -DFLASH_ORIGIN=0x00000000
+             "${QEMU_INCPATH[@]/#/-I}")
+
 # Add the include file paths to AFLAGS and CFLAGS.
 AFLAGS+=("${INCPATH[@]/#/-I}")
 CFLAGS+=("${INCPATH[@]/#/-I}")
 # LDFLAGS+=(${LIBPATH[@]/#/-L})
 
+# Host build: sources in host/src replace the ones of the same name in src, and the headers in
+# host/inc the MSDK's
+HOST_INCPATH=(host/inc
+              "${PROJ_INCPATH[@]}"
+              "$HOST_BUILD_DIR"
+              lib/monocypher)
+
+HOST_CFLAGS=(--std=c23
+             -O2
+             "${DEFAULT_WARNING_FLAGS[@]}"
+             -c
+             -fno-pie
+             -D__unused='[[gnu::unused]]'
+             -DHOST_BUILD=1
+             -DEDDSA_PRECOMPUTED="$DECODER_EDDSA_PRECOMPUTED"
+             -DBENCH_TREE_KDF="$DECODER_BENCH_KDF"
+             -DBENCH_MEM="$DECODER_BENCH_MEM"
+             -DBENCH_KEY_CACHE="$DECODER_BENCH_KEY_CACHE"
+             -DBENCH_EDDSA="$DECODER_BENCH_EDDSA"
+             -DBENCH_ICACHE=0
+             -DFAST_BOOT="$DECODER_FAST_BOOT"
+             -DEXPANSION_FRAME_BITS="$DECODER_EXPANSION_BITS"
+             -DENABLE_PROFILE="$DECODER_PROFILE"
+             -ffreestanding
+             "${HOST_INCPATH[@]/#/-I}")
+
+# Static, so the image built in the container runs on any x86-64 Linux
+HOST_LDFLAGS=(-static
+              -no-pie)
+
 ###########
 # Actions #
 ###########
@@ -177,14 +339,7 @@ function clean {
     rm -rf "$BUILD_DIR"
 }
 
-function build {
-    if [[ -z $DECODER_ID ]]; then
-        echo 'environment var parameter DECODER_ID not specified'
-        exit 1
-    fi
-
-    mkdir -p "$BUILD_DIR"
-
+function python_setup {
     # break-system-packages and root-user-action are safe because this is a container
     echo 'python setup...'
     pip install \
@@ -194,39 +349,107 @@ function build {
         --root-user-action ignore \
         --editable \
         ./ppp_common
+}
 
-    # Generate keys required by the decoder
-    echo 'generate: secrets.c'
-    python -m ppp_common.gen_secrets_c "$GLOBAL_SECRETS" "$SECRETS_C" "$DECODER_ID"
+# Runs a command in the background, once fewer than DECODER_JOBS are running. wait_all() collects
+# them and fails the build if any of them failed.
+RUNNING=0
+FAILED=0
+function spawn {
+    if (( RUNNING >= DECODER_JOBS )); then
+        wait -n || FAILED=1
+        RUNNING=$((RUNNING - 1))
+    fi
+    "$@" &
+    RUNNING=$((RUNNING + 1))
+}
 
-    # Build objects
-    echo 'building...'
-    OBJS=()
-    for src_file in "${SRCS[@]}"; do
-        # From https://stackoverflow.com/questions/965053/extract-filename-and-extension-in-bash
-        src_name="$(basename "$src_file")"
-        extn="${src_name##*.}"
-        name="${src_name%.*}"
+function wait_all {
+    while (( RUNNING > 0 )); do
+        wait -n || FAILED=1
+        RUNNING=$((RUNNING - 1))
+    done
+    if (( FAILED )); then
+        echo 'build failed'
+        exit 1
+    fi
+}
 
-        obj_file="${BUILD_DIR}/${name}.o"
+# Milliseconds since the epoch
+function now_ms {
+    echo $(( ${EPOCHREALTIME/./} / 1000 ))
+}
 
-        case "$extn" in
-            c )
-                echo "c: $src_name"
-                "$CC" "${CFLAGS[@]}" -o "$obj_file" "$src_file" -DDECODER_ID="$DECODER_ID"
-            ;;
-            S )
-                echo "S: $src_name"
-                "$AS" "${AFLAGS[@]}" -o "$obj_file" -c "$src_file"
-            ;;
-            * )
-                echo "unknown file in source paths!: $src_file"
-                exit 1
-            ;;
-        esac
+function compile {
+    local src_file=$1
+    local obj_file=$2
+
+    # From https://stackoverflow.com/questions/965053/extract-filename-and-extension-in-bash
+    src_name="$(basename "$src_file")"
+    extn="${src_name##*.}"
+
+    case "$extn" in
+        c )
+            echo "c: $src_name"
+            "$CC" "${CFLAGS[@]}" -o "$obj_file" "$src_file"
+        ;;
+        S )
+            echo "S: $src_name"
+            "$AS" "${AFLAGS[@]}" -o "$obj_file" -c "$src_file"
+        ;;
+        * )
+            echo "unknown file in source paths!: $src_file"
+            exit 1
+        ;;
+    esac
+}
+
+# Compiles the given sources into objects in the directory $1, DECODER_JOBS at once, into OBJS
+function compile_all {
+    local obj_dir=$1
+    shift
 
+    OBJS=()
+    for src_file in "$@"; do
+        src_name="$(basename "$src_file")"
+        obj_file="${obj_dir}/${src_name%.*}.o"
+        spawn compile "$src_file" "$obj_file"
         OBJS+=("$obj_file")
     done
+    wait_all
+}
+
+# Writes the worst-case stack of the image in the directory $1, from the .ci files of OBJS
+function stack_report {
+    if [[ $DECODER_STACK_REPORT != 1 ]]; then
+        return
+    fi
+
+    echo "stack report: $1/stack_report.txt"
+    python -m ppp_common.stack_report \
+           --elf "$1/${PROJECT}.elf" \
+           --indirect stack_indirect.txt \
+           --out "$1/stack_report.txt" \
+           "${OBJS[@]/%.o/.ci}"
+}
+
+function build {
+    if [[ -z $DECODER_ID ]]; then
+        echo 'environment var parameter DECODER_ID not specified'
+        exit 1
+    fi
+
+    mkdir -p "$BUILD_DIR"
+
+    python_setup
+
+    # Generate keys required by the decoder
+    echo 'generate: secrets.c tree_config.h'
+    python -m ppp_common.gen_secrets_c --config-header "$TREE_CONFIG_H" "$GLOBAL_SECRETS" "$SECRETS_C" "$DECODER_ID"
+
+    # Build objects
+    echo 'building...'
+    compile_all "$BUILD_DIR" "${SRCS[@]}"
 
     # generate linker script using :sparkles: Symbol Shimmy :sparkles:
     echo 'symbol shimmy: firmware.ld'
@@ -234,12 +457,15 @@ function build {
            --template firmware.ld.template \
            --secrets "$GLOBAL_SECRETS" \
            --id "$DECODER_ID" \
+           "${SHIMMY_FLAGS[@]}" \
            "${OBJS[@]}" \
            > "${BUILD_DIR}/firmware.ld"
 
     # Link objects
     echo "link: ${PROJECT}.elf"
-    "$LD" -T "${BUILD_DIR}/firmware.ld" "${LDFLAGS[@]}" -o "${BUILD_DIR}/${PROJECT}.elf" "${OBJS[@]}"
+    "$LD" -T memory.ld -T "${BUILD_DIR}/firmware.ld" "${LDFLAGS[@]}" "-Wl,-Map=${BUILD_DIR}/${PROJECT}.map" \
+          -o "${BUILD_DIR}/${PROJECT}.elf" "${OBJS[@]}"
+    stack_report "${BUILD_DIR}"
 
     # Generate a subscription for channel 0
     python -m ppp_common.gen_subscription --force --embeddable "$GLOBAL_SECRETS" "${BUILD_DIR}/channel0.bin" "$DECODER_ID" 0 0xFFFF_FFFF_FFFF_FFFF 0
@@ -252,10 +478,247 @@ function build {
     "$OBJCOPY"  "${BUILD_DIR}/${PROJECT}.elf" -Obinary "${BUILD_DIR}/${PROJECT}.bin"
 }
 
+function host {
+    if [[ -z $DECODER_ID ]]; then
+        echo 'environment var parameter DECODER_ID not specified'
+        exit 1
+    fi
+    if [[ $DECODER_BENCH_ICACHE == 1 ]]; then
+        echo 'DECODER_BENCH_ICACHE=1 needs a board build, the host build has no instruction cache'
+        exit 1
+    fi
+
+    mkdir -p "$HOST_BUILD_DIR"
+
+    python_setup
+
+    echo 'generate: host secrets.c tree_config.h'
+    python -m ppp_common.gen_secrets_c --config-header "$HOST_BUILD_DIR/tree_config.h" "$GLOBAL_SECRETS" "$HOST_BUILD_DIR/secrets.c" "$DECODER_ID"
+
+    # Peripheral drivers and startup code are replaced, crt0.S is left out
+    HOST_SRCS=(host/src/*.c)
+    for src_file in "${PROJ_SRCPATH[@]/%/\/*.c}"; do
+        if [[ ! -e host/src/$(basename "$src_file") ]]; then
+            HOST_SRCS+=("$src_file")
+        fi
+    done
+    HOST_SRCS+=(lib/monocypher/*.c)
+    HOST_SRCS+=("$HOST_BUILD_DIR/secrets.c")
+
+    echo 'building for host...'
+    OBJS=()
+    for src_file in "${HOST_SRCS[@]}"; do
+        src_name="$(basename "$src_file")"
+        obj_file="${HOST_BUILD_DIR}/${src_name%.*}.o"
+
+        echo "host c: $src_name"
+        "$HOST_CC" "${HOST_CFLAGS[@]}" -o "$obj_file" "$src_file"
+        OBJS+=("$obj_file")
+    done
+
+    # host/flash.ld places the flash symbols of firmware.ld.template
+    echo 'link: host/decoder'
+    "$HOST_CC" "${HOST_LDFLAGS[@]}" -o "${HOST_BUILD_DIR}/decoder" "${OBJS[@]}" host/flash.ld
+
+    # Flash image with channel 0, the decoder's flash.bin unless DECODER_FLASH says otherwise
+    python -m ppp_common.gen_subscription --force --embeddable "$GLOBAL_SECRETS" "${HOST_BUILD_DIR}/channel0.bin" "$DECODER_ID" 0 0xFFFF_FFFF_FFFF_FFFF 0
+    echo 'generate: host/flash.bin'
+    python -m ppp_common.host_flash "${HOST_BUILD_DIR}/channel0.bin" "${HOST_BUILD_DIR}/flash.bin"
+}
+
+function host_test {
+    host
+
+    mkdir -p "$HOST_TEST_DIR"
+
+    # a test brings its own main(), and the linker leaves out the objects of the sources it includes
+    local lib_objs=()
+    for obj_file in "${OBJS[@]}"; do
+        if [[ $obj_file != "$HOST_BUILD_DIR/main.o" ]]; then
+            lib_objs+=("$obj_file")
+        fi
+    done
+    echo 'archive: host/test/libdecoder.a'
+    rm -f "$HOST_TEST_DIR/libdecoder.a"
+    ar rcs "$HOST_TEST_DIR/libdecoder.a" "${lib_objs[@]}"
+
+    echo 'generate: host/test/key_path.txt'
+    python host/test/key_path_vectors.py "$GLOBAL_SECRETS" "$HOST_TEST_DIR/key_path.txt"
+    echo 'generate: host/test/eddsa.txt'
+    python host/test/eddsa_vectors.py "$HOST_TEST_DIR/eddsa.txt"
+
+    echo 'host c: harness.c'
+    "$HOST_CC" "${HOST_CFLAGS[@]}" -Ihost/test -o "$HOST_TEST_DIR/harness.o" host/test/harness.c
+
+    local failed=0
+    for src_file in host/test/test_*.c; do
+        local name
+        name="$(basename "${src_file%.c}")"
+
+        echo "host test: $name"
+        "$HOST_CC" "${HOST_CFLAGS[@]}" -Ihost/test -o "$HOST_TEST_DIR/$name.o" "$src_file"
+        "$HOST_CC" "${HOST_LDFLAGS[@]}" -o "$HOST_TEST_DIR/$name" "$HOST_TEST_DIR/$name.o" \
+                   "$HOST_TEST_DIR/harness.o" "$HOST_TEST_DIR/libdecoder.a" host/flash.ld
+        if ! (cd "$HOST_TEST_DIR" && "./$name"); then
+            failed=1
+        fi
+    done
+
+    if (( failed )); then
+        echo 'host tests failed'
+        exit 1
+    fi
+}
+
+function qemu {
+    if [[ -z $DECODER_ID ]]; then
+        echo 'environment var parameter DECODER_ID not specified'
+        exit 1
+    fi
+    if [[ $DECODER_BENCH_ICACHE == 1 ]]; then
+        echo 'DECODER_BENCH_ICACHE=1 needs a board build, the QEMU build has no instruction cache'
+        exit 1
+    fi
+
+    mkdir -p "$QEMU_BUILD_DIR"
+
+    python_setup
+
+    echo 'generate: qemu secrets.c tree_config.h'
+    python -m ppp_common.gen_secrets_c --config-header "$QEMU_BUILD_DIR/tree_config.h" "$GLOBAL_SECRETS" "$QEMU_BUILD_DIR/secrets.c" "$DECODER_ID"
+
+    # Board support replaced, including crt0.S
+    QEMU_SRCS=(qemu/src/*.c qemu/src/*.S)
+    for src_file in "${PROJ_SRCPATH[@]/%/\/*.c}" "${PROJ_SRCPATH[@]/%/\/*.S}"; do
+        if [[ ! -e qemu/src/$(basename "$src_file") ]]; then
+            QEMU_SRCS+=("$src_file")
+        fi
+    done
+    QEMU_SRCS+=(lib/monocypher/*.c)
+    QEMU_SRCS+=("$QEMU_BUILD_DIR/secrets.c")
+
+    echo 'building for qemu...'
+    OBJS=()
+    for src_file in "${QEMU_SRCS[@]}"; do
+        src_name="$(basename "$src_file")"
+        obj_file="${QEMU_BUILD_DIR}/${src_name%.*}.o"
+
+        case "${src_name##*.}" in
+            c )
+                echo "qemu c: $src_name"
+                "$CC" "${QEMU_CFLAGS[@]}" -o "$obj_file" "$src_file"
+            ;;
+            S )
+                echo "qemu S: $src_name"
+                "$AS" "${AFLAGS[@]}" -o "$obj_file" -c "$src_file"
+            ;;
+        esac
+        OBJS+=("$obj_file")
+    done
+
+    echo 'symbol shimmy: qemu/firmware.ld'
+    python -m ppp_common.symbol_shimmy \
+           --template firmware.ld.template \
+           --secrets "$GLOBAL_SECRETS" \
+           --id "$DECODER_ID" \
+           "${SHIMMY_FLAGS[@]}" \
+           "${OBJS[@]}" \
+           > "${QEMU_BUILD_DIR}/firmware.ld"
+
+    # qemu/memory.ld in place of memory.ld
+    echo "link: qemu/${PROJECT}.elf"
+    "$LD" -T qemu/memory.ld -T "${QEMU_BUILD_DIR}/firmware.ld" "${LDFLAGS[@]}" "-Wl,-Map=${QEMU_BUILD_DIR}/${PROJECT}.map" \
+          -o "${QEMU_BUILD_DIR}/${PROJECT}.elf" "${OBJS[@]}"
+    stack_report "${QEMU_BUILD_DIR}"
+
+    # QEMU loads the ELF as is, so channel 0 goes in like for the board
+    python -m ppp_common.gen_subscription --force --embeddable "$GLOBAL_SECRETS" "${QEMU_BUILD_DIR}/channel0.bin" "$DECODER_ID" 0 0xFFFF_FFFF_FFFF_FFFF 0
+    "$OBJCOPY" --set-section-flags .channel0=contents,alloc,load,readonly --update-section ".channel0=${QEMU_BUILD_DIR}/channel0.bin" "${QEMU_BUILD_DIR}/${PROJECT}.elf" "${QEMU_BUILD_DIR}/${PROJECT}.elf"
+}
+
+# Links the image of one decoder of the fleet, in the directory ppp_common.fleet made for it
+function link_device {
+    local device_dir=$1
+
+    echo "link: ${device_dir}/${PROJECT}.elf"
+    "$CC" "${CFLAGS[@]}" -o "${device_dir}/secrets.o" "${device_dir}/secrets.c"
+    "$LD" -T memory.ld -T "${device_dir}/firmware.ld" "${LDFLAGS[@]}" "-Wl,-Map=${device_dir}/${PROJECT}.map" \
+          -o "${device_dir}/${PROJECT}.elf" "${COMMON_OBJS[@]}" "${device_dir}/secrets.o"
+    "$OBJCOPY" --set-section-flags .channel0=contents,alloc,load,readonly --update-section ".channel0=${device_dir}/channel0.bin" "${device_dir}/${PROJECT}.elf" "${device_dir}/${PROJECT}.elf"
+    "$OBJCOPY" "${device_dir}/${PROJECT}.elf" -Obinary "${device_dir}/${PROJECT}.bin"
+}
+
+function fleet {
+    if [[ -z $DECODER_IDS ]]; then
+        echo 'environment var parameter DECODER_IDS not specified'
+        exit 1
+    fi
+
+    mkdir -p "${FLEET_BUILD_DIR}/common"
+
+    python_setup
+
+    local start_ms
+    start_ms=$(now_ms)
+
+    # Only the header is used, every image gets the secrets.c of its ID from ppp_common.fleet
+    echo 'generate: tree_config.h'
+    python -m ppp_common.gen_secrets_c --config-header "$TREE_CONFIG_H" "$GLOBAL_SECRETS" "${FLEET_BUILD_DIR}/common/secrets.c" 0
+
+    echo 'building common objects...'
+    compile_all "${FLEET_BUILD_DIR}/common" "${COMMON_SRCS[@]}"
+    COMMON_OBJS=("${OBJS[@]}")
+    local compiled_ms
+    compiled_ms=$(now_ms)
+
+    # The same secrets.c, linker script and channel 0 as build would make for each ID
+    echo 'generate: secrets.c firmware.ld channel0.bin per device'
+    python -m ppp_common.fleet \
+           --template firmware.ld.template \
+           --secrets "$GLOBAL_SECRETS" \
+           --ids "$DECODER_IDS" \
+           --out-dir "$FLEET_BUILD_DIR" \
+           "${SHIMMY_FLAGS[@]}" \
+           "${COMMON_OBJS[@]}"
+    local generated_ms
+    generated_ms=$(now_ms)
+
+    local device_dirs
+    mapfile -t device_dirs < "${FLEET_BUILD_DIR}/devices.txt"
+    for device_dir in "${device_dirs[@]}"; do
+        spawn link_device "$device_dir"
+    done
+    wait_all
+    local linked_ms
+    linked_ms=$(now_ms)
+
+    echo "fleet: ${#device_dirs[@]} images with ${DECODER_JOBS} jobs," \
+         "compile $((compiled_ms - start_ms)) ms," \
+         "generate $((generated_ms - compiled_ms)) ms," \
+         "link $((linked_ms - generated_ms)) ms," \
+         "total $((linked_ms - start_ms)) ms"
+}
+
 function debug {
     cat <<EOF
 IN_CONTAINER = $IN_CONTAINER
 DECODER_ID = $DECODER_ID
+DECODER_ICACHE = $DECODER_ICACHE
+DECODER_RAMFUNC = $DECODER_RAMFUNC
+DECODER_EDDSA_PRECOMPUTED = $DECODER_EDDSA_PRECOMPUTED
+DECODER_BENCH_KDF = $DECODER_BENCH_KDF
+DECODER_BENCH_MEM = $DECODER_BENCH_MEM
+DECODER_BENCH_KEY_CACHE = $DECODER_BENCH_KEY_CACHE
+DECODER_BENCH_EDDSA = $DECODER_BENCH_EDDSA
+DECODER_BENCH_ICACHE = $DECODER_BENCH_ICACHE
+DECODER_FAST_BOOT = $DECODER_FAST_BOOT
+DECODER_EXPANSION_BITS = $DECODER_EXPANSION_BITS
+DECODER_PROFILE = $DECODER_PROFILE
+DECODER_HOT_LAYOUT = $DECODER_HOT_LAYOUT
+DECODER_HOT_PROFILE = $DECODER_HOT_PROFILE
+DECODER_STACK_REPORT = $DECODER_STACK_REPORT
+DECODER_JOBS = $DECODER_JOBS
+DECODER_IDS = $DECODER_IDS
 
 CC = $CC
 AS = $AS
@@ -279,6 +742,14 @@ AFLAGS = ${AFLAGS[*]}
 
 LDFLAGS = ${LDFLAGS[*]}
 
+HOST_CC = $HOST_CC
+
+HOST_CFLAGS = ${HOST_CFLAGS[*]}
+
+HOST_LDFLAGS = ${HOST_LDFLAGS[*]}
+
+QEMU_CFLAGS = ${QEMU_CFLAGS[*]}
+
 EOF
     # print resolved incpath
     echo | "$CC" "${CFLAGS[@]}" -E -Wp,-v -
@@ -297,6 +768,10 @@ function check-format {
 
 case "$1" in
     build | all | '' ) build        ;;
+    host             ) host         ;;
+    test             ) host_test    ;;
+    qemu             ) qemu         ;;
+    fleet            ) fleet        ;;
     clean            ) clean        ;;
     format           ) format       ;;
     check-format     ) check-format ;;
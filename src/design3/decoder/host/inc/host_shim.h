@@ -0,0 +1,28 @@
+/**
+ * @file host_shim.h
+ * @brief Peripherals of the host build (build.sh host), simulated on Linux
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// IPO, the clock the board runs at, see src/hardware_init.c -> select_ipo()
+#define HOST_CORE_CLOCK 100000000
+
+void host_require(bool ok, const char* what);
+
+void host_delay_hook(void (*hook)(uint32_t us));
+
+void host_flash_init(const char* path);
+
+void host_flash_create(const char* path);
+
+void host_flash_power_cut(long ops, void (*cut)(void));
+
+long host_flash_erase_count(void);
+
+void host_uart_init(const char* link);
@@ -0,0 +1,22 @@
+/**
+ * @file max78000.h
+ * @brief Host build stand-in for the MSDK device header: the DWT cycle counter only
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+DWT_Type* host_dwt(void);
+
+// Every access reads the clock: CYCCNT counts SystemCoreClock cycles of host time
+#define DWT (host_dwt())
+
+extern uint32_t SystemCoreClock;
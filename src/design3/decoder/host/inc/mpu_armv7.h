@@ -0,0 +1,28 @@
+/**
+ * @file mpu_armv7.h
+ * @brief Host build stand-in for the CMSIS MPU functions, which do nothing
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define ARM_MPU_AP_PRIV 1U
+#define ARM_MPU_AP_PRO 5U
+#define ARM_MPU_ACCESS_ORDERED 0U, 1U, 0U, 0U
+
+#define ARM_MPU_REGION_SIZE_8KB 0x0CU
+#define ARM_MPU_REGION_SIZE_128KB 0x10U
+#define ARM_MPU_REGION_SIZE_512KB 0x12U
+#define ARM_MPU_REGION_SIZE_512MB 0x1CU
+
+#define MPU_BASE 0U
+
+#define ARM_MPU_RBAR(region, base) ((uint32_t)(base) | (uint32_t)(region))
+#define ARM_MPU_RASR(...) 0U
+
+#define ARM_MPU_SetRegion(rbar, rasr) ((void)(rbar), (void)(rasr))
+#define ARM_MPU_ClrRegion(rnr) ((void)(rnr))
+#define ARM_MPU_Enable(control) ((void)(control))
@@ -0,0 +1,12 @@
+/**
+ * @file mxc_delay.h
+ * @brief Host build stand-in for the MSDK delay, sleeps for real
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+int MXC_Delay(uint32_t us);
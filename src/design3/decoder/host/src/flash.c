@@ -0,0 +1,210 @@
+/**
+ * @file flash.c
+ * @brief Host build: flash is a file mapped read-only where the MAX78000 flash would be
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Reads go straight to the mapping. Erases and writes go through the file, which updates the
+ * mapping, and keep the flash semantics the journal and the lockout tally rely on: an erase sets a
+ * whole page to 0xFF and a write can only clear bits. The file outlives the process like flash
+ * outlives a reset.
+ *
+ * The host tests can cut the power in the middle of an erase or write, see host_flash_power_cut().
+ */
+
+#define _GNU_SOURCE
+
+#include "flash.h"
+
+#include "common.h"
+#include "host_shim.h"
+#include "util.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// match: ppp_common/host_flash.py
+#define FLASH_BASE 0x10000000
+#define FLASH_SIZE 0x00080000
+#define FLASH_PAGE_SIZE 0x2000
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+static int flash_fd = -1;
+
+static long ops_until_cut = -1;
+static void (*power_cut)(void) = NULL;
+static long erase_count = 0;
+
+/**
+ * @brief Maps the flash image, must run before flash is read
+ *
+ * @param path flash image made by build.sh host, FLASH_SIZE bytes
+ */
+void host_flash_init(const char* path) {
+    flash_fd = open(path, O_RDWR | O_CLOEXEC);
+    host_require(flash_fd >= 0, path);
+    host_require(lseek(flash_fd, 0, SEEK_END) == FLASH_SIZE, "flash image size");
+
+    void* flash = mmap((void*)FLASH_BASE, FLASH_SIZE, PROT_READ, MAP_SHARED | MAP_FIXED_NOREPLACE,
+                       flash_fd, 0);
+    host_require(flash == (void*)FLASH_BASE, "mmap flash image");
+}
+
+/**
+ * @brief Makes an erased flash image and maps it, for the host tests
+ *
+ * @param path flash image to (re)create
+ */
+void host_flash_create(const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    host_require(fd >= 0, path);
+
+    uint8_t erased[FLASH_PAGE_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    for (uint32_t offs = 0; offs < FLASH_SIZE; offs += sizeof(erased)) {
+        host_require(write(fd, erased, sizeof(erased)) == sizeof(erased), path);
+    }
+    close(fd);
+
+    host_flash_init(path);
+}
+
+/**
+ * @brief Cuts the power in the middle of a later erase or write, for the host tests
+ *
+ * The operation that is cut is done partially, random bits of the page erased or a random prefix
+ * of the data written along with some bits of the next byte, then cut() runs, which must not
+ * return (it longjmp()s to the "reset"). Randomness comes from random().
+ *
+ * @param ops number of erases and writes that complete before the one that is cut, negative for
+ * no cut
+ * @param cut called instead of completing the operation
+ */
+void host_flash_power_cut(long ops, void (*cut)(void)) {
+    ops_until_cut = ops;
+    power_cut = cut;
+}
+
+/**
+ * @brief Number of page erases so far, cut ones included
+ */
+long host_flash_erase_count(void) {
+    return erase_count;
+}
+
+/**
+ * @brief Counts down to the power cut
+ *
+ * @return true if this operation is the one that is cut
+ */
+static bool cut_now(void) {
+    if (ops_until_cut < 0) {
+        return false;
+    }
+    if (ops_until_cut > 0) {
+        ops_until_cut--;
+        return false;
+    }
+    ops_until_cut = -1;
+    return true;
+}
+
+/**
+ * @brief Checks that [address, address + length) is flash
+ */
+static bool in_flash(uint32_t address, uint32_t length) {
+    return address >= FLASH_BASE && length <= FLASH_SIZE &&
+           address - FLASH_BASE <= FLASH_SIZE - length;
+}
+
+/**
+ * @brief Erases a flash page
+ *
+ * @param address any address within the page
+ * @return OK if the page was erased, ERROR otherwise
+ */
+error_t flash_erase_page(uint32_t address) {
+    uint32_t page = address & ~(uint32_t)(FLASH_PAGE_SIZE - 1);
+    if (!in_flash(page, FLASH_PAGE_SIZE)) {
+        return ERROR;
+    }
+
+    uint8_t erased[FLASH_PAGE_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    erase_count++;
+
+    bool cut = cut_now();
+    if (cut) {
+        // some bits make it to 0xFF, the others keep what they held
+        memcpy(erased, (const void*)(size_t)page, sizeof(erased));
+        for (size_t i = 0; i < sizeof(erased); i++) {
+            erased[i] |= (uint8_t)random();
+        }
+    }
+
+    if (pwrite(flash_fd, erased, sizeof(erased), page - FLASH_BASE) != sizeof(erased)) {
+        return ERROR;
+    }
+    if (cut) {
+        power_cut();
+    }
+    return OK;
+}
+
+/**
+ * @brief Writes to erased flash
+ *
+ * @param address destination address
+ * @param length number of bytes to write
+ * @param data data to write
+ * @return OK if the data was written, ERROR otherwise
+ */
+error_t flash_write(uint32_t address, uint32_t length, const uint32_t* data) {
+    UTIL_ASSERT(data != NULL || length == 0);
+
+    if (!in_flash(address, length)) {
+        return ERROR;
+    }
+
+    bool cut = cut_now();
+    uint32_t full_length = length;
+    if (cut) {
+        // a prefix gets written, and some bits of the byte after it
+        length = (uint32_t)random() % (length + 1);
+    }
+
+    const uint8_t* src = (const uint8_t*)data;
+    const uint8_t* current = (const uint8_t*)(size_t)address;
+    uint8_t line[256];
+    for (uint32_t offs = 0; offs < length; offs += sizeof(line)) {
+        uint32_t n = length - offs;
+        if (n > sizeof(line)) {
+            n = sizeof(line);
+        }
+
+        // programming only clears bits
+        for (uint32_t i = 0; i < n; i++) {
+            line[i] = current[offs + i] & src[offs + i];
+        }
+        if (pwrite(flash_fd, line, n, address - FLASH_BASE + offs) != n) {
+            return ERROR;
+        }
+    }
+    if (cut) {
+        if (length < full_length) {
+            uint8_t partial = current[length] & (src[length] | (uint8_t)random());
+            host_require(pwrite(flash_fd, &partial, 1, address - FLASH_BASE + length) == 1,
+                         "flash write");
+        }
+        power_cut();
+    }
+    return OK;
+}
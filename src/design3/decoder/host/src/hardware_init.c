@@ -0,0 +1,114 @@
+/**
+ * @file hardware_init.c
+ * @brief Host build: sets up the simulated peripherals instead of the MAX78000's
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * The host build (build.sh host) runs the decoder as a Linux process. This file and the others in
+ * host/src take the place of the sources of the same name in src:
+ * - host_uart.c: the UART is a pty, linked to from $DECODER_UART (default ./uart)
+ * - flash.c: flash is the file $DECODER_FLASH (default ./flash.bin), made by build.sh host and
+ *   mapped where the MAX78000 flash is, so the pages keep the addresses of firmware.ld.template
+ * - rng.c: the TRNG is /dev/urandom
+ * - util.c: a halt stops the process instead of spinning
+ *
+ * Fault injection delays still spin, MXC_Delay() sleeps and the MPU is left alone.
+ */
+
+#define _GNU_SOURCE
+
+#include "hardware_init.h"
+
+#include "host_shim.h"
+#include "rng.h"
+
+#include <max78000.h>
+#include <mxc_delay.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+uint32_t SystemCoreClock;
+
+static void (*delay_hook)(uint32_t us) = NULL;
+
+/**
+ * @brief Exits the process if a peripheral could not be set up
+ *
+ * @param ok whether the setup step worked
+ * @param what what was being done, printed with errno
+ */
+void host_require(bool ok, const char* what) {
+    if (!ok) {
+        perror(what);
+        exit(1);
+    }
+}
+
+/**
+ * @brief Gets a setting from the environment
+ */
+static const char* setting(const char* name, const char* fallback) {
+    const char* value = getenv(name);
+    return (value != NULL && value[0] != '\0') ? value : fallback;
+}
+
+/**
+ * @brief Initializes the simulated peripherals
+ */
+void hardware_init(void) {
+    SystemCoreClock = HOST_CORE_CLOCK;
+
+    host_flash_init(setting("DECODER_FLASH", "flash.bin"));
+    host_uart_init(setting("DECODER_UART", "uart"));
+    rng_init();
+}
+
+/**
+ * @brief No PMIC to wait for, see src/hardware_init.c
+ */
+bool hardware_ready(void) { return true; }
+
+/**
+ * @brief Samples the cycle counter, see max78000.h -> DWT
+ *
+ * Host time in cycles of SystemCoreClock, so stage times compare with the board's in time though
+ * not in cycles.
+ */
+DWT_Type* host_dwt(void) {
+    static DWT_Type dwt;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t ns = (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+    dwt.CYCCNT = (uint32_t)(ns * (SystemCoreClock / 1000000) / 1000);
+    return &dwt;
+}
+
+/**
+ * @brief Makes MXC_Delay() call hook instead of sleeping, for the host tests
+ *
+ * @param hook called with the microseconds of every delay, NULL to sleep again
+ */
+void host_delay_hook(void (*hook)(uint32_t us)) {
+    delay_hook = hook;
+}
+
+/**
+ * @brief Sleeps, only the lockout waits with it once the board is up
+ *
+ * @param us microseconds to sleep for
+ * @return 0 (E_NO_ERROR)
+ */
+int MXC_Delay(uint32_t us) {
+    if (delay_hook != NULL) {
+        delay_hook(us);
+        return 0;
+    }
+
+    struct timespec delay = {.tv_sec = us / 1000000, .tv_nsec = (long)(us % 1000000) * 1000};
+    while (nanosleep(&delay, &delay) != 0) {}
+    return 0;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file host_uart.c
+ * @brief Host build: the UART is a pty, for the host tools to open like the board's serial port
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * The decoder holds the pty master. The pty's buffers take the place of the RX and TX rings, so
+ * bytes keep arriving while the decoder is busy.
+ */
+
+#define _GNU_SOURCE
+
+#include "host_uart.h"
+
+#include "host_shim.h"
+#include "util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+static int uart_fd = -1;
+
+/**
+ * @brief Opens the pty and links to it
+ *
+ * @param link path of a symlink to the pty, for the host tools' --port
+ */
+void host_uart_init(const char* link) {
+    uart_fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    host_require(uart_fd >= 0, "posix_openpt");
+    host_require(grantpt(uart_fd) == 0 && unlockpt(uart_fd) == 0, "unlockpt");
+
+    const char* name = ptsname(uart_fd);
+    host_require(name != NULL, "ptsname");
+
+    // kept open, so the master does not hang up whenever a host tool closes the port
+    int port_fd = open(name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    host_require(port_fd >= 0, name);
+
+    struct termios tio;
+    host_require(tcgetattr(port_fd, &tio) == 0, "tcgetattr");
+    cfmakeraw(&tio);
+    host_require(tcsetattr(port_fd, TCSANOW, &tio) == 0, "tcsetattr");
+
+    unlink(link);
+    host_require(symlink(name, link) == 0, link);
+    fprintf(stderr, "decoder: UART at %s -> %s\n", link, name);
+}
+
+/**
+ * @brief Write a byte to UART.
+ *
+ * @param data byte to write
+ */
+void uart_writebyte(uint8_t data) { uart_write(&data, 1); }
+
+/**
+ * @brief Read a byte from UART, blocking.
+ *
+ * @return byte read
+ */
+uint8_t uart_readbyte(void) {
+    uint8_t data;
+    uart_read(&data, 1);
+    return data;
+}
+
+/**
+ * @brief Write a block to UART, blocking only while the pty is full.
+ *
+ * @param buf bytes to write
+ * @param length number of bytes
+ */
+void uart_write(const uint8_t* buf, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(uart_fd, buf, length);
+        if (written < 0) {
+            UTIL_ASSERT(errno == EINTR);
+            continue;
+        }
+        buf += written;
+        length -= (size_t)written;
+    }
+}
+
+/**
+ * @brief Read a block from UART, blocking until all of it arrived.
+ *
+ * @param buf (out) bytes read
+ * @param length number of bytes
+ */
+void uart_read(uint8_t* buf, size_t length) {
+    while (length > 0) {
+        ssize_t read_len = read(uart_fd, buf, length);
+        if (read_len < 0) {
+            UTIL_ASSERT(errno == EINTR);
+            continue;
+        }
+        buf += read_len;
+        length -= (size_t)read_len;
+    }
+}
+
+/**
+ * @brief Checks whether a byte can be read from UART without blocking.
+ *
+ * @return true if uart_readbyte() would return immediately
+ */
+bool uart_readable(void) {
+    struct pollfd pfd = {.fd = uart_fd, .events = POLLIN};
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+/**
+ * @brief Number of bytes that can be read from UART without blocking.
+ */
+size_t uart_available(void) {
+    int available = 0;
+    UTIL_ASSERT(ioctl(uart_fd, FIONREAD, &available) == 0);
+    return (size_t)available;
+}
+
+/**
+ * @brief Wait until everything written so far has left.
+ *
+ * Writes to the pty are done once they return.
+ */
+void uart_flush(void) {}
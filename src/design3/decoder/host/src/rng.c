@@ -0,0 +1,66 @@
+/**
+ * @file rng.c
+ * @brief Host build: the TRNG is /dev/urandom, which needs no whitening
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#define _GNU_SOURCE
+
+#include "rng.h"
+
+#include "host_shim.h"
+#include "util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+static int urandom_fd = -1;
+
+void rng_init() {
+    urandom_fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    host_require(urandom_fd >= 0, "/dev/urandom");
+}
+
+/**
+ * @brief Fill a buffer with random data
+ *
+ * @param output buffer pointer
+ * @param length length of the output buffer in bytes
+ */
+void rng_get_unbiased_trng(uint8_t* output, size_t length) {
+    UTIL_ASSERT(output != NULL);
+
+    while (length > 0) {
+        ssize_t read_len = read(urandom_fd, output, length);
+        if (read_len < 0) {
+            UTIL_ASSERT(errno == EINTR);
+            continue;
+        }
+        output += read_len;
+        length -= (size_t)read_len;
+    }
+}
+
+uint16_t rng_get_u16() {
+    uint16_t result;
+    rng_get_unbiased_trng((uint8_t*)&result, sizeof(result));
+    return result;
+}
+
+/**
+ * @brief Get a random byte, which is always ready
+ *
+ * @param output (out) random byte
+ * @return true
+ */
+bool rng_poll_unbiased_trng(uint8_t* output) {
+    UTIL_ASSERT(output != NULL);
+
+    rng_get_unbiased_trng(output, 1);
+    return true;
+}
@@ -0,0 +1,22 @@
+/**
+ * @file sram.c
+ * @brief Host build: there is no SRAM_RW layout, the stack is the process's
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#include "sram.h"
+
+#include "util.h"
+
+#include <stddef.h>
+
+/**
+ * @brief Reports nothing but zeros, see src/sram.c for the board
+ *
+ * @param stats (out) SRAM_RW use
+ */
+void get_sram_stats(sram_stats_t* stats) {
+    UTIL_ASSERT(stats != NULL);
+    *stats = (sram_stats_t){0};
+}
@@ -0,0 +1,20 @@
+/**
+ * @file util.c
+ * @brief Host build: a halt stops the process where the board would spin
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#include "util.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+void do_spin_forever() {
+    // addr2line -e decoder <address> names the failed assertion
+    fprintf(stderr, "decoder: halted at %p\n", __builtin_return_address(0));
+    while (true) {
+        pause(); // like the board: no response, but no CPU spent on it
+    }
+    __builtin_unreachable();
+}
@@ -0,0 +1,353 @@
+"""
+@file eddsa_vectors.py
+@brief EdDSA signatures for host/test/test_eddsa.c (build.sh test)
+@author Plaid Parliament of Pwning
+@copyright Copyright (c) 2025 Carnegie Mellon University
+
+A plain Python model of eddsa_verify.c gives the expected result of every signature:
+the public key must decode (no x = 0 with the sign bit set), s must be below L, and
+the canonical encoding of [s]B - [h]A must equal R. Output lines:
+    h <public key> <signature> <h_ram> <expected>
+        for eddsa_verify_ctx_check(), h_ram already reduced: the RFC 8032 SHA-512
+        vectors and random equations
+    m <public key> <signature> <message> <expected> <cross-check>
+        for verify_asymmetric(), h_ram = BLAKE2b-512(R || A || M) mod L; the message is
+        "-" if empty. If cross-check is 1, crypto_eddsa_check() must agree.
+expected is 1 for a valid signature, 0 for an invalid one, and 2 for a public key that
+eddsa_verify_ctx_init() rejects.
+
+crypto_eddsa_check() decodes R itself and compares points, and has its own opinion on
+points with x = 0 and on non-canonical encodings, so those are only checked against the
+model. The encoder never signs with them.
+"""
+
+import argparse
+import hashlib
+import random
+from pathlib import Path
+
+P = 2**255 - 19
+L = 2**252 + 27742317777372353535851937790883648493
+D = -121665 * pow(121666, P - 2, P) % P
+SQRT_M1 = pow(2, (P - 1) // 4, P)
+IDENTITY = (0, 1)
+
+
+def add(a, b):
+    x1, y1 = a
+    x2, y2 = b
+    t = D * x1 * x2 * y1 * y2
+    x3 = (x1 * y2 + x2 * y1) * pow(1 + t, P - 2, P) % P
+    y3 = (y1 * y2 + x1 * x2) * pow(1 - t, P - 2, P) % P
+    return (x3, y3)
+
+
+def neg(a):
+    return ((P - a[0]) % P, a[1])
+
+
+def mul(k, a):
+    """In extended coordinates (X:Y:Z:T), one inversion at the end"""
+
+    def add_ext(p1, p2):
+        x1, y1, z1, t1 = p1
+        x2, y2, z2, t2 = p2
+        a_ = (y1 - x1) * (y2 - x2) % P
+        b = (y1 + x1) * (y2 + x2) % P
+        c = 2 * D * t1 * t2 % P
+        d = 2 * z1 * z2 % P
+        e, f, g, h = b - a_, d - c, d + c, b + a_
+        return (e * f % P, g * h % P, f * g % P, e * h % P)
+
+    r = (0, 1, 1, 0)
+    q = (a[0], a[1], 1, a[0] * a[1] % P)
+    while k:
+        if k & 1:
+            r = add_ext(r, q)
+        q = add_ext(q, q)
+        k >>= 1
+    z_inv = pow(r[2], P - 2, P)
+    return (r[0] * z_inv % P, r[1] * z_inv % P)
+
+
+def recover_x(y, sign):
+    """x of the point with this y and sign, None if there is none (or x = 0 with sign 1)"""
+    xx = (y * y - 1) * pow(D * y * y + 1, P - 2, P) % P
+    x = pow(xx, (P + 3) // 8, P)
+    if (x * x - xx) % P:
+        x = x * SQRT_M1 % P
+    if (x * x - xx) % P:
+        return None
+    if x == 0 and sign:
+        return None
+    if x % 2 != sign:
+        x = P - x
+    return x
+
+
+BASE = (recover_x(4 * pow(5, P - 2, P) % P, 0), 4 * pow(5, P - 2, P) % P)
+
+
+def encode(a):
+    return (a[1] | ((a[0] & 1) << 255)).to_bytes(32, "little")
+
+
+def decode(b):
+    """As ge_frombytes(): y is taken mod p, so non-canonical encodings decode"""
+    v = int.from_bytes(b, "little")
+    y = (v & (2**255 - 1)) % P
+    x = recover_x(y, v >> 255)
+    return None if x is None else (x, y)
+
+
+def non_canonical(a):
+    """The other encoding of a point with y < 19"""
+    assert a[1] < 2**255 - P
+    return (a[1] + P | ((a[0] & 1) << 255)).to_bytes(32, "little")
+
+
+def model_verify(public_key: bytes, signature: bytes, h: int) -> int:
+    a = decode(public_key)
+    if a is None:
+        return 2
+    s = int.from_bytes(signature[32:], "little")
+    if s >= L:
+        return 0
+    check = add(mul(s, BASE), neg(mul(h, a)))
+    return int(encode(check) == signature[:32])
+
+
+def order(a) -> int:
+    for n in (1, 2, 4, 8):
+        if mul(n, a) == IDENTITY:
+            return n
+    return 0
+
+
+def h_blake2b(r: bytes, public_key: bytes, message: bytes) -> int:
+    digest = hashlib.blake2b(r + public_key + message, digest_size=64).digest()
+    return int.from_bytes(digest, "little") % L
+
+
+def h_sha512(r: bytes, public_key: bytes, message: bytes) -> int:
+    return int.from_bytes(hashlib.sha512(r + public_key + message).digest(), "little") % L
+
+
+def scalar(b: int) -> bytes:
+    return b.to_bytes(32, "little")
+
+
+def flip(b: bytes, bit: int) -> bytes:
+    out = bytearray(b)
+    out[bit // 8] ^= 1 << (bit % 8)
+    return bytes(out)
+
+
+# RFC 8032 section 7.1, tests 1 to 3: secret key, public key, message, signature
+RFC8032 = [
+    (
+        "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+        "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+        "",
+        "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bac"
+        "c61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b",
+    ),
+    (
+        "4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+        "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+        "72",
+        "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da085ac1e43e15996e"
+        "458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00",
+    ),
+    (
+        "c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+        "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+        "af82",
+        "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac18ff9b538d16f290"
+        "ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a",
+    ),
+]
+
+
+class Vectors:
+    def __init__(self, seed: int):
+        self.rnd = random.Random(seed)
+        self.lines: list[str] = []
+        self.torsion = self.find_small_order()
+
+    def find_small_order(self) -> dict[int, list]:
+        """Points of order 1, 2, 4 and 8, the torsion subgroup"""
+        points: dict[int, list] = {1: [], 2: [], 4: [], 8: []}
+        y = 2
+        while len(points[8]) == 0:
+            a = decode(scalar(y))
+            y += 1
+            if a is not None:
+                t = mul(L, a)
+                if order(t) == 8:
+                    for k in range(8):
+                        points[order(mul(k, t))].append(mul(k, t))
+        return points
+
+    def h_line(self, public_key: bytes, signature: bytes, h: int, expected: int | None = None):
+        result = model_verify(public_key, signature, h)
+        assert expected is None or result == expected
+        self.lines.append(f"h {public_key.hex()} {signature.hex()} {scalar(h).hex()} {result}")
+
+    def m_line(self, public_key: bytes, signature: bytes, message: bytes, cross: bool,
+               expected: int | None = None):
+        result = model_verify(public_key, signature, h_blake2b(signature[:32], public_key, message))
+        assert expected is None or result == expected
+        self.lines.append(
+            f"m {public_key.hex()} {signature.hex()} {message.hex() or '-'} {result} {int(cross)}"
+        )
+
+    def key_pair(self):
+        a = self.rnd.randrange(1, L)
+        return a, encode(mul(a, BASE))
+
+    def sign(self, a: int, public_key: bytes, message: bytes) -> bytes:
+        r = self.rnd.randrange(1, L)
+        big_r = encode(mul(r, BASE))
+        s = (r + h_blake2b(big_r, public_key, message) * a) % L
+        return big_r + scalar(s)
+
+    def message(self) -> bytes:
+        return self.rnd.randbytes(self.rnd.randrange(0, 120))
+
+    def forge_small_order_key(self, a_point, k: int, public_key: bytes | None = None):
+        """s = 0 and R = -[k]A: valid when h = k mod the order of A, found by trying messages"""
+        public_key = public_key or encode(a_point)
+        big_r = encode(neg(mul(k, a_point)))
+        n = order(a_point)
+        while True:
+            message = self.message()
+            if h_blake2b(big_r, public_key, message) % n == k % n:
+                return big_r + scalar(0), message
+
+    def rfc8032(self):
+        for secret_key, public_key, message, signature in RFC8032:
+            digest = hashlib.sha512(bytes.fromhex(secret_key)).digest()
+            a = int.from_bytes(digest[:32], "little") & (2**254 - 8) | 2**254
+            pk = bytes.fromhex(public_key)
+            assert encode(mul(a, BASE)) == pk
+            sig = bytes.fromhex(signature)
+            h = h_sha512(sig[:32], pk, bytes.fromhex(message))
+
+            self.h_line(pk, sig, h, expected=1)
+            for bit in (0, 100, 255, 256, 300, 511):
+                self.h_line(pk, flip(sig, bit), h, expected=0)
+            self.h_line(pk, sig, (h + 1) % L, expected=0)
+            s = int.from_bytes(sig[32:], "little")
+            self.h_line(pk, sig[:32] + scalar(s + L), h, expected=0)
+
+    def random_equations(self, count: int):
+        for _ in range(count):
+            a, public_key = self.key_pair()
+            r = self.rnd.randrange(1, L)
+            h = self.rnd.randrange(0, L)
+            signature = encode(mul(r, BASE)) + scalar((r + h * a) % L)
+            self.h_line(public_key, signature, h, expected=1)
+            self.h_line(public_key, flip(signature, self.rnd.randrange(512)), h, expected=0)
+
+        # not on the curve
+        y = 2
+        while decode(scalar(y)) is not None:
+            y += 1
+        self.h_line(scalar(y), bytes(64), 0, expected=2)
+
+    def blake2b_signatures(self, count: int):
+        for _ in range(count):
+            a, public_key = self.key_pair()
+            message = self.message()
+            signature = self.sign(a, public_key, message)
+            self.m_line(public_key, signature, message, True, expected=1)
+
+            # flipped bits of R, s and the message
+            self.m_line(public_key, flip(signature, self.rnd.randrange(256)), message, True, 0)
+            self.m_line(public_key, flip(signature, self.rnd.randrange(256, 512)), message, True,
+                        0)
+            if message:
+                bit = self.rnd.randrange(8 * len(message))
+                self.m_line(public_key, signature, flip(message, bit), True, expected=0)
+
+            # non-canonical s, the same equation mod L
+            s = int.from_bytes(signature[32:], "little")
+            self.m_line(public_key, signature[:32] + scalar(s + L), message, True, expected=0)
+            if s + 2 * L < 2**256:
+                self.m_line(public_key, signature[:32] + scalar(s + 2 * L), message, True, 0)
+
+    def small_order(self):
+        t8 = self.torsion[8]
+
+        # small-order public keys: forged signatures with s = 0 and a small-order R
+        for a_point in t8 + self.torsion[4]:
+            for k in (1, 2, 3):
+                signature, message = self.forge_small_order_key(a_point, k)
+                r_point = neg(mul(k, a_point))
+                self.m_line(encode(a_point), signature, message, r_point[0] != 0, expected=1)
+                self.m_line(encode(a_point), signature, flip(message + b"\0", 0), r_point[0] != 0)
+
+        # a small-order R with an honest key
+        for r_point in t8 + self.torsion[4]:
+            a, public_key = self.key_pair()
+            message = self.message()
+            s = self.rnd.randrange(L)
+            self.m_line(public_key, encode(r_point) + scalar(s), message, True, expected=0)
+
+        # mixed-order public key A = [a]B + T: honestly signed for [a]B, the cofactorless
+        # equation holds only if h = 0 mod 8
+        held = 0
+        while held < 4:
+            a = self.rnd.randrange(1, L)
+            public_key = encode(add(mul(a, BASE), t8[0]))
+            message = self.message()
+            signature = self.sign(a, public_key, message)
+            h = h_blake2b(signature[:32], public_key, message)
+            self.m_line(public_key, signature, message, True, expected=int(h % 8 == 0))
+            held += h % 8 == 0
+
+        # keys and R with x = 0: identity and (0, -1)
+        for a_point in self.torsion[1] + self.torsion[2]:
+            signature, message = self.forge_small_order_key(a_point, 1)
+            self.m_line(encode(a_point), signature, message, False, expected=1)
+        minus_zero = flip(encode(IDENTITY), 255)
+        self.m_line(minus_zero, bytes(64), b"", False, expected=2)
+        a, public_key = self.key_pair()
+        self.m_line(public_key, encode(IDENTITY) + scalar(0), b"", False, expected=0)
+
+        # non-canonical encodings, y + p
+        for a_point in self.torsion[4]:
+            if a_point[1] < 2**255 - P:
+                public_key = non_canonical(a_point)
+                signature, message = self.forge_small_order_key(a_point, 2, public_key)
+                self.m_line(public_key, signature, message, False, expected=1)
+                for k in (1, 3):
+                    signature, message = self.forge_small_order_key(a_point, k)
+                    r_point = decode(signature[:32])
+                    if r_point[1] < 2**255 - P:
+                        signature = non_canonical(r_point) + signature[32:]
+                        self.m_line(encode(a_point), signature, message, False, expected=0)
+
+    def generate(self) -> str:
+        self.rfc8032()
+        self.random_equations(32)
+        self.blake2b_signatures(48)
+        self.small_order()
+        return "\n".join(self.lines) + "\n"
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Signatures for the EdDSA test")
+    parser.add_argument("vectors_file", type=Path, help="Vectors output")
+    parser.add_argument("--seed", type=int, default=1, help="Seed of the random signatures")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    args.vectors_file.write_text(Vectors(args.seed).generate())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,94 @@
+/**
+ * @file harness.c
+ * @brief Host tests (build.sh test): checks and setup shared by host/test/test_*.c
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#define _GNU_SOURCE
+
+#include "harness.h"
+
+#include "drbg.h"
+#include "fiproc.h"
+#include "rng.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* test_name = "test";
+static unsigned failed = 0;
+static unsigned checks = 0;
+
+/**
+ * @brief Replaces host/src/util.c: a halt fails the test
+ */
+void do_spin_forever() {
+    // addr2line -e <test> <address> names the failed assertion
+    fprintf(stderr, "%s: halted at %p\n", test_name, __builtin_return_address(0));
+    exit(1);
+}
+
+/**
+ * @brief Counts a check, see CHECK()
+ *
+ * @return ok
+ */
+bool test_check(bool ok, const char* what, const char* file, int line) {
+    checks++;
+    if (!ok) {
+        failed++;
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    }
+    return ok;
+}
+
+/**
+ * @brief Seeds random() from $TEST_SEED (default 1) and sets up the entropy that fiproc_delay()
+ * draws from, like boot does
+ *
+ * @param name name of the test in the output
+ */
+void test_init(const char* name) {
+    test_name = name;
+
+    const char* seed = getenv("TEST_SEED");
+    unsigned value = (seed != NULL && seed[0] != '\0') ? (unsigned)strtoul(seed, NULL, 0) : 1;
+    srandom(value);
+    printf("%s: seed %u\n", name, value);
+
+    rng_init();
+    drbg_init();
+    fiproc_update_pool();
+}
+
+/**
+ * @brief Reports the checks
+ *
+ * @return exit status of the test
+ */
+int test_finish(void) {
+    if (failed != 0) {
+        printf("%s: %u of %u checks failed\n", test_name, failed, checks);
+        return 1;
+    }
+    printf("%s: %u checks passed\n", test_name, checks);
+    return 0;
+}
+
+/**
+ * @brief Parses exactly len bytes of hex
+ *
+ * @return true if hex held exactly 2 * len hex digits
+ */
+bool test_parse_hex(uint8_t* out, size_t len, const char* hex) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1) {
+            return false;
+        }
+        out[i] = (uint8_t)byte;
+    }
+    return hex[2 * len] == '\0' || hex[2 * len] == '\n';
+}
@@ -0,0 +1,30 @@
+/**
+ * @file harness.h
+ * @brief Host tests (build.sh test): checks and setup shared by host/test/test_*.c
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Every test is a program of its own, linked with the objects of the host build except main.o
+ * and run from build/host/test. A test may include the source it tests to reach its static
+ * functions, the linker then leaves that source's object out. A halt (a failed UTIL_ASSERT) fails
+ * the test instead of pausing forever.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Counts a failed check, the test carries on. Evaluates to the condition.
+ */
+#define CHECK(cond) test_check((cond), #cond, __FILE__, __LINE__)
+
+bool test_check(bool ok, const char* what, const char* file, int line);
+
+void test_init(const char* name);
+
+int test_finish(void);
+
+bool test_parse_hex(uint8_t* out, size_t len, const char* hex);
@@ -0,0 +1,123 @@
+"""
+@file key_path_vectors.py
+@brief Frame keys of a decode scenario for host/test/test_key_path.c (build.sh test)
+@author Plaid Parliament of Pwning
+@copyright Copyright (c) 2025 Carnegie Mellon University
+
+Two channels are subscribed, frames come with increasing timestamps: runs at a small
+cadence, pairs of frames on both sides of subtree boundaries of every level, and the two
+channels taking turns. Channel a starts with a subscription that carries the keys of
+channel b's tree, and is replaced mid-stream by one over the same range with its own
+keys (so only the generation tells them apart), then by one over another range. Last,
+channel b gets a short subscription.
+
+The frame keys come from GlobalSecrets.derive_frame_key(), the packaged keys from
+derive_tree_key() over gen_subscription.vertices_for_range(). Output lines:
+    sub <channel> <start> <end> <key count>, followed by one line per packaged key
+    key <hex>
+    frame <channel> <timestamp> <hex frame key>
+"""
+
+from ppp_common.gen_secrets import GlobalSecrets
+from ppp_common.gen_subscription import vertices_for_range
+
+import argparse
+from pathlib import Path
+
+
+class Scenario:
+    def __init__(self, secrets: GlobalSecrets):
+        self.secrets = secrets
+        self.lines: list[str] = []
+        self.t = 0
+        self.tree_of: dict[int, int] = {}  # channel -> the tree its keys are of
+        self.range_of: dict[int, tuple[int, int]] = {}
+
+    def subscribe(self, ch: int, start: int, end: int, tree: int):
+        vertices = vertices_for_range(start, end, self.secrets.tree_arity_bits)
+        self.lines.append(f"sub {ch} {start} {end} {len(vertices)}")
+        for v in vertices:
+            self.lines.append(f"key {self.secrets.derive_tree_key(tree, v).hex()}")
+        self.tree_of[ch] = tree
+        self.range_of[ch] = (start, end)
+
+    def frame(self, ch: int, t: int):
+        assert t > self.t, "timestamps only increase"
+        start, end = self.range_of[ch]
+        assert start <= t <= end
+        self.t = t
+        key = self.secrets.derive_frame_key(self.tree_of[ch], t)
+        self.lines.append(f"frame {ch} {t} {key.hex()}")
+
+    def run(self, ch: int, count: int, cadence: int):
+        for _ in range(count):
+            self.frame(ch, self.t + cadence)
+
+    def boundaries(self, ch: int):
+        """Frames around the next boundary of every level, up to the subscription end"""
+        k = self.secrets.tree_arity_bits
+        for bits in range(k, 44, k):
+            boundary = ((self.t >> bits) + 1) << bits
+            for t in (boundary - 2, boundary - 1, boundary, boundary + 1):
+                if self.t < t <= self.range_of[ch][1]:
+                    self.frame(ch, t)
+
+    def turns(self, a: int, b: int, count: int, cadence: int):
+        for i in range(count):
+            self.frame(a if i % 2 == 0 else b, self.t + cadence)
+
+
+def gen_vectors(secrets: GlobalSecrets) -> str:
+    a, b = sorted(secrets.tree_root_keys)[:2]
+    s = Scenario(secrets)
+
+    # ranges that start and end mid-subtree, so the packaged keys sit on several levels
+    start = 0x0000_0123_4567_89AB
+    end = start + (1 << 46) + 12345
+    s.subscribe(a, start, end, tree=b)
+    s.subscribe(b, start - 1000, end + 1000, tree=b)
+
+    s.t = start - 1
+    s.run(a, 40, 1)
+    s.boundaries(a)
+    s.turns(a, b, 40, 7)
+    s.run(b, 20, 3)
+    s.boundaries(b)
+    s.run(a, 10, 1)
+
+    # same range and root vertices, now with channel a's own keys
+    s.subscribe(a, start, end, tree=a)
+    s.run(a, 20, 1)
+    s.turns(b, a, 20, 5)
+    s.boundaries(a)
+
+    # another range, another set of root vertices
+    s.subscribe(a, s.t + 1, s.t + (1 << 30) + 77, tree=a)
+    s.run(a, 20, 2)
+    s.turns(a, b, 40, 11)
+    s.boundaries(a)
+
+    # a short range, which the decoder expands close to the leaves
+    s.subscribe(b, s.t + 1, s.t + (1 << 24) + 99, tree=b)
+    s.run(b, 20, 1)
+    s.turns(a, b, 20, 3)
+    s.boundaries(b)
+
+    return "\n".join(s.lines) + "\n"
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Frame keys for the key path test")
+    parser.add_argument("secrets_file", type=Path, help="Global secrets file")
+    parser.add_argument("vectors_file", type=Path, help="Vectors output")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    secrets = GlobalSecrets.deserialize(args.secrets_file.read_bytes())
+    args.vectors_file.write_text(gen_vectors(secrets))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,253 @@
+/**
+ * @file test_eddsa.c
+ * @brief Signature checks against the Python model and crypto_eddsa_check() (build.sh test)
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Runs the signatures of eddsa_vectors.py (eddsa.txt): the RFC 8032 vectors and random
+ * equations through eddsa_verify_ctx_check() and the split check, BLAKE2b signatures through
+ * eddsa_verify_ctx_check(), verify_asymmetric() and a streamed check. The precomputed verifier is
+ * checked whether or not DECODER_EDDSA_PRECOMPUTED picks it for verify_asymmetric(). Then signs
+ * random messages with Monocypher and requires both to agree with crypto_eddsa_check() on them,
+ * on flipped bits and on non-canonical s.
+ */
+
+#include "harness.h"
+
+#include "crypto_wrappers.h"
+#include "eddsa_verify.h"
+#include "fiproc.h"
+#include "util.h"
+
+#include <monocypher.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_MESSAGE_LEN 256
+#define RANDOM_SIGNATURES 200
+
+// L, the order of the base point, little endian
+static const uint8_t ORDER[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10,
+};
+
+/**
+ * @brief Adds L to s, which is below L and so cannot overflow
+ */
+static void add_order(uint8_t s[32]) {
+    unsigned carry = 0;
+    for (size_t i = 0; i < 32; i++) {
+        carry += s[i] + ORDER[i];
+        s[i] = (uint8_t)carry;
+        carry >>= 8;
+    }
+}
+
+/**
+ * @brief h_ram = BLAKE2b-512(R || A || M) mod L
+ */
+static void hash_ram(uint8_t h_ram[32], const uint8_t* signature, const uint8_t* public_key,
+                     const uint8_t* message, size_t length) {
+    uint8_t hash[64];
+    crypto_blake2b_ctx hash_ctx;
+    crypto_blake2b_init(&hash_ctx, sizeof(hash));
+    crypto_blake2b_update(&hash_ctx, signature, 32);
+    crypto_blake2b_update(&hash_ctx, public_key, 32);
+    crypto_blake2b_update(&hash_ctx, message, length);
+    crypto_blake2b_final(&hash_ctx, hash);
+    crypto_eddsa_reduce(h_ram, hash);
+}
+
+/**
+ * @brief The split check, [s]B done in a random number of steps ahead of time
+ */
+static error_t split_check(const eddsa_verify_ctx_t* ctx, const uint8_t* signature,
+                           const uint8_t* h_ram) {
+    eddsa_verify_state_t state;
+    if (eddsa_verify_start(&state, signature + 32) != OK) {
+        return ERROR;
+    }
+    for (long steps = random() % 80; steps > 0 && !eddsa_verify_step(&state); steps--) {}
+    return eddsa_verify_finish(&state, ctx, signature, h_ram);
+}
+
+/**
+ * @brief A streamed check of signature || message, in random pieces with idle steps between them
+ */
+static error_t stream_check(const verify_ctx_t* ctx, const uint8_t* signature,
+                            const uint8_t* message, size_t length) {
+    uint8_t input[SIGNATURE_LEN + MAX_MESSAGE_LEN];
+    memcpy(input, signature, SIGNATURE_LEN);
+    memcpy(input + SIGNATURE_LEN, message, length);
+    length += SIGNATURE_LEN;
+
+    verify_stream_t stream;
+    verify_stream_init(&stream, ctx);
+    for (size_t done = 0; done < length;) {
+        size_t piece = 1 + (size_t)random() % 40;
+        piece = piece < length - done ? piece : length - done;
+        verify_stream_absorb(&stream, input + done, piece);
+        done += piece;
+        for (long idle = random() % 8; idle > 0; idle--) {
+            verify_stream_idle(&stream);
+        }
+    }
+    return verify_stream_final(&stream);
+}
+
+/**
+ * @brief Checks one signature with every verifier that applies
+ *
+ * @param expected 1 if valid, 0 if invalid, 2 if the public key does not decode
+ * @param cross whether crypto_eddsa_check() must agree with the precomputed verifier
+ * @return the result of the precomputed verifier, 2 if the public key does not decode
+ */
+static int check_signature(const uint8_t* public_key, const uint8_t* signature,
+                           const uint8_t* message, size_t length, int expected, bool cross) {
+    fiproc_update_pool();
+
+    static eddsa_verify_ctx_t tables;
+    int result = 2;
+    if (eddsa_verify_ctx_init(&tables, public_key) == OK) {
+        uint8_t h_ram[32];
+        hash_ram(h_ram, signature, public_key, message, length);
+        result = eddsa_verify_ctx_check(&tables, signature, h_ram) == OK;
+    }
+    if (expected >= 0) {
+        CHECK(result == expected);
+    }
+
+    int monocypher = crypto_eddsa_check(signature, public_key, message, length) == 0;
+    if (cross) {
+        CHECK((result == 1) == monocypher);
+    }
+
+    // what the decoder runs, the precomputed verifier or crypto_eddsa_check()
+    static verify_ctx_t ctx;
+    if (verify_ctx_init(&ctx, public_key) == OK) {
+        int built = verify_asymmetric(signature, message, length, &ctx) == OK;
+        CHECK(built == (stream_check(&ctx, signature, message, length) == OK));
+        CHECK(built == (EDDSA_PRECOMPUTED ? result : monocypher));
+    } else {
+        CHECK(EDDSA_PRECOMPUTED && result == 2);
+    }
+    return result;
+}
+
+/**
+ * @brief Checks an "h" or "m" line of eddsa.txt
+ *
+ * @return false if the line is malformed
+ */
+static bool check_vector(const char* line) {
+    char pk_hex[65], sig_hex[129], data_hex[2 * MAX_MESSAGE_LEN + 1];
+    int expected, cross, hex_start, hex_end;
+    uint8_t public_key[32], signature[SIGNATURE_LEN], data[MAX_MESSAGE_LEN];
+
+    if (sscanf(line, "h %64s %128s %64s %d", pk_hex, sig_hex, data_hex, &expected) == 4) {
+        if (!test_parse_hex(public_key, sizeof(public_key), pk_hex) ||
+            !test_parse_hex(signature, sizeof(signature), sig_hex) ||
+            !test_parse_hex(data, 32, data_hex)) {
+            return false;
+        }
+
+        static eddsa_verify_ctx_t ctx;
+        int result = 2;
+        if (eddsa_verify_ctx_init(&ctx, public_key) == OK) {
+            result = eddsa_verify_ctx_check(&ctx, signature, data) == OK;
+            CHECK(result == (split_check(&ctx, signature, data) == OK));
+        }
+        CHECK(result == expected);
+        return true;
+    }
+
+    if (sscanf(line, "m %64s %128s %n%512s%n %d %d", pk_hex, sig_hex, &hex_start, data_hex,
+               &hex_end, &expected, &cross) == 5) {
+        size_t length = data_hex[0] == '-' ? 0 : (size_t)(hex_end - hex_start) / 2;
+        if (!test_parse_hex(public_key, sizeof(public_key), pk_hex) ||
+            !test_parse_hex(signature, sizeof(signature), sig_hex) ||
+            (length > 0 && !test_parse_hex(data, length, data_hex))) {
+            return false;
+        }
+
+        check_signature(public_key, signature, data, length, expected, cross != 0);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Signs a random message with Monocypher and checks it, then a mutation of it
+ *
+ * @return true if the unmodified signature was accepted by both
+ */
+static bool check_random_signature(void) {
+    uint8_t seed[32], secret_key[64], public_key[32];
+    for (size_t i = 0; i < sizeof(seed); i++) {
+        seed[i] = (uint8_t)random();
+    }
+    crypto_eddsa_key_pair(secret_key, public_key, seed);
+
+    uint8_t message[MAX_MESSAGE_LEN];
+    size_t length = (size_t)random() % (MAX_MESSAGE_LEN + 1);
+    for (size_t i = 0; i < length; i++) {
+        message[i] = (uint8_t)random();
+    }
+
+    uint8_t signature[SIGNATURE_LEN];
+    crypto_eddsa_sign(signature, secret_key, message, length);
+    bool valid = check_signature(public_key, signature, message, length, 1, true) == 1;
+
+    long mutation = random() % 4;
+    if (mutation == 1 && length == 0) {
+        mutation = 0;
+    }
+    switch (mutation) {
+    case 0: // a bit of R or s
+        signature[random() % SIGNATURE_LEN] ^= (uint8_t)(1 << (random() % 8));
+        break;
+    case 1: // a bit of the message
+        message[(size_t)random() % length] ^= (uint8_t)(1 << (random() % 8));
+        break;
+    case 2: // a bit of the public key, which then often does not decode
+        public_key[random() % sizeof(public_key)] ^= (uint8_t)(1 << (random() % 8));
+        break;
+    default: // s + L, the same equation
+        add_order(signature + 32);
+        break;
+    }
+    // the model does not know these, but none of them may be accepted
+    CHECK(check_signature(public_key, signature, message, length, -1, true) != 1);
+    return valid;
+}
+
+int main(void) {
+    test_init("eddsa");
+
+    FILE* vectors = fopen("eddsa.txt", "r");
+    UTIL_ASSERT(vectors != NULL);
+
+    char line[1024];
+    size_t count = 0;
+    while (fgets(line, sizeof(line), vectors) != NULL) {
+        if (!CHECK(check_vector(line))) {
+            fprintf(stderr, "  %s", line);
+        }
+        count++;
+    }
+    fclose(vectors);
+    printf("eddsa: %zu vectors\n", count);
+    CHECK(count > 0);
+
+    size_t valid = 0;
+    for (size_t i = 0; i < RANDOM_SIGNATURES; i++) {
+        valid += check_random_signature();
+    }
+    printf("eddsa: %zu of %d random signatures valid\n", valid, RANDOM_SIGNATURES);
+    CHECK(valid == RANDOM_SIGNATURES);
+
+    return test_finish();
+}
@@ -0,0 +1,229 @@
+/**
+ * @file test_journal.c
+ * @brief Subscription journal against power cuts on the file-backed flash (build.sh test)
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Stores random subscriptions of more channels than the journal has room for, through
+ * write_subscription(), and cuts the power in the middle of a random share of them: mid-append,
+ * mid-compaction, and again while journal_init() recovers. After every step the SRAM subscription
+ * index, replayed from flash, must hold the latest subscription of every channel, or for the
+ * subscription that was being written either its old or its new version. The ring has to wrap
+ * several times.
+ */
+
+#include "harness.h"
+
+#include "../../src/journal.c"
+#include "../../src/subscription.c"
+
+#include "host_shim.h"
+
+#include <inttypes.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_CHANNELS (JOURNAL_MAX_LIVE + 4) // channels 1 to TEST_CHANNELS
+#define TEST_STEPS 3000
+
+typedef struct {
+    bool valid;
+    uint32_t generation; // 0 until seen in the index
+    timestamp_t start;
+    timestamp_t end;
+    uint32_t key_count;
+    uint8_t kch[SYMMETRIC_KEY_LEN];
+    uint8_t ktree[MAX_TREE_KEYS][TREE_KEY_LEN];
+} model_t;
+
+static model_t model[TEST_CHANNELS + 1];
+static jmp_buf reset;
+
+static void power_cut(void) {
+    longjmp(reset, 1);
+}
+
+static void random_bytes(uint8_t* out, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        out[i] = (uint8_t)random();
+    }
+}
+
+/**
+ * @brief Power cut after a random number of flash operations, or none
+ *
+ * @param one_in chance of a cut
+ * @param max_ops most operations before the cut
+ */
+static void maybe_cut(long one_in, long max_ops) {
+    host_flash_power_cut(random() % one_in == 0 ? random() % max_ops : -1, power_cut);
+}
+
+/**
+ * @brief What subscription_init() does, but for channel 0 and the key expansion
+ */
+static void replay_index(void) {
+    journal_init();
+    index_journal();
+}
+
+/**
+ * @brief Boots until journal_init() gets through without a power cut
+ *
+ * @return number of cuts during recovery
+ */
+static unsigned reboot(void) {
+    volatile unsigned cuts = 0; // kept across longjmp()
+    maybe_cut(2, 6);
+    if (setjmp(reset) != 0) {
+        cuts++;
+        maybe_cut(2, 6);
+    }
+    replay_index();
+    host_flash_power_cut(-1, NULL);
+    return cuts;
+}
+
+static bool matches(const subscription_info_t* info, const model_t* m) {
+    return info->start == m->start && info->end == m->end && info->key_count == m->key_count &&
+           memcmp(info->kch, m->kch, sizeof(m->kch)) == 0 &&
+           memcmp(info->ktree, m->ktree, m->key_count * TREE_KEY_LEN) == 0;
+}
+
+/**
+ * @brief Checks the index against the model
+ *
+ * @param pending channel of a subscription that may or may not have been stored, 0 for none
+ * @param new_sub that subscription
+ */
+static void check_index(channel_t pending, const model_t* new_sub) {
+    size_t stored = 0;
+    for (channel_t ch = 1; ch <= TEST_CHANNELS; ch++) {
+        const subscription_info_t* info = get_subscription_by_channel(ch);
+        model_t* m = &model[ch];
+
+        if (ch == pending && info != NULL && matches(info, new_sub)) {
+            // the write made it, and replaced whatever was there
+            CHECK(!m->valid || info->generation > m->generation);
+            *m = *new_sub;
+        } else if (!CHECK(m->valid == (info != NULL))) {
+            fprintf(stderr, "  channel %u\n", ch);
+            continue;
+        } else if (info == NULL) {
+            continue;
+        } else if (!CHECK(matches(info, m))) {
+            fprintf(stderr, "  channel %u\n", ch);
+        }
+
+        // the generation of a subscription survives compaction and replay
+        if (m->generation == 0) {
+            m->generation = info->generation;
+        }
+        CHECK(info->generation == m->generation);
+        stored++;
+    }
+    CHECK(stored <= JOURNAL_MAX_LIVE);
+}
+
+static size_t stored_count(void) {
+    size_t count = 0;
+    for (channel_t ch = 1; ch <= TEST_CHANNELS; ch++) {
+        count += model[ch].valid;
+    }
+    return count;
+}
+
+int main(void) {
+    test_init("journal");
+    host_flash_create("journal_flash.bin");
+
+    // left over from an older layout: garbage in some of the pages
+    for (size_t page = 0; page < JOURNAL_PAGES; page += 3) {
+        static uint32_t garbage[JOURNAL_PAGE_SIZE / sizeof(uint32_t)];
+        random_bytes((uint8_t*)garbage, sizeof(garbage));
+        flash_write((uint32_t)(size_t)page_addr(page), sizeof(garbage), garbage);
+    }
+    replay_index();
+    check_index(0, NULL);
+
+    unsigned appends = 0, full = 0, append_cuts = 0, compaction_cuts = 0, init_cuts = 0;
+    for (size_t step = 0; step < TEST_STEPS; step++) {
+        static model_t new_sub;
+        // most renewals are of two channels, the records of the others go stale and are moved by
+        // compaction
+        channel_t ch = 1 + (channel_t)random() % (random() % 10 == 0 ? TEST_CHANNELS : 2);
+        new_sub = (model_t){
+            .valid = true,
+            .start = (timestamp_t)random(),
+            .key_count = 1 + (uint32_t)random() % MAX_TREE_KEYS,
+        };
+        new_sub.end = new_sub.start + (timestamp_t)random();
+        random_bytes(new_sub.kch, sizeof(new_sub.kch));
+        random_bytes(new_sub.ktree[0], new_sub.key_count * TREE_KEY_LEN);
+
+        static valid_subscription_v2_t sub;
+        sub = (valid_subscription_v2_t){
+            .start = new_sub.start,
+            .end = new_sub.end,
+            .channel = ch,
+            .key_count = new_sub.key_count,
+        };
+        memcpy(sub.kch, new_sub.kch, sizeof(sub.kch));
+
+        bool expect_full = !model[ch].valid && stored_count() >= JOURNAL_MAX_LIVE;
+        uint32_t seq_before = head_seq;
+
+        // cuts are more likely when the append opens a page and compacts the page after it
+        uint32_t length = MIN_RECORD_LEN + sizeof(subscription_record_t) +
+                          new_sub.key_count * TREE_KEY_LEN;
+        if (head_offset + length > JOURNAL_PAGE_SIZE) {
+            maybe_cut(2, 24);
+        } else {
+            maybe_cut(4, 12);
+        }
+        if (setjmp(reset) == 0) {
+            error_t result = write_subscription(&sub, new_sub.ktree[0]);
+            host_flash_power_cut(-1, NULL);
+
+            CHECK(result == (expect_full ? ERROR : OK));
+            if (result == OK) {
+                appends++;
+                check_index(ch, &new_sub);
+                CHECK(model[ch].valid && matches(get_subscription_by_channel(ch), &new_sub));
+            } else {
+                full++;
+                check_index(0, NULL);
+            }
+
+            if (random() % 5 == 0) {
+                replay_index();
+                check_index(0, NULL);
+            }
+        } else {
+            // the head moved on before the cut, so the cut hit the compaction or the append after
+            // it; journal_init() erases the head again if the compaction was not done
+            long erases_before = host_flash_erase_count();
+            bool moved = head_seq != seq_before;
+            init_cuts += reboot();
+            if (!moved) {
+                append_cuts++;
+            } else if (host_flash_erase_count() > erases_before) {
+                compaction_cuts++;
+            }
+            check_index(expect_full ? 0 : ch, &new_sub);
+        }
+    }
+
+    printf("journal: %u appends, %u refused, %u cuts mid-append, %u mid-compaction, %u during "
+           "recovery, %ld erases, %" PRIu32 " pages opened\n",
+           appends, full, append_cuts, compaction_cuts, init_cuts, host_flash_erase_count(),
+           head_seq);
+    CHECK(full > 0);
+    CHECK(append_cuts > 0);
+    CHECK(compaction_cuts > 0);
+    CHECK(init_cuts > 0);
+    CHECK(head_seq > 2 * JOURNAL_PAGES); // the ring wrapped
+
+    return test_finish();
+}
@@ -0,0 +1,187 @@
+/**
+ * @file test_key_path.c
+ * @brief Frame keys from the cached key path against the Python key tree (build.sh test)
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Replays the scenario of key_path_vectors.py (key_path.txt): every frame key is derived the way
+ * decode_verified() derives it, through the channel's key path cache, and compared with the leaf
+ * key of the Python key tree. decode_prefetch() runs before every other frame, so keys come from
+ * prefetches, mispredicted prefetches and the cached path. kdf_tree_child() is counted to show that
+ * the cache saves derivations. Every subscription is expanded into the file-backed flash
+ * (key_expansion_build()) once its keys are in, and the derivations a frame needs without the
+ * cache are counted from the expanded vertex and from the packaged one. The subscriptions are the
+ * test's own, get_subscription_by_channel() is redirected to them.
+ */
+
+#include "harness.h"
+
+#include "crypto_wrappers.h"
+#include "subscription.h"
+
+static void counted_tree_child(uint8_t* key_out, const uint8_t* parent, uint32_t child);
+static const subscription_info_t* test_subscription(channel_t ch);
+#define kdf_tree_child counted_tree_child
+#define get_subscription_by_channel test_subscription
+#include "../../src/frame.c"
+#include "../../src/key_expansion.c"
+#undef get_subscription_by_channel
+#undef kdf_tree_child
+
+#include "host_shim.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_CHANNELS 2
+
+static subscription_info_t subs[TEST_CHANNELS];
+static uint8_t ktrees[TEST_CHANNELS][MAX_TREE_KEYS][TREE_KEY_LEN];
+static uint32_t generation = 0;
+static size_t children_derived = 0;
+static size_t from_packaged = 0; // child derivations without the cache or the expansion
+static size_t most_from_packaged = 0;
+static size_t most_uncached = 0; // per frame, without the cache
+
+static void counted_tree_child(uint8_t* key_out, const uint8_t* parent, uint32_t child) {
+    children_derived++;
+    kdf_tree_child(key_out, parent, child);
+}
+
+static const subscription_info_t* test_subscription(channel_t ch) {
+    for (size_t i = 0; i < TEST_CHANNELS; i++) {
+        if (subs[i].valid && subs[i].channel == ch) {
+            return &subs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Stores a subscription, replacing the one of its channel like update_subscription()
+ */
+static subscription_info_t* subscribe(channel_t ch) {
+    subscription_info_t* sub = (subscription_info_t*)test_subscription(ch);
+    for (size_t i = 0; sub == NULL && i < TEST_CHANNELS; i++) {
+        if (!subs[i].valid) {
+            sub = &subs[i];
+        }
+    }
+    UTIL_ASSERT(sub != NULL);
+
+    sub->valid = true;
+    sub->ktree = ktrees[sub - subs][0];
+    sub->channel = ch;
+    sub->generation = ++generation;
+    return sub;
+}
+
+/**
+ * @brief The key part of decode_verified()
+ *
+ * @return number of child derivations without the cache
+ */
+static size_t frame_key(const subscription_info_t* sub, timestamp_t t, uint8_t* key) {
+    UTIL_ASSERT(sub != NULL);
+    fiproc_update_pool();
+
+    vertex_t v = {};
+    size_t index = key_index_for_time(sub, t, &v);
+    UTIL_ASSERT(index != SIZE_MAX);
+    size_t packaged = (MAX_TREE_HEIGHT - v.bits) / TREE_ARITY_BITS;
+    from_packaged += packaged;
+    most_from_packaged = packaged > most_from_packaged ? packaged : most_from_packaged;
+    const uint8_t* root_key = root_key_for_time(sub, t, index, &v);
+    size_t uncached = (MAX_TREE_HEIGHT - v.bits) / TREE_ARITY_BITS;
+    most_uncached = uncached > most_uncached ? uncached : most_uncached;
+
+    key_path_cache_t* cache = get_key_path_cache(sub->channel);
+    bool had_leaf_key = cache->leaf_key_valid;
+    bool hit = derive_tree_key(cache, t, sub, root_key, &v, key);
+    count_derivation(hit, had_leaf_key && !hit, 0);
+
+    received_first_frame = true;
+    current_timestamp = t;
+    track_cadence(cache, t);
+    return uncached;
+}
+
+int main(void) {
+    test_init("key_path");
+    host_flash_create("key_path_flash.bin");
+    key_expansion_init();
+
+    FILE* vectors = fopen("key_path.txt", "r");
+    UTIL_ASSERT(vectors != NULL);
+
+    char line[128];
+    size_t frames = 0;
+    size_t uncached = 0;
+    size_t expansion_derived = 0;
+    subscription_info_t* sub = NULL;
+    size_t keys_read = 0;
+    while (fgets(line, sizeof(line), vectors) != NULL) {
+        channel_t ch;
+        timestamp_t start, end, t;
+        uint32_t key_count;
+        char hex[2 * SYMMETRIC_KEY_LEN + 2];
+
+        if (sscanf(line, "sub %" SCNu32 " %" SCNu64 " %" SCNu64 " %" SCNu32, &ch, &start, &end,
+                   &key_count) == 4) {
+            UTIL_ASSERT(sub == NULL || keys_read == sub->key_count);
+            UTIL_ASSERT(key_count <= MAX_TREE_KEYS);
+            sub = subscribe(ch);
+            sub->start = start;
+            sub->end = end;
+            sub->key_count = key_count;
+            keys_read = 0;
+        } else if (sscanf(line, "key %33s", hex) == 1) {
+            UTIL_ASSERT(sub != NULL && keys_read < sub->key_count);
+            uint8_t* key = (uint8_t*)get_subscription_tree_key(sub, keys_read++);
+            UTIL_ASSERT(test_parse_hex(key, TREE_KEY_LEN, hex));
+            if (keys_read == sub->key_count) {
+                size_t before = children_derived;
+                key_expansion_build(sub);
+                expansion_derived += children_derived - before;
+            }
+        } else if (sscanf(line, "frame %" SCNu32 " %" SCNu64 " %65s", &ch, &t, hex) == 3) {
+            uint8_t expected[SYMMETRIC_KEY_LEN];
+            UTIL_ASSERT(test_parse_hex(expected, sizeof(expected), hex));
+
+            // every other frame finds its key prefetched, if the cadence held
+            if (frames % 2 == 1) {
+                for (size_t i = 0; i < MAX_CHANNEL_COUNT; i++) {
+                    decode_prefetch();
+                }
+            }
+
+            uint8_t key[SYMMETRIC_KEY_LEN];
+            uncached += frame_key(test_subscription(ch), t, key);
+            if (!CHECK(memcmp(key, expected, sizeof(key)) == 0)) {
+                fprintf(stderr, "  %s", line);
+            }
+            frames++;
+        } else {
+            UTIL_ASSERT(false);
+        }
+    }
+    fclose(vectors);
+
+    prefetch_stats_t stats;
+    get_prefetch_stats(&stats);
+    printf("key_path: %zu frames, %" PRIu32 " prefetched, %" PRIu32 " mispredicted, %" PRIu32
+           " derived, %zu child keys derived, %zu without the cache\n",
+           frames, stats.hits, stats.misses, stats.unpredicted, children_derived, uncached);
+    printf("key_path: without the cache, %zu child derivations (at most %zu per frame) from the "
+           "packaged keys, %zu (at most %zu) after %zu for the expansion\n",
+           from_packaged, most_from_packaged, uncached, most_uncached, expansion_derived);
+    CHECK(frames > 0);
+    CHECK(stats.hits > 0);
+    CHECK(stats.misses > 0);
+    CHECK(stats.unpredicted > 0);
+    CHECK((children_derived - expansion_derived) * 2 < uncached);
+    CHECK(EXPANSION_FRAME_BITS == MAX_TREE_HEIGHT || uncached < from_packaged);
+
+    return test_finish();
+}
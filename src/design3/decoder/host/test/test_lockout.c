@@ -0,0 +1,191 @@
+/**
+ * @file test_lockout.c
+ * @brief Lockout tally against power cuts on the file-backed flash (build.sh test)
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Runs attack_detected() many times and cuts the power at random flash operations, then boots
+ * through lockout_process() (with more cuts) until a boot gets through. MXC_Delay() is hooked to
+ * count the periods instead of sleeping. Once the session is armed, no sequence of resets may get
+ * away with less than the full lockout, and after it the page has to hold the tally encoding:
+ * header, the arm lines of the used sessions, cleared tally lines, erased lines after them. Cuts
+ * during format_armed() show that the arm line is written before the header.
+ */
+
+#include "harness.h"
+
+#include "../../src/lockout.c"
+
+#include "host_shim.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_LOCKOUTS 500
+#define FORMAT_TRIALS 200 // per flash operation of format_armed()
+
+static jmp_buf reset;
+static unsigned periods; // delays since the attack
+
+static void power_cut(void) {
+    longjmp(reset, 1);
+}
+
+static void count_period(uint32_t us) {
+    CHECK(us == LOCKOUT_PD_US);
+    periods++;
+}
+
+/**
+ * @brief Boots until lockout_process() gets through, with a power cut in a random share of boots
+ *
+ * @param one_in chance of a cut, 0 for none
+ * @return number of cuts
+ */
+static unsigned boot(long one_in) {
+    volatile unsigned cuts = 0; // kept across longjmp()
+    if (setjmp(reset) != 0) {
+        cuts++;
+    }
+    host_flash_power_cut(one_in != 0 && random() % one_in == 0 ? random() % 70 : -1, power_cut);
+    lockout_process();
+    host_flash_power_cut(-1, NULL);
+    return cuts;
+}
+
+/**
+ * @brief Checks the page against the tally encoding, once no lockout is left
+ *
+ * @param exact whether every line has to be exactly as written, i.e. nothing was torn
+ * @return number of armed sessions
+ */
+static size_t check_encoding(bool exact) {
+    size_t session = 0;
+    CHECK(lockout_scan(&session) == 0);
+    CHECK(line_is(&lockout_state[0], FORMAT_MAGIC));
+
+    size_t armed = 0;
+    for (size_t s = 0; s < LOCKOUT_SESSIONS; s++) {
+        if (line_erased(arm_line(s))) {
+            break;
+        }
+        CHECK(line_is(arm_line(s), ARM_MAGIC));
+        for (size_t p = 0; p < LOCKOUT_TIME_PD; p++) {
+            const lockout_line_t* tally = tally_line(s, p);
+            static const lockout_line_t cleared = {0};
+            CHECK(exact ? memcmp(tally, &cleared, sizeof(cleared)) == 0 : !line_erased(tally));
+        }
+        armed++;
+    }
+    CHECK(session == armed);
+
+    // nothing after the last armed session
+    for (size_t i = 1 + armed * LOCKOUT_SESSION_LINES; i < LOCKOUT_LINES; i++) {
+        if (!CHECK(line_erased(&lockout_state[i]))) {
+            fprintf(stderr, "  line %zu\n", i);
+            break;
+        }
+    }
+    return armed;
+}
+
+/**
+ * @brief Runs an attack, with a power cut at a flash operation
+ *
+ * @param cut_at flash operation to cut at, -1 for none
+ * @return whether the power was cut
+ */
+static bool attack(long cut_at) {
+    host_flash_power_cut(cut_at, power_cut);
+    if (setjmp(reset) == 0) {
+        attack_detected();
+        host_flash_power_cut(-1, NULL);
+        return false;
+    }
+    return true;
+}
+
+int main(void) {
+    test_init("lockout");
+    host_delay_hook(count_period);
+    host_flash_create("lockout_flash.bin");
+
+    // an erased page is not a formatted one: full lockout, then none
+    periods = 0;
+    boot(0);
+    CHECK(periods == LOCKOUT_TIME_PD);
+    CHECK(check_encoding(true) == 1);
+    periods = 0;
+    boot(0);
+    CHECK(periods == 0);
+
+    unsigned cuts = 0;
+    long erases_before = host_flash_erase_count();
+    size_t armed = 1;
+    bool page_torn = false; // since it was last formatted
+    for (size_t i = 0; i < TEST_LOCKOUTS; i++) {
+        long formats_before = host_flash_erase_count();
+        long cut_at = random() % 3 == 0 ? random() % 70 : -1;
+        periods = 0;
+        unsigned lockout_cuts = attack(cut_at);
+        lockout_cuts += boot(4);
+        cuts += lockout_cuts;
+
+        // the first flash operation arms the session, a cut before it can get away with no
+        // lockout at all
+        bool got_armed = cut_at != 0;
+        if (!CHECK(periods >= LOCKOUT_TIME_PD || (!got_armed && periods == 0))) {
+            fprintf(stderr, "  lockout %zu: %u periods, cut at %ld\n", i, periods, cut_at);
+        }
+        if (lockout_cuts == 0) {
+            CHECK(periods == LOCKOUT_TIME_PD);
+        }
+
+        // one more session on the page, or a fresh page
+        bool formatted = host_flash_erase_count() != formats_before;
+        page_torn = (page_torn && !formatted) || lockout_cuts > 0;
+        size_t now_armed = check_encoding(!page_torn);
+        if (!formatted) {
+            CHECK(now_armed == armed + (periods > 0));
+        } else {
+            CHECK(now_armed == 1);
+        }
+        armed = now_armed;
+
+        periods = 0;
+        boot(0);
+        CHECK(periods == 0);
+    }
+    long erases = host_flash_erase_count() - erases_before;
+
+    // fill the page, then cut at each operation of format_armed(): erase, arm line, header. Were
+    // the header written first, a cut with the arm line still erased would leave no lockout
+    unsigned format_cuts = 0;
+    for (long op = 0; op < 3; op++) {
+        for (size_t i = 0; i < FORMAT_TRIALS; i++) {
+            while (armed < LOCKOUT_SESSIONS) {
+                attack(-1);
+                armed = check_encoding(!page_torn);
+            }
+            periods = 0;
+            attack(op);
+            boot(0);
+            if (!CHECK(periods == LOCKOUT_TIME_PD)) {
+                fprintf(stderr, "  cut at operation %ld: %u periods\n", op, periods);
+            }
+            page_torn = false;
+            armed = check_encoding(true);
+            format_cuts++;
+        }
+    }
+
+    printf("lockout: %d lockouts, %u with cuts, %ld erases, %u cuts in format_armed()\n",
+           TEST_LOCKOUTS, cuts, erases, format_cuts);
+    CHECK(cuts > 0);
+    // an erase per page of sessions, and one per lockout that found the page torn
+    CHECK(erases * 2 < TEST_LOCKOUTS);
+
+    return test_finish();
+}
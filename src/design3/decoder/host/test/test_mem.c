@@ -0,0 +1,129 @@
+/**
+ * @file test_mem.c
+ * @brief Memory routines of libdesign3.c against byte by byte results (build.sh test)
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * The word routines have a head, a block loop, a word loop and a tail, so they run over every
+ * alignment of both pointers and every length up to a few blocks, plus the longest frame buffer.
+ * The results are compared with byte loops, and the guard bytes on both sides of the destination
+ * must be untouched. The host build takes the C fallback of the block loops, not LDM/STM.
+ */
+
+#include "harness.h"
+
+#include "../../src/libdesign3.c"
+
+#include <stdio.h>
+
+#define CHECK_OFFSETS 8
+#define CHECK_MAX_LEN 70 // four blocks and change
+#define LONG_LEN 2080    // a frame buffer
+#define GUARD_LEN 8
+#define GUARD 0xa5
+#define BUF_LEN (LONG_LEN + CHECK_OFFSETS + GUARD_LEN)
+
+[[gnu::aligned(8)]] static uint8_t buf_a[BUF_LEN];
+[[gnu::aligned(8)]] static uint8_t buf_b[BUF_LEN];
+
+/**
+ * @brief Fills a buffer with a pattern that differs at every offset and per seed
+ */
+static void fill_pattern(uint8_t* buf, size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buf[i] = (uint8_t)(seed >> 24);
+    }
+}
+
+/**
+ * @brief Checks that buf[off, off + len) holds expected (or the byte c if expected is NULL) and
+ * that the GUARD bytes on both sides are untouched
+ */
+static bool region_ok(const uint8_t* buf, size_t off, size_t len, const uint8_t* expected, int c) {
+    for (size_t i = 0; i < off; i++) {
+        if (buf[i] != GUARD) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (buf[off + i] != (expected != NULL ? expected[i] : (uint8_t)c)) {
+            return false;
+        }
+    }
+    for (size_t i = off + len; i < off + len + GUARD_LEN; i++) {
+        if (buf[i] != GUARD) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int sign(int x) { return (x > 0) - (x < 0); }
+
+/**
+ * @brief Checks memcmp and timingsafe_bcmp on equal buffers, and with a difference at the first,
+ * middle and last byte in either direction
+ */
+static bool compare_ok(const uint8_t* l, uint8_t* r, size_t len) {
+    if (memcmp(l, r, len) != 0 || timingsafe_bcmp(l, r, len) != 0) {
+        return false;
+    }
+    if (len == 0) {
+        return true;
+    }
+
+    const size_t positions[] = {0, len / 2, len - 1};
+    for (size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        size_t pos = positions[i];
+        uint8_t saved = r[pos];
+        r[pos] = (uint8_t)(l[pos] + 1);
+        bool ok = sign(memcmp(l, r, len)) == sign(l[pos] - r[pos]) &&
+                  sign(memcmp(r, l, len)) == sign(r[pos] - l[pos]) &&
+                  timingsafe_bcmp(l, r, len) == 1;
+        r[pos] = saved;
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void) {
+    test_init("mem");
+
+    unsigned runs = 0;
+    // every short length, then the long one
+    for (size_t i = 0; i <= CHECK_MAX_LEN + 1; i++) {
+        size_t len = i <= CHECK_MAX_LEN ? i : LONG_LEN;
+        size_t span = len + CHECK_OFFSETS + GUARD_LEN;
+
+        for (size_t dst_off = 0; dst_off < CHECK_OFFSETS; dst_off++) {
+            for (size_t src_off = 0; src_off < CHECK_OFFSETS; src_off++) {
+                fill_pattern(buf_a, span, (uint32_t)(len * 64 + dst_off * 8 + src_off));
+                memset(buf_b, GUARD, span); // checked on its own below
+
+                memcpy(buf_b + dst_off, buf_a + src_off, len);
+                if (!CHECK(region_ok(buf_b, dst_off, len, buf_a + src_off, 0)) ||
+                    !CHECK(compare_ok(buf_a + src_off, buf_b + dst_off, len))) {
+                    fprintf(stderr, "  %zu bytes, dst +%zu, src +%zu\n", len, dst_off, src_off);
+                }
+                runs++;
+            }
+
+            memset(buf_b, GUARD, span);
+            memset(buf_b + dst_off, (int)(len | 0x100), len); // only the low byte counts
+            if (!CHECK(region_ok(buf_b, dst_off, len, NULL, (int)len))) {
+                fprintf(stderr, "  memset of %zu bytes at +%zu\n", len, dst_off);
+            }
+            memset_explicit(buf_b + dst_off, 0, len);
+            if (!CHECK(region_ok(buf_b, dst_off, len, NULL, 0))) {
+                fprintf(stderr, "  memset_explicit of %zu bytes at +%zu\n", len, dst_off);
+            }
+        }
+    }
+
+    printf("mem: %u copies and compares over %d alignments\n", runs,
+           CHECK_OFFSETS * CHECK_OFFSETS);
+    return test_finish();
+}
@@ -0,0 +1,367 @@
+/**
+ * @file test_uart.c
+ * @brief UART rings and the interrupt driven board UART against a fake 8-byte FIFO (build.sh test)
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * First uart_ring.h against a queue model, with indices about to wrap. Then src/host_uart.c, the
+ * board's driver, on the fake UART of uart.h: bytes arrive and leave the FIFOs at random times,
+ * and UART0_IRQHandler() runs whenever the driver unmasks interrupts with an enabled flag set. The
+ * main loop reads and writes random pieces and is busy for long stretches, so the RX ring fills
+ * and reception has to stall with the bytes waiting in the FIFO. Every byte has to come through
+ * once and in order, both ways.
+ */
+
+#include "harness.h"
+
+// host/src/host_uart.c, the pty of the host build, defines the same functions
+#define uart_init fifo_uart_init
+#define uart_writebyte fifo_uart_writebyte
+#define uart_readbyte fifo_uart_readbyte
+#define uart_readable fifo_uart_readable
+#define uart_write fifo_uart_write
+#define uart_read fifo_uart_read
+#define uart_available fifo_uart_available
+#define uart_flush fifo_uart_flush
+
+#include "../../src/host_uart.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RING_OPS 200000
+#define RX_BYTES 100000
+#define TX_BYTES 100000
+#define MAX_PIECE 700 // more than the TX ring
+
+struct fake_uart {
+    uint8_t rx_fifo[FAKE_UART_FIFO_DEPTH];
+    uint8_t tx_fifo[FAKE_UART_FIFO_DEPTH];
+    unsigned rx_first, rx_level;
+    unsigned tx_first, tx_level;
+    unsigned rx_threshold;
+    unsigned int_en;
+    unsigned flags;
+    bool irq_enabled; // in the NVIC
+};
+
+mxc_uart_regs_t fake_uart0;
+
+static uint32_t primask = 1;
+static bool in_irq = false;
+
+static uint8_t rx_stream[RX_BYTES]; // sent to the decoder
+static uint8_t tx_stream[TX_BYTES]; // sent by the decoder
+static size_t rx_sent, tx_received;
+static unsigned irqs, rx_stalls;
+
+int MXC_UART_Init(mxc_uart_regs_t* uart, unsigned int baud, mxc_uart_clock_t clock) {
+    (void)baud;
+    (void)clock;
+    *uart = (mxc_uart_regs_t){.rx_threshold = 1};
+    return 0;
+}
+
+int MXC_UART_SetRXThreshold(mxc_uart_regs_t* uart, unsigned int num_bytes) {
+    uart->rx_threshold = num_bytes;
+    return 0;
+}
+
+unsigned int MXC_UART_GetRXFIFOAvailable(mxc_uart_regs_t* uart) {
+    CHECK(primask != 0 || in_irq);
+    return uart->rx_level;
+}
+
+unsigned int MXC_UART_GetTXFIFOAvailable(mxc_uart_regs_t* uart) {
+    CHECK(primask != 0 || in_irq);
+    return FAKE_UART_FIFO_DEPTH - uart->tx_level;
+}
+
+int MXC_UART_ReadCharacterRaw(mxc_uart_regs_t* uart) {
+    if (!CHECK(uart->rx_level > 0)) {
+        return -1;
+    }
+    uint8_t byte = uart->rx_fifo[uart->rx_first];
+    uart->rx_first = (uart->rx_first + 1) % FAKE_UART_FIFO_DEPTH;
+    uart->rx_level--;
+    return byte;
+}
+
+int MXC_UART_WriteCharacterRaw(mxc_uart_regs_t* uart, uint8_t character) {
+    if (!CHECK(uart->tx_level < FAKE_UART_FIFO_DEPTH)) {
+        return -1;
+    }
+    uart->tx_fifo[(uart->tx_first + uart->tx_level) % FAKE_UART_FIFO_DEPTH] = character;
+    uart->tx_level++;
+    return 0;
+}
+
+int MXC_UART_EnableInt(mxc_uart_regs_t* uart, unsigned int mask) {
+    CHECK(primask != 0 || in_irq);
+    uart->int_en |= mask;
+    return 0;
+}
+
+int MXC_UART_DisableInt(mxc_uart_regs_t* uart, unsigned int mask) {
+    CHECK(primask != 0 || in_irq);
+    uart->int_en &= ~mask;
+    return 0;
+}
+
+unsigned int MXC_UART_GetFlags(mxc_uart_regs_t* uart) {
+    return uart->flags;
+}
+
+int MXC_UART_ClearFlags(mxc_uart_regs_t* uart, unsigned int flags) {
+    uart->flags &= ~flags;
+    return 0;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq) {
+    (void)irq;
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq) {
+    (void)irq;
+    fake_uart0.irq_enabled = true;
+}
+
+uint32_t __get_PRIMASK(void) {
+    return primask;
+}
+
+void __disable_irq(void) {
+    primask = 1;
+}
+
+/**
+ * @brief Runs the interrupt if it is enabled, pending and not masked
+ */
+static void maybe_irq(void) {
+    if (in_irq || primask != 0 || !fake_uart0.irq_enabled ||
+        (fake_uart0.flags & fake_uart0.int_en) == 0) {
+        return;
+    }
+
+    in_irq = true;
+    UART0_IRQHandler();
+    in_irq = false;
+    irqs++;
+
+    // reception is on exactly while the RX ring has room, transmission while the TX ring has bytes
+    CHECK(uart_ring_full(&rx_ring) == !(fake_uart0.int_en & MXC_F_UART_INT_EN_RX_THD));
+    CHECK(uart_ring_empty(&tx_ring) == !(fake_uart0.int_en & MXC_F_UART_INT_EN_TX_HE));
+}
+
+/**
+ * @brief Time passes: a few bytes arrive and leave on the line, then the interrupt may run
+ */
+static void line_tick(void) {
+    mxc_uart_regs_t* uart = &fake_uart0;
+
+    for (long n = random() % 4; n > 0 && rx_sent < RX_BYTES; n--) {
+        if (uart->rx_level == FAKE_UART_FIFO_DEPTH) {
+            // the host waits, as it does for the decoder's ack of each chunk
+            CHECK(uart_ring_full(&rx_ring));
+            CHECK(!(uart->int_en & MXC_F_UART_INT_EN_RX_THD));
+            rx_stalls++;
+            break;
+        }
+        uart->rx_fifo[(uart->rx_first + uart->rx_level) % FAKE_UART_FIFO_DEPTH] =
+            rx_stream[rx_sent++];
+        uart->rx_level++;
+        if (uart->rx_level >= uart->rx_threshold) {
+            uart->flags |= MXC_F_UART_INT_EN_RX_THD;
+        }
+    }
+
+    for (long n = random() % 4; n > 0 && uart->tx_level > 0; n--) {
+        uint8_t byte = uart->tx_fifo[uart->tx_first];
+        uart->tx_first = (uart->tx_first + 1) % FAKE_UART_FIFO_DEPTH;
+        uart->tx_level--;
+        if (!CHECK(tx_received < TX_BYTES && byte == tx_stream[tx_received])) {
+            fprintf(stderr, "  sent byte %zu\n", tx_received);
+        }
+        tx_received++;
+        // only on the way down
+        if (uart->tx_level == FAKE_UART_FIFO_DEPTH / 2) {
+            uart->flags |= MXC_F_UART_INT_EN_TX_HE;
+        }
+    }
+
+    maybe_irq();
+}
+
+void __set_PRIMASK(uint32_t value) {
+    primask = value;
+    if (primask == 0) {
+        line_tick(); // each round of a blocking loop takes a while
+    }
+}
+
+static void random_bytes(uint8_t* out, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        out[i] = (uint8_t)random();
+    }
+}
+
+/**
+ * @brief uart_ring.h against a queue model, in a 16-byte ring whose indices wrap
+ */
+static void test_ring(void) {
+    uint8_t data[16];
+    uart_ring_t ring = UART_RING_INIT(data);
+    ring.head = ring.tail = UINT32_MAX - 1000;
+
+    uint8_t model[64]; // indexed modulo its size, holds more than the ring
+    size_t model_head = 0, model_tail = 0;
+    uint8_t next = 0;
+
+    for (size_t i = 0; i < RING_OPS; i++) {
+        size_t used = model_head - model_tail;
+        uint8_t bytes[24];
+        size_t length = (size_t)random() % sizeof(bytes);
+
+        switch (random() % 4) {
+        case 0:
+            if (CHECK(uart_ring_push(&ring, next) == (used < sizeof(data))) &&
+                used < sizeof(data)) {
+                model[model_head++ % sizeof(model)] = next++;
+            }
+            break;
+        case 1: {
+            uint8_t byte = 0;
+            if (CHECK(uart_ring_pop(&ring, &byte) == (used > 0)) && used > 0) {
+                CHECK(byte == model[model_tail++ % sizeof(model)]);
+            }
+            break;
+        }
+        case 2: {
+            size_t expected = length < used ? length : used;
+            CHECK(uart_ring_read(&ring, bytes, length) == expected);
+            for (size_t j = 0; j < expected; j++) {
+                CHECK(bytes[j] == model[model_tail++ % sizeof(model)]);
+            }
+            break;
+        }
+        default: {
+            size_t space = sizeof(data) - used;
+            size_t expected = length < space ? length : space;
+            for (size_t j = 0; j < length; j++) {
+                bytes[j] = (uint8_t)(next + j);
+            }
+            CHECK(uart_ring_write(&ring, bytes, length) == expected);
+            for (size_t j = 0; j < expected; j++) {
+                model[model_head++ % sizeof(model)] = next++;
+            }
+            break;
+        }
+        }
+
+        used = model_head - model_tail;
+        CHECK(uart_ring_used(&ring) == used);
+        CHECK(uart_ring_empty(&ring) == (used == 0));
+        CHECK(uart_ring_full(&ring) == (used == sizeof(data)));
+    }
+    CHECK(ring.head < UINT32_MAX - 1000); // wrapped
+}
+
+/**
+ * @brief Checks bytes read by the driver against what was sent
+ */
+static void check_received(const uint8_t* bytes, size_t length, size_t* position) {
+    if (!CHECK(*position + length <= RX_BYTES &&
+               memcmp(bytes, &rx_stream[*position], length) == 0)) {
+        fprintf(stderr, "  received bytes %zu to %zu\n", *position, *position + length);
+    }
+    *position += length;
+}
+
+/**
+ * @brief The main loop of the decoder, reading and writing random pieces and often busy
+ */
+static void test_driver(void) {
+    random_bytes(rx_stream, sizeof(rx_stream));
+    random_bytes(tx_stream, sizeof(tx_stream));
+
+    // the indices wrap during the test
+    rx_ring.head = rx_ring.tail = UINT32_MAX - 3 * RX_RING_SIZE;
+    tx_ring.head = tx_ring.tail = UINT32_MAX - 5 * TX_RING_SIZE;
+
+    uart_init();
+    CHECK(fake_uart0.irq_enabled);
+    CHECK(fake_uart0.int_en == MXC_F_UART_INT_EN_RX_THD);
+    __set_PRIMASK(0); // hardware_init()
+
+    size_t read = 0, written = 0;
+    while (read < RX_BYTES || written < TX_BYTES) {
+        uint8_t piece[MAX_PIECE];
+        size_t length = 1 + (size_t)random() % MAX_PIECE;
+
+        switch (random() % 8) {
+        case 0: // decoding a frame
+            for (long ticks = random() % 2000; ticks > 0; ticks--) {
+                line_tick();
+            }
+            break;
+        case 1: { // get_msg_body() takes what is there
+            size_t available = uart_available();
+            CHECK(available == uart_ring_used(&rx_ring) && available <= RX_RING_SIZE);
+            CHECK(uart_readable() == (available > 0));
+            length = available < MAX_PIECE ? available : MAX_PIECE;
+            uart_read(piece, length);
+            check_received(piece, length, &read);
+            break;
+        }
+        case 2:
+            length = length < RX_BYTES - read ? length : RX_BYTES - read;
+            uart_read(piece, length);
+            check_received(piece, length, &read);
+            break;
+        case 3:
+            if (read < RX_BYTES) {
+                piece[0] = uart_readbyte();
+                check_received(piece, 1, &read);
+            }
+            break;
+        case 4:
+        case 5:
+            length = length < TX_BYTES - written ? length : TX_BYTES - written;
+            uart_write(&tx_stream[written], length);
+            written += length;
+            break;
+        case 6:
+            if (written < TX_BYTES) {
+                uart_writebyte(tx_stream[written++]);
+            }
+            break;
+        default:
+            uart_flush();
+            CHECK(uart_ring_empty(&tx_ring));
+            break;
+        }
+    }
+
+    uart_flush();
+    while (fake_uart0.tx_level > 0) {
+        line_tick();
+    }
+    CHECK(read == RX_BYTES && rx_sent == RX_BYTES);
+    CHECK(tx_received == TX_BYTES);
+    CHECK(!uart_readable());
+    CHECK(rx_ring.head < RX_BYTES && tx_ring.head < TX_BYTES); // wrapped
+}
+
+int main(void) {
+    test_init("uart");
+
+    test_ring();
+    test_driver();
+
+    printf("uart: %d bytes received, %d sent, %u interrupts, %u line waits with the RX ring full\n",
+           RX_BYTES, TX_BYTES, irqs, rx_stalls);
+    CHECK(rx_stalls > 0);
+
+    return test_finish();
+}
@@ -0,0 +1,62 @@
+/**
+ * @file uart.h
+ * @brief Stand-in for the MSDK's uart.h, for src/host_uart.c in test_uart.c (build.sh test)
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Only the calls src/host_uart.c makes, plus the interrupt masking it takes from max78000.h. The
+ * UART behind them is simulated by test_uart.c: 8-byte FIFOs each way, a line on both sides that
+ * moves bytes at random times, and UART0_IRQHandler() run whenever an enabled flag is set and
+ * interrupts are not masked.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define FAKE_UART_FIFO_DEPTH 8
+
+typedef struct fake_uart mxc_uart_regs_t;
+
+extern mxc_uart_regs_t fake_uart0;
+
+#define MXC_UART_GET_UART(i) (&fake_uart0)
+#define MXC_UART_GET_FIFO(i) (i)
+
+// Interrupt enable and flag bits share their positions, as on the MAX78000
+#define MXC_F_UART_INT_EN_RX_THD (1u << 4)
+#define MXC_F_UART_INT_EN_TX_HE (1u << 6)
+
+typedef enum { MXC_UART_IBRO_CLK } mxc_uart_clock_t;
+
+typedef enum { UART0_IRQn } IRQn_Type;
+
+int MXC_UART_Init(mxc_uart_regs_t* uart, unsigned int baud, mxc_uart_clock_t clock);
+
+int MXC_UART_SetRXThreshold(mxc_uart_regs_t* uart, unsigned int num_bytes);
+
+unsigned int MXC_UART_GetRXFIFOAvailable(mxc_uart_regs_t* uart);
+
+unsigned int MXC_UART_GetTXFIFOAvailable(mxc_uart_regs_t* uart);
+
+int MXC_UART_ReadCharacterRaw(mxc_uart_regs_t* uart);
+
+int MXC_UART_WriteCharacterRaw(mxc_uart_regs_t* uart, uint8_t character);
+
+int MXC_UART_EnableInt(mxc_uart_regs_t* uart, unsigned int mask);
+
+int MXC_UART_DisableInt(mxc_uart_regs_t* uart, unsigned int mask);
+
+unsigned int MXC_UART_GetFlags(mxc_uart_regs_t* uart);
+
+int MXC_UART_ClearFlags(mxc_uart_regs_t* uart, unsigned int flags);
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+
+uint32_t __get_PRIMASK(void);
+
+void __set_PRIMASK(uint32_t primask);
+
+void __disable_irq(void);
@@ -0,0 +1,34 @@
+/**
+ * @file batch_decode.h
+ * @brief Decoding of several frame packets sent in a single message
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include "common.h"
+
+#include <stdint.h>
+
+// Records are padded to keep frame packets 4-byte aligned in the receive buffer
+// match: decoder.py -> DecoderIntf.decode_many
+typedef struct {
+    uint16_t length; // length of the frame packet that follows
+    uint16_t _padding;
+} batch_record_hdr_t;
+
+static_assert(sizeof(batch_record_hdr_t) == 4);
+
+// Each record result is followed by `length` bytes of decoded frame
+// match: decoder.py -> DecoderIntf.decode_many
+typedef struct {
+    uint8_t status; // 0 if the frame was decoded, 1 otherwise
+    uint8_t length;
+} batch_result_hdr_t;
+
+static_assert(sizeof(batch_result_hdr_t) == 2);
+
+#define MAX_BATCH_RECORDS 9
+
+error_t decode_batch(uint8_t* msg_buf, uint16_t msg_len);
@@ -0,0 +1,41 @@
+/**
+ * @file bench_report.h
+ * @brief Text building for the boot benchmarks' debug messages, without printf
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Appends a string to a report
+ *
+ * @return the new end of the report
+ */
+static inline char* append_str(char* out, const char* str) {
+    while (*str != '\0') {
+        *out++ = *str++;
+    }
+    return out;
+}
+
+/**
+ * @brief Appends a number in decimal to a report
+ *
+ * @return the new end of the report
+ */
+static inline char* append_u32(char* out, uint32_t value) {
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0) {
+        *out++ = digits[--n];
+    }
+    return out;
+}
@@ -0,0 +1,16 @@
+/**
+ * @file blake2s.h
+ * @brief BLAKE2s (RFC 7693), the 32-bit member of the BLAKE2 family
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLAKE2S_BLOCK_LEN 64
+#define BLAKE2S_MAX_HASH_LEN 32
+
+void blake2s(uint8_t* hash, size_t hash_len, const uint8_t* message, size_t message_len);
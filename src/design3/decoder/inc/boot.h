@@ -0,0 +1,18 @@
+/**
+ * @file boot.h
+ * @brief Startup, split at the first message header with DECODER_FAST_BOOT=1
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+void boot_init(void);
+
+bool boot_ready(void);
+
+bool boot_step(void);
+
+void boot_finish(void);
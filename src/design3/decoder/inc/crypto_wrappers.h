@@ -8,10 +8,15 @@
 #pragma once
 
 #include "common.h"
+#include "eddsa_verify.h"
 
+#include <monocypher.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+void crypto_init(void);
+
 // Symmetric encryption
 
 #define SYMMETRIC_KEY_LEN 32
@@ -25,13 +30,63 @@ error_t decrypt_symmetric(uint8_t* plaintext, const uint8_t* ciphertext, size_t
 #define PUBLIC_KEY_LEN 32
 #define SIGNATURE_LEN 64
 
+#if EDDSA_PRECOMPUTED
+typedef eddsa_verify_ctx_t verify_ctx_t;
+#else
+/**
+ * @brief Public key of a signer, checked with crypto_eddsa_check()
+ */
+typedef struct {
+    uint8_t public_key[PUBLIC_KEY_LEN];
+} verify_ctx_t;
+#endif
+
+extern verify_ctx_t encoder_verify_ctx;
+
+error_t verify_ctx_init(verify_ctx_t* verify_ctx, const uint8_t* public_key);
+
 error_t verify_asymmetric(const uint8_t* signature, const uint8_t* message, size_t length,
-                          const uint8_t* pubkey);
+                          const verify_ctx_t* verify_ctx);
+
+/**
+ * @brief Signature check fed with signature || message as it arrives
+ */
+typedef struct {
+    const verify_ctx_t* verify_ctx;
+    crypto_blake2b_ctx hash_ctx;
+#if EDDSA_PRECOMPUTED
+    eddsa_verify_state_t eddsa;
+    bool s_canonical;
+#endif
+    uint8_t signature[SIGNATURE_LEN];
+    size_t received; // bytes of signature || message absorbed so far
+} verify_stream_t;
+
+void verify_stream_init(verify_stream_t* stream, const verify_ctx_t* verify_ctx);
+
+void verify_stream_absorb(verify_stream_t* stream, const uint8_t* data, size_t length);
+
+void verify_stream_idle(verify_stream_t* stream);
+
+error_t verify_stream_final(verify_stream_t* stream);
 
 // Hashing and key derivation
 
 #define TREE_KEY_LEN 16
 #define TREE_LEFT_RIGHT_LEN 32
 
-void kdf_tree_child(uint8_t* key_out, const uint8_t* parent, const uint8_t* left_right);
+// Key tree KDF versions, selected per deployment by gen_secrets --tree-kdf
+// match: crypto_wrappers.py -> TREE_KDF_*
+#define TREE_KDF_BLAKE2B 1
+#define TREE_KDF_BLAKE2S 2 // 32-bit words, much cheaper on the Cortex-M4
+
+void kdf_tree_child(uint8_t* key_out, const uint8_t* parent, uint32_t child);
 void kdf_tree_leaf(uint8_t* key_out, const uint8_t* tree_key);
+
+#if BENCH_TREE_KDF
+void kdf_tree_benchmark(void);
+#endif
+
+#if BENCH_EDDSA
+void eddsa_benchmark(void);
+#endif
@@ -0,0 +1,20 @@
+/**
+ * @file drbg.h
+ * @brief ChaCha20 deterministic random bit generator, seeded and reseeded from the TRNG
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest request of drbg_generate()
+#define DRBG_MAX_REQUEST 256
+
+void drbg_init(void);
+
+void drbg_generate(void* output, size_t length);
+
+void drbg_idle(void);
@@ -0,0 +1,67 @@
+/**
+ * @file eddsa_verify.h
+ * @brief EdDSA (Ed25519 curve) signature verification against a fixed, precomputed public key
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Scalars are split into EDDSA_SPLIT chunks of 64 bits so that only 64 doublings are needed
+#define EDDSA_SPLIT 4
+// Odd multiples 1P, 3P, ..., 15P for signed sliding windows of width 5
+#define EDDSA_TABLE_SIZE 8
+
+// Field element of GF(2^255 - 19), 10 limbs of alternating 26 and 25 bits
+typedef int32_t fe_t[10];
+
+// Extended coordinates (X:Y:Z:T) with x = X/Z, y = Y/Z, xy = T/Z
+typedef struct {
+    fe_t X;
+    fe_t Y;
+    fe_t Z;
+    fe_t T;
+} ge_t;
+
+// Affine point (y + x, y - x, 2dxy), ready for mixed addition
+typedef struct {
+    fe_t yplusx;
+    fe_t yminusx;
+    fe_t xy2d;
+} ge_precomp_t;
+
+/**
+ * @brief Everything a verification needs to know about a public key, computed once
+ *
+ * minus_a[j][k] = (2k + 1) * 2^(64j) * -A, where A is the decoded public key
+ */
+typedef struct {
+    uint8_t public_key[32];
+    ge_precomp_t minus_a[EDDSA_SPLIT][EDDSA_TABLE_SIZE];
+} eddsa_verify_ctx_t;
+
+/**
+ * @brief A check split in two, so that [s]B can be computed before the message is known
+ */
+typedef struct {
+    ge_t sb;
+    int8_t s_naf[256];
+    uint8_t rows_left; // rows of [s]B still to be accumulated
+} eddsa_verify_state_t;
+
+error_t eddsa_verify_ctx_init(eddsa_verify_ctx_t* ctx, const uint8_t public_key[32]);
+
+error_t eddsa_verify_ctx_check(const eddsa_verify_ctx_t* ctx, const uint8_t signature[64],
+                               const uint8_t h_ram[32]);
+
+error_t eddsa_verify_start(eddsa_verify_state_t* state, const uint8_t s[32]);
+
+bool eddsa_verify_step(eddsa_verify_state_t* state);
+
+error_t eddsa_verify_finish(eddsa_verify_state_t* state, const eddsa_verify_ctx_t* ctx,
+                            const uint8_t r[32], const uint8_t h_ram[32]);
@@ -0,0 +1,23 @@
+/**
+ * @file flash.h
+ * @brief Flash erase/write that keep the instruction cache coherent
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include "common.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void icache_init(void);
+
+#if BENCH_ICACHE
+bool icache_set(bool enable);
+#endif
+
+error_t flash_erase_page(uint32_t address);
+
+error_t flash_write(uint32_t address, uint32_t length, const uint32_t* data);
@@ -9,12 +9,15 @@
 
 #include "common.h"
 #include "crypto_wrappers.h"
+#include "key_tree.h"
+#include "subscription.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct {
     uint64_t prefix;
-    uint8_t bits;
+    uint8_t bits; // multiple of TREE_ARITY_BITS
 } vertex_t;
 
 #define MAX_FRAME_SIZE 64
@@ -49,6 +52,87 @@ typedef struct frame_packet {
 
 static_assert(sizeof(frame_packet_t) == 228);
 
-#define MAX_TREE_HEIGHT 64
+#define FRAME_PACKET_VERSION_2 2
 
-error_t decode(const frame_packet_t* packet);
+// Signature first, so the decoder can hash the payload while it is still being received
+// match: encoder.py -> FramePacketV2
+typedef struct frame_packet_v2 {
+    uint8_t signature[SIGNATURE_LEN];
+    // match: encoder.py -> FramePacketPayloadV2
+    struct {
+        uint32_t version; // FRAME_PACKET_VERSION_2
+        channel_t channel_id;
+        uint8_t enc_frame[SYMMETRIC_METADATA_LEN + sizeof(frame_ch_t)];
+    } payload;
+} frame_packet_v2_t;
+
+static_assert(sizeof(frame_packet_v2_t) == 232);
+
+#define FRAME_PACKET_VERSION_3 3
+
+// Signed cleartext copy of the timestamp, so that stale and out of subscription frames are dropped
+// before the signature check. The encrypted timestamp must match it.
+// match: encoder.py -> FramePacketV3
+typedef struct frame_packet_v3 {
+    uint8_t signature[SIGNATURE_LEN];
+    // match: encoder.py -> FramePacketPayloadV3
+    struct {
+        uint32_t version; // FRAME_PACKET_VERSION_3
+        channel_t channel_id;
+        timestamp_t timestamp;
+        uint8_t enc_frame[SYMMETRIC_METADATA_LEN + sizeof(frame_ch_t)];
+    } payload;
+} frame_packet_v3_t;
+
+static_assert(sizeof(frame_packet_v3_t) == 240);
+
+// Frame key derivations since boot, by whether decode_prefetch() had the key ready
+// match: decoder.py -> PrefetchStats
+typedef struct {
+    uint32_t prefetches;  // frame keys precomputed while idle
+    uint32_t hits;        // precomputed key was the frame's
+    uint32_t misses;      // precomputed key was for another timestamp
+    uint32_t unpredicted; // no key precomputed for the channel
+    // cycles spent getting the frame keys, by outcome
+    uint64_t hit_cycles;
+    uint64_t miss_cycles;
+    uint64_t unpredicted_cycles;
+} prefetch_stats_t;
+
+static_assert(sizeof(prefetch_stats_t) == 40);
+
+error_t decode(frame_packet_t* packet, frame_data_t** frame_out);
+
+error_t decode_v2(frame_packet_v2_t* packet, frame_data_t** frame_out);
+
+error_t decode_v3(frame_packet_v3_t* packet, frame_data_t** frame_out);
+
+void decode_stream_begin(size_t packet_len);
+
+void decode_stream_poll(const uint8_t* msg_buf, size_t received);
+
+error_t decode_stream_end(frame_packet_v2_t* packet, frame_data_t** frame_out);
+
+error_t decode_stream_end_v3(frame_packet_v3_t* packet, frame_data_t** frame_out);
+
+void frame_data_wipe(frame_data_t* frame);
+
+void decode_prefetch(void);
+
+void get_prefetch_stats(prefetch_stats_t* stats);
+
+/**
+ * @brief Receives the i-th key derived by derive_vertex_keys() (TREE_KEY_LEN bytes)
+ */
+typedef void (*vertex_key_fn_t)(void* ctx, uint32_t i, const uint8_t* key);
+
+void derive_vertex_keys(const subscription_info_t* sub, uint8_t bits, timestamp_t first,
+                        uint32_t count, vertex_key_fn_t emit, void* ctx);
+
+#if BENCH_KEY_CACHE
+void key_cache_benchmark(void);
+#endif
+
+#if BENCH_ICACHE
+void icache_benchmark(void);
+#endif
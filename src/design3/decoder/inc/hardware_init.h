@@ -7,4 +7,8 @@
 
 #pragma once
 
+#include <stdbool.h>
+
 void hardware_init(void);
+
+bool hardware_ready(void);
@@ -16,19 +16,44 @@
 #define MSG_CHUNK_SIZE 256 // bytes
 
 typedef enum : char {
-    DECODE_MSG = 'D',    // 0x44
-    SUBSCRIBE_MSG = 'S', // 0x53
-    LIST_MSG = 'L',      // 0x4C
-    ACK_MSG = 'A',       // 0x41
-    ERROR_MSG = 'E',     // 0x45
-    DEBUG_MSG = 'G',     // 0x47
-    MAGIC_MSG = '%'      // 0x25
+    DECODE_MSG = 'D',       // 0x44
+    SUBSCRIBE_MSG = 'S',    // 0x53
+    LIST_MSG = 'L',         // 0x4C
+    BATCH_DECODE_MSG = 'B', // 0x42
+    QUERY_MSG = 'Q',        // 0x51
+    ACK_MSG = 'A',          // 0x41
+    ERROR_MSG = 'E',        // 0x45
+    DEBUG_MSG = 'G',        // 0x47
+    MAGIC_MSG = '%'         // 0x25
 } msg_type_t;
 
+// Body of a QUERY_MSG request: u32 selector, the reply is a QUERY_MSG with the selected data
+// match: decoder.py -> QuerySelector
+typedef enum : uint32_t {
+    QUERY_PREFETCH_STATS = 1, // frame.h -> prefetch_stats_t
+    QUERY_PROFILE = 2,        // profile.h -> profile_t, only with DECODER_PROFILE=1
+    QUERY_BOOT_PROFILE = 3,   // profile.h -> boot_profile_t, only with DECODER_PROFILE=1
+    QUERY_SRAM_STATS = 4,     // sram.h -> sram_stats_t
+} query_selector_t;
+
 void send_msg(const msg_type_t type, const void* msg_buf, const size_t msg_len);
 
 error_t get_msg(msg_type_t* type, void* msg_buf, uint16_t* msg_len, const size_t buf_len);
 
+/**
+ * @brief Called while waiting for message bytes, with the number of bytes stored so far
+ *
+ * Bytes that arrive meanwhile go to the 1 KiB RX ring (see host_uart.c). Once the ring is full,
+ * reception stalls and the next bytes wait in the 8-byte FIFO, so the callback must return before
+ * the host has sent more than the two hold.
+ */
+typedef void (*msg_idle_fn_t)(const uint8_t* msg_buf, size_t received);
+
+void get_msg_header(msg_type_t* type, uint16_t* msg_len);
+
+error_t get_msg_body(void* msg_buf, const uint16_t msg_len, const size_t buf_len,
+                     msg_idle_fn_t on_idle);
+
 #define PRINT_ERROR(msg) send_msg(ERROR_MSG, "" msg "", sizeof(msg) - 1)
 
 #define PRINT_DEBUG(msg) send_msg(DEBUG_MSG, "" msg "", sizeof(msg) - 1)
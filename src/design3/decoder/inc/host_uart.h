@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -19,6 +21,18 @@
  */
 #define CONSOLE_BAUD ((uint32_t)115200)
 
+void uart_init(void);
+
 void uart_writebyte(uint8_t data);
 
 uint8_t uart_readbyte(void);
+
+bool uart_readable(void);
+
+void uart_write(const uint8_t* buf, size_t length);
+
+void uart_read(uint8_t* buf, size_t length);
+
+size_t uart_available(void);
+
+void uart_flush(void);
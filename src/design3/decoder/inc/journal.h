@@ -0,0 +1,68 @@
+/**
+ * @file journal.h
+ * @brief Append-only, wear-leveled record store in reserved flash pages
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JOURNAL_PAGE_SIZE 8192 // exactly one flash page
+#define JOURNAL_PAGES 16 // room for compaction with the largest (16-ary tree) subscriptions
+#define JOURNAL_LINE 16 // flash write granularity, every field below is written exactly once
+
+// Most channels that can have a record at the same time
+#define JOURNAL_MAX_LIVE 8
+
+/**
+ * @brief Header of every record, followed by the record body and a journal_record_trailer_t
+ *
+ * A record only counts once its trailer was written, so a record torn by a reset is ignored.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;    // order of the records, kept when a record is moved by compaction
+    uint32_t length; // whole record including header and trailer, multiple of JOURNAL_LINE
+    channel_t channel;
+} journal_record_hdr_t;
+
+static_assert(sizeof(journal_record_hdr_t) == JOURNAL_LINE);
+
+/**
+ * @brief Piece of a record body, the body is the concatenation of all chunks
+ */
+typedef struct {
+    const void* data;
+    uint32_t length; // multiple of JOURNAL_LINE
+} journal_chunk_t;
+
+void journal_init(void);
+
+const journal_record_hdr_t* journal_get(size_t i);
+
+error_t journal_append(channel_t channel, const journal_chunk_t* chunks, size_t chunk_count);
+
+/**
+ * @brief Body of a record
+ *
+ * @param record record header
+ * @return pointer to the first byte after the header
+ */
+static inline const void* journal_record_body(const journal_record_hdr_t* record) {
+    return record + 1;
+}
+
+/**
+ * @brief Length of the body of a record
+ *
+ * @param record record header
+ * @return length of the body, without header and trailer
+ */
+static inline size_t journal_record_body_length(const journal_record_hdr_t* record) {
+    return record->length - sizeof(journal_record_hdr_t) - JOURNAL_LINE; // trailer is one line
+}
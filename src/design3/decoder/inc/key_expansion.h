@@ -0,0 +1,40 @@
+/**
+ * @file key_expansion.h
+ * @brief Layer of pre-derived tree keys per subscription, in flash the journal does not use
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include "common.h"
+#include "frame.h"
+#include "key_tree.h"
+#include "subscription.h"
+
+#include <stdint.h>
+
+// Levels (in timestamp bits) left to derive below an expanded vertex, as long as the subscription
+// is short enough for its vertices at that level to fit in a slot. MAX_TREE_HEIGHT turns
+// expansion off. Set with DECODER_EXPANSION_BITS in build.sh.
+// match: expansion_budget.py -> --frame-bits
+#ifndef EXPANSION_FRAME_BITS
+#define EXPANSION_FRAME_BITS 16
+#endif
+
+static_assert(EXPANSION_FRAME_BITS >= 0 && EXPANSION_FRAME_BITS <= MAX_TREE_HEIGHT);
+static_assert(EXPANSION_FRAME_BITS % TREE_ARITY_BITS == 0);
+
+#define EXPANSION_PAGE_SIZE 8192 // exactly one flash page per slot
+#define EXPANSION_SLOTS MAX_CHANNEL_COUNT
+
+// Header, tree keys and trailer of a slot fill its page
+// match: expansion_budget.py -> EXPANSION_MAX_KEYS
+#define EXPANSION_MAX_KEYS 509
+
+void key_expansion_init(void);
+
+void key_expansion_build(const subscription_info_t* sub);
+
+const uint8_t* key_expansion_find(const subscription_info_t* sub, timestamp_t t,
+                                  vertex_t* position);
@@ -0,0 +1,28 @@
+/**
+ * @file key_tree.h
+ * @brief Shape of the key tree over the 64-bit timestamps
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Every level of the tree consumes TREE_ARITY_BITS of the timestamp, so a wider tree has fewer
+ * levels to derive per frame but needs more packaged keys to cover a subscription range.
+ * TREE_ARITY_BITS is a deployment parameter (gen_secrets --tree-arity), see tree_cost.py.
+ */
+
+#pragma once
+
+#include "tree_config.h" // generated from the global secrets by gen_secrets_c
+
+// match: gen_subscription.py -> vertices_for_range()
+#define MAX_TREE_HEIGHT 64 // bits of a timestamp
+#define TREE_ARITY (1u << TREE_ARITY_BITS)
+#define TREE_ARITY_MASK (TREE_ARITY - 1)
+#define TREE_LEVELS (MAX_TREE_HEIGHT / TREE_ARITY_BITS)
+
+// Most vertices needed to cover a range: up to TREE_ARITY - 1 on each side of every level below
+// the top, plus up to TREE_ARITY - 2 at the level where the sides meet
+// match: gen_subscription.py -> max_tree_keys()
+#define MAX_TREE_KEYS (2 * (TREE_ARITY - 1) * (TREE_LEVELS - 1) + TREE_ARITY - 2)
+
+static_assert(TREE_ARITY_BITS == 1 || TREE_ARITY_BITS == 2 || TREE_ARITY_BITS == 4);
+static_assert(TREE_ARITY_BITS != 1 || MAX_TREE_KEYS == 126);
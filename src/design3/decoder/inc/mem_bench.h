@@ -0,0 +1,12 @@
+/**
+ * @file mem_bench.h
+ * @brief Cycle counts of the memory routines, built with DECODER_BENCH_MEM=1
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#if BENCH_MEM
+void mem_benchmark(void);
+#endif
@@ -0,0 +1,131 @@
+/**
+ * @file profile.h
+ * @brief Cycle counts of the decoder's processing stages, built with DECODER_PROFILE=1
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// match: perf.py -> STAGES
+typedef enum {
+    PROFILE_UART_RX,       // receiving a message body, including waiting for the host
+    PROFILE_UART_TX,       // sending a response, including waiting for the host's acks
+    PROFILE_DISPATCH,      // message handling not covered by another stage
+    PROFILE_STREAM_VERIFY, // frame signature work done while the packet arrives
+    PROFILE_SIGNATURE,     // frame signature check, or what is left of it after streaming
+    PROFILE_OUTER_AEAD,    // decryption with the channel key
+    PROFILE_TREE,          // frame key derivation
+    PROFILE_INNER_AEAD,    // decryption with the frame key
+    PROFILE_FIPROC,        // random fault injection delays
+    PROFILE_SUB_SIGNATURE, // subscription signature check
+    PROFILE_SUB_DECRYPT,   // subscription decryption
+    PROFILE_SUB_STORE,     // subscription journal write
+    PROFILE_SUB_EXPAND,    // key expansion of a new subscription
+    PROFILE_STAGE_COUNT
+} profile_stage_t;
+
+// match: decoder.py -> ProfileStage
+typedef struct {
+    uint32_t count; // times the stage ran since boot
+    uint32_t min;   // cycles of its shortest run
+    uint32_t max;   // cycles of its longest run
+    uint32_t last;  // cycles spent in the stage during the last recorded message
+    uint64_t total; // cycles spent in the stage since boot
+} profile_stage_stats_t;
+
+// Reply to QUERY_PROFILE
+// match: decoder.py -> Profile
+typedef struct {
+    uint32_t stage_count; // PROFILE_STAGE_COUNT
+    uint32_t core_clock;  // Hz, to convert cycles to time
+    uint32_t messages;    // recorded messages since boot
+    uint32_t _pad;
+    profile_stage_stats_t stages[PROFILE_STAGE_COUNT];
+} profile_t;
+
+static_assert(sizeof(profile_stage_stats_t) == 24);
+static_assert(sizeof(profile_t) == 16 + PROFILE_STAGE_COUNT * 24);
+
+// Startup phases, see boot.c
+// match: perf.py -> BOOT_PHASES
+typedef enum {
+    BOOT_HARDWARE,      // hardware_init(), from the start of the cycle counter
+    BOOT_DRBG,          // seeding the DRBG from the TRNG
+    BOOT_LOCKOUT,       // lockout check, and the lockout itself if one is pending
+    BOOT_CRYPTO,        // crypto_init()
+    BOOT_SUBSCRIPTIONS, // journal recovery, subscription index and key expansion
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+// match: decoder.py -> BootPhase
+typedef struct {
+    uint32_t start;  // cycle count when the phase started
+    uint32_t cycles; // cycles it took, 0 if it did not run yet
+} boot_phase_stats_t;
+
+// Reply to QUERY_BOOT_PROFILE, in cycles since hardware_init() started the cycle counter
+// match: decoder.py -> BootProfile
+typedef struct {
+    uint32_t phase_count;  // BOOT_PHASE_COUNT
+    uint32_t core_clock;   // Hz, to convert cycles to time
+    uint32_t ready;        // when the first header could have been accepted
+    uint32_t first_header; // when the first header arrived
+    boot_phase_stats_t phases[BOOT_PHASE_COUNT];
+} boot_profile_t;
+
+static_assert(sizeof(boot_profile_t) == 16 + BOOT_PHASE_COUNT * 8);
+
+/**
+ * @brief Start of a stage, see PROFILE_BEGIN()
+ */
+typedef struct {
+    uint32_t start;  // DWT->CYCCNT
+    uint32_t nested; // cycles of the stages that ended before this one started
+} profile_mark_t;
+
+#if ENABLE_PROFILE
+
+profile_mark_t profile_begin(void);
+
+void profile_end(const profile_mark_t* mark, profile_stage_t stage);
+
+void profile_begin_msg(bool record);
+
+const profile_t* profile_get(void);
+
+uint32_t profile_boot_begin(void);
+
+void profile_boot_end(uint32_t start, boot_phase_t phase);
+
+void profile_boot_ready(void);
+
+void profile_boot_first_header(void);
+
+const boot_profile_t* profile_boot_get(void);
+
+// Times the code between PROFILE_BEGIN(mark) and PROFILE_END(mark, stage) as stage. Stages nest:
+// a stage only gets the cycles that no stage inside it got, so the stages of a message add up to
+// the cycles it took.
+#define PROFILE_BEGIN(mark) profile_mark_t mark = profile_begin()
+#define PROFILE_END(mark, stage) profile_end(&(mark), (stage))
+
+// Times the code between PROFILE_BOOT_BEGIN(mark) and PROFILE_BOOT_END(mark, phase) as a startup
+// phase, which is not nested in anything
+#define PROFILE_BOOT_BEGIN(mark) uint32_t mark = profile_boot_begin()
+#define PROFILE_BOOT_END(mark, phase) profile_boot_end((mark), (phase))
+
+#else
+
+#define PROFILE_BEGIN(mark)
+#define PROFILE_END(mark, stage)
+#define profile_begin_msg(record)
+#define PROFILE_BOOT_BEGIN(mark)
+#define PROFILE_BOOT_END(mark, phase)
+#define profile_boot_ready()
+#define profile_boot_first_header()
+
+#endif
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -15,3 +16,5 @@ void rng_init();
 void rng_get_unbiased_trng(uint8_t* output, size_t length);
 
 uint16_t rng_get_u16();
+
+bool rng_poll_unbiased_trng(uint8_t* output);
@@ -18,3 +18,6 @@ extern const uint8_t ID_KEY[SYMMETRIC_KEY_LEN];
 extern const uint8_t LEFT_TREE_KEY[TREE_LEFT_RIGHT_LEN];
 
 extern const uint8_t RIGHT_TREE_KEY[TREE_LEFT_RIGHT_LEN];
+
+// one of TREE_KDF_*, must match the encoder and subscriptions of the deployment
+extern const uint32_t TREE_KDF_VERSION;
@@ -0,0 +1,32 @@
+/**
+ * @file sram.h
+ * @brief SRAM_RW use: the static arena for large per-message buffers, and the stack high-water mark
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Places a large per-message buffer in .arena, between .bss and the stack (firmware.ld.template),
+// instead of on the stack. The arena is not zeroed at boot: only for buffers that are written
+// before they are read, and wiped after use if they held secrets.
+#define ARENA [[gnu::section(".arena")]]
+
+// Word crt0.S fills the stack with before main()
+// match: crt0.S -> .L_paint_loop
+#define STACK_PAINT 0x4B415453 // STAK
+
+// Reply to QUERY_SRAM_STATS, in bytes
+// match: decoder.py -> SramStats
+typedef struct {
+    uint32_t static_size; // .data and .bss
+    uint32_t arena_size;  // .arena
+    uint32_t stack_size;  // from the end of the arena to the top of SRAM_RW
+    uint32_t stack_peak;  // most of the stack used since reset, 0 on the host build
+} sram_stats_t;
+
+static_assert(sizeof(sram_stats_t) == 16);
+
+void get_sram_stats(sram_stats_t* stats);
@@ -14,3 +14,15 @@ void* memset(void* b, int c, size_t len);
 void* memcpy(void* restrict dst, const void* restrict src, size_t n);
 
 int memcmp(const void* vl, const void* vr, size_t n);
+
+/**
+ * @brief memset that is never optimized away, for wiping secrets (C23)
+ */
+void* memset_explicit(void* b, int c, size_t len);
+
+/**
+ * @brief Compares secrets in time that only depends on n
+ *
+ * @return 0 if the buffers are equal, 1 otherwise
+ */
+int timingsafe_bcmp(const void* b1, const void* b2, size_t n);
@@ -9,14 +9,14 @@
 
 #include "common.h"
 #include "crypto_wrappers.h"
+#include "key_tree.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #define MAX_CHANNEL_COUNT 9
 
-#define MAX_TREE_KEYS 126
-
 // match: gen_subscription.py -> ValidSubscription
 typedef struct {
     uint8_t ktree[MAX_TREE_KEYS][TREE_KEY_LEN];
@@ -29,7 +29,7 @@ typedef struct {
     uint8_t _pad[4]; // to ensure struct is a multiple of 16 bytes (flash write size)
 } valid_subscription_t;
 
-static_assert(sizeof(valid_subscription_t) == 2080);
+static_assert(sizeof(valid_subscription_t) == MAX_TREE_KEYS * TREE_KEY_LEN + 64);
 
 // match: gen_subscription.py -> SubscriptionUpdate
 typedef struct subscription_update {
@@ -41,9 +41,89 @@ typedef struct subscription_update {
     uint8_t sig[SIGNATURE_LEN];
 } subscription_update_t;
 
-static_assert(sizeof(subscription_update_t) == 2188);
+static_assert(sizeof(subscription_update_t) == sizeof(valid_subscription_t) + 108);
+
+#define SUBSCRIPTION_UPDATE_VERSION_2 2
+
+// The fields of valid_subscription_t, followed by only key_count tree keys. Also the layout of the
+// channel 0 subscription in flash.
+// match: gen_subscription.py -> ValidSubscriptionV2
+typedef struct {
+    uint8_t kch[SYMMETRIC_KEY_LEN];
+    timestamp_t start;
+    timestamp_t end;
+    channel_t channel;
+    uint32_t key_count;
+    uint32_t magic;
+    uint8_t _pad[4]; // tree keys start on a flash line
+    uint8_t ktree[][TREE_KEY_LEN];
+} valid_subscription_v2_t;
+
+static_assert(sizeof(valid_subscription_v2_t) == 64);
+
+// Sized by key_count instead of MAX_TREE_KEYS, signed over everything after sig. The ciphertext
+// holds a valid_subscription_v2_t with key_count tree keys, see SUBSCRIPTION_UPDATE_V2_LEN().
+// match: gen_subscription.py -> SubscriptionUpdateHeaderV2
+typedef struct subscription_update_v2 {
+    uint8_t sig[SIGNATURE_LEN];
+    uint32_t version; // SUBSCRIPTION_UPDATE_VERSION_2
+    decoder_id_t id;
+    uint32_t key_count;
+    uint8_t _pad[4];
+    uint8_t ciphertext[];
+} subscription_update_v2_t;
+
+static_assert(sizeof(subscription_update_v2_t) == SIGNATURE_LEN + 16);
+
+// match: gen_subscription.py -> subscription_update_v2_len()
+#define SUBSCRIPTION_UPDATE_V2_LEN(key_count)                                                      \
+    (sizeof(subscription_update_v2_t) + SYMMETRIC_METADATA_LEN + sizeof(valid_subscription_v2_t) + \
+     (size_t)(key_count) * TREE_KEY_LEN)
+
+// Largest subscription update of either version
+#define MAX_SUBSCRIPTION_UPDATE_LEN SUBSCRIPTION_UPDATE_V2_LEN(MAX_TREE_KEYS)
+
+static_assert(MAX_SUBSCRIPTION_UPDATE_LEN >= sizeof(subscription_update_t));
+
+// main.c tells the versions apart by length
+static_assert(SUBSCRIPTION_UPDATE_V2_LEN(0) % TREE_KEY_LEN !=
+              sizeof(subscription_update_t) % TREE_KEY_LEN);
+
+/**
+ * @brief Checks that a v2 update is as long as its key count says, before anything else reads it
+ *
+ * @param update received update, of at least MAX_SUBSCRIPTION_UPDATE_LEN bytes of buffer
+ * @param length received length
+ * @return true if the length matches
+ */
+static inline bool subscription_update_v2_length_ok(const subscription_update_v2_t* update,
+                                                    size_t length) {
+    return length >= sizeof(*update) && update->key_count <= MAX_TREE_KEYS &&
+           length == SUBSCRIPTION_UPDATE_V2_LEN(update->key_count);
+}
+
+/**
+ * @brief SRAM copy of everything but the tree keys of a stored subscription
+ *
+ * Kept in sync with flash by update_subscription(). generation changes whenever the subscription
+ * is replaced, so anything derived from its tree keys can tell when it is stale.
+ */
+typedef struct {
+    bool valid;
+    const uint8_t* ktree; // tree keys in flash, moves when the journal is compacted
+    channel_t channel;
+    timestamp_t start;
+    timestamp_t end;
+    uint32_t key_count;
+    uint32_t generation;
+    uint8_t kch[SYMMETRIC_KEY_LEN];
+} subscription_info_t;
+
+void subscription_init(void);
 
-const valid_subscription_t* get_subscription(size_t i);
-const valid_subscription_t* get_subscription_by_channel(channel_t ch);
+const subscription_info_t* get_subscription(size_t i);
+const subscription_info_t* get_subscription_by_channel(channel_t ch);
+const uint8_t* get_subscription_tree_key(const subscription_info_t* sub, size_t index);
 
 error_t update_subscription(const subscription_update_t* update_package);
+error_t update_subscription_v2(subscription_update_v2_t* update_package);
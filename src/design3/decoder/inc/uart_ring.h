@@ -0,0 +1,112 @@
+/**
+ * @file uart_ring.h
+ * @brief Single-producer, single-consumer byte ring shared between the UART IRQ and the main loop
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Each index is only ever written by one side, so no locking is needed as long as 32-bit loads and
+ * stores are atomic. Nothing in here touches hardware, so the same code runs in a host build.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Ring of `size` bytes, size must be a power of two
+ *
+ * head and tail count bytes and wrap around at 2^32, head - tail is the fill level.
+ */
+typedef struct {
+    uint8_t* data;
+    uint32_t size;
+    volatile uint32_t head; // written by the producer only
+    volatile uint32_t tail; // written by the consumer only
+} uart_ring_t;
+
+// Keeps the compiler from moving data accesses across the index accesses that guard them
+#define UART_RING_BARRIER() __asm__ volatile("" ::: "memory")
+
+#define UART_RING_INIT(buf) {.data = (buf), .size = sizeof(buf), .head = 0, .tail = 0}
+
+static inline uint32_t uart_ring_used(const uart_ring_t* ring) { return ring->head - ring->tail; }
+
+static inline bool uart_ring_empty(const uart_ring_t* ring) { return ring->head == ring->tail; }
+
+static inline bool uart_ring_full(const uart_ring_t* ring) {
+    return uart_ring_used(ring) == ring->size;
+}
+
+/**
+ * @brief Adds a byte, producer side
+ *
+ * @return false if the ring is full
+ */
+static inline bool uart_ring_push(uart_ring_t* ring, uint8_t byte) {
+    if (uart_ring_full(ring)) {
+        return false;
+    }
+    UART_RING_BARRIER();
+    ring->data[ring->head & (ring->size - 1)] = byte;
+    UART_RING_BARRIER();
+    ring->head = ring->head + 1; // publish after the byte is stored
+    return true;
+}
+
+/**
+ * @brief Removes a byte, consumer side
+ *
+ * @return false if the ring is empty
+ */
+static inline bool uart_ring_pop(uart_ring_t* ring, uint8_t* byte) {
+    if (uart_ring_empty(ring)) {
+        return false;
+    }
+    UART_RING_BARRIER();
+    *byte = ring->data[ring->tail & (ring->size - 1)];
+    UART_RING_BARRIER();
+    ring->tail = ring->tail + 1; // release the slot after the byte is read
+    return true;
+}
+
+/**
+ * @brief Removes up to `length` bytes at once, consumer side
+ *
+ * @return number of bytes removed
+ */
+static inline size_t uart_ring_read(uart_ring_t* ring, uint8_t* output, size_t length) {
+    uint32_t tail = ring->tail;
+    uint32_t available = ring->head - tail;
+    if (length > available) {
+        length = available;
+    }
+    UART_RING_BARRIER();
+    for (size_t i = 0; i < length; i++) {
+        output[i] = ring->data[(tail + i) & (ring->size - 1)];
+    }
+    UART_RING_BARRIER();
+    ring->tail = tail + length;
+    return length;
+}
+
+/**
+ * @brief Adds up to `length` bytes at once, producer side
+ *
+ * @return number of bytes added
+ */
+static inline size_t uart_ring_write(uart_ring_t* ring, const uint8_t* input, size_t length) {
+    uint32_t head = ring->head;
+    uint32_t space = ring->size - (head - ring->tail);
+    if (length > space) {
+        length = space;
+    }
+    UART_RING_BARRIER();
+    for (size_t i = 0; i < length; i++) {
+        ring->data[(head + i) & (ring->size - 1)] = input[i];
+    }
+    UART_RING_BARRIER();
+    ring->head = head + length;
+    return length;
+}
@@ -15,10 +15,15 @@
  * or unreachable system state is detected, and should never be
  * possible to reach during normal operation.
  */
+#if HOST_BUILD
+// Nothing to glitch on the host build, where do_spin_forever() reports the halt
+#define HALT_AND_CATCH_FIRE() do_spin_forever();
+#else
 #define HALT_AND_CATCH_FIRE()                                                                      \
     FI_PROTECT_0;                                                                                  \
     do_spin_forever();                                                                             \
     FI_PROTECT_2;
+#endif
 
 /**
  * @brief Assert and HCF if failed
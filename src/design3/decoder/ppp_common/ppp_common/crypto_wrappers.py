@@ -7,6 +7,7 @@
 
 from .cstruct import cstruct
 
+import hashlib
 import monocypher
 import struct
 
@@ -18,6 +19,12 @@ SYMMETRIC_METADATA_LEN = SYMMETRIC_NONCE_LEN + SYMMETRIC_MAC_LEN
 TREE_KEY_LEN = 16
 TREE_LEFT_RIGHT_LEN = 32
 
+# Key tree KDF versions, match: crypto_wrappers.h -> TREE_KDF_*
+# BLAKE2s works on 32-bit words, which is much cheaper on the decoder's Cortex-M4
+TREE_KDF_BLAKE2B = 1
+TREE_KDF_BLAKE2S = 2
+TREE_KDF_VERSIONS = (TREE_KDF_BLAKE2B, TREE_KDF_BLAKE2S)
+
 PUBLIC_KEY_LEN = 64
 PRIVATE_KEY_LEN = 64
 SIGNATURE_LEN = 64
@@ -55,28 +62,61 @@ def hash_length(message: bytes, hash_size: int = 64) -> bytes:
     return hash
 
 
+# match: crypto_wrappers.c -> tree_hash()
+def tree_hash(message: bytes, hash_size: int, version: int) -> bytes:
+    if version == TREE_KDF_BLAKE2B:
+        return hash_length(message, hash_size)
+    elif version == TREE_KDF_BLAKE2S:
+        return hashlib.blake2s(message, digest_size=hash_size).digest()
+    else:
+        raise ValueError(f"unknown tree KDF version {version}")
+
+
 # match: crypto_wrappers.c -> kdf_tree_child() -> tmp
 class TreeChildTmp(metaclass=cstruct):
     parent: bytes = f"{TREE_KEY_LEN}s"
     left_right: bytes = f"{TREE_LEFT_RIGHT_LEN}s"
 
 
-def kdf_tree_child(parent_key: bytes, left_right: bytes) -> bytes:
+def kdf_tree_child(parent_key: bytes, left_right: bytes, version: int) -> bytes:
     assert len(parent_key) == TREE_KEY_LEN
     assert len(left_right) == TREE_LEFT_RIGHT_LEN
 
     packed = TreeChildTmp(parent_key, left_right).pack()
 
-    child_key = hash_length(packed, TREE_KEY_LEN)
+    child_key = tree_hash(packed, TREE_KEY_LEN, version)
+
+    assert len(child_key) == TREE_KEY_LEN
+    return child_key
+
+
+# match: crypto_wrappers.c -> tree_child_wide() -> tmp
+class TreeChildWideTmp(metaclass=cstruct):
+    parent: bytes = f"{TREE_KEY_LEN}s"
+    tree_key: bytes = f"{TREE_LEFT_RIGHT_LEN}s"
+    child: int = "I"
+
+
+# Child KDF of trees wider than binary, the child index tells the children apart
+def kdf_tree_child_wide(
+    parent_key: bytes, tree_key: bytes, child: int, version: int
+) -> bytes:
+    assert len(parent_key) == TREE_KEY_LEN
+    assert len(tree_key) == TREE_LEFT_RIGHT_LEN
+    assert 0 <= child < 2**32
+
+    packed = TreeChildWideTmp(parent_key, tree_key, child).pack()
+
+    child_key = tree_hash(packed, TREE_KEY_LEN, version)
 
     assert len(child_key) == TREE_KEY_LEN
     return child_key
 
 
-def kdf_tree_leaf(leaf_key: bytes) -> bytes:
+def kdf_tree_leaf(leaf_key: bytes, version: int) -> bytes:
     assert len(leaf_key) == TREE_KEY_LEN
 
-    frame_key = hash_length(leaf_key, SYMMETRIC_KEY_LEN)
+    frame_key = tree_hash(leaf_key, SYMMETRIC_KEY_LEN, version)
 
     assert len(frame_key) == SYMMETRIC_KEY_LEN
     return frame_key
@@ -0,0 +1,154 @@
+"""
+@file expansion_budget.py
+@brief Flash budget and per-frame cost of the decoder's key expansion (key_expansion.c)
+@author Plaid Parliament of Pwning
+@copyright Copyright (c) 2025 Carnegie Mellon University
+
+At subscribe time the decoder derives every key tree vertex --frame-bits above the leaves that
+lies inside the subscription into a one-page flash slot, or the deepest level above it that fits,
+so frames only derive the levels below. This replays that choice for a subscription range and
+reports the flash used, the derivations spent at subscribe time and the worst per-frame cost.
+The cycle estimates take the per-derivation cycles from a decoder built with
+DECODER_BENCH_KDF=1.
+"""
+
+from .gen_subscription import vertices_for_range
+from .key_tree import MAX_TREE_HEIGHT, TREE_ARITY_BITS_CHOICES, tree_levels
+
+import argparse
+
+# match: key_expansion.h
+EXPANSION_PAGE_SIZE = 8192
+EXPANSION_MAX_KEYS = 509
+EXPANSION_SLOTS = 9  # MAX_CHANNEL_COUNT
+
+# match: firmware.ld.template (FLASH_NOLOAD, less the subscription journal)
+FREE_FLASH = 0x38000 - 0x20000
+
+
+# match: key_expansion.c -> expansion_level()
+def expansion_level(start: int, end: int, arity_bits: int, frame_bits: int):
+    """
+    Expanded level of a subscription and its vertices inside [start, end]
+
+    :returns: (level in bits, prefix of the first vertex, number of vertices), with no vertices
+        if nothing is expanded
+    """
+    assert frame_bits % arity_bits == 0
+    bits = MAX_TREE_HEIGHT - frame_bits
+    while bits > 0:
+        shift = MAX_TREE_HEIGHT - bits
+        lo = -(-start >> shift)  # first vertex starting at or after start
+        hi = ((end + 1) >> shift) - 1  # last vertex ending at or before end
+        if hi < lo:
+            return bits, 0, 0
+        if hi - lo < EXPANSION_MAX_KEYS:
+            return bits, lo, hi - lo + 1
+        bits -= arity_bits
+    return 0, 0, 0
+
+
+def packaged_vertex(vertices, t: int):
+    """Packaged vertex of a subscription above timestamp t"""
+    for v in vertices:
+        if t >> (MAX_TREE_HEIGHT - v.bits) == v.prefix:
+            return v
+    raise ValueError(f"{t} is not in the subscription")
+
+
+# match: frame.c -> derive_vertex_keys()
+def expansion_derivations(vertices, arity_bits: int, bits: int, first: int, count: int):
+    """Child derivations to expand a subscription, sharing paths like the decoder does"""
+    depth = bits // arity_bits
+    total = 0
+    root = prev = None
+    for i in range(count):
+        t = (first + i) << (MAX_TREE_HEIGHT - bits)
+        v = packaged_vertex(vertices, t)
+        level = v.bits // arity_bits
+        if v == root:
+            common = (MAX_TREE_HEIGHT - (t ^ prev).bit_length()) // arity_bits
+            level = max(level, min(common, depth))
+        total += depth - level
+        root, prev = v, t
+    return total
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Key expansion flash budget and frame cost")
+    parser.add_argument(
+        "start", type=lambda x: int(x, 0), help="Subscription start timestamp"
+    )
+    parser.add_argument("end", type=lambda x: int(x, 0), help="Subscription end timestamp")
+    parser.add_argument(
+        "--frame-bits",
+        type=int,
+        default=16,
+        help="Bits above the leaves to expand at, DECODER_EXPANSION_BITS (default 16)",
+    )
+    parser.add_argument(
+        "--child-cycles", type=int, help="Cycles of one child derivation on the decoder"
+    )
+    parser.add_argument(
+        "--leaf-cycles", type=int, default=0, help="Cycles of the leaf derivation"
+    )
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    if args.end < args.start:
+        raise SystemExit("end before start")
+
+    columns = ["arity", "level", "keys", "slot bytes", "expand", "frame", "unexpanded"]
+    if args.child_cycles is not None:
+        columns += ["expand cycles", "frame cycles", "unexpanded cycles"]
+
+    rows = []
+    for k in TREE_ARITY_BITS_CHOICES:
+        vertices = vertices_for_range(args.start, args.end, k)
+        unexpanded = tree_levels(k) - min(v.bits for v in vertices) // k
+
+        if args.frame_bits % k != 0:
+            rows.append([str(1 << k), "-", "-", "-", "-", "-", str(unexpanded)])
+            rows[-1] += ["-"] * (len(columns) - len(rows[-1]))
+            continue
+
+        bits, first, count = expansion_level(args.start, args.end, k, args.frame_bits)
+        expand = expansion_derivations(vertices, k, bits, first, count)
+        # frames below an expanded vertex, or below a packaged vertex deeper than the level
+        frame = (MAX_TREE_HEIGHT - bits) // k if count else unexpanded
+        row = [
+            str(1 << k),
+            str(bits) if count else "-",
+            str(count),
+            f"{48 + count * 16} B",
+            str(expand),
+            str(frame),
+            str(unexpanded),
+        ]
+        if args.child_cycles is not None:
+            row += [
+                str(expand * args.child_cycles),
+                str(frame * args.child_cycles + args.leaf_cycles),
+                str(unexpanded * args.child_cycles + args.leaf_cycles),
+            ]
+        rows.append(row)
+
+    widths = [max(len(c), *(len(r[i]) for r in rows)) for i, c in enumerate(columns)]
+    print("  ".join(c.rjust(w) for c, w in zip(columns, widths)))
+    for row in rows:
+        print("  ".join(v.rjust(w) for v, w in zip(row, widths)))
+    print()
+    print("level: expanded tree level in bits, keys: expanded vertices in the slot")
+    print("expand: child derivations at subscribe time")
+    print("frame/unexpanded: most child derivations per frame with/without expansion")
+    print(
+        f"flash: {EXPANSION_SLOTS} slots of {EXPANSION_PAGE_SIZE} B "
+        f"({EXPANSION_SLOTS * EXPANSION_PAGE_SIZE} B of {FREE_FLASH} B free after the "
+        f"journal), one per subscription, at most {EXPANSION_MAX_KEYS} keys each"
+    )
+
+
+if __name__ == "__main__":
+    main()
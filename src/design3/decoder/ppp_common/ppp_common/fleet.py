@@ -0,0 +1,80 @@
+"""
+@file fleet.py
+@brief Per-device inputs of a fleet build: secrets.c, linker script and channel 0
+@author Plaid Parliament of Pwning
+@copyright Copyright (c) 2025 Carnegie Mellon University
+
+build.sh fleet compiles everything but secrets.c once, then links one image per decoder
+ID. Only these inputs differ between the images, and they are all generated here in one
+process, reading the global secrets and the objects' sections once instead of per ID.
+"""
+
+from .gen_secrets import GlobalSecrets
+from .gen_secrets_c import generate as generate_secrets_c
+from .gen_subscription import gen_embeddable_subscription
+from .symbol_shimmy import add_layout_args, layout, read_sections
+
+import argparse
+from pathlib import Path
+import re
+from string import Template
+
+
+def parse_ids(ids: str) -> list[int]:
+    """Decoder IDs separated by whitespace or commas, hex or decimal"""
+    return [int(x, 0) for x in re.split(r"[\s,]+", ids.strip()) if x]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--template", required=True)
+    parser.add_argument("--secrets", type=Path, required=True)
+    parser.add_argument(
+        "--ids", type=parse_ids, required=True, help="Decoder IDs of the fleet"
+    )
+    parser.add_argument(
+        "--out-dir",
+        type=Path,
+        required=True,
+        help="Directory to create a directory per decoder ID in",
+    )
+    add_layout_args(parser)
+    parser.add_argument("objects", nargs="+", help="Objects shared by every image")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    if len(set(args.ids)) != len(args.ids):
+        raise SystemExit("duplicate decoder IDs")
+
+    serialized_secrets = args.secrets.read_bytes()
+    secrets = GlobalSecrets.deserialize(serialized_secrets)
+    with open(args.template, "r") as f:
+        template = Template(f.read())
+    text_syms, sizes = read_sections(args.objects)
+
+    # build.sh links every directory listed in devices.txt
+    devices = []
+    for decoder_id in args.ids:
+        device_dir = args.out_dir / f"{decoder_id:#010x}"
+        device_dir.mkdir(parents=True, exist_ok=True)
+
+        generate_secrets_c(args.secrets, device_dir / "secrets.c", decoder_id, None)
+
+        seed = secrets.symbol_shimmy_seed(decoder_id)
+        script, _ = layout(template, seed, text_syms, sizes, args)
+        (device_dir / "firmware.ld").write_text(script + "\n")
+
+        channel0 = gen_embeddable_subscription(
+            serialized_secrets, decoder_id, 0, 0xFFFF_FFFF_FFFF_FFFF, 0
+        )
+        (device_dir / "channel0.bin").write_bytes(channel0)
+
+        devices.append(str(device_dir))
+
+    (args.out_dir / "devices.txt").write_text("\n".join(devices) + "\n")
+
+
+if __name__ == "__main__":
+    main()
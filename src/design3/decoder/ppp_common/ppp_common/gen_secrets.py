@@ -7,12 +7,18 @@
 
 from .crypto_wrappers import (
     kdf_tree_child,
+    kdf_tree_child_wide,
+    kdf_tree_leaf,
     kdf_id,
     kdf_symbol_shimmy,
     TREE_KEY_LEN,
     TREE_LEFT_RIGHT_LEN,
+    TREE_KDF_BLAKE2B,
+    TREE_KDF_BLAKE2S,
+    TREE_KDF_VERSIONS,
     SYMMETRIC_KEY_LEN,
 )
+from .key_tree import MAX_TREE_HEIGHT, TREE_ARITY_BITS_CHOICES
 
 import monocypher
 import argparse
@@ -52,9 +58,19 @@ class GlobalSecrets:
     right_tree_key: bytes
     tree_root_keys: dict[int, bytes]
     symbol_shimmy_root_key: bytes
+    tree_kdf: int
+    tree_arity_bits: int
 
     @classmethod
-    def generate(cls, channels: list[int]) -> Self:
+    def generate(
+        cls,
+        channels: list[int],
+        tree_kdf: int = TREE_KDF_BLAKE2S,
+        tree_arity_bits: int = 1,
+    ) -> Self:
+        assert tree_kdf in TREE_KDF_VERSIONS
+        assert tree_arity_bits in TREE_ARITY_BITS_CHOICES
+
         enc_private_key, enc_public_key = monocypher.generate_signing_key_pair()
 
         channel_keys = {
@@ -74,6 +90,8 @@ class GlobalSecrets:
             right_tree_key=monocypher.generate_key(TREE_LEFT_RIGHT_LEN),
             tree_root_keys=tree_root_keys,
             symbol_shimmy_root_key=monocypher.generate_key(SYMMETRIC_KEY_LEN),
+            tree_kdf=tree_kdf,
+            tree_arity_bits=tree_arity_bits,
         )
 
     def serialize(self) -> bytes:
@@ -90,6 +108,8 @@ class GlobalSecrets:
             "RIGHT_TREE_KEY": to_base64(self.right_tree_key),
             "TREE_ROOT_KEYS": tree_root_keys,
             "SYMBOL_SHIMMY_ROOT_KEY": to_base64(self.symbol_shimmy_root_key),
+            "TREE_KDF": self.tree_kdf,
+            "TREE_ARITY_BITS": self.tree_arity_bits,
         }
 
         return json.dumps(secrets).encode("ascii")
@@ -115,6 +135,9 @@ class GlobalSecrets:
             from_base64(secrets["RIGHT_TREE_KEY"]),
             tree_root_keys,
             from_base64(secrets["SYMBOL_SHIMMY_ROOT_KEY"]),
+            # secrets from before the KDF was versioned all use BLAKE2b
+            secrets.get("TREE_KDF", TREE_KDF_BLAKE2B),
+            secrets.get("TREE_ARITY_BITS", 1),
         )
 
     def derive_id_key(self, device_id: int) -> bytes:
@@ -124,7 +147,8 @@ class GlobalSecrets:
 
     def derive_tree_key(self, ch: int, vertex: Vertex) -> bytes:
         assert 0 <= ch < 2**32
-        assert vertex.bits >= 0
+        assert 0 <= vertex.bits <= MAX_TREE_HEIGHT
+        assert vertex.bits % self.tree_arity_bits == 0
         assert 0 <= vertex.prefix < (1 << vertex.bits)
 
         root_key = self.tree_root_keys.get(ch)
@@ -137,27 +161,31 @@ class GlobalSecrets:
 
         key = root_key
 
-        if vertex.bits == 0:
-            return key
-
-        bitmask = 1 << (vertex.bits - 1)
-
-        for _ in range(vertex.bits):
-            curr_direction = vertex.prefix & bitmask
-            if curr_direction == 0:
-                key = kdf_tree_child(key, left_tree_key)
+        # walk the digits of the prefix from the most significant one
+        k = self.tree_arity_bits
+        for shift in range(vertex.bits - k, -1, -k):
+            child = (vertex.prefix >> shift) & ((1 << k) - 1)
+            if k > 1:
+                key = kdf_tree_child_wide(key, left_tree_key, child, self.tree_kdf)
+            elif child == 0:
+                key = kdf_tree_child(key, left_tree_key, self.tree_kdf)
             else:
-                key = kdf_tree_child(key, right_tree_key)
-            bitmask >>= 1
+                key = kdf_tree_child(key, right_tree_key, self.tree_kdf)
 
         return key
 
+    def derive_frame_key(self, ch: int, timestamp: int) -> bytes:
+        leaf_vertex = Vertex(prefix=timestamp, bits=MAX_TREE_HEIGHT)
+        return kdf_tree_leaf(self.derive_tree_key(ch, leaf_vertex), self.tree_kdf)
+
     def symbol_shimmy_seed(self, id: int) -> bytes:
         return kdf_symbol_shimmy(self.symbol_shimmy_root_key, id)
 
 
-def gen_secrets(channels: list[int]) -> bytes:
-    secrets = GlobalSecrets.generate(channels)
+def gen_secrets(
+    channels: list[int], tree_kdf: int = TREE_KDF_BLAKE2S, tree_arity_bits: int = 1
+) -> bytes:
+    secrets = GlobalSecrets.generate(channels, tree_kdf, tree_arity_bits)
     return secrets.serialize()
 
 
@@ -170,6 +198,21 @@ def parse_args():
         action="store_true",
         help="Force creation of secrets file, overwriting existing file",
     )
+    parser.add_argument(
+        "--tree-kdf",
+        type=int,
+        choices=TREE_KDF_VERSIONS,
+        default=TREE_KDF_BLAKE2S,
+        help="Key tree KDF version: 1 = BLAKE2b, 2 = BLAKE2s (default, faster on the decoder)",
+    )
+    parser.add_argument(
+        "--tree-arity",
+        type=int,
+        choices=[1 << k for k in TREE_ARITY_BITS_CHOICES],
+        default=2,
+        help="Children per key tree vertex: wider trees derive frame keys in fewer steps but "
+        "need larger subscriptions (see python -m ppp_common.tree_cost)",
+    )
     parser.add_argument(
         "secrets_file",
         type=Path,
@@ -187,7 +230,8 @@ def parse_args():
 def main():
     args = parse_args()
 
-    secrets = gen_secrets(args.channels)
+    tree_arity_bits = args.tree_arity.bit_length() - 1
+    secrets = gen_secrets(args.channels, args.tree_kdf, tree_arity_bits)
 
     with open(args.secrets_file, "wb" if args.force else "xb") as f:
         f.write(secrets)
@@ -25,7 +25,25 @@ def convert_to_byte_arr(key: bytes):
     return f"{{\n{'\n'.join(result)}}}"
 
 
-def generate(secrets_file: Path, header_file: Path, decoder_id: int):
+def generate_config(global_secrets: GlobalSecrets, config_file: Path):
+    with open(config_file, "w") as f:
+        f.write(f"""\
+/**
+ * @file tree_config.h
+ * @author Plaid Parliament of Pwning
+ * @brief Key tree parameters of the deployment, regenerated during build (see key_tree.h)
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#pragma once
+
+#define TREE_ARITY_BITS {global_secrets.tree_arity_bits}
+""")
+
+
+def generate(
+    secrets_file: Path, header_file: Path, decoder_id: int, config_file: Path | None
+):
     with open(secrets_file, "rb") as f:
         serialized_secrets = f.read()
 
@@ -35,6 +53,10 @@ def generate(secrets_file: Path, header_file: Path, decoder_id: int):
     id_key = global_secrets.derive_id_key(decoder_id)
     left_tree_key = global_secrets.left_tree_key
     right_tree_key = global_secrets.right_tree_key
+    tree_kdf = global_secrets.tree_kdf
+
+    if config_file is not None:
+        generate_config(global_secrets, config_file)
 
     with open(header_file, "w") as f:
         f.write(f"""\
@@ -57,11 +79,18 @@ const uint8_t ID_KEY[SYMMETRIC_KEY_LEN] = {convert_to_byte_arr(id_key)};
 const uint8_t LEFT_TREE_KEY[SYMMETRIC_KEY_LEN] = {convert_to_byte_arr(left_tree_key)};
 
 const uint8_t RIGHT_TREE_KEY[SYMMETRIC_KEY_LEN] = {convert_to_byte_arr(right_tree_key)};
+
+const uint32_t TREE_KDF_VERSION = {tree_kdf};
 """)
 
 
 def parse_args():
     parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--config-header",
+        type=Path,
+        help="Path to the key tree config header to be created",
+    )
     parser.add_argument(
         "secrets_file",
         type=Path,
@@ -83,7 +112,7 @@ def parse_args():
 def main():
     args = parse_args()
 
-    generate(args.secrets_file, args.header_file, args.decoder_id)
+    generate(args.secrets_file, args.header_file, args.decoder_id, args.config_header)
 
 
 if __name__ == "__main__":
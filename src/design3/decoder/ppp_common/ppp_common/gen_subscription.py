@@ -15,19 +15,63 @@ from .crypto_wrappers import (
     SIGNATURE_LEN,
 )
 from .gen_secrets import GlobalSecrets, Vertex
+from .key_tree import MAX_TREE_HEIGHT, max_tree_keys
 
 import argparse
+import functools
 from pathlib import Path
 
 
 SUBSCRIPTION_MAGIC = 0x41594E42  # BNYA
 
-MAX_TREE_KEYS = 126
+SUBSCRIPTION_UPDATE_VERSION_1 = 1
+SUBSCRIPTION_UPDATE_VERSION_2 = 2
+SUBSCRIPTION_UPDATE_VERSIONS = (
+    SUBSCRIPTION_UPDATE_VERSION_1,
+    SUBSCRIPTION_UPDATE_VERSION_2,
+)
+
+
+# The version 1 subscription structs hold MAX_TREE_KEYS keys, which depends on the tree arity
+@functools.cache
+def subscription_structs(arity_bits: int):
+    max_keys = max_tree_keys(arity_bits)
+
+    # match: subscription.h -> valid_subscription_t
+    class ValidSubscription(metaclass=cstruct):
+        ktree: bytes = f"{max_keys * TREE_KEY_LEN}s"
+        kch: bytes = f"{SYMMETRIC_KEY_LEN}s"
+        start: int = "Q"
+        end: int = "Q"
+        channel: int = "I"
+        key_count: int = "I"
+        magic: int = "I"
+        pad: bytes = "4s"
+
+    assert ValidSubscription.size == max_keys * TREE_KEY_LEN + 64
+
+    # match subscription.h -> subscription_update_t -> payload
+    class SubscriptionUpdatePayload(metaclass=cstruct):
+        id: int = "I"
+        ciphertext: bytes = f"{SYMMETRIC_METADATA_LEN + ValidSubscription.size}s"
+
+    assert SubscriptionUpdatePayload.size == ValidSubscription.size + 44
 
+    # match subscription.c -> subscription_update_t
+    class SubscriptionUpdate(metaclass=cstruct):
+        payload: bytes = f"{SubscriptionUpdatePayload.size}s"
+        sig: bytes = f"{SIGNATURE_LEN}s"
 
-# match: subscription.h -> valid_subscription_t
-class ValidSubscription(metaclass=cstruct):
-    ktree: bytes = f"{MAX_TREE_KEYS * TREE_KEY_LEN}s"
+    assert SubscriptionUpdate.size == ValidSubscription.size + 108
+
+    return ValidSubscription, SubscriptionUpdatePayload, SubscriptionUpdate
+
+
+assert subscription_structs(1)[2].size == 2188
+
+
+# match: subscription.h -> valid_subscription_v2_t, followed by key_count tree keys
+class ValidSubscriptionV2(metaclass=cstruct):
     kch: bytes = f"{SYMMETRIC_KEY_LEN}s"
     start: int = "Q"
     end: int = "Q"
@@ -37,43 +81,55 @@ class ValidSubscription(metaclass=cstruct):
     pad: bytes = "4s"
 
 
-assert ValidSubscription.size == 2080
+assert ValidSubscriptionV2.size == 64
 
 
-# match subscription.h -> subscription_update_t -> payload
-class SubscriptionUpdatePayload(metaclass=cstruct):
+# match: subscription.h -> subscription_update_v2_t, after sig and before the ciphertext
+class SubscriptionUpdateHeaderV2(metaclass=cstruct):
+    version: int = "I"
     id: int = "I"
-    ciphertext: bytes = f"{SYMMETRIC_METADATA_LEN + ValidSubscription.size}s"
+    key_count: int = "I"
+    pad: bytes = "4s"
 
 
-assert SubscriptionUpdatePayload.size == 2124
+assert SubscriptionUpdateHeaderV2.size == 16
 
 
-# match subscription.c -> subscription_update_t
-class SubscriptionUpdate(metaclass=cstruct):
-    payload: bytes = f"{SubscriptionUpdatePayload.size}s"
-    sig: bytes = f"{SIGNATURE_LEN}s"
+# match: subscription.h -> SUBSCRIPTION_UPDATE_V2_LEN()
+def subscription_update_v2_len(key_count: int) -> int:
+    return (
+        SIGNATURE_LEN
+        + SubscriptionUpdateHeaderV2.size
+        + SYMMETRIC_METADATA_LEN
+        + ValidSubscriptionV2.size
+        + key_count * TREE_KEY_LEN
+    )
 
 
-assert SubscriptionUpdate.size == 2188
+# The decoder tells the versions apart by length, a version 2 update is never as long as a
+# version 1 update of any arity (whose length is 12 mod 16)
+assert subscription_update_v2_len(0) % TREE_KEY_LEN == 8
+assert subscription_structs(1)[2].size % TREE_KEY_LEN == 12
 
 
-def vertices_for_range(start: int, end: int) -> list[Vertex]:
+# match: frame.c -> key_index_for_time()
+def vertices_for_range(start: int, end: int, arity_bits: int = 1) -> list[Vertex]:
+    mask = (1 << arity_bits) - 1
     keys_front = []
     keys_back = []
-    bits = 64
+    bits = MAX_TREE_HEIGHT
     while start != end:
         assert start < end
-        if start & 1 == 0 and end & 1 == 1:
+        if start & mask == 0 and end & mask == mask:
             # We can move up a level
-            start >>= 1
-            end >>= 1
-            bits -= 1
-        elif start & 1 == 1:
+            start >>= arity_bits
+            end >>= arity_bits
+            bits -= arity_bits
+        elif start & mask != 0:
             # start cannot be contracted, package it
             keys_front.append(Vertex(start, bits))
             start += 1
-        else:  # end & 1 == 0
+        else:  # end & mask != mask
             # end cannot be contracted, package it
             keys_back.append(Vertex(end, bits))
             end -= 1
@@ -82,24 +138,48 @@ def vertices_for_range(start: int, end: int) -> list[Vertex]:
 
 
 def gen_embeddable_subscription(
-    secrets: bytes, device_id: int, start: int, end: int, channel: int
+    secrets: bytes,
+    device_id: int,
+    start: int,
+    end: int,
+    channel: int,
+    version: int = SUBSCRIPTION_UPDATE_VERSION_2,
 ) -> bytes:
     """
-    Generate a subscription that can be directly placed in flash
+    Generate a subscription that can be directly placed in flash, in the layout of the given
+    update version: version 1 pads the tree keys to MAX_TREE_KEYS, version 2 holds only the
+    subscription's keys, after the other fields
     """
+    if version not in SUBSCRIPTION_UPDATE_VERSIONS:
+        raise ValueError(f"Unknown subscription update version {version}")
+
     # Deserialize the contents of the secrets file + create the instance of GlobalSecrets
     secrets = GlobalSecrets.deserialize(secrets)
 
     # Utilize kch from the secrets file for the given channel number
     kch = secrets.channel_keys[channel]
 
-    vertices = vertices_for_range(start, end)
+    vertices = vertices_for_range(start, end, secrets.tree_arity_bits)
+    assert len(vertices) <= max_tree_keys(secrets.tree_arity_bits)
     ktree = b""
     for v in vertices:
         ktree += secrets.derive_tree_key(channel, v)
 
     assert len(ktree) == len(vertices) * TREE_KEY_LEN
 
+    if version == SUBSCRIPTION_UPDATE_VERSION_2:
+        valid_subscription = ValidSubscriptionV2(
+            kch=kch,
+            start=start,
+            end=end,
+            channel=channel,
+            key_count=len(vertices),
+            magic=SUBSCRIPTION_MAGIC,
+            pad=b"",
+        )
+        return valid_subscription.pack() + ktree
+
+    ValidSubscription, _, _ = subscription_structs(secrets.tree_arity_bits)
     valid_subscription = ValidSubscription(
         ktree=ktree,
         kch=kch,
@@ -115,14 +195,19 @@ def gen_embeddable_subscription(
 
 
 def gen_subscription(
-    secrets: bytes, device_id: int, start: int, end: int, channel: int
+    secrets: bytes,
+    device_id: int,
+    start: int,
+    end: int,
+    channel: int,
+    version: int = SUBSCRIPTION_UPDATE_VERSION_2,
 ) -> bytes:
     """
     Generate subscription packages
     Definition inspired by the MITRE example
     """
     valid_subscription = gen_embeddable_subscription(
-        secrets, device_id, start, end, channel
+        secrets, device_id, start, end, channel, version
     )
 
     # Deserialize the contents of the secrets file + create the instance of GlobalSecrets
@@ -131,11 +216,40 @@ def gen_subscription(
     # Derive the kid using KDF(id || Sid)
     kid = secrets.derive_id_key(device_id=device_id)
 
-    # Encrypt the plaintext subscription blob with kid (2120 bytes)
+    if version == SUBSCRIPTION_UPDATE_VERSION_2:
+        key_count = ValidSubscriptionV2.unpack(
+            valid_subscription[: ValidSubscriptionV2.size]
+        ).key_count
+
+        # mac (16 bytes) || nonce (24 bytes) || valid_subscription (64 + 16 * key_count bytes)
+        encrypted_subscription = encrypt_symmetric(valid_subscription, kid)
+
+        # message := sig || v || id || key_count || pad || ciphertext
+        # where sig := { v || id || key_count || pad || ciphertext }_k_e^-1
+        subscription_to_sign = (
+            SubscriptionUpdateHeaderV2(
+                version=SUBSCRIPTION_UPDATE_VERSION_2,
+                id=device_id,
+                key_count=key_count,
+                pad=b"",
+            ).pack()
+            + encrypted_subscription
+        )
+        ke_sig = sign_asymmetric(subscription_to_sign, secrets.enc_private_key)
+
+        packed_subscription = ke_sig + subscription_to_sign
+        assert len(packed_subscription) == subscription_update_v2_len(key_count)
+        return packed_subscription
+
+    _, SubscriptionUpdatePayload, SubscriptionUpdate = subscription_structs(
+        secrets.tree_arity_bits
+    )
+
+    # Encrypt the plaintext subscription blob with kid (2120 bytes, binary tree)
     # mac (16 bytes) || nonce (24 bytes) || valid_subscription (2080 bytes)
     encrypted_subscription = encrypt_symmetric(valid_subscription, kid)
 
-    # Concat the id and ciphertext to create the signature: (2124 bytes in len)
+    # Concat the id and ciphertext to create the signature: (2124 bytes, binary tree)
     # id (4 bytes) || ciphertext (2120 bytes)
     subscription_to_sign = SubscriptionUpdatePayload(
         id=device_id, ciphertext=encrypted_subscription
@@ -171,6 +285,13 @@ def parse_args():
         action="store_true",
         help="Generate a subscription file that can be placed in flash",
     )
+    parser.add_argument(
+        "--update-version",
+        type=int,
+        choices=SUBSCRIPTION_UPDATE_VERSIONS,
+        default=SUBSCRIPTION_UPDATE_VERSION_2,
+        help="Update format, 1 pads the tree keys to the maximum (default 2)",
+    )
     parser.add_argument(
         "secrets_file",
         type=argparse.FileType("rb"),
@@ -199,11 +320,21 @@ def main():
 
     if args.embeddable:
         subscription = gen_embeddable_subscription(
-            args.secrets_file.read(), args.device_id, args.start, args.end, args.channel
+            args.secrets_file.read(),
+            args.device_id,
+            args.start,
+            args.end,
+            args.channel,
+            args.update_version,
         )
     else:
         subscription = gen_subscription(
-            args.secrets_file.read(), args.device_id, args.start, args.end, args.channel
+            args.secrets_file.read(),
+            args.device_id,
+            args.start,
+            args.end,
+            args.channel,
+            args.update_version,
         )
 
     # Open the file, erroring if the file exists unless the --force arg is provided
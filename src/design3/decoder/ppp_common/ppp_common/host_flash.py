@@ -0,0 +1,62 @@
+"""
+@file host_flash.py
+@brief Generate the flash image of a host build of the decoder (build.sh host)
+@author Plaid Parliament of Pwning
+@copyright Copyright (c) 2025 Carnegie Mellon University
+
+The host build maps this file where the MAX78000 flash is (see host/src/flash.c), holding what
+the board's flash holds after programming: the formatted lockout page and channel 0, everything
+else erased.
+"""
+
+import argparse
+from pathlib import Path
+import struct
+
+# match: host/src/flash.c
+FLASH_BASE = 0x10000000
+FLASH_SIZE = 0x00080000
+FLASH_PAGE_SIZE = 0x2000
+
+# match: firmware.ld.template, host/flash.ld
+LOCKOUT_STATE = 0x10042000
+CHANNEL0 = 0x10044000
+
+# match: firmware.ld.template -> .lockout_state (see lockout.c)
+LOCKOUT_FORMAT = struct.pack("<4I", 0x4B434F4C, 0xB4BCB0B3, 0x4B434F4C, 0xB4BCB0B3)
+
+
+def gen_host_flash(channel0: bytes) -> bytes:
+    """Flash image with channel 0 from gen_subscription --embeddable"""
+    if len(channel0) > FLASH_PAGE_SIZE:
+        raise ValueError(f"channel 0 subscription too long: {len(channel0)} bytes")
+
+    flash = bytearray(b"\xff" * FLASH_SIZE)
+
+    def place(address: int, data: bytes):
+        offs = address - FLASH_BASE
+        flash[offs : offs + len(data)] = data
+
+    place(LOCKOUT_STATE, LOCKOUT_FORMAT)
+    place(CHANNEL0, channel0)
+    return bytes(flash)
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Flash image of a host build decoder")
+    parser.add_argument(
+        "channel0_file",
+        type=argparse.FileType("rb"),
+        help="Channel 0 subscription made by gen_subscription --embeddable",
+    )
+    parser.add_argument("flash_file", type=Path, help="Flash image output")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    args.flash_file.write_bytes(gen_host_flash(args.channel0_file.read()))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,91 @@
+"""
+@file hot_profile.py
+@brief Hot function profile for symbol_shimmy --hot, from a QEMU execution trace
+@author Plaid Parliament of Pwning
+@copyright Copyright (c) 2025 Carnegie Mellon University
+
+The trace is QEMU's -d exec,nochain log of the QEMU build (build.sh qemu), as written
+by python -m ectf25.utils.icount --trace. Every executed translation block is counted
+for the function containing it, and the functions that together account for --coverage
+of all blocks are written out heaviest first, with their block counts as weights.
+"""
+
+from elftools.elf.elffile import ELFFile
+import argparse
+import bisect
+from collections import Counter
+from pathlib import Path
+import re
+
+# Trace 0: 0x7f0000000000 [00000000/00001234/...] with the guest PC second
+TRACE_RE = re.compile(rb"^Trace \d+: \S+ \[[0-9a-f]+/([0-9a-f]+)/")
+
+
+def function_ranges(elf_path: Path) -> tuple[list[int], list[tuple[int, str]]]:
+    """Start addresses of the functions of an image, sorted, and their (end, name)"""
+    with open(elf_path, "rb") as f:
+        symtab = ELFFile(f).get_section_by_name(".symtab")
+        # Thumb function addresses have bit 0 set
+        funcs = sorted(
+            (s["st_value"] & ~1, (s["st_value"] & ~1) + s["st_size"], s.name)
+            for s in symtab.iter_symbols()
+            if s["st_info"]["type"] == "STT_FUNC" and s["st_size"] > 0
+        )
+    return [start for start, _, _ in funcs], [(end, name) for _, end, name in funcs]
+
+
+def count_blocks(
+    trace: Path, starts: list[int], ends: list[tuple[int, str]]
+) -> Counter:
+    """Executed translation blocks per function"""
+    counts = Counter()
+    with open(trace, "rb") as f:
+        for line in f:
+            match = TRACE_RE.match(line)
+            if not match:
+                continue
+            pc = int(match.group(1), 16)
+            i = bisect.bisect_right(starts, pc) - 1
+            if i >= 0 and pc < ends[i][0]:
+                counts[ends[i][1]] += 1
+    return counts
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n", 1)[1])
+    parser.add_argument(
+        "--elf", type=Path, required=True, help="Image the trace was taken of"
+    )
+    parser.add_argument(
+        "--coverage",
+        type=float,
+        default=0.95,
+        help="Fraction of the executed blocks the hot functions cover (default 0.95)",
+    )
+    parser.add_argument("trace", type=Path, help="QEMU -d exec,nochain log")
+    parser.add_argument("profile", type=Path, help="Hot function profile output")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+
+    counts = count_blocks(args.trace, *function_ranges(args.elf))
+    total = sum(counts.values())
+    if total == 0:
+        raise SystemExit(f"no blocks of {args.elf} in {args.trace}")
+
+    lines = [f"# python -m ppp_common.hot_profile, {total} blocks traced"]
+    covered = 0
+    for name, count in counts.most_common():
+        if covered >= args.coverage * total:
+            break
+        lines.append(f"{name} {count}")
+        covered += count
+
+    args.profile.write_text("\n".join(lines) + "\n")
+    print(f"{len(lines) - 1} functions cover {covered / total:.1%} of the blocks")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,26 @@
+"""
+@file key_tree.py
+@brief Shape of the key tree over the 64-bit timestamps
+@author Plaid Parliament of Pwning
+@copyright Copyright (c) 2025 Carnegie Mellon University
+"""
+
+# match: key_tree.h
+MAX_TREE_HEIGHT = 64  # bits of a timestamp
+
+# Supported arities of the key tree, as bits of the timestamp per level
+TREE_ARITY_BITS_CHOICES = (1, 2, 4)
+
+
+def tree_levels(arity_bits: int) -> int:
+    assert arity_bits in TREE_ARITY_BITS_CHOICES
+    return MAX_TREE_HEIGHT // arity_bits
+
+
+# match: key_tree.h -> MAX_TREE_KEYS
+def max_tree_keys(arity_bits: int) -> int:
+    arity = 1 << arity_bits
+    return 2 * (arity - 1) * (tree_levels(arity_bits) - 1) + arity - 2
+
+
+assert max_tree_keys(1) == 126
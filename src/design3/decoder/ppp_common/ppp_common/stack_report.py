@@ -0,0 +1,252 @@
+"""
+@file stack_report.py
+@brief Worst-case stack per call path, from GCC's -fcallgraph-info=su output
+@author Plaid Parliament of Pwning
+@copyright Copyright (c) 2025 Carnegie Mellon University
+
+build.sh with DECODER_STACK_REPORT=1 compiles with -fcallgraph-info=su, which writes a
+.ci file next to every object: the frame size of every function (what -fstack-usage
+reports) and the calls it makes. The call graphs of all objects are joined, and the
+deepest path is followed from main() and from every interrupt handler. An interrupt can
+come on top of any path of main(), with the exception frame the core pushes for it.
+
+Calls through function pointers are invisible to GCC. Their targets are listed per
+caller in an --indirect file, like stack_indirect.txt. Indirect calls that are not
+listed, recursion, dynamic frames and functions without a .ci (assembly, libgcc) make
+the worst case a guess, and are listed at the end.
+"""
+
+from elftools.elf.elffile import ELFFile
+import argparse
+from dataclasses import dataclass
+from pathlib import Path
+import re
+
+NODE_RE = re.compile(r'^node: \{ title: "([^"]+)" label: "([^"]*)"')
+EDGE_RE = re.compile(r'^edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+FRAME_RE = re.compile(r"(\d+) bytes \(([^)]+)\)")
+
+INDIRECT = "__indirect_call"
+HANDLER_RE = re.compile(r"_(IRQ)?Handler$")
+
+# Cortex-M4 exception entry with the FP context, which the FPU may have to push
+EXCEPTION_FRAME = 104
+
+
+@dataclass
+class Function:
+    name: str
+    location: str
+    frame: int | None  # None without a .ci of its own
+    kind: str  # static, dynamic or "dynamic,bounded"
+
+
+@dataclass
+class Path_:
+    total: int
+    functions: list[str]  # titles, outermost first
+
+
+class CallGraph:
+    def __init__(self):
+        self.functions: dict[str, Function] = {}
+        self.calls: dict[str, set[str]] = {}
+        self.unresolved: set[str] = set()  # callers with an unlisted indirect call
+        self.recursion: set[str] = set()
+        self._worst: dict[str, Path_] = {}
+
+    def read(self, ci: Path):
+        """Adds the call graph of one object"""
+        for line in ci.read_text().splitlines():
+            if match := NODE_RE.match(line):
+                title, label = match.groups()
+                fields = label.split("\\n")
+                frame = FRAME_RE.search(label)
+                function = Function(
+                    fields[0],
+                    fields[1] if len(fields) > 1 else "",
+                    int(frame.group(1)) if frame else None,
+                    frame.group(2) if frame else "",
+                )
+                # declared in one object, defined with a frame in another
+                known = self.functions.get(title)
+                if known is None or known.frame is None:
+                    self.functions[title] = function
+            elif match := EDGE_RE.match(line):
+                source, target = match.groups()
+                self.calls.setdefault(source, set()).add(target)
+
+    def titles(self, name: str) -> list[str]:
+        """Functions of a name, static ones are titled file:name"""
+        return [
+            t
+            for t, f in self.functions.items()
+            if f.name == name and f.frame is not None
+        ]
+
+    def resolve_indirect(self, targets: dict[str, list[str]]):
+        """Replaces the indirect calls of listed callers by calls to their targets"""
+        for caller, callees in self.calls.items():
+            if INDIRECT not in callees:
+                continue
+            name = self.functions[caller].name
+            if name not in targets:
+                self.unresolved.add(caller)
+                continue
+            callees.discard(INDIRECT)
+            for target in targets[name]:
+                callees.update(self.titles(target) or [target])
+
+    def worst(self, title: str, stack: tuple[str, ...] = ()) -> Path_:
+        """Deepest call path from a function, recursion is followed only once"""
+        if title in self._worst:
+            return self._worst[title]
+
+        function = self.functions.get(title)
+        frame = function.frame if function and function.frame is not None else 0
+        deepest = Path_(0, [])
+        for callee in sorted(self.calls.get(title, ())):
+            if callee == INDIRECT:
+                continue
+            if callee in stack or callee == title:
+                self.recursion.add(callee)
+                continue
+            path = self.worst(callee, stack + (title,))
+            if path.total > deepest.total:
+                deepest = path
+
+        path = Path_(frame + deepest.total, [title] + deepest.functions)
+        if not stack or title not in self.recursion:
+            self._worst[title] = path
+        return path
+
+    def unknown(self) -> set[str]:
+        """Called functions without frame information"""
+        called = set().union(*self.calls.values()) - {INDIRECT}
+        return {
+            t for t in called if t in self.functions and self.functions[t].frame is None
+        }
+
+
+def read_indirect(path: Path) -> dict[str, list[str]]:
+    """Lines of a caller and the functions it calls through pointers, # comments"""
+    targets = {}
+    for line in path.read_text().splitlines():
+        fields = line.split("#", 1)[0].split()
+        if fields:
+            targets.setdefault(fields[0], []).extend(fields[1:])
+    return targets
+
+
+def stack_size(elf_path: Path) -> int:
+    """Bytes between _stack_limit and __StackTop, see firmware.ld.template"""
+    with open(elf_path, "rb") as f:
+        symtab = ELFFile(f).get_section_by_name(".symtab")
+        limit = symtab.get_symbol_by_name("_stack_limit")[0]["st_value"]
+        top = symtab.get_symbol_by_name("__StackTop")[0]["st_value"]
+    return top - limit
+
+
+def path_lines(graph: CallGraph, path: Path_) -> list[str]:
+    lines = ["   frame   total  function"]
+    total = path.total
+    for title in path.functions:
+        function = graph.functions.get(title)
+        frame = function.frame if function and function.frame is not None else 0
+        lines.append(f"  {frame:6}  {total:6}  {function.name if function else title}")
+        total -= frame
+    return lines
+
+
+def report(graph: CallGraph, root: str, handlers: list[str], size: int | None) -> str:
+    main = graph.worst(root)
+    lines = [
+        "Worst-case stack per call path, from -fcallgraph-info=su (bytes)",
+        "",
+        f"{graph.functions[root].name}: {main.total}",
+        *path_lines(graph, main),
+        "",
+        f"per call from {graph.functions[root].name}:",
+    ]
+    root_frame = graph.functions[root].frame or 0
+    for callee in sorted(
+        graph.calls.get(root, ()),
+        key=lambda t: -graph.worst(t).total if t != INDIRECT else 0,
+    ):
+        if callee == INDIRECT or callee == root:
+            continue
+        name = graph.functions[callee].name if callee in graph.functions else callee
+        lines.append(f"  {root_frame + graph.worst(callee).total:6}  {name}")
+
+    deepest_handler = Path_(0, [])
+    for handler in handlers:
+        path = graph.worst(handler)
+        lines += ["", f"{graph.functions[handler].name}: {path.total}"]
+        lines += path_lines(graph, path)
+        if path.total > deepest_handler.total:
+            deepest_handler = path
+
+    total = main.total
+    parts = [graph.functions[root].name]
+    if handlers:
+        total += deepest_handler.total + EXCEPTION_FRAME
+        parts += [graph.functions[deepest_handler.functions[0]].name, "exception frame"]
+    lines += ["", f"worst case: {total} ({' + '.join(parts)})"]
+    if size is not None:
+        lines.append(f"stack: {size}, {size - total} left over")
+
+    def listing(title: str, titles) -> list[str]:
+        names = sorted({graph.functions[t].name for t in titles})
+        return [f"{title}: {', '.join(names)}"] if names else []
+
+    dynamic = [t for t, f in graph.functions.items() if "dynamic" in f.kind]
+    lines += ["", "not counted, or not exactly:"]
+    lines += listing("unlisted indirect calls in", graph.unresolved)
+    lines += listing("recursion through", graph.recursion)
+    lines += listing("dynamic frames", dynamic)
+    lines += listing("no .ci", graph.unknown())
+    return "\n".join(lines) + "\n"
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n", 1)[1])
+    parser.add_argument("--root", default="main", help="Entry point (default main)")
+    parser.add_argument(
+        "--indirect", type=Path, help="Targets of the indirect calls, per caller"
+    )
+    parser.add_argument(
+        "--elf", type=Path, help="Linked image, for the size of the stack to compare"
+    )
+    parser.add_argument("--out", type=Path, help="Write the report here, not stdout")
+    parser.add_argument("ci", type=Path, nargs="+", help=".ci files of the objects")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+
+    graph = CallGraph()
+    for ci in args.ci:
+        if ci.exists():  # not for assembly
+            graph.read(ci)
+    graph.resolve_indirect(read_indirect(args.indirect) if args.indirect else {})
+
+    roots = graph.titles(args.root)
+    if not roots:
+        raise SystemExit(f"{args.root} is in none of the call graphs")
+    handlers = sorted(
+        t for t, f in graph.functions.items() if HANDLER_RE.search(f.name) and f.frame
+    )
+
+    size = stack_size(args.elf) if args.elf else None
+    text = report(graph, roots[0], handlers, size)
+    if args.out:
+        args.out.write_text(text)
+        # the summary line for the build log
+        print(next(x for x in text.splitlines() if x.startswith("worst case")))
+    else:
+        print(text, end="")
+
+
+if __name__ == "__main__":
+    main()
@@ -8,13 +8,172 @@
 # The Symbol Shimmy
 # Protect against ROP by randomizing the order of symbols within the binary at link time!
 # Requires -ffunction-sections
+#
+# With a hot function profile (--hot), the hot functions are kept together as one cluster,
+# shuffled within itself and placed at a random spot among the cold functions, so the hot path
+# shares flash lines instead of being spread over all of .text. With --hot-sram the hottest of
+# them go to SRAM_RX instead, as far as --hot-sram-budget allows.
 
 from .gen_secrets import GlobalSecrets
 
 from elftools.elf.elffile import ELFFile
 import argparse
+from pathlib import Path
 from string import Template
 import random
+import sys
+
+
+def read_hot_profile(path: Path) -> list[str]:
+    """
+    Reads a hot function profile: one function (or .text. section) per line,
+    optionally followed by a weight such as an execution count, # starts a comment.
+    Returns the sections heaviest first, in file order where weights are equal.
+    """
+    entries = []
+    for line in path.read_text().splitlines():
+        fields = line.split("#", 1)[0].split()
+        if not fields:
+            continue
+        name = fields[0] if fields[0].startswith(".text.") else f".text.{fields[0]}"
+        weight = float(fields[1]) if len(fields) > 1 else 0.0
+        entries.append((name, weight))
+
+    entries.sort(key=lambda x: -x[1])  # stable, so equal weights keep their order
+    sections = []
+    for name, _ in entries:
+        if name not in sections:
+            sections.append(name)
+    return sections
+
+
+def span(sections: list[str], sizes: dict[str, tuple[int, int]]) -> int:
+    """Bytes the sections take laid out in this order, alignment padding included"""
+    end = 0
+    for x in sections:
+        size, align = sizes.get(x, (0, 1))
+        end = (end + align - 1) // align * align + size
+    return end
+
+
+def cluster(name: str, sections: list[str]) -> list[str]:
+    """Section commands of a cluster, between _<name>_start and _<name>_end"""
+    commands = [f"*({x})" for x in sections]
+    return [f"_{name}_start = .;", *commands, f"_{name}_end = .;"]
+
+
+def add_layout_args(parser: argparse.ArgumentParser):
+    """Options of the layout, shared with fleet.py"""
+    parser.add_argument(
+        "--ramfunc",
+        action="append",
+        default=[],
+        help="function section to place in SRAM_RX instead of flash (repeatable)",
+    )
+    parser.add_argument(
+        "--hot",
+        type=Path,
+        help="hot function profile to cluster, see read_hot_profile()",
+    )
+    parser.add_argument(
+        "--hot-sram",
+        action="store_true",
+        help="place the hottest functions of --hot in SRAM_RX instead of flash",
+    )
+    parser.add_argument(
+        "--hot-sram-budget",
+        type=int,
+        default=4096,
+        help="SRAM_RX bytes the hot functions may take with --hot-sram (default 4096)",
+    )
+
+
+def read_sections(objects: list[str]) -> tuple[list[str], dict[str, tuple[int, int]]]:
+    """
+    Function sections of the objects, and the size and alignment of every section,
+    summed over the objects that have one of the name
+    """
+    # Always include the regular text section in there somewhere just in case
+    text_syms = [".text"]
+    sizes = {}
+    for obj in objects:
+        with open(obj, "rb") as f:
+            elf = ELFFile(f)
+            for x in elf.iter_sections():
+                if x.name.startswith(".text."):
+                    text_syms.append(x.name)
+                    size, align = sizes.get(x.name, (0, 1))
+                    align = max(align, x["sh_addralign"])
+                    sizes[x.name] = (size + x["sh_size"], align)
+    return text_syms, sizes
+
+
+def layout(
+    template: Template,
+    seed: bytes,
+    text_syms: list[str],
+    sizes: dict[str, tuple[int, int]],
+    args: argparse.Namespace,
+) -> tuple[str, str | None]:
+    """
+    Shuffles the sections of read_sections() with the seed of a decoder
+
+    :returns: the linker script, and a report of the hot spans if there is a profile
+    """
+    # Seed PRNG - not a cryptographically secure PRNG but that doesn't matter since
+    # revealing the seed does not do anything useful
+    rng = random.Random(seed)
+
+    # Sections that are asked for but were inlined everywhere simply don't exist
+    ramfunc_syms = [x for x in text_syms if x in args.ramfunc]
+    text_syms = [x for x in text_syms if x not in args.ramfunc]
+
+    profile = read_hot_profile(args.hot) if args.hot else []
+    hot_syms = []
+    if args.hot:
+        hot_syms = [x for x in profile if x in text_syms]
+        text_syms = [x for x in text_syms if x not in hot_syms]
+
+    # Hottest first, the functions that still fit the budget go to SRAM_RX, the others stay
+    # in flash
+    sram_syms = []
+    if args.hot_sram:
+        for x in list(hot_syms):
+            if span(sram_syms + [x], sizes) <= args.hot_sram_budget:
+                sram_syms.append(x)
+                hot_syms.remove(x)
+
+    rng.shuffle(text_syms)
+    rng.shuffle(ramfunc_syms)
+
+    # The cold sections keep the full shuffle, with the hot cluster somewhere among them
+    text_commands = [f"*({x})" for x in text_syms]
+    ramfunc_commands = [f"*({x})" for x in ramfunc_syms]
+    if args.hot:
+        rng.shuffle(hot_syms)
+        rng.shuffle(sram_syms)
+        at = rng.randint(0, len(text_commands))
+        text_commands[at:at] = cluster("hot_text", hot_syms)
+        ramfunc_commands += cluster("hot_sram", sram_syms)
+
+    script = template.substitute(
+        TEXT_SECTIONS="\n".join(text_commands),
+        RAMFUNC_SECTIONS="\n".join(ramfunc_commands),
+    )
+
+    # The linked spans are in the map file, between the _hot_text_start/_hot_text_end and
+    # _hot_sram_start/_hot_sram_end symbols
+    report = None
+    if args.hot:
+        missing = len([x for x in profile if x not in sizes])
+        cold = span(list(dict.fromkeys(text_syms)), sizes)
+        report = (
+            f"symbol shimmy: hot span {span(hot_syms, sizes)} B in flash"
+            f" ({len(hot_syms)} sections), {span(sram_syms, sizes)} B in SRAM_RX"
+            f" ({len(sram_syms)} sections), cold {cold} B ({len(text_syms)} sections),"
+            f" {missing} profiled sections not found"
+        )
+    return script, report
 
 
 def main():
@@ -22,34 +181,24 @@ def main():
     parser.add_argument("--template", required=True)
     parser.add_argument("--secrets", required=True)
     parser.add_argument("--id", type=lambda x: int(x, 0), required=True)
+    add_layout_args(parser)
     parser.add_argument("objects", nargs="+")
 
     args = parser.parse_args()
 
-    # Seed PRNG - not a cryptographically secure PRNG but that doesn't matter since
-    # revealing the seed does not do anything useful
     with open(args.secrets, "rb") as f:
-        rng = random.Random(
-            GlobalSecrets.deserialize(f.read()).symbol_shimmy_seed(args.id)
-        )
+        seed = GlobalSecrets.deserialize(f.read()).symbol_shimmy_seed(args.id)
 
     with open(args.template, "r") as f:
         template = Template(f.read())
 
-    # Always include the regular text section in there somewhere just in case
-    text_syms = [".text"]
-    for obj in args.objects:
-        with open(obj, "rb") as f:
-            elf = ELFFile(f)
-            text_syms.extend(
-                x.name for x in elf.iter_sections() if x.name.startswith(".text.")
-            )
-
-    rng.shuffle(text_syms)
-
-    commands = "\n".join(f"*({x})" for x in text_syms)
+    text_syms, sizes = read_sections(args.objects)
+    script, report = layout(template, seed, text_syms, sizes, args)
 
-    print(template.substitute(TEXT_SECTIONS=commands))
+    # Report on stderr, stdout is the linker script
+    print(script)
+    if report:
+        print(report, file=sys.stderr)
 
 
 if __name__ == "__main__":
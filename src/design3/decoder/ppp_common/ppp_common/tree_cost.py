@@ -0,0 +1,120 @@
+"""
+@file tree_cost.py
+@brief Cost model of the key tree arity: subscription size against per-frame derivation depth
+@author Plaid Parliament of Pwning
+@copyright Copyright (c) 2025 Carnegie Mellon University
+
+A wider tree has fewer levels, so a frame key takes fewer child derivations, but covering a
+subscription range needs up to arity - 1 keys per level and side instead of one. The cycle
+estimates take the per-derivation cycles from a decoder built with DECODER_BENCH_KDF=1.
+"""
+
+from .crypto_wrappers import TREE_KEY_LEN
+from .gen_subscription import subscription_update_v2_len, vertices_for_range
+from .key_tree import (
+    MAX_TREE_HEIGHT,
+    TREE_ARITY_BITS_CHOICES,
+    tree_levels,
+    max_tree_keys,
+)
+
+import argparse
+import random
+
+# Frames simulated for the average cost with the decoder's key path cache
+WARM_FRAMES = 4096
+
+
+def cold_derivations(arity_bits: int) -> int:
+    """
+    Child derivations for a frame whose path is not cached, from a root key down to the leaf
+    """
+    return tree_levels(arity_bits)
+
+
+def warm_derivations(arity_bits: int, frame_step: int, seed: int = 0) -> float:
+    """
+    Average child derivations per frame when consecutive frames are frame_step apart, with the
+    decoder's key path cache (frame.c -> derive_tree_key()) only re-deriving changed levels
+    """
+    rng = random.Random(seed)
+    t = rng.getrandbits(MAX_TREE_HEIGHT - 16)
+    total = 0
+    for _ in range(WARM_FRAMES):
+        diff = t ^ (t + frame_step)
+        common_levels = (MAX_TREE_HEIGHT - diff.bit_length()) // arity_bits
+        total += tree_levels(arity_bits) - common_levels
+        t += frame_step
+    return total / WARM_FRAMES
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Key tree arity cost model")
+    parser.add_argument(
+        "--start", type=lambda x: int(x, 0), help="Subscription start timestamp"
+    )
+    parser.add_argument(
+        "--end", type=lambda x: int(x, 0), help="Subscription end timestamp"
+    )
+    parser.add_argument(
+        "--frame-step",
+        type=lambda x: int(x, 0),
+        default=1,
+        help="Timestamp difference of consecutive frames (default 1)",
+    )
+    parser.add_argument(
+        "--child-cycles", type=int, help="Cycles of one child derivation on the decoder"
+    )
+    parser.add_argument(
+        "--leaf-cycles", type=int, default=0, help="Cycles of the leaf derivation"
+    )
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    if (args.start is None) != (args.end is None):
+        raise SystemExit("--start and --end go together")
+
+    columns = ["arity", "levels", "cold", "warm", "max keys", "max update"]
+    if args.start is not None:
+        columns += ["keys", "key bytes", "update"]
+    if args.child_cycles is not None:
+        columns += ["cold cycles", "warm cycles"]
+
+    rows = []
+    for k in TREE_ARITY_BITS_CHOICES:
+        cold = cold_derivations(k)
+        warm = warm_derivations(k, args.frame_step)
+        row = [
+            str(1 << k),
+            str(tree_levels(k)),
+            str(cold),
+            f"{warm:.2f}",
+            str(max_tree_keys(k)),
+            f"{subscription_update_v2_len(max_tree_keys(k))} B",
+        ]
+        if args.start is not None:
+            keys = len(vertices_for_range(args.start, args.end, k))
+            row += [str(keys), f"{keys * TREE_KEY_LEN} B"]
+            row.append(f"{subscription_update_v2_len(keys)} B")
+        if args.child_cycles is not None:
+            row += [
+                str(cold * args.child_cycles + args.leaf_cycles),
+                f"{warm * args.child_cycles + args.leaf_cycles:.0f}",
+            ]
+        rows.append(row)
+
+    widths = [max(len(c), *(len(r[i]) for r in rows)) for i, c in enumerate(columns)]
+    print("  ".join(c.rjust(w) for c, w in zip(columns, widths)))
+    for row in rows:
+        print("  ".join(v.rjust(w) for v, w in zip(row, widths)))
+    print()
+    print("cold/warm: child derivations per frame without/with the decoder's key path cache")
+    print("max update: size of a v2 subscription update packet with max keys")
+    if args.start is not None:
+        print("update: size of the v2 subscription update packet of the range")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,35 @@
+/**
+ * @file max78000.h
+ * @brief QEMU build: the MSDK device header, with the DWT cycle counter taken from timer 0
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * QEMU does not model the DWT, its CYCCNT reads as zero. Every DWT->CYCCNT in src reads the
+ * instruction count instead, see mps2.h -> qemu_cycles().
+ */
+
+#pragma once
+
+#include_next <max78000.h>
+
+#include "mps2.h"
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} qemu_dwt_t;
+
+extern qemu_dwt_t qemu_dwt;
+
+/**
+ * @brief Refreshes the counter of qemu_dwt, see DWT
+ */
+static inline qemu_dwt_t* qemu_dwt_read(void) {
+    qemu_dwt.CYCCNT = qemu_cycles();
+    return &qemu_dwt;
+}
+
+#undef DWT
+#define DWT (qemu_dwt_read())
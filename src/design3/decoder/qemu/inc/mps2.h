@@ -0,0 +1,72 @@
+/**
+ * @file mps2.h
+ * @brief QEMU build: the peripherals of the mps2-an386 board the decoder runs on
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Register layouts are the ones of the Arm CMSDK APB UART and timer, as modelled by QEMU.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// FPGA system clock, which clocks the APB peripherals
+#define MPS2_SYSCLK 25000000
+
+// Under -icount shift=0 the core executes one instruction per nanosecond of virtual time, so the
+// instruction count is what the profile calls cycles
+#define QEMU_CORE_CLOCK 1000000000
+#define QEMU_INSNS_PER_TICK (QEMU_CORE_CLOCK / MPS2_SYSCLK)
+
+// Interrupt numbers, see crt0.S
+#define MPS2_UART0_RX_IRQn 0
+#define MPS2_UART0_TX_IRQn 1
+#define MPS2_IRQ_COUNT 32
+
+typedef struct {
+    volatile uint32_t data;      // 0x00
+    volatile uint32_t state;     // 0x04
+    volatile uint32_t ctrl;      // 0x08
+    volatile uint32_t intstatus; // 0x0C, write 1 to clear
+    volatile uint32_t bauddiv;   // 0x10
+} mps2_uart_regs_t;
+
+#define MPS2_UART_STATE_TX_FULL (1U << 0)
+#define MPS2_UART_STATE_RX_FULL (1U << 1)
+
+#define MPS2_UART_CTRL_TX_EN (1U << 0)
+#define MPS2_UART_CTRL_RX_EN (1U << 1)
+#define MPS2_UART_CTRL_TX_INT_EN (1U << 2)
+#define MPS2_UART_CTRL_RX_INT_EN (1U << 3)
+
+#define MPS2_UART_INT_TX (1U << 0)
+#define MPS2_UART_INT_RX (1U << 1)
+
+typedef struct {
+    volatile uint32_t ctrl;      // 0x00
+    volatile uint32_t value;     // 0x04, counts down
+    volatile uint32_t reload;    // 0x08
+    volatile uint32_t intstatus; // 0x0C, write 1 to clear
+} mps2_timer_regs_t;
+
+#define MPS2_TIMER_CTRL_EN (1U << 0)
+
+#define MPS2_UART0 ((mps2_uart_regs_t*)0x40004000)
+#define MPS2_TIMER0 ((mps2_timer_regs_t*)0x40000000)
+
+// SSRAM1, which holds the flash, shows up again right after its first 4MB. The MPU keeps flash
+// read-only, so writes go through the mirror like the MAX78000's go through its flash controller.
+#define MPS2_FLASH_MIRROR_OFFSET 0x00400000
+
+void qemu_flash_init(void);
+
+/**
+ * @brief Instructions executed since hardware_init(), modulo 2^32, see max78000.h
+ *
+ * Timer 0 counts down through all 32 bits at MPS2_SYSCLK, so negating it keeps differences right
+ * across its wraparound.
+ */
+static inline uint32_t qemu_cycles(void) {
+    return (0U - MPS2_TIMER0->value) * QEMU_INSNS_PER_TICK;
+}
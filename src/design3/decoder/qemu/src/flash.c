@@ -0,0 +1,104 @@
+/**
+ * @file flash.c
+ * @brief QEMU build: flash is SSRAM1, written through its mirror
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Reads go straight to flash at its address in qemu/memory.ld, which the MPU keeps read-only like
+ * on the board. Erases and writes go through the mirror of SSRAM1 (see mps2.h) and keep the flash
+ * semantics the journal and the lockout tally rely on: an erase sets a whole page to 0xFF and a
+ * write can only clear bits. There is no instruction cache to keep coherent.
+ */
+
+#include "flash.h"
+
+#include "common.h"
+#include "mps2.h"
+#include "util.h"
+
+#include <max78000.h>
+#include <mpu_armv7.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// match: qemu/memory.ld
+#define FLASH_BASE 0x00000000
+#define FLASH_SIZE 0x00080000
+#define FLASH_PAGE_SIZE 0x2000
+
+// MPU region for the mirror, one of those main.c -> enable_mpu() clears
+#define MIRROR_MPU_REGION 7
+
+// Pages QEMU does not load, see qemu/memory.ld
+extern uint8_t flash_noload_start[];
+extern uint8_t flash_noload_end[];
+
+/**
+ * @brief Opens the mirror to writes and erases the pages QEMU left zeroed, must run before flash
+ * is read
+ *
+ * On the board the never loaded pages start out erased, or hold what an earlier boot left there.
+ * QEMU starts with fresh memory every time, so they are erased every boot.
+ */
+void qemu_flash_init(void) {
+    ARM_MPU_SetRegion(
+        // mirror of 0x0000_0000 to 0x0008_0000 (512KiB)
+        ARM_MPU_RBAR(MIRROR_MPU_REGION, FLASH_BASE + MPS2_FLASH_MIRROR_OFFSET),
+        // No-execute, read-write
+        ARM_MPU_RASR(1, ARM_MPU_AP_PRIV, ARM_MPU_ACCESS_ORDERED, 1, 0, 0, 0b00000000,
+                     ARM_MPU_REGION_SIZE_512KB));
+
+    for (uint8_t* page = flash_noload_start; page < flash_noload_end; page += FLASH_PAGE_SIZE) {
+        UTIL_ASSERT(flash_erase_page((uint32_t)page) == OK);
+    }
+}
+
+/**
+ * @brief Checks that [address, address + length) is flash
+ */
+static bool in_flash(uint32_t address, uint32_t length) {
+    return address >= FLASH_BASE && length <= FLASH_SIZE &&
+           address - FLASH_BASE <= FLASH_SIZE - length;
+}
+
+/**
+ * @brief Erases a flash page
+ *
+ * @param address any address within the page
+ * @return OK if the page was erased, ERROR otherwise
+ */
+error_t flash_erase_page(uint32_t address) {
+    uint32_t page = address & ~(uint32_t)(FLASH_PAGE_SIZE - 1);
+    if (!in_flash(page, FLASH_PAGE_SIZE)) {
+        return ERROR;
+    }
+
+    memset((uint8_t*)(page + MPS2_FLASH_MIRROR_OFFSET), 0xFF, FLASH_PAGE_SIZE);
+    return OK;
+}
+
+/**
+ * @brief Writes to erased flash
+ *
+ * @param address destination address
+ * @param length number of bytes to write
+ * @param data data to write
+ * @return OK if the data was written, ERROR otherwise
+ */
+error_t flash_write(uint32_t address, uint32_t length, const uint32_t* data) {
+    UTIL_ASSERT(data != NULL || length == 0);
+
+    if (!in_flash(address, length)) {
+        return ERROR;
+    }
+
+    // programming only clears bits
+    const uint8_t* src = (const uint8_t*)data;
+    uint8_t* dst = (uint8_t*)(address + MPS2_FLASH_MIRROR_OFFSET);
+    for (uint32_t i = 0; i < length; i++) {
+        dst[i] &= src[i];
+    }
+    return OK;
+}
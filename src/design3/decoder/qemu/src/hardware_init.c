@@ -0,0 +1,87 @@
+/**
+ * @file hardware_init.c
+ * @brief QEMU build: sets up the mps2-an386 peripherals instead of the MAX78000's
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * The QEMU build (build.sh qemu) runs the Thumb-2 decoder image on qemu-system-arm's mps2-an386, a
+ * Cortex-M4 board, for instruction counts that do not need hardware. This file and the others in
+ * qemu/src take the place of the sources of the same name in src:
+ * - crt0.S: the mps2-an386 interrupts, and a boot vector where the eCTF bootloader would be
+ * - host_uart.c: the UART is UART 0 of the board, which QEMU connects to a pty (-serial pty)
+ * - flash.c: flash is SSRAM1, laid out by qemu/memory.ld at the offsets of memory.ld
+ * - rng.c: there is no TRNG, so random bytes come from a fixed seed
+ *
+ * The cycle counter counts instructions when QEMU runs with -icount shift=0, as
+ * ectf25.utils.icount does, see mps2.h. Everything else in src runs as it does on the board.
+ */
+
+#include "hardware_init.h"
+
+#include "host_uart.h"
+#include "mps2.h"
+#include "rng.h"
+
+#include <max78000.h>
+#include <mxc_delay.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+extern void (*const _vectors[])(void);
+uint32_t SystemCoreClock;
+qemu_dwt_t qemu_dwt;
+
+/**
+ * @brief Starts timer 0, free running from here on, see mps2.h -> qemu_cycles()
+ */
+static void init_cycle_counter(void) {
+    MPS2_TIMER0->ctrl = 0;
+    MPS2_TIMER0->reload = UINT32_MAX;
+    MPS2_TIMER0->value = UINT32_MAX;
+    MPS2_TIMER0->ctrl = MPS2_TIMER_CTRL_EN;
+}
+
+/**
+ * @brief Initializes required hardware peripherals
+ */
+void hardware_init(void) {
+    // Mask interrupts globally and disable them all on NVIC
+    __disable_irq();
+    for (IRQn_Type irq = 0; irq < MPS2_IRQ_COUNT; irq++) {
+        NVIC_DisableIRQ(irq); // irq MUST NOT be negative
+    }
+
+    SCB->VTOR = (uint32_t)_vectors;
+    SystemCoreClock = QEMU_CORE_CLOCK;
+
+    init_cycle_counter();
+    qemu_flash_init();
+    uart_init();
+    rng_init();
+
+    // Only the UART interrupts are enabled on NVIC, see uart_init()
+    __enable_irq();
+}
+
+/**
+ * @brief No PMIC to wait for, see src/hardware_init.c
+ */
+bool hardware_ready(void) { return true; }
+
+/**
+ * @brief Spins for the given time, only the lockout waits with it once the board is up
+ *
+ * @param us microseconds of virtual time, 1000 instructions each
+ * @return 0 (E_NO_ERROR)
+ */
+int MXC_Delay(uint32_t us) {
+    uint64_t remaining = (uint64_t)us * (QEMU_CORE_CLOCK / 1000000);
+    uint32_t last = qemu_cycles();
+    while (remaining > 0) {
+        uint32_t now = qemu_cycles();
+        uint32_t elapsed = now - last;
+        last = now;
+        remaining = (elapsed >= remaining) ? 0 : remaining - elapsed;
+    }
+    return 0;
+}
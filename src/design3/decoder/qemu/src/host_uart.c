@@ -0,0 +1,180 @@
+/**
+ * @file host_uart.c
+ * @brief QEMU build: functions to read/write to UART 0 of the mps2-an386, raw
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Interrupt driven like src/host_uart.c, with the same rings, so the main loop does the same work
+ * per byte as on the board. The CMSDK UART holds a single byte each way instead of an 8 byte FIFO,
+ * and has separate RX and TX interrupts, both handled by UART0_IRQHandler().
+ */
+
+#include "host_uart.h"
+
+#include "mps2.h"
+#include "uart_ring.h"
+
+#include <max78000.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define UART MPS2_UART0
+
+// Ring sizes in bytes, powers of two. RX holds a few message chunks, TX a whole response chunk.
+#define RX_RING_SIZE 1024
+#define TX_RING_SIZE 512
+
+static uint8_t rx_buf[RX_RING_SIZE];
+static uint8_t tx_buf[TX_RING_SIZE];
+static uart_ring_t rx_ring = UART_RING_INIT(rx_buf);
+static uart_ring_t tx_ring = UART_RING_INIT(tx_buf);
+
+static_assert((RX_RING_SIZE & (RX_RING_SIZE - 1)) == 0);
+static_assert((TX_RING_SIZE & (TX_RING_SIZE - 1)) == 0);
+
+/**
+ * @brief Turns a UART interrupt on or off
+ */
+static void set_int(uint32_t enable_bit, bool on) {
+    if (on) {
+        UART->ctrl |= enable_bit;
+    } else {
+        UART->ctrl &= ~enable_bit;
+    }
+}
+
+/**
+ * @brief Moves a received byte into the RX ring
+ *
+ * Once the ring is full the RX interrupt is turned off and QEMU holds further bytes back, until
+ * uart_service() makes room. Must run in the IRQ or with interrupts masked.
+ */
+static void rx_from_uart(void) {
+    while (!uart_ring_full(&rx_ring) && (UART->state & MPS2_UART_STATE_RX_FULL)) {
+        uart_ring_push(&rx_ring, (uint8_t)UART->data);
+    }
+
+    set_int(MPS2_UART_CTRL_RX_INT_EN, !uart_ring_full(&rx_ring));
+}
+
+/**
+ * @brief Moves bytes to be sent from the TX ring into the UART
+ *
+ * The TX interrupt stays on for as long as the ring has bytes left. Must run in the IRQ or with
+ * interrupts masked.
+ */
+static void tx_to_uart(void) {
+    uint8_t data;
+    while (!(UART->state & MPS2_UART_STATE_TX_FULL) && uart_ring_pop(&tx_ring, &data)) {
+        UART->data = data;
+    }
+
+    set_int(MPS2_UART_CTRL_TX_INT_EN, !uart_ring_empty(&tx_ring));
+}
+
+/**
+ * @brief UART 0 RX and TX interrupts, see crt0.S
+ */
+void UART0_IRQHandler(void) {
+    UART->intstatus = MPS2_UART_INT_RX | MPS2_UART_INT_TX;
+    rx_from_uart();
+    tx_to_uart();
+}
+
+/**
+ * @brief Runs the IRQ's work from the main loop, after the main loop changed a ring
+ */
+static void uart_service(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    rx_from_uart();
+    tx_to_uart();
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Set up the UART and its interrupts
+ *
+ * Interrupts still have to be unmasked globally before any byte moves.
+ */
+void uart_init(void) {
+    UART->ctrl = 0;
+    UART->bauddiv = MPS2_SYSCLK / CONSOLE_BAUD; // QEMU ignores the rate, but not a divider < 16
+    UART->intstatus = MPS2_UART_INT_RX | MPS2_UART_INT_TX;
+    UART->ctrl = MPS2_UART_CTRL_TX_EN | MPS2_UART_CTRL_RX_EN | MPS2_UART_CTRL_RX_INT_EN;
+
+    NVIC_ClearPendingIRQ(MPS2_UART0_RX_IRQn);
+    NVIC_ClearPendingIRQ(MPS2_UART0_TX_IRQn);
+    NVIC_EnableIRQ(MPS2_UART0_RX_IRQn);
+    NVIC_EnableIRQ(MPS2_UART0_TX_IRQn);
+}
+
+/**
+ * @brief Write a byte to UART, blocking only while the TX ring is full.
+ *
+ * @param data byte to write
+ */
+void uart_writebyte(uint8_t data) { uart_write(&data, 1); }
+
+/**
+ * @brief Read a byte from UART, blocking.
+ *
+ * @return byte read
+ */
+uint8_t uart_readbyte(void) {
+    uint8_t data;
+    uart_read(&data, 1);
+    return data;
+}
+
+/**
+ * @brief Write a block to UART, blocking only while the TX ring is full.
+ *
+ * @param buf bytes to write
+ * @param length number of bytes
+ */
+void uart_write(const uint8_t* buf, size_t length) {
+    while (length > 0) {
+        size_t written = uart_ring_write(&tx_ring, buf, length);
+        buf += written;
+        length -= written;
+        uart_service();
+    }
+}
+
+/**
+ * @brief Read a block from UART, blocking until all of it arrived.
+ *
+ * @param buf (out) bytes read
+ * @param length number of bytes
+ */
+void uart_read(uint8_t* buf, size_t length) {
+    while (length > 0) {
+        size_t read = uart_ring_read(&rx_ring, buf, length);
+        buf += read;
+        length -= read;
+        uart_service(); // makes room in the ring, and works with interrupts masked
+    }
+}
+
+/**
+ * @brief Checks whether a byte can be read from UART without blocking.
+ *
+ * @return true if uart_readbyte() would return immediately
+ */
+bool uart_readable(void) { return !uart_ring_empty(&rx_ring); }
+
+/**
+ * @brief Number of bytes that can be read from UART without blocking.
+ */
+size_t uart_available(void) { return uart_ring_used(&rx_ring); }
+
+/**
+ * @brief Wait until everything written so far has left the TX ring.
+ */
+void uart_flush(void) {
+    while (!uart_ring_empty(&tx_ring)) {
+        uart_service();
+    }
+}
@@ -0,0 +1,64 @@
+/**
+ * @file rng.c
+ * @brief QEMU build: the mps2-an386 has no TRNG, so "random" bytes come from a fixed seed
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Never random, this build is for instruction counts only: xorshift32 from the same seed every
+ * boot, so the DRBG and with it the fault injection delays start out the same on every run.
+ */
+
+#include "rng.h"
+
+#include "util.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static uint32_t state;
+
+void rng_init() { state = 0x2545F491; }
+
+/**
+ * @brief Next byte of the xorshift32 stream
+ */
+static uint8_t next_byte(void) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (uint8_t)state;
+}
+
+/**
+ * @brief Fill a buffer with pseudo-random data
+ *
+ * @param output buffer pointer
+ * @param length length of the output buffer in bytes
+ */
+void rng_get_unbiased_trng(uint8_t* output, size_t length) {
+    UTIL_ASSERT(output != NULL);
+
+    for (size_t i = 0; i < length; i++) {
+        output[i] = next_byte();
+    }
+}
+
+uint16_t rng_get_u16() {
+    uint16_t result;
+    rng_get_unbiased_trng((uint8_t*)&result, sizeof(result));
+    return result;
+}
+
+/**
+ * @brief Get a pseudo-random byte, which is always ready
+ *
+ * @param output (out) random byte
+ * @return true
+ */
+bool rng_poll_unbiased_trng(uint8_t* output) {
+    UTIL_ASSERT(output != NULL);
+
+    *output = next_byte();
+    return true;
+}
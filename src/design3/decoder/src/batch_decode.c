@@ -0,0 +1,114 @@
+/**
+ * @file batch_decode.c
+ * @brief Decoding of several frame packets sent in a single message
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ */
+
+#include "batch_decode.h"
+
+#include "common.h"
+#include "fiproc.h"
+#include "frame.h"
+#include "host_messaging.h"
+#include "sram.h"
+#include "util.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MAX_BATCH_RESPONSE_LEN (MAX_BATCH_RECORDS * (sizeof(batch_result_hdr_t) + MAX_FRAME_SIZE))
+
+/**
+ * @brief Checks that a batch is a well-formed sequence of records
+ *
+ * @param msg_buf batch message body
+ * @param msg_len batch message length
+ * @return number of records, or 0 if the batch is malformed
+ */
+static size_t count_records(const uint8_t* msg_buf, uint16_t msg_len) {
+    size_t count = 0;
+    size_t offs = 0;
+
+    while (offs < msg_len) {
+        if (msg_len - offs < sizeof(batch_record_hdr_t) || count == MAX_BATCH_RECORDS) {
+            return 0;
+        }
+
+        const batch_record_hdr_t* hdr = (const batch_record_hdr_t*)(msg_buf + offs);
+        if (hdr->length != sizeof(frame_packet_t) && hdr->length != sizeof(frame_packet_v2_t) &&
+            hdr->length != sizeof(frame_packet_v3_t)) {
+            return 0;
+        }
+
+        offs += sizeof(batch_record_hdr_t);
+        if (msg_len - offs < hdr->length) {
+            return 0;
+        }
+        offs += hdr->length;
+        count += 1;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Decode every frame packet of a batch and send all results to the host in one response.
+ *
+ * A frame that fails to decode only fails its own record.
+ *
+ * @param msg_buf batch message body, 4-byte aligned, frames are decrypted in place
+ * @param msg_len batch message length
+ * @return OK if the response was sent, ERROR if the batch is malformed
+ */
+error_t decode_batch(uint8_t* msg_buf, uint16_t msg_len) {
+    UTIL_ASSERT(msg_buf != NULL);
+
+    size_t count = count_records(msg_buf, msg_len);
+    if (count == 0) {
+        return ERROR;
+    }
+
+    ARENA static uint8_t response[MAX_BATCH_RESPONSE_LEN];
+    size_t response_len = 0;
+    size_t offs = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const batch_record_hdr_t* hdr = (const batch_record_hdr_t*)(msg_buf + offs);
+        uint8_t* packet = msg_buf + offs + sizeof(batch_record_hdr_t);
+        offs += sizeof(batch_record_hdr_t) + hdr->length;
+
+        if (i > 0) {
+            // every record gets the delays a single decode message would get
+            fiproc_update_pool();
+        }
+
+        frame_data_t* frame_data = NULL;
+        error_t result;
+        if (hdr->length == sizeof(frame_packet_t)) {
+            result = decode((frame_packet_t*)packet, &frame_data);
+        } else if (hdr->length == sizeof(frame_packet_v2_t)) {
+            result = decode_v2((frame_packet_v2_t*)packet, &frame_data);
+        } else {
+            result = decode_v3((frame_packet_v3_t*)packet, &frame_data);
+        }
+
+        batch_result_hdr_t* result_hdr = (batch_result_hdr_t*)(response + response_len);
+        response_len += sizeof(batch_result_hdr_t);
+        if (result == OK) {
+            result_hdr->status = 0;
+            result_hdr->length = (uint8_t)frame_data->length;
+            memcpy(response + response_len, frame_data->frame, frame_data->length);
+            response_len += frame_data->length;
+            frame_data_wipe(frame_data);
+        } else {
+            result_hdr->status = 1;
+            result_hdr->length = 0;
+        }
+    }
+
+    send_msg(BATCH_DECODE_MSG, response, response_len);
+    memset_explicit(response, 0, response_len);
+    return OK;
+}
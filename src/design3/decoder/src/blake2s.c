@@ -0,0 +1,142 @@
+/**
+ * @file blake2s.c
+ * @brief BLAKE2s (RFC 7693), the 32-bit member of the BLAKE2 family
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Monocypher only ships BLAKE2b, whose 64-bit additions and rotations take two or more
+ * instructions each on the Cortex-M4. BLAKE2s works on 32-bit words, which the M4 adds and rotates
+ * (as part of the next instruction) natively, and needs 10 rounds instead of 12.
+ *
+ * Only unkeyed one-shot hashing is needed, for the tree KDF.
+ */
+
+#include "blake2s.h"
+
+#include "util.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static const uint32_t blake2s_iv[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+static const uint8_t blake2s_sigma[10][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+};
+
+static inline uint32_t rotr32(uint32_t x, unsigned n) { return (x >> n) | (x << (32 - n)); }
+
+static inline uint32_t load32_le(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+#define G(a, b, c, d, x, y)                                                                        \
+    do {                                                                                           \
+        v[a] = v[a] + v[b] + (x);                                                                  \
+        v[d] = rotr32(v[d] ^ v[a], 16);                                                            \
+        v[c] = v[c] + v[d];                                                                        \
+        v[b] = rotr32(v[b] ^ v[c], 12);                                                            \
+        v[a] = v[a] + v[b] + (y);                                                                  \
+        v[d] = rotr32(v[d] ^ v[a], 8);                                                             \
+        v[c] = v[c] + v[d];                                                                        \
+        v[b] = rotr32(v[b] ^ v[c], 7);                                                             \
+    } while (0)
+
+/**
+ * @brief Compresses one block into the chaining value
+ *
+ * @param h chaining value
+ * @param block message block, zero padded if it is the last one
+ * @param counter number of message bytes up to and including this block
+ * @param last whether this is the last block
+ */
+[[gnu::noinline]] // keep .text.blake2s_compress for DECODER_RAMFUNC
+static void blake2s_compress(uint32_t h[8], const uint8_t block[BLAKE2S_BLOCK_LEN],
+                             uint32_t counter, bool last) {
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; i++) {
+        m[i] = load32_le(block + 4 * i);
+    }
+
+    uint32_t v[16];
+    for (size_t i = 0; i < 8; i++) {
+        v[i] = h[i];
+        v[i + 8] = blake2s_iv[i];
+    }
+    v[12] ^= counter; // messages are far shorter than 2^32 bytes, the high word stays 0
+    if (last) {
+        v[14] = ~v[14];
+    }
+
+    for (size_t r = 0; r < 10; r++) {
+        const uint8_t* s = blake2s_sigma[r];
+        G(0, 4, 8, 12, m[s[0]], m[s[1]]);
+        G(1, 5, 9, 13, m[s[2]], m[s[3]]);
+        G(2, 6, 10, 14, m[s[4]], m[s[5]]);
+        G(3, 7, 11, 15, m[s[6]], m[s[7]]);
+        G(0, 5, 10, 15, m[s[8]], m[s[9]]);
+        G(1, 6, 11, 12, m[s[10]], m[s[11]]);
+        G(2, 7, 8, 13, m[s[12]], m[s[13]]);
+        G(3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        h[i] ^= v[i] ^ v[i + 8];
+    }
+}
+
+/**
+ * @brief Unkeyed BLAKE2s of a message
+ *
+ * @param hash (out) digest
+ * @param hash_len length of the digest, 1 to BLAKE2S_MAX_HASH_LEN bytes
+ * @param message message to hash
+ * @param message_len length of the message
+ */
+void blake2s(uint8_t* hash, size_t hash_len, const uint8_t* message, size_t message_len) {
+    UTIL_ASSERT(hash != NULL);
+    UTIL_ASSERT(hash_len > 0 && hash_len <= BLAKE2S_MAX_HASH_LEN);
+    UTIL_ASSERT(message != NULL || message_len == 0);
+
+    uint32_t h[8];
+    memcpy(h, blake2s_iv, sizeof(h));
+    h[0] ^= 0x01010000 ^ (uint32_t)hash_len; // parameter block: fanout 1, depth 1, no key
+
+    // every block but the last one, which may be partial (or empty)
+    uint32_t counter = 0;
+    while (message_len > BLAKE2S_BLOCK_LEN) {
+        counter += BLAKE2S_BLOCK_LEN;
+        blake2s_compress(h, message, counter, false);
+        message += BLAKE2S_BLOCK_LEN;
+        message_len -= BLAKE2S_BLOCK_LEN;
+    }
+
+    uint8_t block[BLAKE2S_BLOCK_LEN] = {0};
+    memcpy(block, message, message_len);
+    counter += (uint32_t)message_len;
+    blake2s_compress(h, block, counter, true);
+
+    uint8_t digest[BLAKE2S_MAX_HASH_LEN];
+    for (size_t i = 0; i < 8; i++) {
+        digest[4 * i + 0] = (uint8_t)(h[i]);
+        digest[4 * i + 1] = (uint8_t)(h[i] >> 8);
+        digest[4 * i + 2] = (uint8_t)(h[i] >> 16);
+        digest[4 * i + 3] = (uint8_t)(h[i] >> 24);
+    }
+    memcpy(hash, digest, hash_len);
+}
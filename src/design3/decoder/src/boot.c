@@ -0,0 +1,101 @@
+/**
+ * @file boot.c
+ * @brief Startup, split at the first message header with DECODER_FAST_BOOT=1
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Before the first header can be accepted, the hardware is set up, the DRBG seeded, the lockout
+ * served and the board must be up (see hardware_ready()). Nothing else is needed to receive a
+ * header, so with DECODER_FAST_BOOT=1 the rest is deferred:
+ * - while the decoder waits for the host (mostly for the PMIC to come up after power up) it runs
+ *   one step at a time from the main loop, see boot_step()
+ * - whatever is left when the first header arrives runs once the header is acknowledged, while
+ *   the host sends the body, see boot_finish()
+ * No message is handled before boot_finish(). With DECODER_FAST_BOOT=0 all of it runs in
+ * boot_init(), which then waits for the board.
+ *
+ * Every phase is timed, see profile.h -> boot_profile_t.
+ */
+
+#include "boot.h"
+
+#include "crypto_wrappers.h"
+#include "drbg.h"
+#include "hardware_init.h"
+#include "lockout.h"
+#include "profile.h"
+#include "subscription.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    boot_phase_t phase;
+    void (*run)(void);
+} boot_step_t;
+
+// In the order they run
+static const boot_step_t deferred_steps[] = {
+    {BOOT_CRYPTO, crypto_init},
+    {BOOT_SUBSCRIPTIONS, subscription_init},
+};
+
+#define DEFERRED_STEP_COUNT (sizeof(deferred_steps) / sizeof(deferred_steps[0]))
+
+static size_t next_step = 0;
+
+/**
+ * @brief Runs what has to run before the first header can be accepted
+ */
+void boot_init(void) {
+    hardware_init();
+    PROFILE_BOOT_END(0, BOOT_HARDWARE); // the cycle counter starts at 0 in hardware_init()
+
+    PROFILE_BOOT_BEGIN(drbg);
+    drbg_init();
+    PROFILE_BOOT_END(drbg, BOOT_DRBG);
+
+    PROFILE_BOOT_BEGIN(lockout);
+    lockout_process();
+    PROFILE_BOOT_END(lockout, BOOT_LOCKOUT);
+
+#if !FAST_BOOT
+    boot_finish();
+    while (!boot_ready()) {}
+#endif
+}
+
+/**
+ * @brief Checks whether a header can be accepted, that is the board is up
+ */
+bool boot_ready(void) {
+    if (!hardware_ready()) {
+        return false;
+    }
+    profile_boot_ready();
+    return true;
+}
+
+/**
+ * @brief Runs the next deferred step, if any is left
+ *
+ * @return false once the boot is done, then nothing was run
+ */
+bool boot_step(void) {
+    if (next_step == DEFERRED_STEP_COUNT) {
+        return false;
+    }
+
+    const boot_step_t* step = &deferred_steps[next_step++];
+    PROFILE_BOOT_BEGIN(start);
+    step->run();
+    PROFILE_BOOT_END(start, step->phase);
+    return true;
+}
+
+/**
+ * @brief Runs the deferred steps that are left, must run before a message is handled
+ */
+void boot_finish(void) {
+    while (boot_step()) {}
+}
@@ -7,21 +7,42 @@
 
 #include "crypto_wrappers.h"
 
+#include "bench_report.h"
+#include "blake2s.h"
 #include "common.h"
+#include "drbg.h"
+#include "eddsa_verify.h"
 #include "fiproc.h"
+#include "frame.h"
+#include "host_messaging.h"
+#include "key_tree.h"
+#include "secrets.h"
 #include "util.h"
 
+#include <max78000.h>
 #include <monocypher.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
+// Verification context for the encoder's public key
+verify_ctx_t encoder_verify_ctx;
+
+/**
+ * @brief One-time setup of the crypto wrappers, must run before any signature is checked
+ */
+void crypto_init(void) {
+    UTIL_ASSERT(TREE_KDF_VERSION == TREE_KDF_BLAKE2B || TREE_KDF_VERSION == TREE_KDF_BLAKE2S);
+    UTIL_ASSERT(verify_ctx_init(&encoder_verify_ctx, ENCODER_PUBLIC_KEY) == OK);
+}
+
 /**
  * @brief Wrapper for symmetric decryption
  *
  * Plaintext will be length bytes long
  * Ciphertext will be length+CC_ENC_SYM_METADATA_LEN bytes long
  * Provides authenticated encryption;
+ * Decrypts in place if plaintext is ciphertext + SYMMETRIC_METADATA_LEN
  *
  * @param plaintext pointer to plaintext
  * @param ciphertext pointer to ciphertext
@@ -43,21 +64,75 @@ error_t decrypt_symmetric(uint8_t* plaintext, const uint8_t* ciphertext, size_t
     }
 }
 
+/**
+ * @brief Sets up the verification context of a signer's public key
+ *
+ * With EDDSA_PRECOMPUTED, decodes the key and precomputes its tables. Otherwise the key is only
+ * kept, and crypto_eddsa_check() decodes it on every check.
+ *
+ * @param verify_ctx (out) verification context
+ * @param public_key the signer's public key (len 32)
+ * @return OK, ERROR if EDDSA_PRECOMPUTED and the key does not decode
+ */
+error_t verify_ctx_init(verify_ctx_t* verify_ctx, const uint8_t* public_key) {
+    UTIL_ASSERT(verify_ctx != NULL);
+    UTIL_ASSERT(public_key != NULL);
+
+#if EDDSA_PRECOMPUTED
+    return eddsa_verify_ctx_init(verify_ctx, public_key);
+#else
+    memcpy(verify_ctx->public_key, public_key, PUBLIC_KEY_LEN);
+    return OK;
+#endif
+}
+
+#if EDDSA_PRECOMPUTED || BENCH_EDDSA
+/**
+ * @brief h_ram = BLAKE2b-512(R || A || M) mod L, as computed by crypto_eddsa_check()
+ */
+static void hash_ram(uint8_t h_ram[32], const uint8_t* signature, const uint8_t* public_key,
+                     const uint8_t* message, size_t length) {
+    uint8_t hash[64];
+    crypto_blake2b_ctx hash_ctx;
+    crypto_blake2b_init(&hash_ctx, sizeof(hash));
+    crypto_blake2b_update(&hash_ctx, signature, 32);
+    crypto_blake2b_update(&hash_ctx, public_key, PUBLIC_KEY_LEN);
+    crypto_blake2b_update(&hash_ctx, message, length);
+    crypto_blake2b_final(&hash_ctx, hash);
+    crypto_eddsa_reduce(h_ram, hash);
+}
+#endif
+
 /**
  * @brief Wrapper for asymmetric signature checking
  *
+ * With EDDSA_PRECOMPUTED, gives the same result as crypto_eddsa_check() for signatures made with
+ * crypto_eddsa_sign(), but uses the tables precomputed for the public key.
+ * host/test/eddsa_vectors.py lists the encodings where the two may differ.
+ *
  * @param signature pointer to signature to verify (len 64)
  * @param message pointer to message
  * @param length length of message
- * @param pubkey pointer to public key (len 32)
+ * @param verify_ctx verification context of the signer's public key
  * @return OK if the signature is valid, ERROR if the signature is invalid
  */
 error_t verify_asymmetric(const uint8_t* signature, const uint8_t* message, size_t length,
-                          const uint8_t* pubkey) {
-    volatile int res1 = crypto_eddsa_check(signature, pubkey, message, length);
+                          const verify_ctx_t* verify_ctx) {
+    UTIL_ASSERT(signature != NULL);
+    UTIL_ASSERT(message != NULL);
+    UTIL_ASSERT(verify_ctx != NULL);
+
+#if EDDSA_PRECOMPUTED
+    uint8_t h_ram[32];
+    hash_ram(h_ram, signature, verify_ctx->public_key, message, length);
+    volatile error_t res1 = eddsa_verify_ctx_check(verify_ctx, signature, h_ram);
+#else
+    volatile error_t res1 =
+        crypto_eddsa_check(signature, verify_ctx->public_key, message, length) == 0 ? OK : ERROR;
+#endif
     fiproc_delay();
 
-    if (res1 == 0) {
+    if (res1 == OK) {
         return OK;
     } else {
         return ERROR;
@@ -65,17 +140,138 @@ error_t verify_asymmetric(const uint8_t* signature, const uint8_t* message, size
 }
 
 /**
- * @brief Derives a child tree key
+ * @brief Starts a streamed signature check
  *
- * @param key_out: output key (16 bytes)
- * @param parent: tree key of the parent node (16 bytes)
- * @param left_right: left or right tree key (32 bytes)
+ * The input is the signature followed by the signed message, fed in pieces through
+ * verify_stream_absorb(). Spare time between pieces can be given to verify_stream_idle().
+ *
+ * @param stream (out) stream state
+ * @param verify_ctx verification context of the signer's public key
  */
-void kdf_tree_child(uint8_t* key_out, const uint8_t* parent, const uint8_t* left_right) {
-    UTIL_ASSERT(key_out != NULL);
-    UTIL_ASSERT(parent != NULL);
-    UTIL_ASSERT(left_right != NULL);
+void verify_stream_init(verify_stream_t* stream, const verify_ctx_t* verify_ctx) {
+    UTIL_ASSERT(stream != NULL);
+    UTIL_ASSERT(verify_ctx != NULL);
+
+    stream->verify_ctx = verify_ctx;
+    stream->received = 0;
+#if EDDSA_PRECOMPUTED
+    stream->s_canonical = false;
+#endif
+}
+
+/**
+ * @brief Absorbs the next piece of signature || message
+ *
+ * Message bytes go straight into the hash. With EDDSA_PRECOMPUTED, [s]B can be computed by
+ * verify_stream_idle() once the whole signature is in.
+ *
+ * @param stream stream state
+ * @param data next bytes of the input
+ * @param length number of bytes in data
+ */
+void verify_stream_absorb(verify_stream_t* stream, const uint8_t* data, size_t length) {
+    UTIL_ASSERT(stream != NULL);
+    UTIL_ASSERT(data != NULL || length == 0);
+
+    while (length > 0 && stream->received < SIGNATURE_LEN) {
+        stream->signature[stream->received] = *data;
+        stream->received += 1;
+        data += 1;
+        length -= 1;
+
+        if (stream->received == SIGNATURE_LEN) {
+            // h_ram = BLAKE2b-512(R || A || M) mod L, as in verify_asymmetric()
+            crypto_blake2b_init(&stream->hash_ctx, 64);
+            crypto_blake2b_update(&stream->hash_ctx, stream->signature, 32);
+            crypto_blake2b_update(&stream->hash_ctx, stream->verify_ctx->public_key,
+                                  PUBLIC_KEY_LEN);
+#if EDDSA_PRECOMPUTED
+            stream->s_canonical = eddsa_verify_start(&stream->eddsa, stream->signature + 32) == OK;
+#endif
+        }
+    }
+
+    if (length > 0) {
+        crypto_blake2b_update(&stream->hash_ctx, data, length);
+        stream->received += length;
+    }
+}
+
+/**
+ * @brief Does a small, bounded step of the check ahead of time, nothing without EDDSA_PRECOMPUTED
+ *
+ * @param stream stream state
+ */
+void verify_stream_idle(verify_stream_t* stream) {
+    UTIL_ASSERT(stream != NULL);
+
+#if EDDSA_PRECOMPUTED
+    if (stream->s_canonical) {
+        eddsa_verify_step(&stream->eddsa);
+    }
+#endif
+}
+
+/**
+ * @brief Completes a streamed signature check once the whole message was absorbed
+ *
+ * Without EDDSA_PRECOMPUTED, the hash goes to crypto_eddsa_check_equation(), the second half of
+ * crypto_eddsa_check().
+ *
+ * @param stream stream state
+ * @return OK if the signature is valid, ERROR if the signature is invalid
+ */
+error_t verify_stream_final(verify_stream_t* stream) {
+    UTIL_ASSERT(stream != NULL);
+
+    if (stream->received < SIGNATURE_LEN) {
+        return ERROR;
+    }
+
+    uint8_t hash[64];
+    uint8_t h_ram[32];
+    crypto_blake2b_final(&stream->hash_ctx, hash);
+    crypto_eddsa_reduce(h_ram, hash);
+
+#if EDDSA_PRECOMPUTED
+    volatile error_t res1 = ERROR;
+    if (stream->s_canonical) {
+        res1 = eddsa_verify_finish(&stream->eddsa, stream->verify_ctx, stream->signature, h_ram);
+    }
+#else
+    const uint8_t* public_key = stream->verify_ctx->public_key;
+    volatile error_t res1 =
+        crypto_eddsa_check_equation(stream->signature, public_key, h_ram) == 0 ? OK : ERROR;
+#endif
+    fiproc_delay();
+
+    if (res1 == OK) {
+        return OK;
+    } else {
+        return ERROR;
+    }
+}
 
+/**
+ * @brief Hash primitive of the key tree
+ *
+ * @param version: TREE_KDF_* version of the key tree
+ * @param out: output hash
+ * @param out_len: length of the output hash (at most 32 bytes)
+ * @param message: message to hash
+ * @param message_len: length of the message
+ */
+static void tree_hash(uint32_t version, uint8_t* out, size_t out_len, const uint8_t* message,
+                      size_t message_len) {
+    if (version == TREE_KDF_BLAKE2S) {
+        blake2s(out, out_len, message, message_len);
+    } else {
+        crypto_blake2b(out, out_len, message, message_len);
+    }
+}
+
+static void tree_child(uint32_t version, uint8_t* key_out, const uint8_t* parent,
+                       const uint8_t* left_right) {
     // match: crypto_wrappers.py -> TreeChildTmp
     struct {
         uint8_t parent[TREE_KEY_LEN];
@@ -84,9 +280,54 @@ void kdf_tree_child(uint8_t* key_out, const uint8_t* parent, const uint8_t* left
     memcpy(tmp.parent, parent, sizeof(tmp.parent));
     memcpy(tmp.left_right, left_right, sizeof(tmp.left_right));
 
+    tree_hash(version, key_out, TREE_KEY_LEN, (uint8_t*)&tmp, sizeof(tmp));
+}
+
+static void tree_child_wide(uint32_t version, uint8_t* key_out, const uint8_t* parent,
+                            uint32_t child) {
+    // match: crypto_wrappers.py -> TreeChildWideTmp
+    struct {
+        uint8_t parent[TREE_KEY_LEN];
+        uint8_t tree_key[TREE_LEFT_RIGHT_LEN];
+        uint32_t child;
+    } tmp;
+    memcpy(tmp.parent, parent, sizeof(tmp.parent));
+    memcpy(tmp.tree_key, LEFT_TREE_KEY, sizeof(tmp.tree_key));
+    tmp.child = child;
+
+    tree_hash(version, key_out, TREE_KEY_LEN, (uint8_t*)&tmp, sizeof(tmp));
+}
+
+/**
+ * @brief Child KDF of the deployment's tree arity
+ *
+ * Binary trees hash the parent with the left or right tree key. Wider trees hash the parent with
+ * the left tree key and the index of the child.
+ */
+static void tree_child_index(uint32_t version, uint8_t* key_out, const uint8_t* parent,
+                             uint32_t child) {
+    if (TREE_ARITY == 2) {
+        tree_child(version, key_out, parent, child == 0 ? LEFT_TREE_KEY : RIGHT_TREE_KEY);
+    } else {
+        tree_child_wide(version, key_out, parent, child);
+    }
+}
+
+/**
+ * @brief Derives a child tree key
+ *
+ * @param key_out: output key (16 bytes)
+ * @param parent: tree key of the parent node (16 bytes)
+ * @param child: index of the child, less than TREE_ARITY
+ */
+void kdf_tree_child(uint8_t* key_out, const uint8_t* parent, uint32_t child) {
+    UTIL_ASSERT(key_out != NULL);
+    UTIL_ASSERT(parent != NULL);
+    UTIL_ASSERT(child < TREE_ARITY);
+
     // no need to do this multiple times as FI would just result in a garbage key that will fail
     // decryption
-    crypto_blake2b(key_out, TREE_KEY_LEN, (uint8_t*)&tmp, sizeof(tmp));
+    tree_child_index(TREE_KDF_VERSION, key_out, parent, child);
     fiproc_delay();
 }
 
@@ -102,6 +343,118 @@ void kdf_tree_leaf(uint8_t* key_out, const uint8_t* tree_key) {
 
     // no need to do this multiple times as FI would just result in a garbage key that will fail
     // decryption
-    crypto_blake2b(key_out, SYMMETRIC_KEY_LEN, tree_key, TREE_KEY_LEN);
+    tree_hash(TREE_KDF_VERSION, key_out, SYMMETRIC_KEY_LEN, tree_key, TREE_KEY_LEN);
     fiproc_delay();
 }
+
+#if BENCH_TREE_KDF
+
+/**
+ * @brief Times a whole path from a channel root down to a frame key with a KDF version
+ *
+ * @param out: (out) end of the report so far, the timings are appended
+ * @param version: TREE_KDF_* version to time
+ * @param name: name of the version in the report
+ * @return the new end of the report
+ */
+static char* bench_version(char* out, uint32_t version, const char* name) {
+    uint8_t key[TREE_KEY_LEN] = {0};
+    uint8_t leaf[SYMMETRIC_KEY_LEN];
+
+    uint32_t start = DWT->CYCCNT;
+    for (size_t i = 0; i < TREE_LEVELS; i++) {
+        tree_child_index(version, key, key, i & TREE_ARITY_MASK);
+    }
+    uint32_t child_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    tree_hash(version, leaf, sizeof(leaf), key, sizeof(key));
+    uint32_t leaf_cycles = DWT->CYCCNT - start;
+
+    memset_explicit(key, 0, sizeof(key));
+    memset_explicit(leaf, 0, sizeof(leaf));
+
+    out = append_str(out, name);
+    out = append_str(out, ": child ");
+    out = append_u32(out, child_cycles / TREE_LEVELS);
+    out = append_str(out, ", leaf ");
+    out = append_u32(out, leaf_cycles);
+    out = append_str(out, ", path ");
+    out = append_u32(out, child_cycles + leaf_cycles);
+    return append_str(out, " cycles\n");
+}
+
+/**
+ * @brief Compares both key tree KDF versions on the device and reports the cycle counts in a
+ * debug message, enabled by building with DECODER_BENCH_KDF=1
+ */
+void kdf_tree_benchmark(void) {
+    // the cycle counter was started by hardware_init()
+    char report[160];
+    char* end = bench_version(report, TREE_KDF_BLAKE2B, "blake2b");
+    end = bench_version(end, TREE_KDF_BLAKE2S, "blake2s");
+    UTIL_ASSERT(end <= report + sizeof(report));
+
+    send_msg(DEBUG_MSG, report, (size_t)(end - report));
+}
+
+#endif
+
+#if BENCH_EDDSA
+
+/**
+ * @brief Times the signature check of a frame with the precomputed tables against Monocypher's
+ * crypto_eddsa_check() and reports the cycle counts in a debug message, enabled by building with
+ * DECODER_BENCH_EDDSA=1
+ *
+ * The key pair is made up on the spot. Both are timed without the fault injection delay of
+ * verify_asymmetric(), whichever one DECODER_EDDSA_PRECOMPUTED picks for it.
+ */
+void eddsa_benchmark(void) {
+    // 3.8 KiB of tables, too much for the stack
+    static eddsa_verify_ctx_t ctx;
+    uint8_t seed[32];
+    uint8_t secret_key[64];
+    uint8_t public_key[PUBLIC_KEY_LEN];
+    uint8_t signature[SIGNATURE_LEN];
+    uint8_t message[sizeof(frame_packet_t) - SIGNATURE_LEN]; // the signed part of a frame
+
+    drbg_generate(seed, sizeof(seed));
+    drbg_generate(message, sizeof(message));
+    crypto_eddsa_key_pair(secret_key, public_key, seed);
+    crypto_eddsa_sign(signature, secret_key, message, sizeof(message));
+    memset_explicit(secret_key, 0, sizeof(secret_key));
+
+    // the cycle counter was started by hardware_init()
+    uint32_t start = DWT->CYCCNT;
+    UTIL_ASSERT(eddsa_verify_ctx_init(&ctx, public_key) == OK);
+    uint32_t init_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    uint8_t h_ram[32];
+    hash_ram(h_ram, signature, public_key, message, sizeof(message));
+    error_t ours = eddsa_verify_ctx_check(&ctx, signature, h_ram);
+    uint32_t check_cycles = DWT->CYCCNT - start;
+
+    start = DWT->CYCCNT;
+    int monocypher = crypto_eddsa_check(signature, public_key, message, sizeof(message));
+    uint32_t monocypher_cycles = DWT->CYCCNT - start;
+
+    // both have to accept, or the timings mean nothing
+    UTIL_ASSERT(ours == OK);
+    UTIL_ASSERT(monocypher == 0);
+
+    char report[120];
+    char* end = append_str(report, "eddsa: key tables ");
+    end = append_u32(end, init_cycles);
+    end = append_str(end, ", check ");
+    end = append_u32(end, check_cycles);
+    end = append_str(end, ", crypto_eddsa_check ");
+    end = append_u32(end, monocypher_cycles);
+    end = append_str(end, " cycles\n");
+    UTIL_ASSERT(end <= report + sizeof(report));
+
+    send_msg(DEBUG_MSG, report, (size_t)(end - report));
+}
+
+#endif
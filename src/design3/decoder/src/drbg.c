@@ -0,0 +1,109 @@
+/**
+ * @file drbg.c
+ * @brief ChaCha20 deterministic random bit generator, seeded and reseeded from the TRNG
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Output is ChaCha20 keystream under a secret key. Every request also replaces the key with
+ * keystream of its own (fast key erasure), so earlier output cannot be recovered from the state.
+ *
+ * Reading the TRNG through the Von Neumann whitener is slow, so seed material for the next reseed
+ * is collected, and the reseed done, by drbg_idle() while the decoder waits for the host. Only when
+ * the decoder was too busy for that does drbg_generate() reseed and wait for the TRNG.
+ */
+
+#include "drbg.h"
+
+#include "rng.h"
+#include "util.h"
+
+#include <monocypher.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DRBG_KEY_LEN 32
+#define DRBG_SEED_LEN 32
+
+// Number of requests after which drbg_idle() reseeds
+#define DRBG_RESEED_INTERVAL 64
+// Number of requests after which drbg_generate() reseeds, even if it has to wait for the TRNG
+#define DRBG_RESEED_LIMIT (4 * DRBG_RESEED_INTERVAL)
+
+static const uint8_t drbg_nonce[8] = {0};
+
+static uint8_t drbg_key[DRBG_KEY_LEN];
+static uint32_t requests_since_reseed = 0;
+
+// Seed material for the next reseed, filled while idle
+static uint8_t seed_ring[DRBG_SEED_LEN];
+static size_t seed_fill = 0;
+
+/**
+ * @brief Mixes the collected seed material into the key, topping it up from the TRNG first
+ */
+static void reseed(void) {
+    if (seed_fill < DRBG_SEED_LEN) {
+        rng_get_unbiased_trng(seed_ring + seed_fill, DRBG_SEED_LEN - seed_fill);
+    }
+
+    // key = BLAKE2b(key = old key, message = seed)
+    uint8_t new_key[DRBG_KEY_LEN];
+    crypto_blake2b_keyed(new_key, sizeof(new_key), drbg_key, sizeof(drbg_key), seed_ring,
+                         sizeof(seed_ring));
+    memcpy(drbg_key, new_key, sizeof(drbg_key));
+
+    memset_explicit(new_key, 0, sizeof(new_key));
+    memset_explicit(seed_ring, 0, sizeof(seed_ring));
+    seed_fill = 0;
+    requests_since_reseed = 0;
+}
+
+/**
+ * @brief Seeds the generator from the TRNG, must run before any other drbg function
+ */
+void drbg_init(void) {
+    rng_get_unbiased_trng(drbg_key, sizeof(drbg_key));
+    seed_fill = 0;
+    requests_since_reseed = 0;
+}
+
+/**
+ * @brief Fill a buffer with random data
+ *
+ * @param output (out) buffer
+ * @param length length of the buffer in bytes, at most DRBG_MAX_REQUEST
+ */
+void drbg_generate(void* output, size_t length) {
+    UTIL_ASSERT(output != NULL || length == 0);
+    UTIL_ASSERT(length <= DRBG_MAX_REQUEST);
+
+    if (requests_since_reseed >= DRBG_RESEED_LIMIT) {
+        reseed();
+    }
+    requests_since_reseed++;
+
+    // block 0 becomes the next key, output starts at block 1
+    crypto_chacha20_djb(output, NULL, length, drbg_key, drbg_nonce, 1);
+
+    uint8_t new_key[DRBG_KEY_LEN];
+    crypto_chacha20_djb(new_key, NULL, sizeof(new_key), drbg_key, drbg_nonce, 0);
+    memcpy(drbg_key, new_key, sizeof(drbg_key));
+    memset_explicit(new_key, 0, sizeof(new_key));
+}
+
+/**
+ * @brief Collects seed material and reseeds once it is due, call whenever there is nothing else
+ * to do
+ *
+ * Never waits for the TRNG, every call takes at most one word from it.
+ */
+void drbg_idle(void) {
+    if (seed_fill < DRBG_SEED_LEN) {
+        if (rng_poll_unbiased_trng(&seed_ring[seed_fill])) {
+            seed_fill++;
+        }
+    } else if (requests_since_reseed >= DRBG_RESEED_INTERVAL) {
+        reseed();
+    }
+}
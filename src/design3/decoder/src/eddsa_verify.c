@@ -0,0 +1,775 @@
+/**
+ * @file eddsa_verify.c
+ * @brief EdDSA (Ed25519 curve) signature verification against a fixed, precomputed public key
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Monocypher's crypto_eddsa_check() decompresses the public key and rebuilds its window table on
+ * every call, then runs 253 doublings. Every signature we check is made with the same encoder key,
+ * so the decoded key and the multiples of 2^0, 2^64, 2^128 and 2^192 times it are computed once at
+ * boot. Splitting both scalars into four 64-bit chunks leaves 64 shared doublings per check.
+ *
+ * Field arithmetic follows the usual ref10 layout. Everything here handles public data only
+ * (signatures, public keys, hashes of public messages), so none of it is constant time.
+ *
+ * The decoder only checks signatures with it when built with DECODER_EDDSA_PRECOMPUTED=1, the
+ * default is crypto_eddsa_check().
+ */
+
+#include "eddsa_verify.h"
+
+#include "common.h"
+#include "util.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Projective point (Y + X, Y - X, Z, 2dT), ready for full addition
+typedef struct {
+    fe_t YplusX;
+    fe_t YminusX;
+    fe_t Z;
+    fe_t T2d;
+} ge_cached_t;
+
+// Little-endian encodings of the constants, decoded into field elements on first use
+static const uint8_t D_BYTES[32] = {
+    0xA3, 0x78, 0x59, 0x13, 0xCA, 0x4D, 0xEB, 0x75, 0xAB, 0xD8, 0x41, 0x41, 0x4D, 0x0A, 0x70, 0x00,
+    0x98, 0xE8, 0x79, 0x77, 0x79, 0x40, 0xC7, 0x8C, 0x73, 0xFE, 0x6F, 0x2B, 0xEE, 0x6C, 0x03, 0x52};
+
+static const uint8_t SQRTM1_BYTES[32] = {
+    0xB0, 0xA0, 0x0E, 0x4A, 0x27, 0x1B, 0xEE, 0xC4, 0x78, 0xE4, 0x2F, 0xAD, 0x06, 0x18, 0x43, 0x2F,
+    0xA7, 0xD7, 0xFB, 0x3D, 0x99, 0x00, 0x4D, 0x2B, 0x0B, 0xDF, 0xC1, 0x4F, 0x80, 0x24, 0x83, 0x2B};
+
+static const uint8_t BASE_POINT_BYTES[32] = {
+    0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66};
+
+// Order of the base point
+static const uint8_t L_BYTES[32] = {
+    0xED, 0xD3, 0xF5, 0x5C, 0x1A, 0x63, 0x12, 0x58, 0xD6, 0x9C, 0xF7, 0xA2, 0xDE, 0xF9, 0xDE, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10};
+
+static const uint8_t LIMB_OFFSET[10] = {0, 26, 51, 77, 102, 128, 153, 179, 204, 230};
+
+#define LIMB_BITS(i) (((i) & 1) ? 25 : 26)
+
+static fe_t fe_d;
+static fe_t fe_d2;
+static fe_t fe_sqrtm1;
+
+// base_table[j][k] = (2k + 1) * 2^(64j) * B, shared by every context
+static ge_precomp_t base_table[EDDSA_SPLIT][EDDSA_TABLE_SIZE];
+static bool tables_ready = false;
+
+/////////////////////////
+// Field arithmetic
+/////////////////////////
+
+/**
+ * @brief Propagates carries so every limb is back within (about) its nominal width
+ */
+static void fe_carry(fe_t h, int64_t t[10]) {
+    for (size_t i = 0; i < 10; i++) {
+        int64_t c = t[i] >> LIMB_BITS(i);
+        t[i] -= c * ((int64_t)1 << LIMB_BITS(i));
+        if (i < 9) {
+            t[i + 1] += c;
+        } else {
+            t[0] += 19 * c; // 2^255 = 19
+        }
+    }
+    int64_t c = t[0] >> 26;
+    t[0] -= c * ((int64_t)1 << 26);
+    t[1] += c;
+
+    for (size_t i = 0; i < 10; i++) {
+        h[i] = (int32_t)t[i];
+    }
+}
+
+static void fe_copy(fe_t h, const fe_t f) { memcpy(h, f, sizeof(fe_t)); }
+
+static void fe_0(fe_t h) { memset(h, 0, sizeof(fe_t)); }
+
+static void fe_1(fe_t h) {
+    fe_0(h);
+    h[0] = 1;
+}
+
+static void fe_add(fe_t h, const fe_t f, const fe_t g) {
+    int64_t t[10];
+    for (size_t i = 0; i < 10; i++) {
+        t[i] = (int64_t)f[i] + g[i];
+    }
+    fe_carry(h, t);
+}
+
+static void fe_sub(fe_t h, const fe_t f, const fe_t g) {
+    int64_t t[10];
+    for (size_t i = 0; i < 10; i++) {
+        t[i] = (int64_t)f[i] - g[i];
+    }
+    fe_carry(h, t);
+}
+
+static void fe_neg(fe_t h, const fe_t f) {
+    int64_t t[10];
+    for (size_t i = 0; i < 10; i++) {
+        t[i] = -(int64_t)f[i];
+    }
+    fe_carry(h, t);
+}
+
+static void fe_mul(fe_t h, const fe_t f, const fe_t g) {
+    int32_t g19[10];
+    for (size_t i = 0; i < 10; i++) {
+        g19[i] = 19 * g[i];
+    }
+
+    int64_t t[10] = {0};
+#pragma GCC unroll 10
+    for (size_t i = 0; i < 10; i++) {
+#pragma GCC unroll 10
+        for (size_t j = 0; j < 10; j++) {
+            // odd limbs are a half bit short, so odd * odd lands one bit above its slot
+            int64_t fi = (i & j & 1) ? 2 * (int64_t)f[i] : f[i];
+            int64_t gj = (i + j < 10) ? g[j] : g19[j];
+            t[(i + j) % 10] += fi * gj;
+        }
+    }
+    fe_carry(h, t);
+}
+
+static void fe_sq(fe_t h, const fe_t f) {
+    int64_t t[10] = {0};
+#pragma GCC unroll 10
+    for (size_t i = 0; i < 10; i++) {
+#pragma GCC unroll 10
+        for (size_t j = i; j < 10; j++) {
+            int64_t fi = f[i];
+            if (i != j) {
+                fi *= 2;
+            }
+            if (i & j & 1) {
+                fi *= 2;
+            }
+            int64_t fj = (i + j < 10) ? f[j] : 19 * (int64_t)f[j];
+            t[(i + j) % 10] += fi * fj;
+        }
+    }
+    fe_carry(h, t);
+}
+
+/**
+ * @brief Squares f n times in a row
+ */
+static void fe_sqn(fe_t h, const fe_t f, size_t n) {
+    fe_sq(h, f);
+    for (size_t i = 1; i < n; i++) {
+        fe_sq(h, h);
+    }
+}
+
+/**
+ * @brief Common prefix of the inversion and square root addition chains
+ *
+ * @param z250 (out) z^(2^250 - 1)
+ * @param z11 (out) z^11
+ * @param z input
+ */
+static void fe_pow250(fe_t z250, fe_t z11, const fe_t z) {
+    fe_t t0, t1, t2;
+
+    fe_sq(t0, z);         // z^2
+    fe_sqn(t1, t0, 2);    // z^8
+    fe_mul(t1, z, t1);    // z^9
+    fe_mul(z11, t0, t1);  // z^11
+    fe_sq(t0, z11);       // z^22
+    fe_mul(t0, t1, t0);   // z^(2^5 - 1)
+    fe_sqn(t1, t0, 5);    //
+    fe_mul(t0, t1, t0);   // z^(2^10 - 1)
+    fe_sqn(t1, t0, 10);   //
+    fe_mul(t1, t1, t0);   // z^(2^20 - 1)
+    fe_sqn(t2, t1, 20);   //
+    fe_mul(t1, t2, t1);   // z^(2^40 - 1)
+    fe_sqn(t1, t1, 10);   //
+    fe_mul(t0, t1, t0);   // z^(2^50 - 1)
+    fe_sqn(t1, t0, 50);   //
+    fe_mul(t1, t1, t0);   // z^(2^100 - 1)
+    fe_sqn(t2, t1, 100);  //
+    fe_mul(t1, t2, t1);   // z^(2^200 - 1)
+    fe_sqn(t1, t1, 50);   //
+    fe_mul(z250, t1, t0); // z^(2^250 - 1)
+}
+
+/**
+ * @brief h = 1/z = z^(p - 2) = z^(2^255 - 21)
+ */
+static void fe_invert(fe_t h, const fe_t z) {
+    fe_t z250, z11;
+    fe_pow250(z250, z11, z);
+    fe_sqn(z250, z250, 5);
+    fe_mul(h, z250, z11);
+}
+
+/**
+ * @brief h = z^((p - 5) / 8) = z^(2^252 - 3)
+ */
+static void fe_pow22523(fe_t h, const fe_t z) {
+    fe_t z250, z11;
+    fe_pow250(z250, z11, z);
+    fe_sqn(z250, z250, 2);
+    fe_mul(h, z250, z);
+}
+
+/**
+ * @brief Loads 255 bits, ignoring the top bit
+ */
+static void fe_frombytes(fe_t h, const uint8_t s[32]) {
+    for (size_t i = 0; i < 10; i++) {
+        size_t byte = LIMB_OFFSET[i] / 8;
+        uint64_t w = 0;
+        for (size_t b = 0; b < 5 && byte + b < 32; b++) {
+            w |= (uint64_t)s[byte + b] << (8 * b);
+        }
+        h[i] = (int32_t)((w >> (LIMB_OFFSET[i] % 8)) & ((1u << LIMB_BITS(i)) - 1));
+    }
+}
+
+/**
+ * @brief Stores the canonical (fully reduced) encoding of f
+ */
+static void fe_tobytes(uint8_t s[32], const fe_t f) {
+    int32_t h[10];
+    memcpy(h, f, sizeof(h));
+
+    // carry until every limb is within [0, 2^bits), which puts the value in [0, 2^255)
+    int32_t top_carry;
+    do {
+        for (size_t i = 0; i < 9; i++) {
+            int32_t c = h[i] >> LIMB_BITS(i);
+            h[i] -= c * (1 << LIMB_BITS(i));
+            h[i + 1] += c;
+        }
+        top_carry = h[9] >> 25;
+        h[9] -= top_carry * (1 << 25);
+        h[0] += 19 * top_carry;
+    } while (top_carry != 0 || h[0] < 0 || h[0] >= (1 << 26));
+
+    // values in [p, 2^255) still need p subtracted
+    bool above_p = h[0] >= (1 << 26) - 19;
+    for (size_t i = 1; i < 10; i++) {
+        above_p = above_p && h[i] == (1 << LIMB_BITS(i)) - 1;
+    }
+    if (above_p) {
+        // x - p = x + 19 - 2^255, which clears every limb but the first
+        h[0] -= (1 << 26) - 19;
+        for (size_t i = 1; i < 10; i++) {
+            h[i] = 0;
+        }
+    }
+
+    memset(s, 0, 32);
+    for (size_t i = 0; i < 10; i++) {
+        size_t byte = LIMB_OFFSET[i] / 8;
+        uint64_t w = (uint64_t)(uint32_t)h[i] << (LIMB_OFFSET[i] % 8);
+        for (size_t b = 0; b < 5 && byte + b < 32; b++) {
+            s[byte + b] |= (uint8_t)(w >> (8 * b));
+        }
+    }
+}
+
+static bool fe_isnegative(const fe_t f) {
+    uint8_t s[32];
+    fe_tobytes(s, f);
+    return s[0] & 1;
+}
+
+static bool fe_iszero(const fe_t f) {
+    uint8_t s[32];
+    fe_tobytes(s, f);
+    uint8_t acc = 0;
+    for (size_t i = 0; i < 32; i++) {
+        acc |= s[i];
+    }
+    return acc == 0;
+}
+
+/////////////////////////
+// Group arithmetic
+/////////////////////////
+
+static void ge_identity(ge_t* p) {
+    fe_0(p->X);
+    fe_1(p->Y);
+    fe_1(p->Z);
+    fe_0(p->T);
+}
+
+/**
+ * @brief Decodes a point, rejecting encodings that are not on the curve
+ *
+ * @param p (out) decoded point
+ * @param s encoded point (32 bytes)
+ * @return OK if s encodes a point, ERROR otherwise
+ */
+static error_t ge_frombytes(ge_t* p, const uint8_t s[32]) {
+    fe_t one, u, v, v3, vxx, check;
+
+    fe_1(one);
+    fe_frombytes(p->Y, s);
+    fe_1(p->Z);
+
+    // x^2 = (y^2 - 1) / (d y^2 + 1) = u / v
+    fe_sq(u, p->Y);
+    fe_mul(v, u, fe_d);
+    fe_sub(u, u, one);
+    fe_add(v, v, one);
+
+    // x = u v^3 (u v^7)^((p - 5) / 8)
+    fe_sq(v3, v);
+    fe_mul(v3, v3, v);
+    fe_sq(p->X, v3);
+    fe_mul(p->X, p->X, v);
+    fe_mul(p->X, p->X, u);
+    fe_pow22523(p->X, p->X);
+    fe_mul(p->X, p->X, v3);
+    fe_mul(p->X, p->X, u);
+
+    fe_sq(vxx, p->X);
+    fe_mul(vxx, vxx, v);
+    fe_sub(check, vxx, u);
+    if (!fe_iszero(check)) {
+        fe_add(check, vxx, u);
+        if (!fe_iszero(check)) {
+            return ERROR; // u / v is not a square
+        }
+        fe_mul(p->X, p->X, fe_sqrtm1);
+    }
+
+    bool sign = s[31] >> 7;
+    if (sign && fe_iszero(p->X)) {
+        return ERROR; // -0 is not a valid encoding
+    }
+    if (fe_isnegative(p->X) != sign) {
+        fe_neg(p->X, p->X);
+    }
+
+    fe_mul(p->T, p->X, p->Y);
+    return OK;
+}
+
+static void ge_tobytes(uint8_t s[32], const ge_t* p) {
+    fe_t recip, x, y;
+
+    fe_invert(recip, p->Z);
+    fe_mul(x, p->X, recip);
+    fe_mul(y, p->Y, recip);
+    fe_tobytes(s, y);
+    s[31] ^= fe_isnegative(x) << 7;
+}
+
+static void ge_neg(ge_t* r, const ge_t* p) {
+    fe_neg(r->X, p->X);
+    fe_copy(r->Y, p->Y);
+    fe_copy(r->Z, p->Z);
+    fe_neg(r->T, p->T);
+}
+
+static void ge_to_cached(ge_cached_t* r, const ge_t* p) {
+    fe_add(r->YplusX, p->Y, p->X);
+    fe_sub(r->YminusX, p->Y, p->X);
+    fe_copy(r->Z, p->Z);
+    fe_mul(r->T2d, p->T, fe_d2);
+}
+
+/**
+ * @brief r = p + q
+ */
+static void ge_add(ge_t* r, const ge_t* p, const ge_cached_t* q) {
+    fe_t a, b, c, d, e, f, g, h;
+
+    fe_sub(a, p->Y, p->X);
+    fe_mul(a, a, q->YminusX);
+    fe_add(b, p->Y, p->X);
+    fe_mul(b, b, q->YplusX);
+    fe_mul(c, p->T, q->T2d);
+    fe_mul(d, p->Z, q->Z);
+    fe_add(d, d, d);
+
+    fe_sub(e, b, a);
+    fe_sub(f, d, c);
+    fe_add(g, d, c);
+    fe_add(h, b, a);
+
+    fe_mul(r->X, e, f);
+    fe_mul(r->Y, g, h);
+    fe_mul(r->T, e, h);
+    fe_mul(r->Z, f, g);
+}
+
+/**
+ * @brief r = p + q (negate = false) or r = p - q (negate = true) for an affine q
+ */
+static void ge_madd(ge_t* r, const ge_t* p, const ge_precomp_t* q, bool negate) {
+    fe_t a, b, c, d, e, f, g, h;
+
+    fe_sub(a, p->Y, p->X);
+    fe_mul(a, a, negate ? q->yplusx : q->yminusx);
+    fe_add(b, p->Y, p->X);
+    fe_mul(b, b, negate ? q->yminusx : q->yplusx);
+    fe_mul(c, p->T, q->xy2d);
+    fe_add(d, p->Z, p->Z);
+
+    fe_sub(e, b, a);
+    if (negate) {
+        fe_add(f, d, c);
+        fe_sub(g, d, c);
+    } else {
+        fe_sub(f, d, c);
+        fe_add(g, d, c);
+    }
+    fe_add(h, b, a);
+
+    fe_mul(r->X, e, f);
+    fe_mul(r->Y, g, h);
+    fe_mul(r->T, e, h);
+    fe_mul(r->Z, f, g);
+}
+
+/**
+ * @brief r = 2p
+ */
+static void ge_double(ge_t* r, const ge_t* p) {
+    fe_t a, b, c, e, f, g, h;
+
+    fe_sq(a, p->X);
+    fe_sq(b, p->Y);
+    fe_sq(c, p->Z);
+    fe_add(c, c, c);
+    fe_add(e, p->X, p->Y);
+    fe_sq(e, e);
+    fe_sub(e, e, a);
+    fe_sub(e, e, b);
+    fe_sub(g, b, a);
+    fe_sub(f, g, c);
+    fe_add(h, a, b);
+    fe_neg(h, h);
+
+    fe_mul(r->X, e, f);
+    fe_mul(r->Y, g, h);
+    fe_mul(r->T, e, h);
+    fe_mul(r->Z, f, g);
+}
+
+/**
+ * @brief Fills table[j][k] with (2k + 1) * 2^(64j) * p, in affine form
+ *
+ * All points are normalized with a single inversion (Montgomery's trick).
+ */
+static void build_table(ge_precomp_t table[EDDSA_SPLIT][EDDSA_TABLE_SIZE], const ge_t* p) {
+    ge_t points[EDDSA_SPLIT][EDDSA_TABLE_SIZE];
+    ge_t chunk_base = *p;
+
+    for (size_t j = 0; j < EDDSA_SPLIT; j++) {
+        ge_t twice;
+        ge_cached_t twice_cached;
+        ge_double(&twice, &chunk_base);
+        ge_to_cached(&twice_cached, &twice);
+
+        points[j][0] = chunk_base;
+        for (size_t k = 1; k < EDDSA_TABLE_SIZE; k++) {
+            ge_add(&points[j][k], &points[j][k - 1], &twice_cached);
+        }
+
+        for (size_t i = 0; i < 64; i++) {
+            ge_double(&chunk_base, &chunk_base);
+        }
+    }
+
+    // prefix[n] = Z_0 * ... * Z_n
+    ge_t* flat = &points[0][0];
+    const size_t count = EDDSA_SPLIT * EDDSA_TABLE_SIZE;
+    fe_t prefix[EDDSA_SPLIT * EDDSA_TABLE_SIZE];
+    fe_copy(prefix[0], flat[0].Z);
+    for (size_t n = 1; n < count; n++) {
+        fe_mul(prefix[n], prefix[n - 1], flat[n].Z);
+    }
+
+    fe_t inv;
+    fe_invert(inv, prefix[count - 1]);
+
+    for (size_t n = count; n-- > 0;) {
+        // inv = 1 / (Z_0 * ... * Z_n) at the top of every iteration
+        fe_t recip, x, y;
+        if (n > 0) {
+            fe_mul(recip, inv, prefix[n - 1]);
+            fe_mul(inv, inv, flat[n].Z);
+        } else {
+            fe_copy(recip, inv);
+        }
+
+        fe_mul(x, flat[n].X, recip);
+        fe_mul(y, flat[n].Y, recip);
+
+        ge_precomp_t* out = &table[n / EDDSA_TABLE_SIZE][n % EDDSA_TABLE_SIZE];
+        fe_add(out->yplusx, y, x);
+        fe_sub(out->yminusx, y, x);
+        fe_mul(out->xy2d, x, y);
+        fe_mul(out->xy2d, out->xy2d, fe_d2);
+    }
+}
+
+/////////////////////////
+// Scalars
+/////////////////////////
+
+/**
+ * @brief Checks that a scalar is fully reduced (s < L), which rules out malleable signatures
+ */
+static bool scalar_is_canonical(const uint8_t s[32]) {
+    for (size_t i = 32; i-- > 0;) {
+        if (s[i] != L_BYTES[i]) {
+            return s[i] < L_BYTES[i];
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Recodes a scalar below 2^253 into signed digits (width 5 NAF)
+ *
+ * Every non-zero digit is odd and in [-15, 15], and is followed by at least four zero digits.
+ *
+ * @param naf (out) digits, least significant first
+ * @param scalar little-endian scalar
+ */
+static void scalar_wnaf(int8_t naf[256], const uint8_t scalar[32]) {
+    uint32_t k[9] = {0};
+    for (size_t i = 0; i < 32; i++) {
+        k[i / 4] |= (uint32_t)scalar[i] << (8 * (i % 4));
+    }
+
+    for (size_t pos = 0; pos < 256; pos++) {
+        int8_t digit = 0;
+        if (k[0] & 1) {
+            digit = (int8_t)(k[0] & 0x1F);
+            if (digit > 15) {
+                digit -= 32;
+            }
+
+            // k -= digit, which makes k a multiple of 32
+            int64_t carry = -(int64_t)digit;
+            for (size_t w = 0; w < 9 && carry != 0; w++) {
+                int64_t sum = (int64_t)k[w] + carry;
+                k[w] = (uint32_t)sum;
+                carry = sum >> 32;
+            }
+        }
+        naf[pos] = digit;
+
+        for (size_t w = 0; w < 8; w++) {
+            k[w] = (k[w] >> 1) | (k[w + 1] << 31);
+        }
+        k[8] >>= 1;
+    }
+}
+
+/**
+ * @brief acc += digit * P, where table holds the odd multiples of P
+ */
+static void add_digit(ge_t* acc, const ge_precomp_t table[EDDSA_TABLE_SIZE], int8_t digit) {
+    if (digit > 0) {
+        ge_madd(acc, acc, &table[digit / 2], false);
+    } else if (digit < 0) {
+        ge_madd(acc, acc, &table[-digit / 2], true);
+    }
+}
+
+/**
+ * @brief Adds row i of a split scalar multiplication to acc
+ *
+ * Digit i of chunk j is worth 2^(64j + i), and chunk j's table is already scaled by 2^(64j), so
+ * after the row for i = 0 the accumulator holds naf * P as long as it was doubled before each row.
+ */
+static void add_row(ge_t* acc, const int8_t naf[256],
+                    const ge_precomp_t table[EDDSA_SPLIT][EDDSA_TABLE_SIZE], size_t i) {
+    for (size_t j = 0; j < EDDSA_SPLIT; j++) {
+        add_digit(acc, table[j], naf[64 * j + i]);
+    }
+}
+
+/**
+ * @brief Compares the encoding of p with an encoded point
+ */
+static error_t ge_equals_encoding(const ge_t* p, const uint8_t encoding[32]) {
+    uint8_t check[32];
+    ge_tobytes(check, p);
+
+    if (memcmp(check, encoding, 32) == 0) {
+        return OK;
+    } else {
+        return ERROR;
+    }
+}
+
+/////////////////////////
+// Public interface
+/////////////////////////
+
+/**
+ * @brief Decodes a public key and precomputes everything needed to check signatures against it
+ *
+ * The first call also builds the base point table shared by all contexts.
+ *
+ * @param ctx (out) verification context
+ * @param public_key EdDSA public key (32 bytes)
+ * @return OK on success, ERROR if the public key is not a valid point
+ */
+error_t eddsa_verify_ctx_init(eddsa_verify_ctx_t* ctx, const uint8_t public_key[32]) {
+    UTIL_ASSERT(ctx != NULL);
+    UTIL_ASSERT(public_key != NULL);
+
+    if (!tables_ready) {
+        fe_frombytes(fe_d, D_BYTES);
+        fe_add(fe_d2, fe_d, fe_d);
+        fe_frombytes(fe_sqrtm1, SQRTM1_BYTES);
+
+        ge_t base;
+        UTIL_ASSERT(ge_frombytes(&base, BASE_POINT_BYTES) == OK);
+        build_table(base_table, &base);
+        tables_ready = true;
+    }
+
+    ge_t a;
+    if (ge_frombytes(&a, public_key) != OK) {
+        return ERROR;
+    }
+    ge_neg(&a, &a);
+    build_table(ctx->minus_a, &a);
+    memcpy(ctx->public_key, public_key, sizeof(ctx->public_key));
+
+    return OK;
+}
+
+/**
+ * @brief Checks the EdDSA equation R = [s]B - [h]A for a signature (R, s)
+ *
+ * Uses the cofactorless equation and compares encodings, so R never has to be decompressed.
+ *
+ * @param ctx verification context of the signer's public key
+ * @param signature signature (R || s, 64 bytes)
+ * @param h_ram reduced hash of R || A || message (32 bytes)
+ * @return OK if the signature is valid, ERROR otherwise
+ */
+error_t eddsa_verify_ctx_check(const eddsa_verify_ctx_t* ctx, const uint8_t signature[64],
+                               const uint8_t h_ram[32]) {
+    UTIL_ASSERT(ctx != NULL);
+    UTIL_ASSERT(signature != NULL);
+    UTIL_ASSERT(h_ram != NULL);
+    UTIL_ASSERT(tables_ready);
+
+    const uint8_t* s = signature + 32;
+    if (!scalar_is_canonical(s)) {
+        return ERROR;
+    }
+
+    int8_t s_naf[256];
+    int8_t h_naf[256];
+    scalar_wnaf(s_naf, s);
+    scalar_wnaf(h_naf, h_ram);
+
+    ge_t acc;
+    ge_identity(&acc);
+    for (size_t i = 64; i-- > 0;) {
+        ge_double(&acc, &acc);
+        add_row(&acc, s_naf, base_table, i);
+        add_row(&acc, h_naf, ctx->minus_a, i);
+    }
+
+    return ge_equals_encoding(&acc, signature);
+}
+
+/**
+ * @brief Starts a split check for a signature with scalar s
+ *
+ * Split checks compute [s]B and [h](-A) separately, which costs 64 more doublings than
+ * eddsa_verify_ctx_check() but lets [s]B be computed while the message is still arriving.
+ *
+ * @param state (out) state of the check
+ * @param s second half of the signature (32 bytes)
+ * @return OK if the check can go ahead, ERROR if s is not canonical (signature is invalid)
+ */
+error_t eddsa_verify_start(eddsa_verify_state_t* state, const uint8_t s[32]) {
+    UTIL_ASSERT(state != NULL);
+    UTIL_ASSERT(s != NULL);
+    UTIL_ASSERT(tables_ready);
+
+    state->rows_left = 0;
+    if (!scalar_is_canonical(s)) {
+        return ERROR;
+    }
+
+    scalar_wnaf(state->s_naf, s);
+    ge_identity(&state->sb);
+    state->rows_left = 64;
+    return OK;
+}
+
+/**
+ * @brief Accumulates one row of [s]B, a small bounded amount of work
+ *
+ * @param state state of the check
+ * @return true if [s]B is complete, false if more steps are needed
+ */
+bool eddsa_verify_step(eddsa_verify_state_t* state) {
+    UTIL_ASSERT(state != NULL);
+    UTIL_ASSERT(state->rows_left <= 64);
+
+    if (state->rows_left == 0) {
+        return true;
+    }
+
+    state->rows_left -= 1;
+    ge_double(&state->sb, &state->sb);
+    add_row(&state->sb, state->s_naf, base_table, state->rows_left);
+
+    return state->rows_left == 0;
+}
+
+/**
+ * @brief Completes a split check, R = [s]B - [h]A
+ *
+ * @param state state of the check, after eddsa_verify_start() succeeded
+ * @param ctx verification context of the signer's public key
+ * @param r first half of the signature (32 bytes)
+ * @param h_ram reduced hash of R || A || message (32 bytes)
+ * @return OK if the signature is valid, ERROR otherwise
+ */
+error_t eddsa_verify_finish(eddsa_verify_state_t* state, const eddsa_verify_ctx_t* ctx,
+                            const uint8_t r[32], const uint8_t h_ram[32]) {
+    UTIL_ASSERT(state != NULL);
+    UTIL_ASSERT(ctx != NULL);
+    UTIL_ASSERT(r != NULL);
+    UTIL_ASSERT(h_ram != NULL);
+
+    while (!eddsa_verify_step(state)) {}
+
+    int8_t h_naf[256];
+    scalar_wnaf(h_naf, h_ram);
+
+    ge_t acc;
+    ge_identity(&acc);
+    for (size_t i = 64; i-- > 0;) {
+        ge_double(&acc, &acc);
+        add_row(&acc, h_naf, ctx->minus_a, i);
+    }
+
+    ge_cached_t sb;
+    ge_to_cached(&sb, &state->sb);
+    ge_add(&acc, &acc, &sb);
+
+    return ge_equals_encoding(&acc, r);
+}
@@ -7,10 +7,10 @@
 
 #include "fiproc.h"
 
-#include "rng.h"
+#include "drbg.h"
+#include "profile.h"
 #include "util.h"
 
-#include <monocypher.h>
 #include <mxc_delay.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -28,12 +28,21 @@
  * @param ticks number of ticks to delay for
  */
 inline static void delay_ticks(int32_t ticks) {
+#if HOST_BUILD
+    __asm__ inline volatile("0:\n\t"
+                            "subl $1, %0\n\t"
+                            "jns 0b\n\t"
+                            : "+r"(ticks)
+                            : // marking ticks as in-out already covers this
+                            : "cc");
+#else
     __asm__ inline volatile("0:\n\t"
                             "subs %0, #1\n\t"
                             "bpl 0b\n\t"
                             : "+r"(ticks)
                             : // marking ticks as in-out already covers this
                             : "cc");
+#endif
 }
 
 // Entropy pool to store pregenerated entropy for time critical usages
@@ -55,36 +64,15 @@ bool fiproc_pool_empty() {
     return false;
 }
 
-/**
- * @brief xor output buffer with input buffer
- */
-static void xor_bytes(uint8_t* output, const uint8_t* input, size_t length) {
-    for (size_t i = 0; i < length; i++) {
-        output[i] ^= input[i];
-    }
-}
-
 /**
  * @brief updates the fiproc pool if necessary
  *
- * Fills pool with FIPROC_POOL_SIZE bytes of random data
+ * Fills pool with FIPROC_POOL_SIZE bytes of random data from the DRBG, which costs a few ChaCha20
+ * blocks instead of a TRNG read
  */
 void fiproc_update_pool() {
-    uint8_t rng_buf[8];
-    // get new entropy
-    rng_get_unbiased_trng(rng_buf, 8);
-
-    // expand 8 bytes of RNG into 128 bytes
-    uint8_t entropy_pool_tmp[FIPROC_POOL_SIZE];
-    for (uint32_t i = 0; i < 2; i++) {
-        // Expand by using entropy as key and index as message, per HKDF-Expand
-        crypto_blake2b_keyed(entropy_pool_tmp + (i * 64), 64, // output
-                             rng_buf, sizeof(rng_buf),        // key
-                             (uint8_t*)&i, sizeof(i));        // message
-    }
-
-    // xor new entropy with any leftover entropy to update pool
-    xor_bytes(entropy_pool, entropy_pool_tmp, FIPROC_POOL_SIZE);
+    static_assert(FIPROC_POOL_SIZE <= DRBG_MAX_REQUEST);
+    drbg_generate(entropy_pool, FIPROC_POOL_SIZE);
 
     next = &entropy_pool[0];
 }
@@ -96,13 +84,18 @@ void fiproc_delay() {
     UTIL_ASSERT(fiproc_pool_empty() == false);
     uint32_t delay = *next;
     next++;
+    PROFILE_BEGIN(fiproc);
     delay_ticks(delay);
+    PROFILE_END(fiproc, PROFILE_FIPROC);
 }
 
 /**
- * @brief ranged delay between 2ms ~ 4ms
+ * @brief ranged delay between 0ms ~ 2ms
  */
 void fiproc_small_ranged_delay() {
-    uint32_t range = rng_get_u16(); // takes approx 2ms
+    uint16_t range;
+    drbg_generate(&range, sizeof(range));
+    PROFILE_BEGIN(fiproc);
     delay_ticks(range);
+    PROFILE_END(fiproc, PROFILE_FIPROC);
 }
@@ -0,0 +1,135 @@
+/**
+ * @file flash.c
+ * @brief Flash erase/write that keep the instruction cache coherent
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * ICC0 caches everything the CM4 reads through the code bus, which includes the subscription and
+ * lockout pages. The cache is suspended while the flash controller is busy and invalidated
+ * before it is turned back on, so no stale line survives an erase or write. Interrupts are masked
+ * for the same span.
+ */
+
+#include "flash.h"
+
+#include "common.h"
+#include "util.h"
+
+#include <flc.h>
+#include <icc_regs.h>
+#include <max78000.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Set by build.sh from DECODER_ICACHE
+#ifndef ENABLE_ICACHE
+#define ENABLE_ICACHE 1
+#endif
+
+/**
+ * @brief Invalidates the whole instruction cache and waits until it is usable again
+ */
+static void icache_invalidate(void) {
+    MXC_ICC0->invalidate = 1;
+    while (!(MXC_ICC0->ctrl & MXC_F_ICC_CTRL_RDY)) {}
+}
+
+/**
+ * @brief Turns the instruction cache off for a flash operation
+ *
+ * @return whether the cache was on
+ */
+static bool icache_suspend(void) {
+    bool was_enabled = MXC_ICC0->ctrl & MXC_F_ICC_CTRL_EN;
+    MXC_ICC0->ctrl &= ~MXC_F_ICC_CTRL_EN;
+    return was_enabled;
+}
+
+/**
+ * @brief Invalidates the instruction cache and turns it back on if it was on before
+ *
+ * @param was_enabled return value of the matching icache_suspend()
+ */
+static void icache_resume(bool was_enabled) {
+    icache_invalidate();
+    if (was_enabled) {
+        MXC_ICC0->ctrl |= MXC_F_ICC_CTRL_EN;
+        while (!(MXC_ICC0->ctrl & MXC_F_ICC_CTRL_RDY)) {}
+    }
+}
+
+/**
+ * @brief Sets up the CM4 instruction cache, on unless built with DECODER_ICACHE=0
+ *
+ * ICC1 belongs to the RISC-V core, which is never started, so it always stays off.
+ */
+void icache_init(void) {
+    MXC_ICC1->ctrl &= ~MXC_F_ICC_CTRL_EN;
+
+    icache_suspend();
+    icache_resume(ENABLE_ICACHE);
+}
+
+#if BENCH_ICACHE
+
+/**
+ * @brief Turns the instruction cache on or off, for icache_benchmark()
+ *
+ * @param enable whether the cache should be on
+ * @return whether the cache was on
+ */
+bool icache_set(bool enable) {
+    bool was_enabled = icache_suspend();
+    icache_resume(enable);
+    return was_enabled;
+}
+
+#endif
+
+/**
+ * @brief Erases a flash page
+ *
+ * @param address any address within the page
+ * @return OK if the page was erased, ERROR otherwise
+ */
+error_t flash_erase_page(uint32_t address) {
+    // interrupt handlers run from flash, which cannot be read while it is being programmed
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool was_enabled = icache_suspend();
+    int res = MXC_FLC_PageErase(address);
+    icache_resume(was_enabled);
+    __set_PRIMASK(primask);
+
+    if (res == E_NO_ERROR) {
+        return OK;
+    } else {
+        return ERROR;
+    }
+}
+
+/**
+ * @brief Writes to erased flash
+ *
+ * @param address destination address, 16-byte aligned for writes longer than a word
+ * @param length number of bytes to write
+ * @param data data to write
+ * @return OK if the data was written, ERROR otherwise
+ */
+error_t flash_write(uint32_t address, uint32_t length, const uint32_t* data) {
+    UTIL_ASSERT(data != NULL || length == 0);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool was_enabled = icache_suspend();
+    int res = MXC_FLC_Write(address, length, (uint32_t*)data);
+    icache_resume(was_enabled);
+    __set_PRIMASK(primask);
+
+    if (res == E_NO_ERROR) {
+        return OK;
+    } else {
+        return ERROR;
+    }
+}
@@ -7,14 +7,21 @@
 
 #include "frame.h"
 
+#include "bench_report.h"
 #include "common.h"
+#include "drbg.h"
 #include "fiproc.h"
+#include "flash.h"
 #include "host_messaging.h"
+#include "key_expansion.h"
+#include "key_tree.h"
 #include "lockout.h"
-#include "secrets.h"
+#include "profile.h"
 #include "subscription.h"
 #include "util.h"
 
+#include <max78000.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -22,12 +29,15 @@
 /**
  * @brief Determines the tree vertex and key for a timestamp within a subscription.
  *
+ * Replays the cover of [start, end] built by gen_subscription.py -> vertices_for_range(), one
+ * tree digit (TREE_ARITY_BITS) at a time.
+ *
  * @param sub The subscription that the timestamp is for
  * @param t The timestamp to find a parent key for
  * @param position Position of parent key is written on success
- * @return SIZE_MAX if t is outside [start, end], index into in sub->tree_keys otherwise
+ * @return SIZE_MAX if t is outside [start, end], index of the packaged tree key otherwise
  */
-static size_t key_index_for_time(const valid_subscription_t* sub, timestamp_t t,
+static size_t key_index_for_time(const subscription_info_t* sub, timestamp_t t,
                                  vertex_t* position) {
     UTIL_ASSERT(sub != NULL);
     UTIL_ASSERT(position != NULL);
@@ -48,13 +58,14 @@ static size_t key_index_for_time(const valid_subscription_t* sub, timestamp_t t,
         UTIL_ASSERT(t <= end_prefix);
         UTIL_ASSERT(start_idx <= end_idx);
 
-        if ((start_prefix & 1) == 0 && (end_prefix & 1) == 1) {
+        if ((start_prefix & TREE_ARITY_MASK) == 0 &&
+            (end_prefix & TREE_ARITY_MASK) == TREE_ARITY_MASK) {
             // move up a level
-            start_prefix >>= 1;
-            end_prefix >>= 1;
-            t >>= 1;
-            bits -= 1;
-        } else if ((start_prefix & 1) == 1) {
+            start_prefix >>= TREE_ARITY_BITS;
+            end_prefix >>= TREE_ARITY_BITS;
+            t >>= TREE_ARITY_BITS;
+            bits -= TREE_ARITY_BITS;
+        } else if ((start_prefix & TREE_ARITY_MASK) != 0) {
             // start is a packaged key
             if (start_prefix == t) {
                 position->prefix = start_prefix;
@@ -65,7 +76,7 @@ static size_t key_index_for_time(const valid_subscription_t* sub, timestamp_t t,
                 start_prefix += 1;
                 start_idx += 1;
             }
-        } else { // end & 1 == 0
+        } else { // end & TREE_ARITY_MASK != TREE_ARITY_MASK
             // end is a packaged key
             if (end_prefix == t) {
                 position->prefix = end_prefix;
@@ -80,106 +91,359 @@ static size_t key_index_for_time(const valid_subscription_t* sub, timestamp_t t,
     }
 }
 
-static void derive_tree_key_helper(const vertex_t* path, const uint8_t* parent_key, uint8_t* key) {
-    UTIL_ASSERT(path != NULL);
+/**
+ * @brief Cached tree keys on the path from a stored vertex down to the last derived leaf
+ *
+ * path[l] holds the key of the level-l vertex on the path to `leaf`, for root.bits /
+ * TREE_ARITY_BITS <= l <= depth. Timestamps only increase, so the next frame usually shares
+ * all but the last few levels of this path and only the levels below the deepest common ancestor
+ * are re-derived. The root is a packaged vertex or an expanded one (see key_expansion.c), and the
+ * root level holds an SRAM copy of its key, so flash is only read when the root changes.
+ *
+ * The entry also tracks the channel's frame cadence, so decode_prefetch() can derive the key of the
+ * expected next frame ahead of time and leave it in leaf_key (then `leaf` is that frame's
+ * timestamp).
+ */
+typedef struct {
+    bool valid;
+    channel_t channel;
+    uint32_t generation; // of the subscription the packaged key came from
+    vertex_t root;
+    timestamp_t leaf;
+    uint8_t depth; // TREE_LEVELS, except while expanding a subscription
+    uint8_t path[TREE_LEVELS + 1][TREE_KEY_LEN];
+
+    bool seen;              // last_frame is set
+    timestamp_t last_frame; // timestamp of the last decoded frame
+    timestamp_t cadence;    // difference of the last two decoded frames, 0 if unknown
+    bool prefetch_done;     // prefetch attempted since the last decoded frame
+    bool leaf_key_valid;    // leaf_key is the frame key of `leaf`
+    uint8_t leaf_key[SYMMETRIC_KEY_LEN];
+} key_path_cache_t;
+
+static key_path_cache_t key_path_cache[MAX_CHANNEL_COUNT];
+static size_t key_path_cache_victim = 0;
+static size_t prefetch_next = 0;
+
+static prefetch_stats_t prefetch_stats;
+
+/**
+ * @brief Drops the precomputed frame key of a cache entry
+ */
+static void forget_leaf_key(key_path_cache_t* cache) {
+    memset_explicit(cache->leaf_key, 0, sizeof(cache->leaf_key));
+    cache->leaf_key_valid = false;
+}
+
+/**
+ * @brief Finds the key path cache entry for a channel, recycling an entry if there is none
+ *
+ * @param ch channel to find the cache entry for
+ * @return cache entry for ch (possibly invalid)
+ */
+static key_path_cache_t* get_key_path_cache(channel_t ch) {
+    key_path_cache_t* unused = NULL;
+    for (size_t i = 0; i < MAX_CHANNEL_COUNT; i++) {
+        if (key_path_cache[i].valid && key_path_cache[i].channel == ch) {
+            return &key_path_cache[i];
+        }
+        if (!key_path_cache[i].valid && unused == NULL) {
+            unused = &key_path_cache[i];
+        }
+    }
+
+    if (unused == NULL) {
+        // all entries belong to other channels, some of which may no longer be subscribed
+        unused = &key_path_cache[key_path_cache_victim];
+        key_path_cache_victim = (key_path_cache_victim + 1) % MAX_CHANNEL_COUNT;
+    }
+
+    unused->valid = false;
+    unused->channel = ch;
+    unused->seen = false;
+    unused->cadence = 0;
+    unused->prefetch_done = false;
+    forget_leaf_key(unused);
+    return unused;
+}
+
+/**
+ * @brief Brings the cached path down to level `depth` of the path to timestamp t
+ *
+ * Only the levels below the deepest common ancestor of t and the cached leaf are derived, as long
+ * as the cache was filled from the same root key.
+ *
+ * @param cache key path cache for the frame's channel
+ * @param t timestamp
+ * @param sub subscription the root key belongs to
+ * @param parent_key key of the root vertex, packaged or expanded (TREE_KEY_LEN bytes)
+ * @param parent_position parent position (prefix, bits(tree level))
+ * @param depth last level to derive, TREE_LEVELS for a leaf
+ */
+static void derive_path(key_path_cache_t* cache, const timestamp_t t,
+                        const subscription_info_t* sub, const uint8_t* parent_key,
+                        const vertex_t* parent_position, uint8_t depth) {
+    UTIL_ASSERT(cache != NULL);
+    UTIL_ASSERT(sub != NULL);
     UTIL_ASSERT(parent_key != NULL);
-    UTIL_ASSERT(key != NULL);
-    memcpy(key, parent_key, TREE_KEY_LEN);
-
-    // get the msb of path
-    // path    = 0b abcd_...._wxyz
-    // bitmask = 0b 1000_...._0000
-    for (uint8_t level = 0; level < path->bits; level++) {
-        uint8_t bit = path->bits - level - 1;
-        uint64_t curr_direction = path->prefix & (1LL << bit);
-        if (curr_direction == 0) {
-            // key = KDF(key || left)
-            kdf_tree_child(key, key, LEFT_TREE_KEY);
-        } else {
-            // key = KDF(key || right)
-            kdf_tree_child(key, key, RIGHT_TREE_KEY);
+    UTIL_ASSERT(parent_position != NULL);
+    UTIL_ASSERT(parent_position->bits <= MAX_TREE_HEIGHT);
+    UTIL_ASSERT(parent_position->bits % TREE_ARITY_BITS == 0);
+    UTIL_ASSERT(depth <= TREE_LEVELS);
+    UTIL_ASSERT(parent_position->bits / TREE_ARITY_BITS <= depth);
+
+    if (parent_position->bits == 0) {
+        UTIL_ASSERT(parent_position->prefix == 0);
+    } else {
+        UTIL_ASSERT((t >> (MAX_TREE_HEIGHT - parent_position->bits)) == parent_position->prefix);
+    }
+
+    uint8_t level = parent_position->bits / TREE_ARITY_BITS;
+
+    // the leaf moves, a precomputed frame key would no longer match it
+    forget_leaf_key(cache);
+
+    // the stored key of a vertex only changes when the subscription is replaced
+    if (cache->valid && cache->generation == sub->generation &&
+        cache->root.bits == parent_position->bits &&
+        cache->root.prefix == parent_position->prefix) {
+        // the top `common` digits of t select the same vertices as the cached leaf
+        timestamp_t diff = t ^ cache->leaf;
+        uint8_t common_bits = (diff == 0) ? MAX_TREE_HEIGHT : (uint8_t)__builtin_clzll(diff);
+        uint8_t common = common_bits / TREE_ARITY_BITS;
+        if (common > cache->depth) {
+            common = cache->depth;
         }
+        if (common > level) {
+            level = common;
+        }
+    } else {
+        cache->valid = false;
+        cache->generation = sub->generation;
+        cache->root = *parent_position;
+        memcpy(cache->path[level], parent_key, TREE_KEY_LEN);
     }
+
+    // walk from the most significant remaining digit of t down to the requested level
+    // t     = 0b abcd_...._wxyz
+    // digit = 0b 1111_...._0000 -> 0b 0000_...._1111 (TREE_ARITY_BITS = 4)
+    for (; level < depth; level++) {
+        uint8_t shift = MAX_TREE_HEIGHT - (level + 1) * TREE_ARITY_BITS;
+        uint32_t child = (uint32_t)(t >> shift) & TREE_ARITY_MASK;
+        kdf_tree_child(cache->path[level + 1], cache->path[level], child);
+    }
+
+    cache->leaf = t;
+    cache->depth = depth;
+    cache->valid = true;
 }
 
 /**
  * @brief derive frame key by timestamp and key tree
  *
+ * Takes the key precomputed by decode_prefetch() if it was derived for t from the same root key,
+ * otherwise walks the cached path (see derive_path()).
+ *
+ * @param cache key path cache for the frame's channel
  * @param t timestamp
- * @param parent_key parent key (32 bytes)
+ * @param sub subscription the root key belongs to
+ * @param parent_key key of the root vertex, packaged or expanded (TREE_KEY_LEN bytes)
  * @param parent_position parent position (prefix, bits(tree level))
  * @param key (out) frame key (32 bytes)
+ * @return true if the precomputed key was used
  */
-static void derive_tree_key(const timestamp_t t, const uint8_t* parent_key,
+static bool derive_tree_key(key_path_cache_t* cache, const timestamp_t t,
+                            const subscription_info_t* sub, const uint8_t* parent_key,
                             const vertex_t* parent_position, uint8_t* key) {
-    UTIL_ASSERT(parent_key != NULL);
+    UTIL_ASSERT(cache != NULL);
+    UTIL_ASSERT(sub != NULL);
     UTIL_ASSERT(parent_position != NULL);
     UTIL_ASSERT(key != NULL);
 
-    if (parent_position->bits == MAX_TREE_HEIGHT) {
-        UTIL_ASSERT(parent_position->prefix == t);
-        memcpy(key, parent_key, SYMMETRIC_KEY_LEN);
-    } else if (parent_position->bits == 0) {
-        UTIL_ASSERT(parent_position->prefix == 0);
-        const vertex_t path = {.prefix = t, .bits = MAX_TREE_HEIGHT};
-        derive_tree_key_helper(&path, parent_key, key);
-    } else {
-        UTIL_ASSERT((t >> (MAX_TREE_HEIGHT - parent_position->bits)) == parent_position->prefix);
+    if (cache->leaf_key_valid && cache->valid && cache->leaf == t &&
+        cache->generation == sub->generation && cache->root.bits == parent_position->bits &&
+        cache->root.prefix == parent_position->prefix) {
+        memcpy(key, cache->leaf_key, SYMMETRIC_KEY_LEN);
+        forget_leaf_key(cache);
+        return true;
+    }
+
+    derive_path(cache, t, sub, parent_key, parent_position, TREE_LEVELS);
+    kdf_tree_leaf(key, cache->path[TREE_LEVELS]);
+    return false;
+}
 
-        // e.g. t = 0b1001_abcd_...._wxyz (bits = 64)
-        // parent = 0b1001                (bits = 4)
-        // path   = 0b0000_abcd_...._wxyz, (60 bits)
-        // abcd_...._xwyz is the path we want to follow along with from the parent node down to
-        // the leaf
-        const vertex_t path = {
-            .prefix = t ^ (parent_position->prefix << (MAX_TREE_HEIGHT - parent_position->bits)),
-            .bits = MAX_TREE_HEIGHT - parent_position->bits};
-        derive_tree_key_helper(&path, parent_key, key);
+/**
+ * @brief Picks the deepest stored vertex above t: an expanded vertex if there is one, otherwise
+ * the packaged vertex found by key_index_for_time()
+ *
+ * @param sub subscription of t
+ * @param t timestamp within the subscription
+ * @param index index of the packaged key above t
+ * @param position (in/out) position of the packaged key, replaced by the expanded vertex if any
+ * @return key of the vertex at position (TREE_KEY_LEN bytes, in flash)
+ */
+static const uint8_t* root_key_for_time(const subscription_info_t* sub, timestamp_t t,
+                                        size_t index, vertex_t* position) {
+    const uint8_t* key = key_expansion_find(sub, t, position);
+    if (key != NULL) {
+        return key;
     }
+    return get_subscription_tree_key(sub, index);
+}
+
+/**
+ * @brief Derives the keys of consecutive vertices of one tree level, used to expand a
+ * subscription (see key_expansion.c)
+ *
+ * Consecutive vertices share most of their paths, so this takes about TREE_ARITY / (TREE_ARITY -
+ * 1) child derivations per vertex once the first path is derived.
+ *
+ * @param sub subscription covering all the vertices
+ * @param bits tree level of the vertices, a multiple of TREE_ARITY_BITS
+ * @param first prefix of the first vertex
+ * @param count number of vertices
+ * @param emit called with each vertex key in order
+ * @param ctx passed to emit
+ */
+void derive_vertex_keys(const subscription_info_t* sub, uint8_t bits, timestamp_t first,
+                        uint32_t count, vertex_key_fn_t emit, void* ctx) {
+    UTIL_ASSERT(sub != NULL);
+    UTIL_ASSERT(emit != NULL);
+    UTIL_ASSERT(bits > 0 && bits <= MAX_TREE_HEIGHT);
+    UTIL_ASSERT(bits % TREE_ARITY_BITS == 0);
 
-    kdf_tree_leaf(key, key);
+    static key_path_cache_t cache;
+    cache.valid = false;
+
+    for (uint32_t i = 0; i < count; i++) {
+        // first timestamp below the vertex
+        timestamp_t t = first + i;
+        if (bits < MAX_TREE_HEIGHT) {
+            t <<= MAX_TREE_HEIGHT - bits;
+        }
+
+        // the vertex is inside the subscription, so its packaged key is itself or an ancestor
+        vertex_t v = {};
+        size_t index = key_index_for_time(sub, t, &v);
+        UTIL_ASSERT(index != SIZE_MAX);
+        UTIL_ASSERT(v.bits <= bits);
+
+        // each derivation takes a delay, a vertex takes at most TREE_LEVELS of them
+        fiproc_update_pool();
+        derive_path(&cache, t, sub, get_subscription_tree_key(sub, index), &v,
+                    bits / TREE_ARITY_BITS);
+        emit(ctx, i, cache.path[bits / TREE_ARITY_BITS]);
+    }
+
+    memset_explicit(&cache, 0, sizeof(cache));
+}
+
+/**
+ * @brief Counts a frame key derivation in the prefetch statistics
+ *
+ * @param hit the key precomputed by decode_prefetch() was used
+ * @param mispredicted a key had been precomputed, but for another timestamp
+ * @param cycles cycles spent in derive_tree_key()
+ */
+static void count_derivation(bool hit, bool mispredicted, uint32_t cycles) {
+    if (hit) {
+        prefetch_stats.hits++;
+        prefetch_stats.hit_cycles += cycles;
+    } else if (mispredicted) {
+        prefetch_stats.misses++;
+        prefetch_stats.miss_cycles += cycles;
+    } else {
+        prefetch_stats.unpredicted++;
+        prefetch_stats.unpredicted_cycles += cycles;
+    }
+}
+
+/**
+ * @brief Updates a channel's cadence with a decoded frame, allowing the next prefetch
+ */
+static void track_cadence(key_path_cache_t* cache, timestamp_t t) {
+    if (cache->seen && t > cache->last_frame) {
+        cache->cadence = t - cache->last_frame;
+    }
+    cache->seen = true;
+    cache->last_frame = t;
+    cache->prefetch_done = false;
 }
 
 static bool received_first_frame = false;
 static timestamp_t current_timestamp = 0;
 
 /**
- * @brief Decode a frame packet and send the decoded frame to the host.
+ * @brief Checks the cleartext timestamp of a v3 packet before its signature
  *
- * @param packet Frame packet to decode
- * @return OK if frame was able to be decoded, ERROR if it was not.
+ * A frame that fails here would be dropped by decode_verified() anyway, as the encrypted timestamp
+ * has to match. The timestamp is not authenticated yet, so a forged one can only get its own
+ * packet dropped.
+ *
+ * @param sub subscription for the frame's channel
+ * @param t cleartext timestamp
+ * @return true if the frame may still be decoded
  */
-error_t decode(const frame_packet_t* packet) {
+static bool timestamp_acceptable(const subscription_info_t* sub, timestamp_t t) {
+    if (received_first_frame && t <= current_timestamp) {
+        return false;
+    }
+    return sub->start <= t && t <= sub->end;
+}
 
-    // Decoder will only enter the lockout state once it detects an attack.
+/**
+ * @brief Decrypts a frame whose signature has been checked, in place
+ *
+ * Both layers are decrypted where they were received: the timestamped frame overwrites the outer
+ * ciphertext and the frame overwrites the inner ciphertext, so nothing is copied out of the
+ * receive buffer. The caller clears the plaintext with frame_data_wipe() once it is sent.
+ *
+ * @param sub subscription for the frame's channel
+ * @param channel_id channel of the frame
+ * @param enc_frame encrypted timestamped frame, 4-byte aligned, overwritten
+ * @param timestamp_hint signed cleartext timestamp of a v3 packet, NULL for older versions
+ * @param frame_out (out) decoded frame, points into enc_frame
+ * @return OK if frame was able to be decoded, ERROR if it was not.
+ */
+static error_t decode_verified(const subscription_info_t* sub, channel_t channel_id,
+                               uint8_t* enc_frame, const timestamp_t* timestamp_hint,
+                               frame_data_t** frame_out) {
+    UTIL_ASSERT(sub != NULL);
+    UTIL_ASSERT(enc_frame != NULL);
+    UTIL_ASSERT(frame_out != NULL);
+    UTIL_ASSERT((size_t)enc_frame % sizeof(uint32_t) == 0);
 
-    const valid_subscription_t* sub = get_subscription_by_channel(packet->payload.channel_id);
+    // the timestamped frame may not be 8-byte aligned, so it is only accessed bytewise
+    uint8_t* timestamped_frame = enc_frame + SYMMETRIC_METADATA_LEN;
+    uint8_t* enc_frame_data = timestamped_frame + offsetof(frame_ch_t, ciphertext);
 
     fiproc_delay();
-    if (sub == NULL) {
+    PROFILE_BEGIN(outer);
+    error_t outer_result =
+        decrypt_symmetric(timestamped_frame, enc_frame, sizeof(frame_ch_t), sub->kch);
+    PROFILE_END(outer, PROFILE_OUTER_AEAD);
+    if (outer_result != OK) {
+        // inner decryption is corrupted but signature passes means attack
+        attack_detected();
         return ERROR;
     }
 
-    volatile error_t result = ERROR;
-    result = verify_asymmetric(packet->signature, (const uint8_t*)&packet->payload,
-                               sizeof(packet->payload), ENCODER_PUBLIC_KEY);
-    fiproc_delay();
-    MULTI_IF_FAILIN(result != OK) { return ERROR; }
+    timestamp_t timestamp;
+    memcpy(&timestamp, timestamped_frame + offsetof(frame_ch_t, timestamp), sizeof(timestamp));
 
     fiproc_delay();
-    frame_ch_t timestamped_frame = {};
-    if (decrypt_symmetric((uint8_t*)&timestamped_frame, packet->payload.enc_frame,
-                          sizeof(timestamped_frame), sub->kch) != OK) {
-        // inner decryption is corrupted but signature passes means attack
+    if (timestamp_hint != NULL && timestamp != *timestamp_hint) {
+        // both timestamps are authenticated, the encoder never makes them differ
         attack_detected();
         return ERROR;
     }
 
     // Check for monotonicity
     fiproc_delay();
-    if (!received_first_frame || timestamped_frame.timestamp > current_timestamp) {
+    if (!received_first_frame || timestamp > current_timestamp) {
         received_first_frame = true;
-        current_timestamp = timestamped_frame.timestamp;
+        current_timestamp = timestamp;
     } else {
         // Not an attack just drop the packet and go to the next packet
         return ERROR;
@@ -187,7 +451,7 @@ error_t decode(const frame_packet_t* packet) {
 
     // obtain position and index of parent key in the tree for this timestamp
     vertex_t v = {};
-    size_t index = key_index_for_time(sub, timestamped_frame.timestamp, &v);
+    size_t index = key_index_for_time(sub, timestamp, &v);
     fiproc_delay();
     if (index == SIZE_MAX) {
         // t is outside of the subscription's time range, possibly just expired/recorded (not an
@@ -195,32 +459,603 @@ error_t decode(const frame_packet_t* packet) {
         return ERROR;
     }
 
+    PROFILE_BEGIN(root);
+    const uint8_t* root_key = root_key_for_time(sub, timestamp, index, &v);
+    PROFILE_END(root, PROFILE_TREE);
+
     uint8_t kt[SYMMETRIC_KEY_LEN] = {};
+    key_path_cache_t* cache = get_key_path_cache(channel_id);
+    bool had_leaf_key = cache->leaf_key_valid;
     fiproc_delay();
-    derive_tree_key(timestamped_frame.timestamp, sub->ktree[index], &v, kt);
+    PROFILE_BEGIN(tree);
+    uint32_t start = DWT->CYCCNT;
+    bool hit = derive_tree_key(cache, timestamp, sub, root_key, &v, kt);
+    count_derivation(hit, had_leaf_key && !hit, DWT->CYCCNT - start);
+    PROFILE_END(tree, PROFILE_TREE);
 
     // decrypt enc_frame with kt
-    frame_data_t frame_data = {};
+    frame_data_t* frame_data = (frame_data_t*)(enc_frame_data + SYMMETRIC_METADATA_LEN);
     fiproc_delay();
-    if (decrypt_symmetric((uint8_t*)&frame_data, timestamped_frame.ciphertext, sizeof(frame_data),
-                          kt) == ERROR) {
-        // inner decryption corrupted means attack
+    PROFILE_BEGIN(inner);
+    error_t result =
+        decrypt_symmetric((uint8_t*)frame_data, enc_frame_data, sizeof(*frame_data), kt);
+    PROFILE_END(inner, PROFILE_INNER_AEAD);
+    memset_explicit(kt, 0, sizeof(kt));
+    if (result == ERROR) {
+        // inner decryption corrupted means attack, don't trust the cached path afterwards
+        cache->valid = false;
         attack_detected();
         return ERROR;
     }
 
     fiproc_delay();
-    if (frame_data.length > MAX_FRAME_SIZE) {
+    if (frame_data->length > MAX_FRAME_SIZE) {
         // attacker forged a signature and got through two layers of encryption, definitely an
         // attack
+        frame_data_wipe(frame_data);
         attack_detected();
         return ERROR;
     }
 
     // update most recent timestamp
-    current_timestamp = timestamped_frame.timestamp;
+    current_timestamp = timestamp;
+    track_cadence(cache, timestamp);
+
+    *frame_out = frame_data;
+
+    return OK;
+}
+
+/**
+ * @brief Idle hook: precomputes the frame key of the next expected frame of one channel
+ *
+ * The next timestamp of a channel is predicted as its last frame plus its cadence. Each call
+ * prefetches for at most one channel, taking the channels in turn, and each channel is prefetched
+ * at most once per decoded frame. On a misprediction derive_tree_key() still reuses the path down
+ * to the common ancestor.
+ */
+void decode_prefetch(void) {
+    for (size_t n = 0; n < MAX_CHANNEL_COUNT; n++) {
+        key_path_cache_t* cache = &key_path_cache[prefetch_next];
+        prefetch_next = (prefetch_next + 1) % MAX_CHANNEL_COUNT;
+
+        if (cache->cadence == 0 || cache->prefetch_done) {
+            continue;
+        }
+        cache->prefetch_done = true;
+
+        // no prefetch on overflow, or for a frame that would be dropped as not monotonic
+        timestamp_t next = cache->last_frame + cache->cadence;
+        if (next < cache->last_frame || (received_first_frame && next <= current_timestamp)) {
+            continue;
+        }
+
+        const subscription_info_t* sub = get_subscription_by_channel(cache->channel);
+        if (sub == NULL) {
+            continue;
+        }
+
+        vertex_t v = {};
+        size_t index = key_index_for_time(sub, next, &v);
+        if (index == SIZE_MAX) {
+            continue;
+        }
+
+        const uint8_t* root_key = root_key_for_time(sub, next, index, &v);
+        derive_path(cache, next, sub, root_key, &v, TREE_LEVELS);
+        kdf_tree_leaf(cache->leaf_key, cache->path[TREE_LEVELS]);
+        cache->leaf_key_valid = true;
+
+        // the derivations took up to TREE_LEVELS + 1 delays, the next prefetch or message gets a
+        // full pool again
+        fiproc_update_pool();
+        prefetch_stats.prefetches++;
+        return;
+    }
+}
+
+/**
+ * @brief Copies out the prefetch hit rate and frame key latency counters
+ *
+ * @param stats (out) counters since boot
+ */
+void get_prefetch_stats(prefetch_stats_t* stats) {
+    UTIL_ASSERT(stats != NULL);
+    *stats = prefetch_stats;
+}
+
+/**
+ * @brief Clears the plaintext left in a receive buffer by a successful decode
+ *
+ * @param frame decoded frame, as returned by one of the decode functions
+ */
+void frame_data_wipe(frame_data_t* frame) {
+    UTIL_ASSERT(frame != NULL);
+
+    // the whole timestamped frame was decrypted in place, the frame data is at its end
+    uint8_t* timestamped_frame =
+        (uint8_t*)frame - SYMMETRIC_METADATA_LEN - offsetof(frame_ch_t, ciphertext);
+    memset_explicit(timestamped_frame, 0, sizeof(frame_ch_t));
+}
+
+/**
+ * @brief Decode a frame packet.
+ *
+ * @param packet Frame packet to decode, decrypted in place
+ * @param frame_out (out) decoded frame inside the packet, valid on success
+ * @return OK if frame was able to be decoded, ERROR if it was not.
+ */
+error_t decode(frame_packet_t* packet, frame_data_t** frame_out) {
+
+    // Decoder will only enter the lockout state once it detects an attack.
+
+    const subscription_info_t* sub = get_subscription_by_channel(packet->payload.channel_id);
+
+    fiproc_delay();
+    if (sub == NULL) {
+        return ERROR;
+    }
+
+    volatile error_t result = ERROR;
+    PROFILE_BEGIN(signature);
+    result = verify_asymmetric(packet->signature, (const uint8_t*)&packet->payload,
+                               sizeof(packet->payload), &encoder_verify_ctx);
+    PROFILE_END(signature, PROFILE_SIGNATURE);
+    fiproc_delay();
+    MULTI_IF_FAILIN(result != OK) { return ERROR; }
+
+    return decode_verified(sub, packet->payload.channel_id, packet->payload.enc_frame, NULL,
+                           frame_out);
+}
+
+/**
+ * @brief Decode a v2 frame packet that was received without decode_stream_poll().
+ *
+ * @param packet Frame packet to decode, decrypted in place
+ * @param frame_out (out) decoded frame inside the packet, valid on success
+ * @return OK if frame was able to be decoded, ERROR if it was not.
+ */
+error_t decode_v2(frame_packet_v2_t* packet, frame_data_t** frame_out) {
+    if (packet->payload.version != FRAME_PACKET_VERSION_2) {
+        return ERROR;
+    }
+
+    const subscription_info_t* sub = get_subscription_by_channel(packet->payload.channel_id);
+
+    fiproc_delay();
+    if (sub == NULL) {
+        return ERROR;
+    }
+
+    volatile error_t result = ERROR;
+    PROFILE_BEGIN(signature);
+    result = verify_asymmetric(packet->signature, (const uint8_t*)&packet->payload,
+                               sizeof(packet->payload), &encoder_verify_ctx);
+    PROFILE_END(signature, PROFILE_SIGNATURE);
+    fiproc_delay();
+    MULTI_IF_FAILIN(result != OK) { return ERROR; }
+
+    return decode_verified(sub, packet->payload.channel_id, packet->payload.enc_frame, NULL,
+                           frame_out);
+}
+
+/**
+ * @brief Decode a v3 frame packet that was received without decode_stream_poll().
+ *
+ * Stale and out of subscription frames are dropped by their cleartext timestamp before the
+ * signature check.
+ *
+ * @param packet Frame packet to decode, 4-byte aligned, decrypted in place
+ * @param frame_out (out) decoded frame inside the packet, valid on success
+ * @return OK if frame was able to be decoded, ERROR if it was not.
+ */
+error_t decode_v3(frame_packet_v3_t* packet, frame_data_t** frame_out) {
+    if (packet->payload.version != FRAME_PACKET_VERSION_3) {
+        return ERROR;
+    }
+
+    const subscription_info_t* sub = get_subscription_by_channel(packet->payload.channel_id);
+
+    fiproc_delay();
+    if (sub == NULL) {
+        return ERROR;
+    }
+
+    // batch records are only 4-byte aligned
+    timestamp_t timestamp;
+    memcpy(&timestamp, (const uint8_t*)packet + offsetof(frame_packet_v3_t, payload.timestamp),
+           sizeof(timestamp));
+
+    fiproc_delay();
+    if (!timestamp_acceptable(sub, timestamp)) {
+        return ERROR;
+    }
+
+    volatile error_t result = ERROR;
+    PROFILE_BEGIN(signature);
+    result = verify_asymmetric(packet->signature, (const uint8_t*)&packet->payload,
+                               sizeof(packet->payload), &encoder_verify_ctx);
+    PROFILE_END(signature, PROFILE_SIGNATURE);
+    fiproc_delay();
+    MULTI_IF_FAILIN(result != OK) { return ERROR; }
+
+    return decode_verified(sub, packet->payload.channel_id, packet->payload.enc_frame, &timestamp,
+                           frame_out);
+}
+
+// Signature check of the v2/v3 packet currently being received
+static verify_stream_t frame_stream;
+static size_t frame_stream_len = 0;
+static size_t frame_stream_absorbed = 0;
+static bool frame_stream_active = false;
+static bool frame_stream_dropped = false; // v3 packet that will be dropped by its timestamp
+
+/**
+ * @brief Starts checking the signature of a v2/v3 frame packet that is about to be received
+ *
+ * @param packet_len length of the packet, sizeof(frame_packet_v2_t) or sizeof(frame_packet_v3_t)
+ */
+void decode_stream_begin(size_t packet_len) {
+    UTIL_ASSERT(packet_len == sizeof(frame_packet_v2_t) ||
+                packet_len == sizeof(frame_packet_v3_t));
+
+    verify_stream_init(&frame_stream, &encoder_verify_ctx);
+    frame_stream_len = packet_len;
+    frame_stream_absorbed = 0;
+    frame_stream_active = true;
+    frame_stream_dropped = false;
+}
+
+/**
+ * @brief Checks the cleartext header of a v3 packet being received, once when it is complete
+ *
+ * @param msg_buf receive buffer holding the packet, 8-byte aligned
+ * @param received number of bytes of the packet received so far
+ */
+static void stream_check_header(const uint8_t* msg_buf, size_t received) {
+    size_t header_len = offsetof(frame_packet_v3_t, payload.enc_frame);
+    if (frame_stream_len != sizeof(frame_packet_v3_t) || frame_stream_absorbed >= header_len ||
+        received < header_len) {
+        return;
+    }
+
+    const frame_packet_v3_t* packet = (const frame_packet_v3_t*)msg_buf;
+    const subscription_info_t* sub = get_subscription_by_channel(packet->payload.channel_id);
+    if (packet->payload.version != FRAME_PACKET_VERSION_3 || sub == NULL ||
+        !timestamp_acceptable(sub, packet->payload.timestamp)) {
+        frame_stream_dropped = true;
+    }
+}
+
+/**
+ * @brief Receive idle hook: absorbs newly received bytes, or precomputes part of the check
+ *
+ * The signature is first on the wire, so everything except [h](-A) can be done by the time the
+ * last byte arrives. A v3 packet whose cleartext header already rules it out gets no more
+ * signature work.
+ *
+ * @param msg_buf receive buffer holding the packet
+ * @param received number of bytes of the packet received so far
+ */
+void decode_stream_poll(const uint8_t* msg_buf, size_t received) {
+    UTIL_ASSERT(msg_buf != NULL);
+    UTIL_ASSERT(frame_stream_active);
+    UTIL_ASSERT(received <= frame_stream_len);
+    UTIL_ASSERT(received >= frame_stream_absorbed);
+
+    if (frame_stream_dropped) {
+        return;
+    }
+
+    PROFILE_BEGIN(stream);
+    if (received > frame_stream_absorbed) {
+        stream_check_header(msg_buf, received);
+        verify_stream_absorb(&frame_stream, msg_buf + frame_stream_absorbed,
+                             received - frame_stream_absorbed);
+        frame_stream_absorbed = received;
+    } else {
+        verify_stream_idle(&frame_stream);
+    }
+    PROFILE_END(stream, PROFILE_STREAM_VERIFY);
+}
 
-    send_msg(DECODE_MSG, frame_data.frame, frame_data.length);
+/**
+ * @brief Finishes receiving a streamed packet
+ *
+ * @param packet the whole packet
+ * @param packet_len its length, as passed to decode_stream_begin()
+ * @return OK if the signature check can be finished, ERROR if the stream is not for this packet
+ */
+static error_t stream_finish(const uint8_t* packet, size_t packet_len) {
+    if (!frame_stream_active || frame_stream_len != packet_len) {
+        return ERROR;
+    }
+    frame_stream_active = false;
 
+    // bytes that arrived after the last idle call, unless the packet is dropped before its check
+    if (!frame_stream_dropped) {
+        verify_stream_absorb(&frame_stream, packet + frame_stream_absorbed,
+                             packet_len - frame_stream_absorbed);
+        frame_stream_absorbed = packet_len;
+    }
     return OK;
 }
+
+/**
+ * @brief Decode a v2 frame packet received with decode_stream_poll() as idle hook.
+ *
+ * @param packet Frame packet to decode, decrypted in place
+ * @param frame_out (out) decoded frame inside the packet, valid on success
+ * @return OK if frame was able to be decoded, ERROR if it was not.
+ */
+error_t decode_stream_end(frame_packet_v2_t* packet, frame_data_t** frame_out) {
+    UTIL_ASSERT(packet != NULL);
+
+    if (stream_finish((const uint8_t*)packet, sizeof(*packet)) != OK) {
+        return ERROR;
+    }
+
+    if (packet->payload.version != FRAME_PACKET_VERSION_2) {
+        return ERROR;
+    }
+
+    const subscription_info_t* sub = get_subscription_by_channel(packet->payload.channel_id);
+
+    fiproc_delay();
+    if (sub == NULL) {
+        return ERROR;
+    }
+
+    volatile error_t result = ERROR;
+    PROFILE_BEGIN(signature);
+    result = verify_stream_final(&frame_stream);
+    PROFILE_END(signature, PROFILE_SIGNATURE);
+    fiproc_delay();
+    MULTI_IF_FAILIN(result != OK) { return ERROR; }
+
+    return decode_verified(sub, packet->payload.channel_id, packet->payload.enc_frame, NULL,
+                           frame_out);
+}
+
+/**
+ * @brief Decode a v3 frame packet received with decode_stream_poll() as idle hook.
+ *
+ * @param packet Frame packet to decode, 8-byte aligned, decrypted in place
+ * @param frame_out (out) decoded frame inside the packet, valid on success
+ * @return OK if frame was able to be decoded, ERROR if it was not.
+ */
+error_t decode_stream_end_v3(frame_packet_v3_t* packet, frame_data_t** frame_out) {
+    UTIL_ASSERT(packet != NULL);
+
+    if (stream_finish((const uint8_t*)packet, sizeof(*packet)) != OK) {
+        return ERROR;
+    }
+
+    // same checks as stream_check_header(), which may not have seen the whole header
+    if (packet->payload.version != FRAME_PACKET_VERSION_3) {
+        return ERROR;
+    }
+
+    const subscription_info_t* sub = get_subscription_by_channel(packet->payload.channel_id);
+
+    fiproc_delay();
+    if (sub == NULL) {
+        return ERROR;
+    }
+
+    timestamp_t timestamp = packet->payload.timestamp;
+    fiproc_delay();
+    if (!timestamp_acceptable(sub, timestamp)) {
+        return ERROR;
+    }
+
+    volatile error_t result = ERROR;
+    PROFILE_BEGIN(signature);
+    result = verify_stream_final(&frame_stream);
+    PROFILE_END(signature, PROFILE_SIGNATURE);
+    fiproc_delay();
+    MULTI_IF_FAILIN(result != OK) { return ERROR; }
+
+    return decode_verified(sub, packet->payload.channel_id, packet->payload.enc_frame, &timestamp,
+                           frame_out);
+}
+
+#if BENCH_KEY_CACHE || BENCH_ICACHE
+#define BENCH_FIRST_FRAME 0x0000018000000000 // within channel 0's subscription
+#endif
+
+#if BENCH_KEY_CACHE
+
+#define BENCH_FRAMES 64
+
+/**
+ * @brief Times the frame keys of BENCH_FRAMES channel 0 frames at a cadence, like
+ * decode_verified() gets them
+ *
+ * @param sub channel 0's subscription
+ * @param cadence difference of consecutive timestamps
+ * @param cached keep the key path between frames, otherwise every key is derived from the stored
+ * vertex like before the cache
+ * @return cycles per frame key
+ */
+static uint32_t bench_key_path(const subscription_info_t* sub, timestamp_t cadence, bool cached) {
+    static key_path_cache_t cache;
+    cache.valid = false;
+
+    uint8_t key[SYMMETRIC_KEY_LEN];
+    uint32_t cycles = 0;
+    for (size_t i = 0; i < BENCH_FRAMES; i++) {
+        timestamp_t t = BENCH_FIRST_FRAME + i * cadence;
+        fiproc_update_pool();
+        if (!cached) {
+            cache.valid = false;
+        }
+
+        uint32_t start = DWT->CYCCNT;
+        vertex_t v = {};
+        size_t index = key_index_for_time(sub, t, &v);
+        UTIL_ASSERT(index != SIZE_MAX);
+        const uint8_t* root_key = root_key_for_time(sub, t, index, &v);
+        derive_tree_key(&cache, t, sub, root_key, &v, key);
+        cycles += DWT->CYCCNT - start;
+    }
+
+    memset_explicit(key, 0, sizeof(key));
+    memset_explicit(&cache, 0, sizeof(cache));
+    return cycles / BENCH_FRAMES;
+}
+
+/**
+ * @brief Compares frame key derivation with and without the key path cache on channel 0 and
+ * reports the cycle counts in a debug message, enabled by building with DECODER_BENCH_KEY_CACHE=1
+ */
+void key_cache_benchmark(void) {
+    const subscription_info_t* sub = get_subscription_by_channel(0);
+    UTIL_ASSERT(sub != NULL);
+
+    // every frame, a frame every 30 and every 1000 timestamps
+    static const timestamp_t cadences[] = {1, 30, 1000};
+
+    char report[160];
+    char* end = report;
+    for (size_t i = 0; i < sizeof(cadences) / sizeof(cadences[0]); i++) {
+        end = append_str(end, "cadence ");
+        end = append_u32(end, (uint32_t)cadences[i]);
+        end = append_str(end, ": cold ");
+        end = append_u32(end, bench_key_path(sub, cadences[i], false));
+        end = append_str(end, ", cached ");
+        end = append_u32(end, bench_key_path(sub, cadences[i], true));
+        end = append_str(end, " cycles\n");
+    }
+    UTIL_ASSERT(end <= report + sizeof(report));
+
+    send_msg(DEBUG_MSG, report, (size_t)(end - report));
+}
+
+#endif
+
+#if BENCH_ICACHE
+
+#define BENCH_DECODES 16
+
+/**
+ * @brief Makes a channel 0 frame packet for timestamp t, encrypted like the encoder does it
+ *
+ * The signature is random with a canonical s, so checking it costs as much as a valid one.
+ *
+ * @param sub channel 0's subscription
+ * @param t timestamp of the frame
+ * @param packet (out) frame packet
+ */
+static void bench_frame_packet(const subscription_info_t* sub, timestamp_t t,
+                               frame_packet_t* packet) {
+    static key_path_cache_t cache;
+    cache.valid = false;
+
+    vertex_t v = {};
+    size_t index = key_index_for_time(sub, t, &v);
+    UTIL_ASSERT(index != SIZE_MAX);
+    const uint8_t* root_key = root_key_for_time(sub, t, index, &v);
+    uint8_t kt[SYMMETRIC_KEY_LEN];
+    derive_tree_key(&cache, t, sub, root_key, &v, kt);
+
+    // mac || nonce || ciphertext, see decrypt_symmetric()
+    frame_data_t frame = {.length = MAX_FRAME_SIZE};
+    drbg_generate(frame.frame, sizeof(frame.frame));
+    frame_ch_t frame_ch = {.timestamp = t};
+    drbg_generate(frame_ch.ciphertext + 16, 24);
+    crypto_aead_lock(frame_ch.ciphertext + SYMMETRIC_METADATA_LEN, frame_ch.ciphertext, kt,
+                     frame_ch.ciphertext + 16, NULL, 0, (const uint8_t*)&frame, sizeof(frame));
+
+    uint8_t* enc_frame = packet->payload.enc_frame;
+    packet->payload.channel_id = 0;
+    drbg_generate(enc_frame + 16, 24);
+    crypto_aead_lock(enc_frame + SYMMETRIC_METADATA_LEN, enc_frame, sub->kch, enc_frame + 16, NULL,
+                     0, (const uint8_t*)&frame_ch, sizeof(frame_ch));
+
+    drbg_generate(packet->signature, sizeof(packet->signature));
+    packet->signature[SIGNATURE_LEN - 1] &= 0x0f; // s < 2^252 < L
+
+    memset_explicit(kt, 0, sizeof(kt));
+    memset_explicit(&frame, 0, sizeof(frame));
+    memset_explicit(&frame_ch, 0, sizeof(frame_ch));
+    memset_explicit(&cache, 0, sizeof(cache));
+}
+
+/**
+ * @brief Times BENCH_DECODES decodes of consecutive channel 0 frames, after one to warm up
+ *
+ * A decode is the signature check of decode() (which fails on the made-up signature) and
+ * decode_verified(), which must succeed.
+ *
+ * @param sub channel 0's subscription
+ * @param t (in/out) timestamp of the last frame
+ * @return cycles per decode
+ */
+static uint32_t bench_decodes(const subscription_info_t* sub, timestamp_t* t) {
+    static frame_packet_t packet;
+
+    uint32_t cycles = 0;
+    for (size_t i = 0; i <= BENCH_DECODES; i++) {
+        *t += 1;
+        bench_frame_packet(sub, *t, &packet);
+        fiproc_update_pool();
+
+        uint32_t start = DWT->CYCCNT;
+        verify_asymmetric(packet.signature, (const uint8_t*)&packet.payload,
+                          sizeof(packet.payload), &encoder_verify_ctx);
+        frame_data_t* frame = NULL;
+        error_t result = decode_verified(sub, 0, packet.payload.enc_frame, NULL, &frame);
+        uint32_t elapsed = DWT->CYCCNT - start;
+
+        UTIL_ASSERT(result == OK);
+        frame_data_wipe(frame);
+        if (i > 0) {
+            cycles += elapsed;
+        }
+    }
+    return cycles / BENCH_DECODES;
+}
+
+/**
+ * @brief Compares the cycles of a channel 0 decode with the instruction cache off and on and
+ * reports them in a debug message, enabled by building with DECODER_BENCH_ICACHE=1
+ *
+ * Code placed in SRAM by DECODER_RAMFUNC=1 does not go through the cache either way. The decoder
+ * state the decodes touch is put back afterwards.
+ */
+void icache_benchmark(void) {
+    const subscription_info_t* sub = get_subscription_by_channel(0);
+    UTIL_ASSERT(sub != NULL);
+
+    key_path_cache_t* cache = get_key_path_cache(0);
+    key_path_cache_t saved_cache = *cache;
+    prefetch_stats_t saved_stats = prefetch_stats;
+    bool saved_first_frame = received_first_frame;
+    timestamp_t saved_timestamp = current_timestamp;
+
+    timestamp_t t = BENCH_FIRST_FRAME;
+    bool was_enabled = icache_set(false);
+    uint32_t off_cycles = bench_decodes(sub, &t);
+    icache_set(true);
+    uint32_t on_cycles = bench_decodes(sub, &t);
+    icache_set(was_enabled);
+
+    *cache = saved_cache;
+    prefetch_stats = saved_stats;
+    received_first_frame = saved_first_frame;
+    current_timestamp = saved_timestamp;
+    memset_explicit(&saved_cache, 0, sizeof(saved_cache));
+
+    char report[80];
+    char* end = append_str(report, "decode: icache off ");
+    end = append_u32(end, off_cycles);
+    end = append_str(end, ", on ");
+    end = append_u32(end, on_cycles);
+    end = append_str(end, " cycles\n");
+    UTIL_ASSERT(end <= report + sizeof(report));
+
+    send_msg(DEBUG_MSG, report, (size_t)(end - report));
+}
+
+#endif
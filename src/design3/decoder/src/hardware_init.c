@@ -7,30 +7,33 @@
 
 #include "hardware_init.h"
 
+#include "flash.h"
 #include "host_uart.h"
 #include "rng.h"
 
 #include <gcr_regs.h>
 #include <gpio.h>
-#include <icc_regs.h>
 #include <lpgcr_regs.h>
 #include <max78000.h>
-#include <mxc_delay.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <uart.h>
 
 static void disable_irq(void);
-static void disable_cache(void);
 static void disable_clocks(void);
 static void disable_events(void);
 
 static void set_vtor(void);
 static void select_ipo(void);
 static void update_system_core_clock(void);
+static void init_cycle_counter(void);
 
 static void init_uart(void);
 
+// PMIC 1.8V is available about 180ms after power up (Board_Init waited this long for it)
+#define PMIC_READY_US 200000
+
 extern void (*const _vectors[])(void);
 uint32_t SystemCoreClock;
 
@@ -40,7 +43,6 @@ uint32_t SystemCoreClock;
 void hardware_init(void) {
     // Disable unused functionalities
     disable_irq();
-    disable_cache();
     disable_clocks();
     disable_events();
 
@@ -49,15 +51,41 @@ void hardware_init(void) {
     select_ipo();
     update_system_core_clock();
 
+    // Cycle counter for the decode latency statistics, see frame.c
+    init_cycle_counter();
+
+    // Instruction cache, kept coherent with flash writes by flash.c
+    icache_init();
+
     // Setup originally done in Board_Init
     init_uart();
 
     // Setup RNG
     rng_init();
 
-    // Wait for PMIC 1.8V to become available, about 180ms after power up
-    // (originally done in Board_Init)
-    MXC_Delay(200000);
+    // The PMIC is waited for by hardware_ready(), so the rest of the boot overlaps with it
+
+    // Only the UART interrupt is enabled on NVIC, see init_uart()
+    __enable_irq();
+}
+
+/**
+ * @brief Checks whether the board is up, once hardware_init() ran
+ *
+ * Instead of a fixed delay in hardware_init(), the PMIC gets PMIC_READY_US from the start of the
+ * cycle counter, which is a little after power up.
+ *
+ * @return true once the PMIC is ready, from then on
+ */
+bool hardware_ready(void) {
+    static bool ready = false;
+
+    // the counter wraps after 42s at 100MHz, so this has to latch before then: it is polled from
+    // the end of boot_init() on, which comes after at most a full lockout (6s)
+    if (!ready && DWT->CYCCNT >= PMIC_READY_US * (SystemCoreClock / 1000000)) {
+        ready = true;
+    }
+    return ready;
 }
 
 /**
@@ -73,15 +101,6 @@ static void disable_irq(void) {
     }
 }
 
-/**
- * @brief Disables the instruction cache
- */
-static void disable_cache(void) {
-    // Disable all ICCs
-    MXC_ICC0->ctrl &= ~MXC_F_ICC_CTRL_EN;
-    MXC_ICC1->ctrl &= ~MXC_F_ICC_CTRL_EN;
-}
-
 /**
  * @brief Disables other clocks
  */
@@ -156,8 +175,15 @@ static void select_ipo() {
 }
 
 /**
- * @brief Initialize UART
+ * @brief Starts the DWT cycle counter, free running from here on
  */
-static void init_uart(void) {
-    MXC_UART_Init(MXC_UART_GET_UART(CONSOLE_UART), CONSOLE_BAUD, MXC_UART_IBRO_CLK);
+static void init_cycle_counter(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
+
+/**
+ * @brief Initialize UART
+ */
+static void init_uart(void) { uart_init(); }
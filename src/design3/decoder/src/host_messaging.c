@@ -9,6 +9,7 @@
 
 #include "common.h"
 #include "host_uart.h"
+#include "profile.h"
 #include "util.h"
 
 #include <stddef.h>
@@ -20,11 +21,7 @@
  * @param buf payload
  * @param len payload length in byte
  */
-static void send_body(const void* buf, const size_t len) {
-    for (size_t i = 0; i < len; i++) {
-        uart_writebyte(((uint8_t*)buf)[i]);
-    }
-}
+static void send_body(const void* buf, const size_t len) { uart_write(buf, len); }
 
 /**
  * @brief Receive message body
@@ -32,14 +29,39 @@ static void send_body(const void* buf, const size_t len) {
  * @param buf (out) payload
  * @param len payload length in byte
  * @param buf_remaining remaining buffer length in byte
+ * @param on_idle called whenever no byte is waiting, may be NULL
+ * @param msg_buf start of the whole message buffer, passed to on_idle
+ * @param received bytes of the message stored before this chunk
  */
-static void get_body(void* buf, const uint16_t len, const size_t buf_remaining) {
-    for (size_t i = 0; i < len; i++) {
+static void get_body(void* buf, const uint16_t len, const size_t buf_remaining,
+                     msg_idle_fn_t on_idle, const uint8_t* msg_buf, size_t received) {
+    size_t i = 0;
+    while (i < len) {
+        if (on_idle != NULL) {
+            while (!uart_readable()) {
+                on_idle(msg_buf, received + ((i < buf_remaining) ? i : buf_remaining));
+            }
+        }
+
+        // take whatever has arrived, in one block
+        size_t rlen = uart_available();
+        if (rlen == 0) {
+            rlen = 1; // nothing yet, block for the next byte
+        }
+        if (rlen > len - i) {
+            rlen = len - i;
+        }
+
         if (i < buf_remaining) {
-            ((uint8_t*)buf)[i] = uart_readbyte();
+            if (rlen > buf_remaining - i) {
+                rlen = buf_remaining - i;
+            }
+            uart_read((uint8_t*)buf + i, rlen);
         } else {
             uart_readbyte(); // exceeds buffer size, discard
+            rlen = 1;
         }
+        i += rlen;
     }
 }
 
@@ -106,10 +128,12 @@ static error_t get_ack() {
 void send_msg(const msg_type_t type, const void* msg_buf, const size_t msg_len) {
     UTIL_ASSERT(msg_buf != NULL || msg_len == 0);
 
+    PROFILE_BEGIN(tx);
     send_header(type, (uint16_t)msg_len);
     if (type != DEBUG_MSG) {
         if (get_ack() != OK) {
             // Protocol violation - fail silently
+            PROFILE_END(tx, PROFILE_UART_TX);
             return;
         }
     }
@@ -123,40 +147,74 @@ void send_msg(const msg_type_t type, const void* msg_buf, const size_t msg_len)
         if (type != DEBUG_MSG) {
             if (get_ack() != OK) {
                 // Protocol violation - fail silently
+                PROFILE_END(tx, PROFILE_UART_TX);
                 return;
             }
         }
     }
+    PROFILE_END(tx, PROFILE_UART_TX);
 }
 
 /**
- * @brief Receive uart message from host
+ * @brief Receive uart message header from host, the body must be read with get_msg_body()
  *
  * @param type (out) message type
- * @param msg_buf (out) message payload buffer
  * @param msg_len (out) message payload length
- * @param buf_len length of of msg_buf
- * @return OK if successful, ERROR otherwise (null type, msg_buf, msg_len or read data that has size
- * larger than buf_len)
  */
-error_t get_msg(msg_type_t* type, void* msg_buf, uint16_t* msg_len, const size_t buf_len) {
+void get_msg_header(msg_type_t* type, uint16_t* msg_len) {
+    UTIL_ASSERT(type != NULL);
+    UTIL_ASSERT(msg_len != NULL);
+
     get_header(type, msg_len);
     send_ack();
+}
 
-    for (size_t offs = 0; offs < *msg_len; offs += MSG_CHUNK_SIZE) {
+/**
+ * @brief Receive uart message body from host
+ *
+ * on_idle lets the caller start working on the message while the rest of it is still arriving.
+ *
+ * @param msg_buf (out) message payload buffer
+ * @param msg_len message payload length, from get_msg_header()
+ * @param buf_len length of of msg_buf
+ * @param on_idle called whenever no byte is waiting, may be NULL
+ * @return OK if successful, ERROR if the message is larger than buf_len
+ */
+error_t get_msg_body(void* msg_buf, const uint16_t msg_len, const size_t buf_len,
+                     msg_idle_fn_t on_idle) {
+    PROFILE_BEGIN(rx);
+    for (size_t offs = 0; offs < msg_len; offs += MSG_CHUNK_SIZE) {
         size_t buf_remaining = (buf_len < offs) ? 0 : buf_len - offs;
-        size_t rlen = *msg_len - offs; // rlen = min(*msg_len-off, MSG_CHUNK_SIZE)
+        size_t rlen = msg_len - offs; // rlen = min(msg_len-off, MSG_CHUNK_SIZE)
         if (rlen > MSG_CHUNK_SIZE) {
             rlen = MSG_CHUNK_SIZE;
         }
 
-        get_body(msg_buf + offs, rlen, buf_remaining);
+        size_t received = (buf_len < offs) ? buf_len : offs; // bytes already stored in msg_buf
+
+        get_body(msg_buf + offs, rlen, buf_remaining, on_idle, msg_buf, received);
         send_ack();
     }
+    PROFILE_END(rx, PROFILE_UART_RX);
 
-    if (*msg_len <= buf_len) {
+    if (msg_len <= buf_len) {
         return OK;
     } else {
         return ERROR;
     }
 }
+
+/**
+ * @brief Receive uart message from host
+ *
+ * @param type (out) message type
+ * @param msg_buf (out) message payload buffer
+ * @param msg_len (out) message payload length
+ * @param buf_len length of of msg_buf
+ * @return OK if successful, ERROR otherwise (null type, msg_buf, msg_len or read data that has size
+ * larger than buf_len)
+ */
+error_t get_msg(msg_type_t* type, void* msg_buf, uint16_t* msg_len, const size_t buf_len) {
+    get_msg_header(type, msg_len);
+    return get_msg_body(msg_buf, *msg_len, buf_len, NULL);
+}
@@ -3,33 +3,182 @@
  * @brief Functions to read/write to UART, raw
  * @author Plaid Parliament of Pwning
  * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Interrupt driven: the UART 0 IRQ moves bytes between the hardware FIFOs (8 bytes each) and two
+ * rings in SRAM, so input keeps arriving and output keeps leaving while the main loop is busy.
+ *
+ * The IRQ and the main loop share the rings without locking (see uart_ring.h). Only the interrupt
+ * enable register, which both sides modify, and the FIFO accesses made from the main loop are done
+ * with interrupts masked.
  */
 
 #include "host_uart.h"
 
+#include "uart_ring.h"
+
+#include <max78000.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <uart.h>
 
 #define MXC_UARTn MXC_UART_GET_UART(CONSOLE_UART)
 #define UART_FIFO MXC_UART_GET_FIFO(CONSOLE_UART)
 
+// Ring sizes in bytes, powers of two. RX holds a few message chunks, TX a whole response chunk.
+#define RX_RING_SIZE 1024
+#define TX_RING_SIZE 512
+
+static uint8_t rx_buf[RX_RING_SIZE];
+static uint8_t tx_buf[TX_RING_SIZE];
+static uart_ring_t rx_ring = UART_RING_INIT(rx_buf);
+static uart_ring_t tx_ring = UART_RING_INIT(tx_buf);
+
+static_assert((RX_RING_SIZE & (RX_RING_SIZE - 1)) == 0);
+static_assert((TX_RING_SIZE & (TX_RING_SIZE - 1)) == 0);
+
 /**
- * @brief Write a byte to UART, blocking.
+ * @brief Moves received bytes from the FIFO into the RX ring
  *
- * @param data byte to write
+ * Once the ring is full the RX interrupt is turned off and further bytes wait in the FIFO, until
+ * uart_rx_resume() makes room. Must run in the IRQ or with interrupts masked.
+ */
+static void rx_from_fifo(void) {
+    while (!uart_ring_full(&rx_ring) && MXC_UART_GetRXFIFOAvailable(MXC_UARTn) > 0) {
+        uart_ring_push(&rx_ring, (uint8_t)MXC_UART_ReadCharacterRaw(MXC_UARTn));
+    }
+
+    if (uart_ring_full(&rx_ring)) {
+        MXC_UART_DisableInt(MXC_UARTn, MXC_F_UART_INT_EN_RX_THD);
+    } else {
+        MXC_UART_EnableInt(MXC_UARTn, MXC_F_UART_INT_EN_RX_THD);
+    }
+}
+
+/**
+ * @brief Moves bytes to be sent from the TX ring into the FIFO
+ *
+ * The TX interrupt stays on for as long as the ring has bytes left. Must run in the IRQ or with
+ * interrupts masked.
+ */
+static void tx_to_fifo(void) {
+    uint8_t data;
+    while (MXC_UART_GetTXFIFOAvailable(MXC_UARTn) > 0 && uart_ring_pop(&tx_ring, &data)) {
+        MXC_UART_WriteCharacterRaw(MXC_UARTn, data);
+    }
+
+    if (uart_ring_empty(&tx_ring)) {
+        MXC_UART_DisableInt(MXC_UARTn, MXC_F_UART_INT_EN_TX_HE);
+    } else {
+        MXC_UART_EnableInt(MXC_UARTn, MXC_F_UART_INT_EN_TX_HE);
+    }
+}
+
+/**
+ * @brief UART 0 interrupt, see crt0.S
  */
-void uart_writebyte(uint8_t data) {
-    // Wait until there's room in the FIFO
-    while (MXC_UART_GetTXFIFOAvailable(MXC_UARTn) == 0) {}
+void UART0_IRQHandler(void) {
+    MXC_UART_ClearFlags(MXC_UARTn, MXC_UART_GetFlags(MXC_UARTn));
+    rx_from_fifo();
+    tx_to_fifo();
+}
 
-    MXC_UART_WriteCharacter(MXC_UARTn, data);
+/**
+ * @brief Runs the IRQ's work from the main loop, after the main loop changed a ring
+ *
+ * This also restarts transmission if the TX FIFO already drained (the half-empty interrupt only
+ * fires on the way down) and reception if the RX ring had been full.
+ */
+static void uart_service(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    rx_from_fifo();
+    tx_to_fifo();
+    __set_PRIMASK(primask);
 }
 
+/**
+ * @brief Set up the UART and its interrupt
+ *
+ * Interrupts still have to be unmasked globally before any byte moves.
+ */
+void uart_init(void) {
+    MXC_UART_Init(MXC_UARTn, CONSOLE_BAUD, MXC_UART_IBRO_CLK);
+
+    MXC_UART_SetRXThreshold(MXC_UARTn, 1);
+    MXC_UART_DisableInt(MXC_UARTn, 0xFFFFFFFF);
+    MXC_UART_ClearFlags(MXC_UARTn, MXC_UART_GetFlags(MXC_UARTn));
+    MXC_UART_EnableInt(MXC_UARTn, MXC_F_UART_INT_EN_RX_THD);
+
+    NVIC_ClearPendingIRQ(UART0_IRQn);
+    NVIC_EnableIRQ(UART0_IRQn);
+}
+
+/**
+ * @brief Write a byte to UART, blocking only while the TX ring is full.
+ *
+ * @param data byte to write
+ */
+void uart_writebyte(uint8_t data) { uart_write(&data, 1); }
+
 /**
  * @brief Read a byte from UART, blocking.
  *
  * @return byte read
  */
 uint8_t uart_readbyte(void) {
-    uint8_t data = MXC_UART_ReadCharacter(MXC_UARTn);
+    uint8_t data;
+    uart_read(&data, 1);
     return data;
 }
+
+/**
+ * @brief Write a block to UART, blocking only while the TX ring is full.
+ *
+ * @param buf bytes to write
+ * @param length number of bytes
+ */
+void uart_write(const uint8_t* buf, size_t length) {
+    while (length > 0) {
+        size_t written = uart_ring_write(&tx_ring, buf, length);
+        buf += written;
+        length -= written;
+        uart_service();
+    }
+}
+
+/**
+ * @brief Read a block from UART, blocking until all of it arrived.
+ *
+ * @param buf (out) bytes read
+ * @param length number of bytes
+ */
+void uart_read(uint8_t* buf, size_t length) {
+    while (length > 0) {
+        size_t read = uart_ring_read(&rx_ring, buf, length);
+        buf += read;
+        length -= read;
+        uart_service(); // makes room in the ring, and works with interrupts masked
+    }
+}
+
+/**
+ * @brief Checks whether a byte can be read from UART without blocking.
+ *
+ * @return true if uart_readbyte() would return immediately
+ */
+bool uart_readable(void) { return !uart_ring_empty(&rx_ring); }
+
+/**
+ * @brief Number of bytes that can be read from UART without blocking.
+ */
+size_t uart_available(void) { return uart_ring_used(&rx_ring); }
+
+/**
+ * @brief Wait until everything written so far has left the TX ring.
+ */
+void uart_flush(void) {
+    while (!uart_ring_empty(&tx_ring)) {
+        uart_service();
+    }
+}
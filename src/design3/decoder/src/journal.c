@@ -0,0 +1,442 @@
+/**
+ * @file journal.c
+ * @brief Append-only, wear-leveled record store in reserved flash pages
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * The journal is a ring of JOURNAL_PAGES flash pages. Records are appended to the head page and
+ * each one replaces the previous record of its channel, so a renewal costs a few line writes
+ * instead of a page erase. Pages are only erased when the head moves on to them.
+ *
+ * The page after the head never holds a live record: whenever the head moves, the live records
+ * of the page after it (the oldest page) are copied to the head. The erase itself is left until
+ * the head reaches that page again. Live data is at most JOURNAL_MAX_LIVE records, far less than
+ * the ring, so compaction always has room.
+ *
+ * Every step can be interrupted by a reset. Uncommitted records are skipped, copies keep the
+ * sequence number of their original, and journal_init() finishes an interrupted compaction.
+ */
+
+#include "journal.h"
+
+#include "common.h"
+#include "flash.h"
+#include "util.h"
+
+#include <monocypher.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Allocated by linker, never loaded
+extern const uint8_t subscription_journal[];
+
+#define JOURNAL_ADDR ((size_t)subscription_journal)
+
+#define PAGE_MAGIC 0x4C4E524A   // JRNL
+#define RECORD_MAGIC 0x4452434A // JCRD
+#define COMMIT_MAGIC 0x54494D43 // CMIT
+#define ERASED_WORD 0xFFFFFFFF
+
+typedef struct {
+    uint32_t magic;
+    uint32_t page_seq;     // order of the pages, the head has the highest
+    uint32_t page_seq_inv; // ~page_seq, a torn header write or erase cannot keep both consistent
+    uint32_t _pad;
+} journal_page_hdr_t;
+
+static_assert(sizeof(journal_page_hdr_t) == JOURNAL_LINE);
+
+typedef struct {
+    uint32_t commit;
+    uint32_t _pad;
+    uint8_t check[8]; // BLAKE2b of header and body, catches bits left behind by a torn erase
+} journal_record_trailer_t;
+
+static_assert(sizeof(journal_record_trailer_t) == JOURNAL_LINE);
+
+#define MIN_RECORD_LEN (sizeof(journal_record_hdr_t) + sizeof(journal_record_trailer_t))
+#define MAX_RECORD_LEN (JOURNAL_PAGE_SIZE - sizeof(journal_page_hdr_t))
+
+// Latest committed record of each channel
+static const journal_record_hdr_t* live[JOURNAL_MAX_LIVE];
+
+static size_t head = JOURNAL_PAGES - 1;
+static uint32_t head_seq = 0;
+static size_t head_offset = JOURNAL_PAGE_SIZE; // full until a page is opened
+static uint32_t next_seq = 1;
+
+static const uint8_t* page_addr(size_t page) {
+    UTIL_ASSERT(page < JOURNAL_PAGES);
+    return (const uint8_t*)(JOURNAL_ADDR + page * JOURNAL_PAGE_SIZE);
+}
+
+static const journal_page_hdr_t* page_hdr(size_t page) {
+    return (const journal_page_hdr_t*)page_addr(page);
+}
+
+static bool page_formatted(size_t page) {
+    const journal_page_hdr_t* hdr = page_hdr(page);
+    return hdr->magic == PAGE_MAGIC && hdr->page_seq == ~hdr->page_seq_inv;
+}
+
+/**
+ * @brief Writes the header of an erased page
+ */
+static void format_page(size_t page, uint32_t page_seq) {
+    journal_page_hdr_t hdr = {
+        .magic = PAGE_MAGIC,
+        .page_seq = page_seq,
+        .page_seq_inv = ~page_seq,
+    };
+    UTIL_ASSERT(flash_write((uint32_t)(size_t)page_addr(page), sizeof(hdr),
+                            (const uint32_t*)&hdr) == OK);
+}
+
+/**
+ * @brief Checks whether a whole page reads as erased
+ */
+static bool page_blank(size_t page) {
+    const uint32_t* words = (const uint32_t*)page_addr(page);
+    for (size_t i = 0; i < JOURNAL_PAGE_SIZE / sizeof(uint32_t); i++) {
+        if (words[i] != ERASED_WORD) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the record at an offset of a formatted page
+ *
+ * @param page page index
+ * @param offset offset of the record within the page
+ * @return the record, or NULL if there is no (readable) record at the offset
+ */
+static const journal_record_hdr_t* record_at(size_t page, size_t offset) {
+    if (offset + MIN_RECORD_LEN > JOURNAL_PAGE_SIZE) {
+        return NULL;
+    }
+
+    const journal_record_hdr_t* record = (const journal_record_hdr_t*)(page_addr(page) + offset);
+    if (record->magic != RECORD_MAGIC || record->length < MIN_RECORD_LEN ||
+        record->length % JOURNAL_LINE != 0 || record->length > JOURNAL_PAGE_SIZE - offset) {
+        return NULL;
+    }
+
+    return record;
+}
+
+/**
+ * @brief Checks that a record was completely written and is still intact
+ */
+static bool record_committed(const journal_record_hdr_t* record) {
+    const journal_record_trailer_t* trailer =
+        (const journal_record_trailer_t*)((const uint8_t*)record + record->length) - 1;
+    if (trailer->commit != COMMIT_MAGIC) {
+        return false;
+    }
+
+    uint8_t check[sizeof(trailer->check)];
+    crypto_blake2b(check, sizeof(check), (const uint8_t*)record,
+                   record->length - sizeof(journal_record_trailer_t));
+    return timingsafe_bcmp(check, trailer->check, sizeof(check)) == 0;
+}
+
+/**
+ * @brief Makes a committed record the live record of its channel, unless it is outdated
+ *
+ * @param record committed record
+ * @return OK on success, ERROR if it is a new channel and there is no room left
+ */
+static error_t set_live(const journal_record_hdr_t* record) {
+    size_t unused = JOURNAL_MAX_LIVE;
+    for (size_t i = 0; i < JOURNAL_MAX_LIVE; i++) {
+        if (live[i] == NULL) {
+            if (unused == JOURNAL_MAX_LIVE) {
+                unused = i;
+            }
+        } else if (live[i]->channel == record->channel) {
+            // equal sequence numbers are a record and its copy
+            if (record->seq >= live[i]->seq) {
+                live[i] = record;
+            }
+            return OK;
+        }
+    }
+
+    if (unused == JOURNAL_MAX_LIVE) {
+        return ERROR;
+    }
+    live[unused] = record;
+    return OK;
+}
+
+static bool is_live(const journal_record_hdr_t* record) {
+    for (size_t i = 0; i < JOURNAL_MAX_LIVE; i++) {
+        if (live[i] == record) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool page_has_live(size_t page) {
+    const uint8_t* start = page_addr(page);
+    for (size_t i = 0; i < JOURNAL_MAX_LIVE; i++) {
+        const uint8_t* record = (const uint8_t*)live[i];
+        if (record != NULL && start <= record && record < start + JOURNAL_PAGE_SIZE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Writes a record at the head, which must have room for it
+ *
+ * @param seq sequence number of the record
+ * @param channel channel of the record
+ * @param chunks record body
+ * @param chunk_count number of chunks
+ * @return the record, already committed
+ */
+static const journal_record_hdr_t* write_record(uint32_t seq, channel_t channel,
+                                                const journal_chunk_t* chunks,
+                                                size_t chunk_count) {
+    uint32_t length = MIN_RECORD_LEN;
+    for (size_t i = 0; i < chunk_count; i++) {
+        length += chunks[i].length;
+    }
+    UTIL_ASSERT(head_offset + length <= JOURNAL_PAGE_SIZE);
+
+    uint32_t addr = (uint32_t)(size_t)page_addr(head) + head_offset;
+    const journal_record_hdr_t* record = (const journal_record_hdr_t*)(size_t)addr;
+
+    // header first, so that a torn record can still be skipped over
+    journal_record_hdr_t hdr = {
+        .magic = RECORD_MAGIC,
+        .seq = seq,
+        .length = length,
+        .channel = channel,
+    };
+    UTIL_ASSERT(flash_write(addr, sizeof(hdr), (const uint32_t*)&hdr) == OK);
+    head_offset += length;
+    addr += sizeof(hdr);
+
+    crypto_blake2b_ctx check_ctx;
+    crypto_blake2b_init(&check_ctx, sizeof(((journal_record_trailer_t*)0)->check));
+    crypto_blake2b_update(&check_ctx, (const uint8_t*)&hdr, sizeof(hdr));
+
+    for (size_t i = 0; i < chunk_count; i++) {
+        UTIL_ASSERT(chunks[i].length % JOURNAL_LINE == 0);
+
+        // stage through SRAM, the source may be flash (compaction)
+        for (uint32_t offs = 0; offs < chunks[i].length; offs += 16 * JOURNAL_LINE) {
+            uint32_t buf[16 * JOURNAL_LINE / sizeof(uint32_t)];
+            uint32_t wlen = chunks[i].length - offs;
+            if (wlen > sizeof(buf)) {
+                wlen = sizeof(buf);
+            }
+            memcpy(buf, (const uint8_t*)chunks[i].data + offs, wlen);
+            crypto_blake2b_update(&check_ctx, (const uint8_t*)buf, wlen);
+            UTIL_ASSERT(flash_write(addr, wlen, buf) == OK);
+            addr += wlen;
+        }
+    }
+
+    journal_record_trailer_t trailer = {.commit = COMMIT_MAGIC};
+    crypto_blake2b_final(&check_ctx, trailer.check);
+    UTIL_ASSERT(flash_write(addr, sizeof(trailer), (const uint32_t*)&trailer) == OK);
+
+    return record;
+}
+
+static void open_page(void);
+
+/**
+ * @brief Appends a record at the head, moving the head on if it does not fit
+ */
+static const journal_record_hdr_t* append(uint32_t seq, channel_t channel,
+                                          const journal_chunk_t* chunks, size_t chunk_count) {
+    uint32_t length = MIN_RECORD_LEN;
+    for (size_t i = 0; i < chunk_count; i++) {
+        length += chunks[i].length;
+    }
+    UTIL_ASSERT(length <= MAX_RECORD_LEN);
+
+    while (head_offset + length > JOURNAL_PAGE_SIZE) {
+        open_page();
+    }
+
+    return write_record(seq, channel, chunks, chunk_count);
+}
+
+/**
+ * @brief Copies the live records of a page to the head, after which the page can be reused
+ *
+ * @param page page to compact, must not be the head
+ */
+static void compact(size_t page) {
+    UTIL_ASSERT(page != head);
+
+    if (!page_formatted(page)) {
+        return;
+    }
+
+    size_t offset = sizeof(journal_page_hdr_t);
+    const journal_record_hdr_t* record;
+    while ((record = record_at(page, offset)) != NULL) {
+        offset += record->length;
+
+        if (record_committed(record) && is_live(record)) {
+            journal_chunk_t body = {
+                .data = journal_record_body(record),
+                .length = journal_record_body_length(record),
+            };
+            const journal_record_hdr_t* copy = append(record->seq, record->channel, &body, 1);
+            UTIL_ASSERT(set_live(copy) == OK);
+        }
+    }
+
+    UTIL_ASSERT(!page_has_live(page));
+}
+
+/**
+ * @brief Moves the head to the next page of the ring
+ */
+static void open_page(void) {
+    size_t next = (head + 1) % JOURNAL_PAGES;
+    UTIL_ASSERT(!page_has_live(next));
+
+    // lazy erase: pages are only erased once they are needed again
+    if (!page_blank(next)) {
+        UTIL_ASSERT(flash_erase_page((uint32_t)(size_t)page_addr(next)) == OK);
+    }
+
+    format_page(next, head_seq + 1);
+
+    head = next;
+    head_seq += 1;
+    head_offset = sizeof(journal_page_hdr_t);
+
+    // keep the page after the head free of live records
+    compact((head + 1) % JOURNAL_PAGES);
+}
+
+/**
+ * @brief Rebuilds the live records and the head position from flash
+ */
+static void replay(void) {
+    memset(live, 0, sizeof(live));
+    head = JOURNAL_PAGES - 1;
+    head_seq = 0;
+    head_offset = JOURNAL_PAGE_SIZE;
+    next_seq = 1;
+
+    // replay oldest page first, so that a copy made by compaction wins over its original
+    size_t order[JOURNAL_PAGES];
+    size_t formatted = 0;
+    for (size_t page = 0; page < JOURNAL_PAGES; page++) {
+        if (!page_formatted(page)) {
+            continue; // erased, or written by something else, reused once the head gets here
+        }
+
+        size_t pos = formatted++;
+        while (pos > 0 && page_hdr(order[pos - 1])->page_seq > page_hdr(page)->page_seq) {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = page;
+    }
+
+    for (size_t i = 0; i < formatted; i++) {
+        size_t page = order[i];
+
+        size_t offset = sizeof(journal_page_hdr_t);
+        const journal_record_hdr_t* record;
+        while ((record = record_at(page, offset)) != NULL) {
+            offset += record->length;
+
+            // the sequence number of a torn record cannot be trusted, and is never needed
+            if (record_committed(record)) {
+                if (record->seq >= next_seq) {
+                    next_seq = record->seq + 1;
+                }
+                UTIL_ASSERT(set_live(record) == OK);
+            }
+        }
+
+        // the last page replayed is the head
+        head = page;
+        head_seq = page_hdr(page)->page_seq;
+
+        // anything but an erased line after the last record leaves the rest of the page unusable
+        const uint32_t* end = (const uint32_t*)(page_addr(page) + offset);
+        bool clean = offset + JOURNAL_LINE <= JOURNAL_PAGE_SIZE && end[0] == ERASED_WORD;
+        head_offset = clean ? offset : JOURNAL_PAGE_SIZE;
+    }
+}
+
+/**
+ * @brief Replays the journal from flash, must run before any other journal function
+ */
+void journal_init(void) {
+    replay();
+
+    // a reset interrupted the compaction that follows opening the head, so the head only holds
+    // copies (maybe torn ones) of records that are still in the page after it: start over
+    size_t after = (head + 1) % JOURNAL_PAGES;
+    if (head_seq != 0 && page_has_live(after)) {
+        UTIL_ASSERT(flash_erase_page((uint32_t)(size_t)page_addr(head)) == OK);
+        format_page(head, head_seq);
+
+        replay();
+        compact(after);
+    }
+}
+
+/**
+ * @brief Returns one of the live records
+ *
+ * Records may move whenever a record is appended, pointers are only valid until then.
+ *
+ * @param i index of the record, less than JOURNAL_MAX_LIVE
+ * @return the record, or NULL if there is no record with that index
+ */
+const journal_record_hdr_t* journal_get(size_t i) {
+    UTIL_ASSERT(i < JOURNAL_MAX_LIVE);
+    return live[i];
+}
+
+/**
+ * @brief Appends a record, replacing the live record of the same channel
+ *
+ * @param channel channel of the record
+ * @param chunks record body
+ * @param chunk_count number of chunks
+ * @return OK on success, ERROR if the channel is new and JOURNAL_MAX_LIVE channels are in use
+ */
+error_t journal_append(channel_t channel, const journal_chunk_t* chunks, size_t chunk_count) {
+    UTIL_ASSERT(chunks != NULL || chunk_count == 0);
+
+    bool known = false;
+    bool full = true;
+    for (size_t i = 0; i < JOURNAL_MAX_LIVE; i++) {
+        if (live[i] == NULL) {
+            full = false;
+        } else if (live[i]->channel == channel) {
+            known = true;
+        }
+    }
+    if (!known && full) {
+        return ERROR;
+    }
+
+    const journal_record_hdr_t* record = append(next_seq, channel, chunks, chunk_count);
+    next_seq += 1;
+    UTIL_ASSERT(set_live(record) == OK);
+
+    return OK;
+}
@@ -0,0 +1,289 @@
+/**
+ * @file key_expansion.c
+ * @brief Layer of pre-derived tree keys per subscription, in flash the journal does not use
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * A frame key takes one child derivation per level between the packaged vertex and the leaf, up
+ * to TREE_LEVELS. When a subscription is stored, every vertex EXPANSION_FRAME_BITS above the
+ * leaves that lies inside [start, end] is derived once and written to a slot, so frames only
+ * derive the levels below it. Long subscriptions have too many vertices at that level for a slot
+ * and are expanded at the deepest level that fits instead.
+ *
+ * Each slot is one flash page, owned by the subscription (channel and generation) it was derived
+ * from. A slot only counts once its trailer was written and checks out, so a slot torn by a reset
+ * is ignored and rebuilt by subscription_init().
+ */
+
+#include "key_expansion.h"
+
+#include "common.h"
+#include "flash.h"
+#include "frame.h"
+#include "key_tree.h"
+#include "subscription.h"
+#include "util.h"
+
+#include <monocypher.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Allocated by linker, never loaded
+extern const uint8_t key_expansion[];
+
+#define COMMIT_MAGIC 0x444E5058 // XPND
+#define SLOT_LINE 16            // flash write granularity
+
+typedef struct {
+    channel_t channel;
+    uint32_t generation; // of the subscription the keys were derived from
+    uint32_t bits;       // tree level of the expanded vertices
+    uint32_t count;      // number of expanded vertices
+    timestamp_t first;   // prefix of the first expanded vertex, the others follow in order
+    uint8_t _pad[8];
+} expansion_hdr_t;
+
+typedef struct {
+    uint32_t commit;
+    uint32_t _pad;
+    uint8_t check[8]; // BLAKE2b of header and keys, catches bits left behind by a torn erase
+} expansion_trailer_t;
+
+typedef struct {
+    expansion_hdr_t hdr;
+    uint8_t keys[EXPANSION_MAX_KEYS][TREE_KEY_LEN];
+    expansion_trailer_t trailer;
+} expansion_slot_t;
+
+static_assert(sizeof(expansion_hdr_t) % SLOT_LINE == 0);
+static_assert(sizeof(expansion_trailer_t) == SLOT_LINE);
+static_assert(sizeof(expansion_slot_t) == EXPANSION_PAGE_SIZE);
+
+// match: firmware.ld.template -> .key_expansion
+static_assert(EXPANSION_SLOTS * EXPANSION_PAGE_SIZE == 0x12000);
+
+#define SLOTS ((const expansion_slot_t*)key_expansion)
+
+// Slots that checked out, in SRAM so the check is only done once per boot or write
+static bool slot_valid[EXPANSION_SLOTS];
+
+/**
+ * @brief Computes the check of a slot's header and keys
+ */
+static void slot_check(const expansion_hdr_t* hdr, const uint8_t* keys, uint8_t* check) {
+    crypto_blake2b_ctx ctx;
+    crypto_blake2b_init(&ctx, sizeof(((expansion_trailer_t*)0)->check));
+    crypto_blake2b_update(&ctx, (const uint8_t*)hdr, sizeof(*hdr));
+    crypto_blake2b_update(&ctx, keys, hdr->count * TREE_KEY_LEN);
+    crypto_blake2b_final(&ctx, check);
+}
+
+/**
+ * @brief Checks a slot read from flash
+ */
+static bool slot_intact(const expansion_slot_t* slot) {
+    const expansion_hdr_t* hdr = &slot->hdr;
+    if (slot->trailer.commit != COMMIT_MAGIC || hdr->count == 0 ||
+        hdr->count > EXPANSION_MAX_KEYS || hdr->bits == 0 || hdr->bits > MAX_TREE_HEIGHT ||
+        hdr->bits % TREE_ARITY_BITS != 0) {
+        return false;
+    }
+
+    uint8_t check[sizeof(slot->trailer.check)];
+    slot_check(hdr, &slot->keys[0][0], check);
+    return timingsafe_bcmp(check, slot->trailer.check, sizeof(check)) == 0;
+}
+
+/**
+ * @brief Checks all slots, must run before any slot is used
+ */
+void key_expansion_init(void) {
+    for (size_t i = 0; i < EXPANSION_SLOTS; i++) {
+        slot_valid[i] = slot_intact(&SLOTS[i]);
+    }
+}
+
+/**
+ * @brief Finds the slot expanded from a subscription
+ *
+ * @return slot index, or EXPANSION_SLOTS if the subscription has none
+ */
+static size_t find_slot(const subscription_info_t* sub) {
+    for (size_t i = 0; i < EXPANSION_SLOTS; i++) {
+        if (slot_valid[i] && SLOTS[i].hdr.channel == sub->channel &&
+            SLOTS[i].hdr.generation == sub->generation) {
+            return i;
+        }
+    }
+    return EXPANSION_SLOTS;
+}
+
+/**
+ * @brief Finds a slot that no stored subscription owns
+ *
+ * A subscription owns at most one slot and there is a slot for every subscription, so there
+ * always is one for a subscription that owns none.
+ */
+static size_t free_slot(void) {
+    for (size_t i = 0; i < EXPANSION_SLOTS; i++) {
+        if (!slot_valid[i]) {
+            return i;
+        }
+
+        const subscription_info_t* owner = get_subscription_by_channel(SLOTS[i].hdr.channel);
+        if (owner == NULL || owner->generation != SLOTS[i].hdr.generation) {
+            return i;
+        }
+    }
+
+    UTIL_ASSERT(false);
+    return EXPANSION_SLOTS;
+}
+
+/**
+ * @brief Chooses the expanded level of a subscription: EXPANSION_FRAME_BITS above the leaves, or
+ * the deepest level above it whose vertices inside [start, end] fit in a slot
+ *
+ * match: expansion_budget.py -> expansion_level()
+ *
+ * @param sub subscription to expand
+ * @param first (out) prefix of the first vertex inside the subscription
+ * @param count (out) number of vertices inside the subscription, 0 if there are none to expand
+ * @return the expanded level in bits
+ */
+static uint8_t expansion_level(const subscription_info_t* sub, timestamp_t* first,
+                               uint32_t* count) {
+    *count = 0;
+    for (uint8_t bits = MAX_TREE_HEIGHT - EXPANSION_FRAME_BITS; bits > 0;
+         bits -= TREE_ARITY_BITS) {
+        uint8_t shift = MAX_TREE_HEIGHT - bits;
+        timestamp_t mask = (bits == MAX_TREE_HEIGHT) ? 0 : (UINT64_MAX >> bits);
+
+        // vertices lo..hi lie inside [start, end], the ones around them only partially
+        timestamp_t lo = (sub->start >> shift) + ((sub->start & mask) != 0);
+        timestamp_t hi = sub->end >> shift;
+        if ((sub->end & mask) != mask) {
+            if (hi == 0) {
+                return bits;
+            }
+            hi -= 1;
+        }
+
+        // a level without a whole vertex has none above it either
+        if (hi < lo) {
+            return bits;
+        }
+
+        if (hi - lo < EXPANSION_MAX_KEYS) {
+            *first = lo;
+            *count = (uint32_t)(hi - lo + 1);
+            return bits;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Slot being written by key_expansion_build()
+ */
+typedef struct {
+    uint32_t addr;
+    crypto_blake2b_ctx check_ctx;
+} slot_writer_t;
+
+/**
+ * @brief Writes the next expanded key to the slot (vertex_key_fn_t)
+ */
+static void write_key(void* ctx, uint32_t i, const uint8_t* key) {
+    slot_writer_t* writer = ctx;
+
+    uint32_t line[TREE_KEY_LEN / sizeof(uint32_t)];
+    memcpy(line, key, sizeof(line));
+    crypto_blake2b_update(&writer->check_ctx, (const uint8_t*)line, sizeof(line));
+    UTIL_ASSERT(flash_write(writer->addr + i * TREE_KEY_LEN, sizeof(line), line) == OK);
+    memset_explicit(line, 0, sizeof(line));
+}
+
+/**
+ * @brief Expands a stored subscription into a slot, unless it already has one
+ *
+ * Takes up to about EXPANSION_MAX_KEYS * TREE_ARITY / (TREE_ARITY - 1) child derivations plus a
+ * page erase, see expansion_budget.py.
+ *
+ * @param sub valid subscription
+ */
+void key_expansion_build(const subscription_info_t* sub) {
+    UTIL_ASSERT(sub != NULL);
+    UTIL_ASSERT(sub->valid);
+
+    timestamp_t first = 0;
+    uint32_t count = 0;
+    uint8_t bits = expansion_level(sub, &first, &count);
+    if (count == 0 || find_slot(sub) != EXPANSION_SLOTS) {
+        return;
+    }
+
+    size_t i = free_slot();
+    const expansion_slot_t* slot = &SLOTS[i];
+    slot_valid[i] = false;
+    UTIL_ASSERT(flash_erase_page((uint32_t)(size_t)slot) == OK);
+
+    // header first, the trailer commits the slot once all keys are written
+    expansion_hdr_t hdr = {
+        .channel = sub->channel,
+        .generation = sub->generation,
+        .bits = bits,
+        .count = count,
+        .first = first,
+    };
+    UTIL_ASSERT(flash_write((uint32_t)(size_t)&slot->hdr, sizeof(hdr), (const uint32_t*)&hdr) ==
+                OK);
+
+    slot_writer_t writer = {.addr = (uint32_t)(size_t)&slot->keys[0][0]};
+    crypto_blake2b_init(&writer.check_ctx, sizeof(((expansion_trailer_t*)0)->check));
+    crypto_blake2b_update(&writer.check_ctx, (const uint8_t*)&hdr, sizeof(hdr));
+    derive_vertex_keys(sub, bits, first, count, write_key, &writer);
+
+    expansion_trailer_t trailer = {.commit = COMMIT_MAGIC};
+    crypto_blake2b_final(&writer.check_ctx, trailer.check);
+    UTIL_ASSERT(flash_write((uint32_t)(size_t)&slot->trailer, sizeof(trailer),
+                            (const uint32_t*)&trailer) == OK);
+
+    slot_valid[i] = slot_intact(slot);
+}
+
+/**
+ * @brief Finds the expanded vertex above a timestamp, if it is below the packaged one
+ *
+ * @param sub subscription of t
+ * @param t timestamp within the subscription
+ * @param position (in/out) position of the packaged key above t, replaced by the expanded vertex
+ * if one is found
+ * @return key of the expanded vertex (TREE_KEY_LEN bytes, in flash), or NULL if there is none
+ */
+const uint8_t* key_expansion_find(const subscription_info_t* sub, timestamp_t t,
+                                  vertex_t* position) {
+    UTIL_ASSERT(sub != NULL);
+    UTIL_ASSERT(position != NULL);
+
+    size_t i = find_slot(sub);
+    if (i == EXPANSION_SLOTS) {
+        return NULL;
+    }
+
+    const expansion_hdr_t* hdr = &SLOTS[i].hdr;
+    if (hdr->bits <= position->bits) {
+        return NULL;
+    }
+
+    timestamp_t prefix = (hdr->bits == MAX_TREE_HEIGHT) ? t : t >> (MAX_TREE_HEIGHT - hdr->bits);
+    if (prefix < hdr->first || prefix - hdr->first >= hdr->count) {
+        return NULL;
+    }
+
+    position->prefix = prefix;
+    position->bits = (uint8_t)hdr->bits;
+    return SLOTS[i].keys[prefix - hdr->first];
+}
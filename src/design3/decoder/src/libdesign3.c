@@ -2,20 +2,115 @@
  * @brief Implementations for libc functions which the compiler expects to be present
  * @author Plaid Parliament of Pwning
  * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * memcpy, memset and memcmp go a word at a time once the destination is aligned, and 16 bytes per
+ * LDM/STM on the Cortex-M4 when the source is aligned too. Only the head and the tail go byte by
+ * byte. Single word accesses may be unaligned (LDR/STR on the Cortex-M4, like on x86 for the host
+ * build), LDM/STM may not.
  */
 
 #include <string.h>
 
+#include <stdbool.h>
 #include <stdint.h>
 
 // as per https://stackoverflow.com/questions/67210527/how-to-provide-an-implementation-of-memcpy
 // attribute required to prevent these functions from optimizing to themselves
 #define inhibit_libcall_opt [[gnu::optimize("no-tree-loop-distribute-patterns")]]
 
+// Word accesses to any object, aligned or not
+typedef uint32_t [[gnu::may_alias]] word_t;
+typedef uint32_t [[gnu::may_alias, gnu::aligned(1)]] unaligned_word_t;
+
+#define WORD_MASK (sizeof(word_t) - 1)
+#define BLOCK_LEN (4 * sizeof(word_t))
+
+// Below this many bytes the byte loop is cheaper than aligning
+#define MIN_WORD_LEN 8
+
+static inline bool word_aligned(const void* p) { return ((uintptr_t)p & WORD_MASK) == 0; }
+
+/**
+ * @brief Copies blocks of BLOCK_LEN bytes between word aligned pointers, and advances them
+ *
+ * @param d destination
+ * @param s source
+ * @param blocks number of blocks, at least 1
+ */
+static inline void copy_blocks(uint8_t** d, const uint8_t** s, size_t blocks) {
+#if defined(__thumb2__)
+    __asm__ volatile("1:\n\t"
+                     "ldmia %[s]!, {r3-r6}\n\t"
+                     "stmia %[d]!, {r3-r6}\n\t"
+                     "subs %[n], #1\n\t"
+                     "bne 1b"
+                     : [d] "+r"(*d), [s] "+r"(*s), [n] "+r"(blocks)
+                     :
+                     : "r3", "r4", "r5", "r6", "cc", "memory");
+#else
+    for (; blocks > 0; blocks--, *d += BLOCK_LEN, *s += BLOCK_LEN) {
+        word_t* dw = (word_t*)*d;
+        const word_t* sw = (const word_t*)*s;
+        dw[0] = sw[0];
+        dw[1] = sw[1];
+        dw[2] = sw[2];
+        dw[3] = sw[3];
+    }
+#endif
+}
+
+/**
+ * @brief Fills blocks of BLOCK_LEN bytes at a word aligned pointer, and advances it
+ *
+ * @param p destination
+ * @param w word to fill with
+ * @param blocks number of blocks, at least 1
+ */
+static inline void set_blocks(uint8_t** p, uint32_t w, size_t blocks) {
+#if defined(__thumb2__)
+    register uint32_t w3 asm("r3") = w;
+    __asm__ volatile("mov r4, r3\n\t"
+                     "mov r5, r3\n\t"
+                     "mov r6, r3\n"
+                     "1:\n\t"
+                     "stmia %[p]!, {r3-r6}\n\t"
+                     "subs %[n], #1\n\t"
+                     "bne 1b"
+                     : [p] "+r"(*p), [n] "+r"(blocks)
+                     : "r"(w3)
+                     : "r4", "r5", "r6", "cc", "memory");
+#else
+    for (; blocks > 0; blocks--, *p += BLOCK_LEN) {
+        word_t* pw = (word_t*)*p;
+        pw[0] = w;
+        pw[1] = w;
+        pw[2] = w;
+        pw[3] = w;
+    }
+#endif
+}
+
 inhibit_libcall_opt void* memset(void* b, int c, size_t len) {
     uint8_t* p = (uint8_t*)b;
-    for (size_t i = 0; i < len; ++i) {
-        p[i] = (uint8_t)c;
+    uint8_t v = (uint8_t)c;
+
+    if (len >= MIN_WORD_LEN) {
+        for (; !word_aligned(p); len--) {
+            *p++ = v;
+        }
+
+        uint32_t w = v * 0x01010101u;
+        if (len >= BLOCK_LEN) {
+            set_blocks(&p, w, len / BLOCK_LEN);
+            len %= BLOCK_LEN;
+        }
+        for (; len >= sizeof(word_t); len -= sizeof(word_t), p += sizeof(word_t)) {
+            *(word_t*)p = w;
+        }
+    }
+
+    for (; len > 0; len--) {
+        *p++ = v;
     }
     return b;
 }
@@ -27,17 +122,68 @@ inhibit_libcall_opt void* memcpy(void* restrict dst, const void* restrict src, s
 
     uint8_t* d = (uint8_t*)dst;
     const uint8_t* s = (const uint8_t*)src;
-    for (size_t i = 0; i < n; ++i) {
-        d[i] = s[i];
+
+    if (n >= MIN_WORD_LEN) {
+        for (; !word_aligned(d); n--) {
+            *d++ = *s++;
+        }
+
+        if (word_aligned(s) && n >= BLOCK_LEN) {
+            copy_blocks(&d, &s, n / BLOCK_LEN);
+            n %= BLOCK_LEN;
+        }
+        for (; n >= sizeof(word_t); n -= sizeof(word_t), d += sizeof(word_t), s += sizeof(word_t)) {
+            *(word_t*)d = *(const unaligned_word_t*)s;
+        }
+    }
+
+    for (; n > 0; n--) {
+        *d++ = *s++;
     }
     return dst;
 }
 
 inhibit_libcall_opt int memcmp(const void* vl, const void* vr, size_t n) {
+    const unsigned char *l = vl, *r = vr;
+
+    // skip the equal words, the first difference is found by the byte loop
+    if (n >= MIN_WORD_LEN) {
+        for (; !word_aligned(l) && *l == *r; n--, l++, r++)
+            ;
+        for (; word_aligned(l) && n >= sizeof(word_t) &&
+               *(const word_t*)l == *(const unaligned_word_t*)r;
+             n -= sizeof(word_t), l += sizeof(word_t), r += sizeof(word_t))
+            ;
+    }
+
     // taken from MUSL http://git.musl-libc.org/cgit/musl/tree/src/string/memcmp.c
     // under MIT license ( https://opensource.org/license/mit )
-    const unsigned char *l = vl, *r = vr;
     for (; n && *l == *r; n--, l++, r++)
         ;
     return n ? *l - *r : 0;
 }
+
+void* memset_explicit(void* b, int c, size_t len) {
+    memset(b, c, len);
+    // the stores are needed as far as the compiler knows, even if b is never read again
+    __asm__ volatile("" : : "r"(b) : "memory");
+    return b;
+}
+
+int timingsafe_bcmp(const void* b1, const void* b2, size_t n) {
+    const uint8_t* l = (const uint8_t*)b1;
+    const uint8_t* r = (const uint8_t*)b2;
+
+    uint32_t diff = 0;
+    for (; n >= sizeof(word_t); n -= sizeof(word_t), l += sizeof(word_t), r += sizeof(word_t)) {
+        diff |= *(const unaligned_word_t*)l ^ *(const unaligned_word_t*)r;
+        __asm__ volatile("" : "+r"(diff)); // no early exit once diff is nonzero
+    }
+    for (; n > 0; n--) {
+        diff |= (uint32_t)(*l++ ^ *r++);
+        __asm__ volatile("" : "+r"(diff));
+    }
+
+    // 1 if any bit differs, without a branch on the data
+    return (int)((diff | (0 - diff)) >> 31);
+}
@@ -40,7 +40,7 @@ static size_t get_channel_info(list_response_t* msg_buf) {
     msg_buf->n_channels = 0;
 
     for (size_t i = 1; i < MAX_CHANNEL_COUNT; i++) { // skip channel 0
-        const valid_subscription_t* valid_sub = get_subscription(i);
+        const subscription_info_t* valid_sub = get_subscription(i);
         if (valid_sub) {
             channel_info_t* next_info = &msg_buf->channel_info[msg_buf->n_channels];
             next_info->channel = valid_sub->channel;
@@ -3,74 +3,198 @@
  * @brief Lockout delay in response to attack, and persist the delay when powered off/reset
  * @author Plaid Parliament of Pwning
  * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * The lockout page is a tally: flash bits can only be cleared without an erase, so every lockout
+ * arms a session of LOCKOUT_TIME_PD erased tally lines and clears one of them per elapsed period.
+ * The page is only erased once it has no room for another session, instead of once per period.
+ *
+ * Page layout, in flash lines (the write granularity):
+ *   line 0                         format header, written last when the page is (re)formatted
+ *   1 + s * LOCKOUT_SESSION_LINES  arm line of session s, erased until the session is armed
+ *   ... + 1 + p                    tally line of period p, cleared once period p has elapsed
+ *
+ * Anything that is not one of these states (a torn write, an interrupted erase, glitched reads)
+ * is treated as a full lockout.
  */
 
 #include "lockout.h"
 
+#include "flash.h"
 #include "util.h"
 
-#include <flc.h>
 #include <mxc_delay.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
-// Lockout state stored in flash (0-initialized by linker)
-extern uint32_t lockout_state;
-#define LOCKOUT_STATE_ADDR ((uint32_t)&lockout_state)
-
 // Period length (store to flash after each period)
 #define LOCKOUT_TIME_PD 60
 
 // Time to delay in microseconds for each period
 #define LOCKOUT_PD_US 100000
 
+#define LOCKOUT_PAGE_SIZE 8192 // exactly one flash page
+#define LOCKOUT_LINES (LOCKOUT_PAGE_SIZE / sizeof(lockout_line_t))
+#define LOCKOUT_SESSION_LINES (1 + LOCKOUT_TIME_PD)
+#define LOCKOUT_SESSIONS ((LOCKOUT_LINES - 1) / LOCKOUT_SESSION_LINES)
+
+// match: firmware.ld.template -> .lockout_state
+#define FORMAT_MAGIC 0x4B434F4C // LOCK
+#define ARM_MAGIC 0x444D5241    // ARMD
+#define ERASED_WORD 0xFFFFFFFF
+
+// Returned by lockout_scan() when the page does not make sense
+#define LOCKOUT_UNKNOWN UINT32_MAX
+
+// One flash line, the smallest unit that can be written
+typedef struct {
+    uint32_t words[4];
+} lockout_line_t;
+
+static_assert(sizeof(lockout_line_t) == 16);
+static_assert(LOCKOUT_SESSIONS >= 2);
+
+// Lockout state stored in flash (formatted by linker)
+extern const lockout_line_t lockout_state[];
+#define LOCKOUT_STATE_ADDR ((uint32_t)(size_t)lockout_state)
+
 /**
- * @brief Helper function to perform update on the attack lockout state.
+ * @brief Checks a flash line against a magic, stored as magic, ~magic, magic, ~magic
+ */
+static bool line_is(const lockout_line_t* line, uint32_t magic) {
+    return line->words[0] == magic && line->words[1] == ~magic && line->words[2] == magic &&
+           line->words[3] == ~magic;
+}
+
+static bool line_erased(const lockout_line_t* line) {
+    return line->words[0] == ERASED_WORD && line->words[1] == ERASED_WORD &&
+           line->words[2] == ERASED_WORD && line->words[3] == ERASED_WORD;
+}
+
+static const lockout_line_t* arm_line(size_t session) {
+    UTIL_ASSERT(session < LOCKOUT_SESSIONS);
+    return &lockout_state[1 + session * LOCKOUT_SESSION_LINES];
+}
+
+static const lockout_line_t* tally_line(size_t session, size_t period) {
+    UTIL_ASSERT(period < LOCKOUT_TIME_PD);
+    return arm_line(session) + 1 + period;
+}
+
+/**
+ * @brief Helper function to write a single flash line of the lockout page.
+ *
+ * @param line line to write, must be erased
+ * @param magic magic to write, or 0 to clear the line
+ */
+static void write_line(const lockout_line_t* line, uint32_t magic) {
+    lockout_line_t value = {{magic, ~magic, magic, ~magic}};
+    if (magic == 0) {
+        value = (lockout_line_t){0};
+    }
+    UTIL_ASSERT(flash_write((uint32_t)(size_t)line, sizeof(value), value.words) == OK);
+}
+
+/**
+ * @brief Erases the lockout page and arms its first session
+ *
+ * The header is written after the arm line, so a reset anywhere in between leaves a page that is
+ * still treated as a full lockout.
+ */
+static void format_armed(void) {
+    UTIL_ASSERT(flash_erase_page(LOCKOUT_STATE_ADDR) == OK);
+    write_line(arm_line(0), ARM_MAGIC);
+    write_line(&lockout_state[0], FORMAT_MAGIC);
+}
+
+/**
+ * @brief Reads the lockout state from flash
  *
- * @param lockout_time_period lockout time period value to be updated in the flash.
+ * @param session (out) the armed session with periods left, or else the first unused session
+ * (LOCKOUT_SESSIONS if the page is full)
+ * @return number of periods left, or LOCKOUT_UNKNOWN if the page is not in a valid state
  */
-static void flash_helper(uint32_t lockout_time_period) {
-    UTIL_ASSERT(MXC_FLC_PageErase(LOCKOUT_STATE_ADDR) == E_NO_ERROR);
-    UTIL_ASSERT(MXC_FLC_Write(LOCKOUT_STATE_ADDR, sizeof(lockout_time_period),
-                              &lockout_time_period) == E_NO_ERROR);
+static uint32_t lockout_scan(size_t* session) {
+    if (!line_is(&lockout_state[0], FORMAT_MAGIC)) {
+        return LOCKOUT_UNKNOWN;
+    }
+
+    uint32_t remaining = 0;
+    *session = LOCKOUT_SESSIONS;
+    for (size_t s = 0; s < LOCKOUT_SESSIONS; s++) {
+        const lockout_line_t* arm = arm_line(s);
+        if (line_erased(arm)) {
+            if (remaining == 0) {
+                *session = s;
+            }
+            break;
+        }
+        if (!line_is(arm, ARM_MAGIC)) {
+            return LOCKOUT_UNKNOWN;
+        }
+
+        // a torn tally write happens after its period elapsed, so only erased lines are left
+        uint32_t left = 0;
+        for (size_t p = 0; p < LOCKOUT_TIME_PD; p++) {
+            left += line_erased(tally_line(s, p));
+        }
+        if (left > remaining) {
+            remaining = left;
+            *session = s;
+        }
+    }
+
+    return remaining;
 }
 
 /**
  * @brief Continue sleeping if there is remaining time on the persisted sleep timer
  */
 void lockout_process(void) {
-    // check the flash value with LOCKOUT_TIME_PD
-    uint32_t lockout_time_period = lockout_state;
+    size_t session = 0;
+    uint32_t lockout_time_period = lockout_scan(&session);
 
-    // if flash value greater than LOCKOUT_TIME_PD , write to flash LOCKOUT_TIME_PD , as there was a
-    // HW attack.
-    if (lockout_time_period > LOCKOUT_TIME_PD) {
+    // if the page makes no sense, there was a HW attack (or an interrupted erase): full lockout
+    if (lockout_time_period == LOCKOUT_UNKNOWN) {
+        format_armed();
+        session = 0;
         lockout_time_period = LOCKOUT_TIME_PD;
-        flash_helper(lockout_time_period);
     }
 
     // read again from flash to check if no hardware attack caused again
-    UTIL_ASSERT(lockout_time_period == lockout_state);
+    size_t check_session = 0;
+    UTIL_ASSERT(lockout_time_period == lockout_scan(&check_session));
+    UTIL_ASSERT(lockout_time_period == 0 || session == check_session);
 
-    // process the delay and keep looping and updating the flash
+    // process the delay and keep looping and clearing tally lines
+    size_t period = 0;
     while (lockout_time_period > 0) {
         MXC_Delay(LOCKOUT_PD_US); // delay for time in microseconds
         lockout_time_period--;    // decrement the lockout period variable
 
-        // update the flash with the new lockout value
-        flash_helper(lockout_time_period);
+        // clear the next tally line of the session
+        while (!line_erased(tally_line(session, period))) {
+            period++;
+        }
+        write_line(tally_line(session, period), 0);
     }
 
-    // just making sure that lockout time is written as 0
+    // just making sure that the lockout is over in flash as well
     UTIL_ASSERT(lockout_time_period == 0);
-    flash_helper(lockout_time_period);
+    UTIL_ASSERT(lockout_scan(&check_session) == 0);
 }
 
 /**
  * @brief Force a 5 second delay that cannot be skipped by resetting.
  */
 void attack_detected() {
-    // check the value of attack and either set state to LOCKOUT_TIME_PD and call process
-    uint32_t lockout_time_period = LOCKOUT_TIME_PD;
-    flash_helper(lockout_time_period);
+    // arm the next session, or start over on a fresh page once all sessions are used
+    size_t session = 0;
+    uint32_t lockout_time_period = lockout_scan(&session);
+    if (lockout_time_period == LOCKOUT_UNKNOWN || session == LOCKOUT_SESSIONS) {
+        format_armed();
+    } else if (lockout_time_period == 0) {
+        write_line(arm_line(session), ARM_MAGIC);
+    }
     lockout_process();
 }
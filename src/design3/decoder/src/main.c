@@ -5,20 +5,30 @@
  * @copyright Copyright (c) 2025 Carnegie Mellon University
  */
 
+#include "batch_decode.h"
+#include "boot.h"
 #include "common.h"
+#include "crypto_wrappers.h"
+#include "drbg.h"
 #include "fiproc.h"
 #include "frame.h"
-#include "hardware_init.h"
 #include "host_messaging.h"
+#include "host_uart.h"
 #include "list_subscriptions.h"
-#include "lockout.h"
+#include "mem_bench.h"
+#include "profile.h"
+#include "sram.h"
 #include "subscription.h"
 
 #include <mpu_armv7.h>
-#include <string.h>
 
 // Subscription update is the largest valid packet we'll ever receive
-#define MAX_BUF_LEN (sizeof(subscription_update_t))
+#define MAX_BUF_LEN MAX_SUBSCRIPTION_UPDATE_LEN
+
+// Start of flash, moved by build.sh qemu to where the emulated board has memory (qemu/memory.ld)
+#ifndef FLASH_ORIGIN
+#define FLASH_ORIGIN 0x10000000
+#endif
 
 void handle_list_msg(uint16_t msg_len) {
     if (msg_len != 0) {
@@ -31,35 +41,110 @@ void handle_list_msg(uint16_t msg_len) {
     return;
 }
 
-void handle_decode_msg(const uint8_t* msg_buf, uint16_t msg_len) {
-    if (msg_len != sizeof(frame_packet_t)) {
+void handle_decode_msg(uint8_t* msg_buf, uint16_t msg_len) {
+    error_t result;
+    frame_data_t* frame_data = NULL;
+
+    // the packet version is told apart by length
+    if (msg_len == sizeof(frame_packet_t)) {
+        result = decode((frame_packet_t*)msg_buf, &frame_data);
+    } else if (msg_len == sizeof(frame_packet_v2_t)) {
+        result = decode_stream_end((frame_packet_v2_t*)msg_buf, &frame_data);
+    } else if (msg_len == sizeof(frame_packet_v3_t)) {
+        result = decode_stream_end_v3((frame_packet_v3_t*)msg_buf, &frame_data);
+    } else {
         PRINT_ERROR("Invalid decode msg length.\n");
         return;
     }
 
-    if (decode((const frame_packet_t*)msg_buf) != OK) {
+    if (result != OK) {
         PRINT_ERROR("Failed to decode frame.\n");
+        return;
+    }
+
+    // straight from the receive buffer, where the frame was decrypted
+    send_msg(DECODE_MSG, frame_data->frame, frame_data->length);
+    frame_data_wipe(frame_data);
+    return;
+}
+
+void handle_batch_decode_msg(uint8_t* msg_buf, uint16_t msg_len) {
+    if (decode_batch(msg_buf, msg_len) != OK) {
+        PRINT_ERROR("Invalid batch decode msg.\n");
     }
     return;
 }
 
-void handle_subscribe_msg(const uint8_t* msg_buf, uint16_t msg_len) {
-    if (msg_len != sizeof(subscription_update_t)) {
+void handle_subscribe_msg(uint8_t* msg_buf, uint16_t msg_len) {
+    // the versions are told apart by length, see subscription.h
+    error_t result;
+    if (msg_len == sizeof(subscription_update_t)) {
+        result = update_subscription((const subscription_update_t*)msg_buf);
+    } else if (subscription_update_v2_length_ok((const subscription_update_v2_t*)msg_buf,
+                                                msg_len)) {
+        result = update_subscription_v2((subscription_update_v2_t*)msg_buf);
+    } else {
         PRINT_ERROR("Invalid subscribe msg length.\n");
         return;
     }
 
-    if (update_subscription((const subscription_update_t*)msg_buf) != OK) {
+    if (result != OK) {
         PRINT_ERROR("Failed to update subscription.\n");
     }
     return;
 }
+
+void handle_query_msg(const uint8_t* msg_buf, uint16_t msg_len) {
+    if (msg_len != sizeof(query_selector_t)) {
+        PRINT_ERROR("Invalid query msg length.\n");
+        return;
+    }
+
+    switch (*(const query_selector_t*)msg_buf) {
+        case QUERY_PREFETCH_STATS: {
+            prefetch_stats_t stats;
+            get_prefetch_stats(&stats);
+            send_msg(QUERY_MSG, &stats, sizeof(stats));
+            break;
+        }
+
+        case QUERY_SRAM_STATS: {
+            sram_stats_t stats;
+            get_sram_stats(&stats);
+            send_msg(QUERY_MSG, &stats, sizeof(stats));
+            break;
+        }
+
+#if ENABLE_PROFILE
+        case QUERY_PROFILE:
+            send_msg(QUERY_MSG, profile_get(), sizeof(profile_t));
+            break;
+
+        case QUERY_BOOT_PROFILE:
+            send_msg(QUERY_MSG, profile_boot_get(), sizeof(boot_profile_t));
+            break;
+#endif
+
+        default:
+            PRINT_ERROR("Invalid query selector.\n");
+            break;
+    }
+    return;
+}
+
+/**
+ * @brief Idle callback while a message body arrives, see drbg_idle()
+ */
+static void collect_entropy(const uint8_t* msg_buf, size_t received) {
+    drbg_idle();
+}
+
 static void enable_mpu(void) {
 
     // Whole flash region
     ARM_MPU_SetRegion(
         // 0x1000_0000 to 0x1008_0000 (512KiB)
-        ARM_MPU_RBAR(0, 0x10000000),
+        ARM_MPU_RBAR(0, FLASH_ORIGIN),
         // Allow execution, read-only
         ARM_MPU_RASR(0, ARM_MPU_AP_PRO, ARM_MPU_ACCESS_ORDERED, 1, 0, 0, 0b00000000,
                      ARM_MPU_REGION_SIZE_512KB));
@@ -99,22 +184,64 @@ static void enable_mpu(void) {
 
 int main() {
     enable_mpu();
-    hardware_init();
+    boot_init();
 
-    lockout_process();
+#if BENCH_TREE_KDF || BENCH_MEM || BENCH_KEY_CACHE || BENCH_EDDSA || BENCH_ICACHE
+    // the benchmarks report over the UART, so the board has to be up
+    boot_finish();
+    while (!boot_ready()) {}
+#endif
+#if BENCH_TREE_KDF
+    kdf_tree_benchmark();
+#endif
+#if BENCH_MEM
+    mem_benchmark();
+#endif
+#if BENCH_KEY_CACHE
+    key_cache_benchmark();
+#endif
+#if BENCH_EDDSA
+    eddsa_benchmark();
+#endif
+#if BENCH_ICACHE
+    icache_benchmark();
+#endif
 
     msg_type_t msg_type;
-    uint8_t msg_buf[MAX_BUF_LEN];
+    ARENA [[gnu::aligned(8)]] static uint8_t msg_buf[MAX_BUF_LEN]; // cast to packet structs
     uint16_t msg_len;
 
     while (true) {
         fiproc_update_pool();
-        memset(msg_buf, 0, MAX_BUF_LEN);
-        if (get_msg(&msg_type, msg_buf, &msg_len, MAX_BUF_LEN) != OK) {
+
+        // finish booting, then collect entropy and precompute frame keys until the host starts
+        // talking. boot_ready() comes first so it is polled even while the host is silent, see
+        // hardware_ready()
+        while (!boot_ready() || !uart_readable()) {
+            if (!boot_step()) {
+                drbg_idle();
+                decode_prefetch();
+            }
+        }
+        get_msg_header(&msg_type, &msg_len);
+        profile_boot_first_header();
+        boot_finish(); // while the host sends the body, see boot.c
+        profile_begin_msg(msg_type != QUERY_MSG);
+
+        // v2/v3 frame packets are verified while they are being received
+        msg_idle_fn_t on_idle = collect_entropy;
+        if (msg_type == DECODE_MSG &&
+            (msg_len == sizeof(frame_packet_v2_t) || msg_len == sizeof(frame_packet_v3_t))) {
+            decode_stream_begin(msg_len);
+            on_idle = decode_stream_poll;
+        }
+
+        if (get_msg_body(msg_buf, msg_len, MAX_BUF_LEN, on_idle) != OK) {
             PRINT_ERROR("Failed to get message.\n");
             continue;
         }
 
+        PROFILE_BEGIN(dispatch);
         switch (msg_type) {
             case LIST_MSG:
                 fiproc_small_ranged_delay();
@@ -126,15 +253,26 @@ int main() {
                 handle_decode_msg(msg_buf, msg_len);
                 break;
 
+            case BATCH_DECODE_MSG:
+                fiproc_small_ranged_delay();
+                handle_batch_decode_msg(msg_buf, msg_len);
+                break;
+
             case SUBSCRIBE_MSG:
                 fiproc_small_ranged_delay();
                 handle_subscribe_msg(msg_buf, msg_len);
                 break;
 
+            case QUERY_MSG:
+                fiproc_small_ranged_delay();
+                handle_query_msg(msg_buf, msg_len);
+                break;
+
             default:
                 fiproc_small_ranged_delay();
                 PRINT_ERROR("Invalid message type received.\n");
                 break;
         }
+        PROFILE_END(dispatch, PROFILE_DISPATCH);
     }
 }
@@ -0,0 +1,135 @@
+/**
+ * @file mem_bench.c
+ * @brief Cycle counts of the memory routines of libdesign3.c, built with DECODER_BENCH_MEM=1
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Runs on the board and the QEMU build, where the cycles are instructions. Their results are
+ * checked by host/test/test_mem.c.
+ */
+
+#include "mem_bench.h"
+
+#include "bench_report.h"
+#include "host_messaging.h"
+#include "util.h"
+
+#include <max78000.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if BENCH_MEM
+
+// Lengths of the key copies, struct clears and frame buffers the decoder moves
+static const size_t bench_lens[] = {16, 64, 120, 256, 2080};
+#define BENCH_MAX_LEN 2080
+#define BUF_LEN (BENCH_MAX_LEN + 1) // and the unaligned source
+
+[[gnu::aligned(8)]] static uint8_t buf_a[BUF_LEN];
+[[gnu::aligned(8)]] static uint8_t buf_b[BUF_LEN];
+
+// Results of the timed compares, so they are not optimized away
+static volatile int bench_sink;
+
+/**
+ * @brief Fills a buffer with a pattern that differs at every offset and per seed
+ */
+static void fill_pattern(uint8_t* buf, size_t len, uint32_t seed) {
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buf[i] = (uint8_t)(seed >> 24);
+    }
+}
+
+typedef enum {
+    BENCH_MEMCPY,
+    BENCH_MEMCPY_UNALIGNED,
+    BENCH_MEMSET,
+    BENCH_MEMCMP,
+    BENCH_TIMINGSAFE_BCMP,
+    BENCH_MEMSET_EXPLICIT,
+    BENCH_COUNT
+} bench_routine_t;
+
+static const char* const bench_names[BENCH_COUNT] = {
+    "memcpy", "memcpy +1", "memset", "memcmp", "timingsafe_bcmp", "memset_explicit",
+};
+
+/**
+ * @brief Cycles of one call of a routine on len bytes, the buffers already in the cache
+ */
+static uint32_t bench_one(bench_routine_t routine, size_t len) {
+    uint32_t best = UINT32_MAX;
+    for (size_t run = 0; run < 2; run++) { // the first run warms up the caches
+        __asm__ volatile("" : : : "memory");
+        uint32_t start = DWT->CYCCNT;
+        switch (routine) {
+        case BENCH_MEMCPY:
+            memcpy(buf_b, buf_a, len);
+            break;
+        case BENCH_MEMCPY_UNALIGNED:
+            memcpy(buf_b, buf_a + 1, len);
+            break;
+        case BENCH_MEMSET:
+            memset(buf_b, 0, len);
+            break;
+        case BENCH_MEMCMP:
+            bench_sink = memcmp(buf_a, buf_b, len);
+            break;
+        case BENCH_TIMINGSAFE_BCMP:
+            bench_sink = timingsafe_bcmp(buf_a, buf_b, len);
+            break;
+        case BENCH_MEMSET_EXPLICIT:
+            memset_explicit(buf_b, 0, len);
+            break;
+        default:
+            HALT_AND_CATCH_FIRE();
+        }
+        uint32_t cycles = DWT->CYCCNT - start;
+        __asm__ volatile("" : : : "memory");
+
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Reports the cycles per length of the memory routines in a debug message, enabled by
+ * building with DECODER_BENCH_MEM=1
+ */
+void mem_benchmark(void) {
+    // the cycle counter was started by hardware_init()
+    char report[384];
+    char* end = report;
+
+    end = append_str(end, "mem cycles for");
+    for (size_t i = 0; i < sizeof(bench_lens) / sizeof(bench_lens[0]); i++) {
+        end = append_str(end, i == 0 ? " " : "/");
+        end = append_u32(end, bench_lens[i]);
+    }
+    end = append_str(end, " bytes\n");
+
+    // equal buffers, so the compares go all the way
+    fill_pattern(buf_a, sizeof(buf_a), 0);
+    memcpy(buf_b, buf_a, sizeof(buf_b));
+    for (bench_routine_t routine = 0; routine < BENCH_COUNT; routine++) {
+        end = append_str(end, bench_names[routine]);
+        end = append_str(end, ":");
+        for (size_t i = 0; i < sizeof(bench_lens) / sizeof(bench_lens[0]); i++) {
+            if (routine == BENCH_MEMCMP || routine == BENCH_TIMINGSAFE_BCMP) {
+                memcpy(buf_b, buf_a, bench_lens[i]);
+            }
+            end = append_str(end, " ");
+            end = append_u32(end, bench_one(routine, bench_lens[i]));
+        }
+        end = append_str(end, "\n");
+    }
+    UTIL_ASSERT(end <= report + sizeof(report));
+
+    send_msg(DEBUG_MSG, report, (size_t)(end - report));
+}
+
+#endif
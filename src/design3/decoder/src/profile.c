@@ -0,0 +1,138 @@
+/**
+ * @file profile.c
+ * @brief Cycle counts of the decoder's processing stages, built with DECODER_PROFILE=1
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * Stages are timed with the DWT cycle counter started by hardware_init(). A stage that contains
+ * other stages, like a decode with its fault injection delays, only gets the cycles outside of
+ * them. Only stages of recorded messages are counted, so querying the profile does not show up in
+ * it. ectf25.utils.perf collects and tabulates the profile over a run.
+ *
+ * The startup phases are timed once, from the start of the cycle counter until the first header
+ * arrived (see boot.c), and read out separately with ectf25.utils.perf --boot.
+ */
+
+#include "profile.h"
+
+#include <max78000.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if ENABLE_PROFILE
+
+static profile_t profile = {.stage_count = PROFILE_STAGE_COUNT};
+
+// Cycles of all stages that ended so far, outermost runs only
+static uint32_t nested_cycles = 0;
+
+// Whether the message being handled is recorded
+static bool recording = false;
+
+static boot_profile_t boot_profile = {.phase_count = BOOT_PHASE_COUNT};
+
+/**
+ * @brief Starts timing a stage, see PROFILE_BEGIN()
+ */
+profile_mark_t profile_begin(void) {
+    return (profile_mark_t){.start = DWT->CYCCNT, .nested = nested_cycles};
+}
+
+/**
+ * @brief Ends a stage and counts its cycles less the ones of the stages inside it
+ *
+ * @param mark from profile_begin() at the start of the stage
+ * @param stage stage that ended
+ */
+void profile_end(const profile_mark_t* mark, profile_stage_t stage) {
+    uint32_t cycles = DWT->CYCCNT - mark->start;
+    uint32_t self = cycles - (nested_cycles - mark->nested);
+
+    // the enclosing stage excludes this one as a whole, including the stages inside it
+    nested_cycles = mark->nested + cycles;
+
+    if (!recording) {
+        return;
+    }
+
+    profile_stage_stats_t* stats = &profile.stages[stage];
+    if (stats->count == 0 || self < stats->min) {
+        stats->min = self;
+    }
+    if (self > stats->max) {
+        stats->max = self;
+    }
+    stats->count++;
+    stats->last += self;
+    stats->total += self;
+}
+
+/**
+ * @brief Starts a message, called once its header arrived
+ *
+ * @param record false for a message that should not be counted, like a profile query
+ */
+void profile_begin_msg(bool record) {
+    recording = record;
+    if (!record) {
+        return;
+    }
+
+    profile.messages++;
+    for (size_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        profile.stages[i].last = 0;
+    }
+}
+
+/**
+ * @brief Gets the profile, with the stages of the last recorded message in last
+ */
+const profile_t* profile_get(void) {
+    profile.core_clock = SystemCoreClock;
+    return &profile;
+}
+
+/**
+ * @brief Starts timing a startup phase, see PROFILE_BOOT_BEGIN()
+ */
+uint32_t profile_boot_begin(void) { return DWT->CYCCNT; }
+
+/**
+ * @brief Ends a startup phase
+ *
+ * @param start from profile_boot_begin() at the start of the phase
+ * @param phase phase that ended
+ */
+void profile_boot_end(uint32_t start, boot_phase_t phase) {
+    boot_profile.phases[phase].start = start;
+    boot_profile.phases[phase].cycles = DWT->CYCCNT - start;
+}
+
+/**
+ * @brief Records when the decoder could first accept a header, later calls are ignored
+ */
+void profile_boot_ready(void) {
+    if (boot_profile.ready == 0) {
+        boot_profile.ready = DWT->CYCCNT;
+    }
+}
+
+/**
+ * @brief Records when the first header arrived, later calls are ignored
+ */
+void profile_boot_first_header(void) {
+    if (boot_profile.first_header == 0) {
+        boot_profile.first_header = DWT->CYCCNT;
+    }
+}
+
+/**
+ * @brief Gets the startup profile
+ */
+const boot_profile_t* profile_boot_get(void) {
+    boot_profile.core_clock = SystemCoreClock;
+    return &boot_profile;
+}
+
+#endif
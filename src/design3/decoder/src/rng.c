@@ -11,7 +11,10 @@
 #include "string.h"
 #include "util.h"
 
+#include <max78000.h>
+#include <stdbool.h>
 #include <trng.h>
+#include <trng_regs.h>
 
 void rng_init() { MXC_TRNG_Init(); }
 
@@ -61,3 +64,47 @@ uint16_t rng_get_u16() {
     rng_get_unbiased_trng((uint8_t*)&result, sizeof(result));
     return result;
 }
+
+/**
+ * @brief Whiten one TRNG word if one is ready, without blocking
+ *
+ * Bits are collected across calls, so this can be called whenever there is nothing else to do.
+ *
+ * @param output (out) random byte, valid if true is returned
+ * @return true if a whole byte was collected
+ */
+bool rng_poll_unbiased_trng(uint8_t* output) {
+    static uint8_t current_byte = 0;
+    static uint8_t bits_generated = 0;
+
+    UTIL_ASSERT(output != NULL);
+
+    if (!(MXC_TRNG->status & MXC_F_TRNG_STATUS_RDY)) {
+        return false;
+    }
+
+    uint32_t stream = MXC_TRNG->data;
+    bool done = false;
+
+    for (uint32_t bit = 0; bit < 8; bit += 2, stream >>= 2) {
+        uint8_t bit1 = (stream >> 1);
+        uint8_t bit2 = stream;
+
+        uint8_t diff = (bit1 ^ bit2) & 1;
+
+        if (diff) {
+            current_byte <<= 1;
+            current_byte |= (bit1 & 1);
+
+            if (++bits_generated == 8) {
+                // at most 4 bits per word, so at most one byte per call
+                *output = current_byte;
+                current_byte = 0;
+                bits_generated = 0;
+                done = true;
+            }
+        }
+    }
+
+    return done;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file sram.c
+ * @brief SRAM_RW use: the static arena for large per-message buffers, and the stack high-water mark
+ * @author Plaid Parliament of Pwning
+ * @copyright Copyright (c) 2025 Carnegie Mellon University
+ *
+ * crt0.S paints the whole stack with STACK_PAINT before main(). The stack grows down from the top
+ * of SRAM_RW, so the lowest word that is no longer paint is as deep as it ever went. A frame that
+ * reserves space it never writes is not seen, so the peak is a lower bound; the worst case per call
+ * path comes from ppp_common.stack_report at build time.
+ */
+
+#include "sram.h"
+
+#include "util.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// match: firmware.ld.template
+extern const uint32_t _data_start[], _data_end[];
+extern const uint32_t _bss_start[], _bss_end[];
+extern const uint32_t _arena_start[], _arena_end[];
+extern const uint32_t _stack_limit[], __StackTop[];
+
+static uint32_t span(const uint32_t* start, const uint32_t* end) {
+    return (uint32_t)((uintptr_t)end - (uintptr_t)start);
+}
+
+/**
+ * @brief Gets the sizes of the SRAM_RW regions and the stack high-water mark
+ *
+ * @param stats (out) SRAM_RW use
+ */
+void get_sram_stats(sram_stats_t* stats) {
+    UTIL_ASSERT(stats != NULL);
+
+    const uint32_t* deepest = _stack_limit;
+    while (deepest < __StackTop && *deepest == STACK_PAINT) {
+        deepest++;
+    }
+
+    stats->static_size = span(_data_start, _data_end) + span(_bss_start, _bss_end);
+    stats->arena_size = span(_arena_start, _arena_end);
+    stats->stack_size = span(_stack_limit, __StackTop);
+    stats->stack_peak = span(deepest, __StackTop);
+}
@@ -11,46 +11,137 @@
 #include "crypto_wrappers.h"
 #include "fiproc.h"
 #include "host_messaging.h"
+#include "journal.h"
+#include "key_expansion.h"
 #include "lockout.h"
+#include "profile.h"
 #include "secrets.h"
+#include "sram.h"
 #include "util.h"
 
-#include <flc.h>
+#include <monocypher.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
 // Allocated by linker and patched into binary during build
-extern const valid_subscription_t channel0;
+extern const valid_subscription_v2_t channel0;
 
-#define SUBSCRIPTION_FLASH_ADDR ((size_t)&channel0)
-#define SUBSCRIPTION_SIZE 8192        // exactly one flash page
 #define SUBSCRIPTION_MAGIC 0x41594E42 // BNYA
 
 /**
- * @brief Calculate address for a particular subscription package
+ * @brief Body of a journal record holding a subscription, followed by key_count tree keys
+ */
+typedef struct {
+    timestamp_t start;
+    timestamp_t end;
+    uint32_t key_count;
+    uint8_t _pad[12]; // tree keys start on a flash line
+    uint8_t kch[SYMMETRIC_KEY_LEN];
+} subscription_record_t;
+
+static_assert(sizeof(subscription_record_t) % JOURNAL_LINE == 0);
+static_assert(TREE_KEY_LEN % JOURNAL_LINE == 0);
+static_assert(JOURNAL_MAX_LIVE == MAX_CHANNEL_COUNT - 1);
+
+// match: firmware.ld.template -> .channel0
+static_assert(sizeof(valid_subscription_v2_t) + MAX_TREE_KEYS * TREE_KEY_LEN <= 0x2000);
+
+// Largest journal record of a subscription, with record header and trailer
+#define MAX_SUBSCRIPTION_RECORD_LEN                                                                \
+    (2 * JOURNAL_LINE + sizeof(subscription_record_t) + MAX_TREE_KEYS * TREE_KEY_LEN)
+
+// Compaction needs pages without live records to move on to, even if every channel holds the
+// largest subscription of the key tree
+static_assert(JOURNAL_MAX_LIVE * MAX_SUBSCRIPTION_RECORD_LEN <=
+              (JOURNAL_PAGES - 2) * (JOURNAL_PAGE_SIZE - JOURNAL_LINE));
+
+// Index of the stored subscriptions: channel 0 first, then the live journal records
+static subscription_info_t subscription_index[MAX_CHANNEL_COUNT];
+
+/**
+ * @brief Refreshes the index entry of channel 0, which is patched into the binary
+ */
+static void index_channel0(void) {
+    subscription_info_t* info = &subscription_index[0];
+
+    info->valid = false;
+    if (channel0.magic != SUBSCRIPTION_MAGIC || channel0.key_count > MAX_TREE_KEYS) {
+        return;
+    }
+
+    info->ktree = &channel0.ktree[0][0];
+    info->channel = channel0.channel;
+    info->start = channel0.start;
+    info->end = channel0.end;
+    info->key_count = channel0.key_count;
+    info->generation = 0; // journal records start at 1
+    memcpy(info->kch, channel0.kch, sizeof(info->kch));
+    info->valid = true;
+}
+
+/**
+ * @brief Refreshes the index entries of the journal, whose records move on every append
  *
- * @param i Subscription index
- * @return const valid_subscription_t*  Pointer to subscription package
+ * The generation of an entry is the sequence number of its record, which survives compaction.
  */
-const valid_subscription_t* get_subscription_raw(size_t i) {
-    UTIL_ASSERT(i < MAX_CHANNEL_COUNT);
-    return (valid_subscription_t*)(SUBSCRIPTION_FLASH_ADDR + i * SUBSCRIPTION_SIZE);
+static void index_journal(void) {
+    for (size_t i = 1; i < MAX_CHANNEL_COUNT; i++) {
+        const journal_record_hdr_t* record = journal_get(i - 1);
+        subscription_info_t* info = &subscription_index[i];
+
+        info->valid = false;
+        if (record == NULL || journal_record_body_length(record) < sizeof(subscription_record_t)) {
+            continue;
+        }
+
+        const subscription_record_t* sub = journal_record_body(record);
+        if (sub->key_count > MAX_TREE_KEYS || journal_record_body_length(record) !=
+                                                  sizeof(*sub) + sub->key_count * TREE_KEY_LEN) {
+            continue;
+        }
+
+        info->ktree = (const uint8_t*)(sub + 1);
+        info->channel = record->channel;
+        info->start = sub->start;
+        info->end = sub->end;
+        info->key_count = sub->key_count;
+        info->generation = record->seq;
+        memcpy(info->kch, sub->kch, sizeof(info->kch));
+        info->valid = true;
+    }
 }
 
 /**
- * @brief Returns the subscription at the given flash index, if it exists.
+ * @brief Replays the journal and builds the subscription index, must run before any subscription
+ * is used
  *
- * @param i index into subscription storage of desired subscription.
- * @return pointer to valid subscription in flash or NULL if none exists at that location.
+ * Also expands every subscription that has no key expansion slot yet: channel 0 on first boot,
+ * and any subscription whose expansion was interrupted by a reset.
  */
-const valid_subscription_t* get_subscription(size_t i) {
-    if (i < MAX_CHANNEL_COUNT) {
-        const valid_subscription_t* sub = get_subscription_raw(i);
-        if (sub->magic == SUBSCRIPTION_MAGIC) {
-            return sub;
+void subscription_init(void) {
+    journal_init();
+    index_channel0();
+    index_journal();
+
+    key_expansion_init();
+    for (size_t i = 0; i < MAX_CHANNEL_COUNT; i++) {
+        if (subscription_index[i].valid) {
+            key_expansion_build(&subscription_index[i]);
         }
     }
+}
+
+/**
+ * @brief Returns the subscription at the given index, if it exists.
+ *
+ * @param i index into the subscription index, 0 is channel 0
+ * @return pointer to subscription info or NULL if none exists at that location.
+ */
+const subscription_info_t* get_subscription(size_t i) {
+    if (i < MAX_CHANNEL_COUNT && subscription_index[i].valid) {
+        return &subscription_index[i];
+    }
 
     return NULL;
 }
@@ -59,12 +150,12 @@ const valid_subscription_t* get_subscription(size_t i) {
  * @brief Finds a valid subscription for the channel if one exists.
  *
  * @param ch channel number to find
- * @return pointer to valid subscription in flash or NULL if none exists
+ * @return pointer to subscription info or NULL if none exists
  */
-const valid_subscription_t* get_subscription_by_channel(channel_t ch) {
+const subscription_info_t* get_subscription_by_channel(channel_t ch) {
     for (size_t i = 0; i < MAX_CHANNEL_COUNT; i++) {
-        const valid_subscription_t* sub = get_subscription(i);
-        if (sub != NULL && sub->magic == SUBSCRIPTION_MAGIC && sub->channel == ch) {
+        const subscription_info_t* sub = &subscription_index[i];
+        if (sub->valid && sub->channel == ch) {
             return sub;
         }
     }
@@ -73,16 +164,46 @@ const valid_subscription_t* get_subscription_by_channel(channel_t ch) {
 }
 
 /**
- * @brief Writes a subscription to a specific index in flash storage
+ * @brief Returns a packaged tree key of a subscription, which stays in flash
+ *
+ * @param sub subscription info
+ * @param index index of the tree key, less than sub->key_count
+ * @return pointer to the tree key (TREE_KEY_LEN bytes)
+ */
+const uint8_t* get_subscription_tree_key(const subscription_info_t* sub, size_t index) {
+    UTIL_ASSERT(sub != NULL);
+    UTIL_ASSERT(sub->ktree != NULL);
+    UTIL_ASSERT(index < sub->key_count);
+    UTIL_ASSERT(index < MAX_TREE_KEYS);
+
+    return sub->ktree + index * TREE_KEY_LEN;
+}
+
+/**
+ * @brief Appends a subscription to the journal, replacing any subscription of its channel
  * YOU MUST HAVE CHECKED THE VALIDITY OF `sub` BEFORE WRITING IT
  *
- * @param i index of subscription
- * @param sub Subscription package
+ * @param sub Subscription package, without its tree keys
+ * @param ktree sub->key_count tree keys
+ * @return OK on success, ERROR if the channel is new and there is no room for it
  */
-static void write_subscription(size_t i, const valid_subscription_t* sub) {
-    UTIL_ASSERT(MXC_FLC_PageErase((uint32_t)get_subscription_raw(i)) == E_NO_ERROR);
-    UTIL_ASSERT(MXC_FLC_Write((uint32_t)get_subscription_raw(i), sizeof(*sub), (uint32_t*)sub) ==
-                E_NO_ERROR);
+static error_t write_subscription(const valid_subscription_v2_t* sub, const uint8_t* ktree) {
+    subscription_record_t record = {
+        .start = sub->start,
+        .end = sub->end,
+        .key_count = sub->key_count,
+    };
+    memcpy(record.kch, sub->kch, sizeof(record.kch));
+
+    journal_chunk_t chunks[] = {
+        {.data = &record, .length = sizeof(record)},
+        {.data = ktree, .length = sub->key_count * TREE_KEY_LEN},
+    };
+    error_t result = journal_append(sub->channel, chunks, sizeof(chunks) / sizeof(chunks[0]));
+
+    // records of other channels may have been moved by compaction
+    index_journal();
+    return result;
 }
 
 /**
@@ -105,7 +226,67 @@ static error_t decrypt_subscription(const uint8_t* update_package,
  */
 static error_t validate_signature(const subscription_update_t* signed_package) {
     return verify_asymmetric(signed_package->sig, (const uint8_t*)&signed_package->payload,
-                             sizeof(signed_package->payload), ENCODER_PUBLIC_KEY);
+                             sizeof(signed_package->payload), &encoder_verify_ctx);
+}
+
+/**
+ * @brief Checks a decrypted subscription of either update version, and if valid, stores it in
+ * flash memory and expands its keys.
+ *
+ * @param dec_package decrypted subscription, without its tree keys
+ * @param ktree dec_package->key_count tree keys, if key_count is valid
+ * @return OK if subscription was valid and space was available to store it, ERROR otherwise
+ */
+static error_t store_subscription(const valid_subscription_v2_t* dec_package,
+                                  const uint8_t* ktree) {
+    // check channel 0
+    fiproc_delay();
+    if (dec_package->channel == 0) {
+        // can't update subscription 0 but not an attack per organizers
+        return ERROR;
+    }
+
+    // check timestamp
+    fiproc_delay();
+    if (dec_package->end < dec_package->start) {
+        // bad subscription, lockout
+        attack_detected();
+        return ERROR;
+    }
+
+    fiproc_delay();
+    if (dec_package->magic != SUBSCRIPTION_MAGIC) {
+        // corrupted subscription after signature+encrypt, lockout
+        attack_detected();
+        return ERROR;
+    }
+
+    fiproc_delay();
+    if (dec_package->key_count > MAX_TREE_KEYS) {
+        // corrupted subscription after signature+encrypt, lockout
+        attack_detected();
+        return ERROR;
+    }
+
+    // okay, subscription is valid
+    // store it in the journal for frame decoding, replacing an existing subscription of the
+    // channel or taking a free entry
+    fiproc_delay();
+    PROFILE_BEGIN(store);
+    error_t store_result = write_subscription(dec_package, ktree);
+    PROFILE_END(store, PROFILE_SUB_STORE);
+    if (store_result != OK) {
+        // just too many subscriptions, not an attack
+        return ERROR;
+    }
+
+    send_msg(SUBSCRIBE_MSG, NULL, 0);
+
+    // after the response, frames that arrive in the meantime wait in the UART RX ring
+    PROFILE_BEGIN(expand);
+    key_expansion_build(get_subscription_by_channel(dec_package->channel));
+    PROFILE_END(expand, PROFILE_SUB_EXPAND);
+    return OK;
 }
 
 /**
@@ -119,7 +300,9 @@ static error_t validate_signature(const subscription_update_t* signed_package) {
 error_t update_subscription(const subscription_update_t* update_package) {
     // validate the signature of the subscription data
     volatile error_t sig_result = ERROR;
+    PROFILE_BEGIN(signature);
     sig_result = validate_signature(update_package);
+    PROFILE_END(signature, PROFILE_SUB_SIGNATURE);
     fiproc_delay();
     MULTI_IF_FAILIN(sig_result != OK) {
         // invalid subscription is an attack
@@ -129,65 +312,93 @@ error_t update_subscription(const subscription_update_t* update_package) {
 
     // decrypt the subscription
     // this inherently checks that the ID is correct - it will fail for wrong key
-    valid_subscription_t dec_package = {0};
+    ARENA static valid_subscription_t dec_package;
+    memset(&dec_package, 0, sizeof(dec_package));
     fiproc_delay();
-    if (decrypt_subscription(update_package->payload.ciphertext, &dec_package) != OK) {
+    PROFILE_BEGIN(decrypt);
+    error_t dec_result = decrypt_subscription(update_package->payload.ciphertext, &dec_package);
+    PROFILE_END(decrypt, PROFILE_SUB_DECRYPT);
+    if (dec_result != OK) {
         // failed to decrypt the update_package
+        memset_explicit(&dec_package, 0, sizeof(dec_package));
         attack_detected();
         return ERROR;
     }
 
-    // check channel 0
+    // the same fields as a v2 subscription, whose keys follow them
+    valid_subscription_v2_t fields = {
+        .start = dec_package.start,
+        .end = dec_package.end,
+        .channel = dec_package.channel,
+        .key_count = dec_package.key_count,
+        .magic = dec_package.magic,
+    };
+    memcpy(fields.kch, dec_package.kch, sizeof(fields.kch));
+
+    error_t result = store_subscription(&fields, &dec_package.ktree[0][0]);
+    memset_explicit(&dec_package, 0, sizeof(dec_package));
+    memset_explicit(&fields, 0, sizeof(fields));
+    return result;
+}
+
+/**
+ * @brief Given an encrypted v2 subscription package, verify its authenticity and validity,
+ * and if valid, store it in flash memory.
+ *
+ * The subscription is decrypted in place and wiped from the package once it is stored.
+ *
+ * @param update_package the encrypted subscription update package, 8-byte aligned, whose length
+ * was checked with subscription_update_v2_length_ok()
+ * @return OK if subscription was valid and space was available to store it, ERROR otherwise
+ */
+error_t update_subscription_v2(subscription_update_v2_t* update_package) {
+    UTIL_ASSERT(update_package->key_count <= MAX_TREE_KEYS);
+    size_t key_count = update_package->key_count;
+    size_t signed_len = SUBSCRIPTION_UPDATE_V2_LEN(key_count) - SIGNATURE_LEN;
+
+    // validate the signature of everything after it, the key count included
+    volatile error_t sig_result = ERROR;
+    PROFILE_BEGIN(signature);
+    sig_result = verify_asymmetric(update_package->sig, (const uint8_t*)&update_package->version,
+                                   signed_len, &encoder_verify_ctx);
+    PROFILE_END(signature, PROFILE_SUB_SIGNATURE);
     fiproc_delay();
-    if (dec_package.channel == 0) {
-        // can't update subscription 0 but not an attack per organizers
+    MULTI_IF_FAILIN(sig_result != OK) {
+        // invalid subscription is an attack
+        attack_detected();
         return ERROR;
     }
 
-    // check timestamp
     fiproc_delay();
-    if (dec_package.end < dec_package.start) {
-        // bad subscription, lockout
-        attack_detected();
+    if (update_package->version != SUBSCRIPTION_UPDATE_VERSION_2) {
         return ERROR;
     }
 
+    // decrypt the subscription in place, where the data of the ciphertext starts
+    // this inherently checks that the ID is correct - it will fail for wrong key
+    valid_subscription_v2_t* dec_package =
+        (valid_subscription_v2_t*)(update_package->ciphertext + SYMMETRIC_METADATA_LEN);
+    size_t dec_len = sizeof(*dec_package) + key_count * TREE_KEY_LEN;
     fiproc_delay();
-    if (dec_package.magic != SUBSCRIPTION_MAGIC) {
-        // corrupted subscription after signature+encrypt, lockout
+    PROFILE_BEGIN(decrypt);
+    error_t dec_result =
+        decrypt_symmetric((uint8_t*)dec_package, update_package->ciphertext, dec_len, ID_KEY);
+    PROFILE_END(decrypt, PROFILE_SUB_DECRYPT);
+    if (dec_result != OK) {
+        // failed to decrypt the update_package
         attack_detected();
         return ERROR;
     }
 
-    // okay, subscription is valid
-    // store it in memory in "subscriptions" for frame decoding
-
-    // skip index 0 in loops below since we never update channel 0
-
-    // first, check to see if there is an existing subscription for this channel and replace it
-    for (size_t i = 1; i < MAX_CHANNEL_COUNT; i++) {
-        fiproc_delay();
-        const valid_subscription_t* old_subscription = get_subscription_raw(i);
-        if (old_subscription->magic == SUBSCRIPTION_MAGIC &&
-            old_subscription->channel == dec_package.channel) {
-            // update this entry
-            write_subscription(i, &dec_package);
-            send_msg(SUBSCRIBE_MSG, NULL, 0);
-            return OK;
-        }
-    }
-
-    // if no existing subscription, replace an empty subscription
-    for (size_t i = 1; i < MAX_CHANNEL_COUNT; i++) {
-        fiproc_delay();
-        const valid_subscription_t* old_subscription = get_subscription_raw(i);
-        if (old_subscription->magic != SUBSCRIPTION_MAGIC) {
-            write_subscription(i, &dec_package);
-            send_msg(SUBSCRIBE_MSG, NULL, 0);
-            return OK;
-        }
+    error_t result = ERROR;
+    fiproc_delay();
+    if (dec_package->key_count != key_count) {
+        // corrupted subscription after signature+encrypt, lockout
+        attack_detected();
+    } else {
+        result = store_subscription(dec_package, &dec_package->ktree[0][0]);
     }
 
-    // just too many subscriptions, not an attack
-    return ERROR;
+    memset_explicit(dec_package, 0, dec_len);
+    return result;
 }
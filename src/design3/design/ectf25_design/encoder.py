@@ -9,11 +9,10 @@ from ppp_common.cstruct import cstruct
 from ppp_common.crypto_wrappers import (
     sign_asymmetric,
     encrypt_symmetric,
-    kdf_tree_leaf,
     SYMMETRIC_METADATA_LEN,
     SIGNATURE_LEN,
 )
-from ppp_common.gen_secrets import GlobalSecrets, Vertex
+from ppp_common.gen_secrets import GlobalSecrets
 
 from loguru import logger
 
@@ -56,9 +55,62 @@ class FramePacket(metaclass=cstruct):
 
 assert FramePacket.size == 228
 
+FRAME_PACKET_VERSION_1 = 1
+FRAME_PACKET_VERSION_2 = 2
+FRAME_PACKET_VERSION_3 = 3
+
+
+# match: frame.h -> frame_packet_v2_t -> payload
+class FramePacketPayloadV2(metaclass=cstruct):
+    version: int = "I"
+    channel_id: int = "I"
+    enc_frame: bytes = f"{SYMMETRIC_METADATA_LEN + FrameCh.size}s"
+
+
+assert FramePacketPayloadV2.size == 168
+
+
+# match: frame.h -> frame_packet_v2_t
+class FramePacketV2(metaclass=cstruct):
+    signature: bytes = f"{SIGNATURE_LEN}s"
+    payload: bytes = f"{FramePacketPayloadV2.size}s"
+
+
+assert FramePacketV2.size == 232
+
+
+# match: frame.h -> frame_packet_v3_t -> payload
+class FramePacketPayloadV3(metaclass=cstruct):
+    version: int = "I"
+    channel_id: int = "I"
+    timestamp: int = "Q"
+    enc_frame: bytes = f"{SYMMETRIC_METADATA_LEN + FrameCh.size}s"
+
+
+assert FramePacketPayloadV3.size == 176
+
+
+# match: frame.h -> frame_packet_v3_t
+class FramePacketV3(metaclass=cstruct):
+    signature: bytes = f"{SIGNATURE_LEN}s"
+    payload: bytes = f"{FramePacketPayloadV3.size}s"
+
+
+assert FramePacketV3.size == 240
+
+FRAME_PACKET_VERSIONS = (
+    FRAME_PACKET_VERSION_1,
+    FRAME_PACKET_VERSION_2,
+    FRAME_PACKET_VERSION_3,
+)
+
 
 class Encoder:
-    def __init__(self, secrets: bytes):
+    def __init__(self, secrets: bytes, packet_version: int = FRAME_PACKET_VERSION_3):
+        if packet_version not in FRAME_PACKET_VERSIONS:
+            raise ValueError(f"Unknown frame packet version {packet_version}")
+
+        self.packet_version = packet_version
         self.keys = GlobalSecrets.deserialize(secrets)
         self.channel_keys = self.keys.channel_keys
         self.enc_private_key = self.keys.enc_private_key
@@ -73,10 +125,8 @@ class Encoder:
 
         # enc_frame := { frame }_ktree  (68 + 40 = 108 bytes)
 
-        # create vertex with prefix as the timestamp of frame bits is 64
-        frame_vertex = Vertex(prefix=timestamp, bits=64)
-
-        ktree = kdf_tree_leaf(self.keys.derive_tree_key(channel, frame_vertex))
+        # leaf of the key tree at the timestamp, with the deployment's KDF version
+        ktree = self.keys.derive_frame_key(channel, timestamp)
 
         enc_frame = encrypt_symmetric(frame_data, ktree)
 
@@ -86,6 +136,23 @@ class Encoder:
         # enc_timestamp := { timestamped_frame }_kch (120 + 40 = 160 bytes)
         enc_timestamp = encrypt_symmetric(timestamped_frame, self.channel_keys[channel])
 
+        if self.packet_version == FRAME_PACKET_VERSION_3:
+            # message := sig || v || ch || t || enc_timestamp (64 + 4 + 4 + 8 + 160 = 240 bytes)
+            # where sig := { v || ch || t || enc_timestamp }_k_e^-1
+            # t is also sent in the clear so the decoder can drop stale frames before verifying
+            payload = FramePacketPayloadV3(
+                FRAME_PACKET_VERSION_3, channel, timestamp, enc_timestamp
+            ).pack()
+            signature = sign_asymmetric(payload, self.keys.enc_private_key)
+            return FramePacketV3(signature, payload).pack()
+
+        if self.packet_version == FRAME_PACKET_VERSION_2:
+            # message := sig || v || ch || enc_timestamp (64 + 4 + 4 + 160 = 232 bytes)
+            # where sig := { v || ch || enc_timestamp }_k_e^-1
+            payload = FramePacketPayloadV2(FRAME_PACKET_VERSION_2, channel, enc_timestamp).pack()
+            signature = sign_asymmetric(payload, self.keys.enc_private_key)
+            return FramePacketV2(signature, payload).pack()
+
         # message := ch || enc_timestamp || { ch || enc_timestamp }_k_e^-1 (4 + 160 + 64 = 228 bytes)
         ch_enc_timestamp = FramePacketPayload(channel, enc_timestamp).pack()
         signature = sign_asymmetric(ch_enc_timestamp, self.keys.enc_private_key)
@@ -22,6 +22,13 @@ from serial.serialutil import SerialTimeoutException
 MAGIC = b"%"
 BLOCK_LEN = 256
 
+# Largest batch body the Decoder accepts: its message buffer, sized for a subscription update of
+# the binary key tree (wider trees have a larger buffer)
+# match: main.c -> MAX_BUF_LEN
+MAX_BATCH_LEN = 2200
+# Most frame packets the Decoder accepts in one batch, see batch_decode.h
+MAX_BATCH_RECORDS = 9
+
 
 class Opcode(IntEnum):
     """Enum class for use in device output processing."""
@@ -29,6 +36,8 @@ class Opcode(IntEnum):
     DECODE = 0x44  # D
     SUBSCRIBE = 0x53  # S
     LIST = 0x4C  # L
+    BATCH_DECODE = 0x42  # B
+    QUERY = 0x51  # Q
     ACK = 0x41  # A
     DEBUG = 0x47  # G
     ERROR = 0x45  # E
@@ -37,6 +46,142 @@ class Opcode(IntEnum):
 NACK_MSGS = {Opcode.DEBUG, Opcode.ACK}
 
 
+class QuerySelector(IntEnum):
+    """What a QUERY message asks for, see design3 host_messaging.h -> query_selector_t"""
+
+    PREFETCH_STATS = 1
+    PROFILE = 2
+    BOOT_PROFILE = 3
+    SRAM_STATS = 4
+
+
+@dataclass
+class PrefetchStats:
+    """Frame key derivations since boot, see design3 frame.h -> prefetch_stats_t"""
+
+    prefetches: int
+    hits: int
+    misses: int
+    unpredicted: int
+    hit_cycles: int
+    miss_cycles: int
+    unpredicted_cycles: int
+
+    FMT = "<IIIIQQQ"
+
+    @classmethod
+    def parse(cls, body: bytes) -> "PrefetchStats":
+        if len(body) != struct.calcsize(cls.FMT):
+            raise DecoderError(f"Bad prefetch stats length {len(body)}")
+        return cls(*struct.unpack(cls.FMT, body))
+
+    @property
+    def hit_rate(self) -> float:
+        """Share of decoded frames whose key was precomputed"""
+        total = self.hits + self.misses + self.unpredicted
+        return self.hits / total if total else 0.0
+
+
+@dataclass
+class ProfileStage:
+    """Cycles of one processing stage, see design3 profile.h -> profile_stage_stats_t"""
+
+    count: int
+    min: int
+    max: int
+    last: int
+    total: int
+
+    FMT = "<IIIIQ"
+
+
+@dataclass
+class Profile:
+    """Cycles of the Decoder's processing stages, see design3 profile.h -> profile_t
+
+    ``last`` of each stage covers the last message before the query.
+    """
+
+    core_clock: int
+    messages: int
+    stages: list[ProfileStage]
+
+    FMT = "<IIII"
+
+    @classmethod
+    def parse(cls, body: bytes) -> "Profile":
+        hdr_len = struct.calcsize(cls.FMT)
+        stage_len = struct.calcsize(ProfileStage.FMT)
+        if len(body) < hdr_len:
+            raise DecoderError(f"Bad profile length {len(body)}")
+        stage_count, core_clock, messages, _ = struct.unpack_from(cls.FMT, body)
+        if len(body) != hdr_len + stage_count * stage_len:
+            raise DecoderError(f"Bad profile length {len(body)}")
+        stages = [
+            ProfileStage(*struct.unpack_from(ProfileStage.FMT, body, offs))
+            for offs in range(hdr_len, len(body), stage_len)
+        ]
+        return cls(core_clock, messages, stages)
+
+
+@dataclass
+class BootPhase:
+    """One startup phase, see design3 profile.h -> boot_phase_stats_t"""
+
+    start: int
+    cycles: int
+
+    FMT = "<II"
+
+
+@dataclass
+class BootProfile:
+    """Cycles of the Decoder's startup, see design3 profile.h -> boot_profile_t
+
+    All cycle counts are since the Decoder started its cycle counter.
+    """
+
+    core_clock: int
+    ready: int
+    first_header: int
+    phases: list[BootPhase]
+
+    FMT = "<IIII"
+
+    @classmethod
+    def parse(cls, body: bytes) -> "BootProfile":
+        hdr_len = struct.calcsize(cls.FMT)
+        phase_len = struct.calcsize(BootPhase.FMT)
+        if len(body) < hdr_len:
+            raise DecoderError(f"Bad boot profile length {len(body)}")
+        phase_count, core_clock, ready, first_header = struct.unpack_from(cls.FMT, body)
+        if len(body) != hdr_len + phase_count * phase_len:
+            raise DecoderError(f"Bad boot profile length {len(body)}")
+        phases = [
+            BootPhase(*struct.unpack_from(BootPhase.FMT, body, offs))
+            for offs in range(hdr_len, len(body), phase_len)
+        ]
+        return cls(core_clock, ready, first_header, phases)
+
+
+@dataclass
+class SramStats:
+    """Bytes of SRAM the Decoder uses, see design3 sram.h -> sram_stats_t"""
+
+    static_size: int
+    arena_size: int
+    stack_size: int
+    stack_peak: int
+
+    FMT = "<IIII"
+
+    @classmethod
+    def parse(cls, body: bytes) -> "SramStats":
+        if len(body) != struct.calcsize(cls.FMT):
+            raise DecoderError(f"Bad SRAM stats length {len(body)}")
+        return cls(*struct.unpack(cls.FMT, body))
+
+
 @dataclass
 class MessageHdr:
     """Header for the Decoder protocol"""
@@ -137,6 +282,61 @@ class DecoderIntf:
             raise DecoderError(f"Bad decode response {resp}")
         return resp.body
 
+    def decode_many(self, frames: list[bytes]) -> list[Optional[bytes]]:
+        """Decode several frames, sending as few batch messages as possible
+
+        :param frames: Encoded frames to be decoded
+        :returns: The decoded frames, with None for each frame that failed to decode
+        :raises DecoderError: Error on a malformed batch or response
+        """
+        results = []
+        batch = []
+        batch_len = 0
+        for frame in frames:
+            # each record is u16 length || u16 padding || frame packet
+            record = struct.pack("<HH", len(frame), 0) + frame
+            if batch and (
+                batch_len + len(record) > MAX_BATCH_LEN or len(batch) == MAX_BATCH_RECORDS
+            ):
+                results += self._decode_batch(batch)
+                batch, batch_len = [], 0
+            batch.append(record)
+            batch_len += len(record)
+
+        if batch:
+            results += self._decode_batch(batch)
+        return results
+
+    def _decode_batch(self, records: list[bytes]) -> list[Optional[bytes]]:
+        """Send one batch decode message and unpack the per-frame results
+
+        :param records: Batch records, each frame prefixed with its length
+        :returns: The decoded frames, with None for each frame that failed to decode
+        :raises DecoderError: Error on a malformed batch or response
+        """
+        msg = Message(Opcode.BATCH_DECODE, b"".join(records))
+        self.send_msg(msg)
+
+        resp = self.get_msg()
+        if resp.opcode != Opcode.BATCH_DECODE:
+            raise DecoderError(f"Bad batch decode response {resp}")
+
+        # each result is u8 status || u8 length || decoded frame
+        results = []
+        body = resp.body
+        for _ in records:
+            if len(body) < 2:
+                raise DecoderError("Truncated batch decode response")
+            status, ln = struct.unpack("<BB", body[:2])
+            frame, body = body[2 : 2 + ln], body[2 + ln :]
+            if len(frame) != ln:
+                raise DecoderError("Truncated batch decode response")
+            results.append(frame if status == 0 else None)
+
+        if body:
+            raise DecoderError(f"Bad batch decode response! {len(body)} extra bytes")
+        return results
+
     def subscribe(self, subscription: bytes):
         """Subscribe the Decoder to a new subscription
 
@@ -192,6 +392,49 @@ class DecoderIntf:
 
         return channels
 
+    def query(self, selector: QuerySelector) -> bytes:
+        """Query internal state of the Decoder
+
+        :param selector: What to query
+        :returns: The raw reply body
+        :raises DecoderError: Error on query failure
+        """
+        msg = Message(Opcode.QUERY, struct.pack("<I", selector))
+        self.send_msg(msg)
+
+        resp = self.get_msg()
+        if resp.opcode != Opcode.QUERY:
+            raise DecoderError(f"Bad query response {resp}")
+        return resp.body
+
+    def prefetch_stats(self) -> PrefetchStats:
+        """Get the frame key prefetch hit rate and latency counters of the Decoder
+
+        :raises DecoderError: Error on query failure
+        """
+        return PrefetchStats.parse(self.query(QuerySelector.PREFETCH_STATS))
+
+    def profile(self) -> Profile:
+        """Get the per-stage cycle counts of the Decoder, built with DECODER_PROFILE=1
+
+        :raises DecoderError: Error on query failure, or if profiling is not built in
+        """
+        return Profile.parse(self.query(QuerySelector.PROFILE))
+
+    def boot_profile(self) -> BootProfile:
+        """Get the startup cycle counts of the Decoder, built with DECODER_PROFILE=1
+
+        :raises DecoderError: Error on query failure, or if profiling is not built in
+        """
+        return BootProfile.parse(self.query(QuerySelector.BOOT_PROFILE))
+
+    def sram_stats(self) -> SramStats:
+        """Get the SRAM use of the Decoder, with the most stack used since reset
+
+        :raises DecoderError: Error on query failure
+        """
+        return SramStats.parse(self.query(QuerySelector.SRAM_STATS))
+
     def send_ack(self):
         """Send an ACK to the Decoder"""
         self._open()
@@ -0,0 +1,285 @@
+"""
+Author: Plaid Parliament of Pwning
+Date: 2025
+
+Instruction counts of the design3 Decoder built with ./build.sh qemu. Boots the image
+on QEMU's mps2-an386 with -icount shift=0, where the Decoder's profile counts
+instructions instead of cycles, sends it subscriptions and frames, and tabulates the
+instructions each stage took per message. Frames, channels and timestamps all come from
+--seed, so runs of the same image are comparable, and --save/--baseline turn two runs
+into a regression check.
+
+Only the work of a message is totaled: the UART stages wait on the host and the fault
+injection delays are random, so their counts change from run to run.
+
+Copyright: Copyright (c) 2025 Carnegie Mellon University
+"""
+
+import argparse
+import json
+from pathlib import Path
+import random
+import re
+import subprocess
+import threading
+
+from loguru import logger
+
+from ectf25.utils import Encoder
+from ectf25.utils.decoder import DecoderError, DecoderIntf, Profile
+from ectf25.utils.perf import STAGES, profile_after
+
+# Stages left out of the total, see the module doc
+UNSTABLE = {"uart_rx", "uart_tx", "fiproc"}
+
+# match: design3 qemu/inc/mps2.h -> QEMU_CORE_CLOCK
+QEMU_CORE_CLOCK = 1_000_000_000
+
+
+class Qemu:
+    """qemu-system-arm running a Decoder image, with its UART on a pty"""
+
+    PTY_RE = re.compile(r"char device redirected to (\S+) \(label serial0\)")
+
+    def __init__(self, qemu: str, elf: Path, trace: Path | None = None):
+        # fmt: off
+        self.cmd = [
+            qemu,
+            "-machine", "mps2-an386",
+            "-display", "none",
+            "-monitor", "none",
+            "-serial", "pty",
+            "-icount", "shift=0",
+            "-kernel", str(elf),
+        ]
+        # fmt: on
+        if trace:
+            # every executed block, for ppp_common.hot_profile
+            self.cmd += ["-d", "exec,nochain", "-D", str(trace)]
+        self.proc = None
+
+    def __enter__(self) -> str:
+        """Starts QEMU
+
+        :returns: path of the pty connected to the Decoder's UART
+        """
+        logger.info(" ".join(self.cmd))
+        self.proc = subprocess.Popen(
+            self.cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True
+        )
+
+        output = []
+        for line in self.proc.stdout:
+            output.append(line)
+            if match := self.PTY_RE.search(line):
+                threading.Thread(target=self._drain, daemon=True).start()
+                return match.group(1)
+
+        self.proc.wait()
+        raise RuntimeError(f"QEMU exited without a pty:\n{''.join(output)}")
+
+    def _drain(self):
+        for line in self.proc.stdout:
+            logger.debug(f"qemu: {line.rstrip()}")
+
+    def __exit__(self, *exc):
+        self.proc.terminate()
+        self.proc.wait()
+
+
+class Run:
+    """Per-message stage instructions of one kind of message"""
+
+    def __init__(self):
+        self.stages: dict[str, list[int]] = {name: [] for name in STAGES}
+
+    def add(self, profile: Profile):
+        for name, stage in zip(STAGES, profile.stages):
+            self.stages[name].append(stage.last)
+
+    def totals(self) -> list[int]:
+        stable = [v for n, v in self.stages.items() if n not in UNSTABLE]
+        return [sum(msg) for msg in zip(*stable)]
+
+    def summary(self) -> dict[str, float]:
+        """Mean instructions per message of every stage that ran, and of the total"""
+        means = {n: sum(v) / len(v) for n, v in self.stages.items() if any(v)}
+        means["total"] = sum(self.totals()) / len(self.totals())
+        return means
+
+    def rows(self) -> list[list[str]]:
+        def row(name, values):
+            mean = sum(values) / len(values)
+            return [name, str(min(values)), f"{mean:.0f}", str(max(values))]
+
+        rows = []
+        for name, values in self.stages.items():
+            if any(values):
+                rows.append(row(name + (" *" if name in UNSTABLE else ""), values))
+        rows.append(row("total", self.totals()))
+        return rows
+
+
+def print_table(title: str, run: Run):
+    columns = ["stage", "min", "mean", "max"]
+    rows = run.rows()
+    widths = [max(len(c), *(len(r[i]) for r in rows)) for i, c in enumerate(columns)]
+
+    messages = len(run.stages[STAGES[0]])
+    print(f"{title}: {messages} messages, instructions (* not in the total)")
+    print("  ".join(c.rjust(w) for c, w in zip(columns, widths)))
+    for r in rows:
+        print("  ".join(v.rjust(w) for v, w in zip(r, widths)))
+    print()
+
+
+def compare(results: dict, baseline: dict, tolerance: float) -> bool:
+    """Prints the change of every mean against the baseline
+
+    :returns: True if no message total grew by more than tolerance percent
+    """
+    ok = True
+    for kind, means in results.items():
+        for name, mean in means.items():
+            base = baseline.get(kind, {}).get(name)
+            if not base:
+                continue
+            change = (mean - base) / base * 100
+            print(f"{kind} {name}: {base:.0f} -> {mean:.0f} ({change:+.2f}%)")
+            if name == "total" and change > tolerance:
+                ok = False
+    return ok
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(prog="ectf25.utils.icount")
+    parser.add_argument(
+        "--secrets",
+        "-s",
+        type=argparse.FileType("rb"),
+        required=True,
+        help="Path to the secrets file",
+    )
+    parser.add_argument(
+        "--elf",
+        "-e",
+        type=Path,
+        required=True,
+        help="Decoder image built with ./build.sh qemu (build/qemu/max78000.elf)",
+    )
+    parser.add_argument(
+        "--qemu", default="qemu-system-arm", help="QEMU binary for the mps2-an386"
+    )
+    parser.add_argument(
+        "--subscribe",
+        type=Path,
+        nargs="*",
+        default=[],
+        help="Subscription update files to send (and count) before the frames",
+    )
+    parser.add_argument(
+        "--num-frames", "-n", type=int, default=100, help="Number of frames to send"
+    )
+    parser.add_argument(
+        "--channels",
+        "-c",
+        nargs="+",
+        type=int,
+        default=[0],
+        help="Channels to randomly chose from, all subscribed (NOTE: 0 is broadcast)",
+    )
+    parser.add_argument(
+        "--frame-size", "-f", type=int, default=64, help="Size (in bytes) of frame"
+    )
+    parser.add_argument(
+        "--timestamp",
+        type=int,
+        default=1,
+        help="Timestamp of the first frame, within the subscriptions",
+    )
+    parser.add_argument(
+        "--interval",
+        type=int,
+        default=33_333,
+        help="Timestamp step between frames (default: 30 frames/s in microseconds)",
+    )
+    parser.add_argument(
+        "--seed", type=int, default=0, help="Seed of the frames and channels"
+    )
+    parser.add_argument(
+        "--timeout", type=float, default=120, help="Seconds to wait for a reply"
+    )
+    parser.add_argument(
+        "--save", type=Path, help="Write the mean instructions to this JSON file"
+    )
+    parser.add_argument(
+        "--trace",
+        type=Path,
+        help="Write QEMU's execution trace here, for a hot function profile (slow)",
+    )
+    parser.add_argument(
+        "--baseline", type=Path, help="JSON file from --save to compare against"
+    )
+    parser.add_argument(
+        "--tolerance",
+        type=float,
+        default=1.0,
+        help="Percent a message total may grow over --baseline before failing",
+    )
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+
+    encoder = Encoder(args.secrets.read())
+    rng = random.Random(args.seed)
+
+    with Qemu(args.qemu, args.elf, args.trace) as port:
+        decoder = DecoderIntf(port, timeout=args.timeout)
+
+        try:
+            profile = decoder.profile()
+        except DecoderError as e:
+            exit(f"Could not read the profile, built with ./build.sh qemu? {e}")
+
+        if len(profile.stages) != len(STAGES):
+            exit(f"Decoder has {len(profile.stages)} stages, expected {len(STAGES)}")
+        if profile.core_clock != QEMU_CORE_CLOCK:
+            logger.warning(f"Core clock is {profile.core_clock} Hz, not a QEMU build?")
+
+        subscribe = Run()
+        for path in args.subscribe:
+            decoder.subscribe(path.read_bytes())
+            profile = profile_after(decoder, profile.messages)
+            subscribe.add(profile)
+
+        decode = Run()
+        for i in range(args.num_frames):
+            channel = rng.choice(args.channels)
+            frame = rng.randbytes(args.frame_size)
+            timestamp = args.timestamp + i * args.interval
+
+            decoded = decoder.decode(encoder.encode(channel, frame, timestamp))
+            if decoded != frame:
+                logger.warning(f"Frame mismatch on channel {channel}")
+            profile = profile_after(decoder, profile.messages)
+            decode.add(profile)
+
+    results = {}
+    if args.subscribe:
+        print_table("subscribe", subscribe)
+        results["subscribe"] = subscribe.summary()
+    if args.num_frames > 0:
+        print_table("decode", decode)
+        results["decode"] = decode.summary()
+
+    if args.save:
+        args.save.write_text(json.dumps(results, indent=4) + "\n")
+    if args.baseline:
+        if not compare(results, json.loads(args.baseline.read_text()), args.tolerance):
+            exit(f"Instructions per message grew by more than {args.tolerance}%")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,256 @@
+"""
+Author: Plaid Parliament of Pwning
+Date: 2025
+
+Per-stage cycle counts of a Decoder built with DECODER_PROFILE=1. Sends random frames
+(and optionally subscriptions) to the Decoder, reads its profile after every message
+and tabulates how long each stage took per message over the run. With --boot, right
+after a reset, it first tabulates the startup phases up to the first message header.
+At the end, it prints the SRAM use and the most stack the run took.
+
+Copyright: Copyright (c) 2025 Carnegie Mellon University
+"""
+
+import argparse
+import math
+from pathlib import Path
+import random
+import time
+
+from loguru import logger
+
+from ectf25.utils import Encoder
+from ectf25.utils.decoder import (
+    BootProfile,
+    DecoderError,
+    DecoderIntf,
+    Profile,
+    SramStats,
+)
+
+# match: design3 profile.h -> profile_stage_t
+STAGES = [
+    "uart_rx",
+    "uart_tx",
+    "dispatch",
+    "stream_verify",
+    "signature",
+    "outer_aead",
+    "tree",
+    "inner_aead",
+    "fiproc",
+    "sub_signature",
+    "sub_decrypt",
+    "sub_store",
+    "sub_expand",
+]
+
+# match: design3 profile.h -> boot_phase_t
+BOOT_PHASES = [
+    "hardware",
+    "drbg",
+    "lockout",
+    "crypto",
+    "subscriptions",
+]
+
+
+def percentile(values: list[int], p: float) -> int:
+    """Nearest-rank percentile"""
+    ordered = sorted(values)
+    return ordered[max(math.ceil(p / 100 * len(ordered)) - 1, 0)]
+
+
+class Run:
+    """Per-message stage cycles of one kind of message"""
+
+    def __init__(self):
+        self.stages: dict[str, list[int]] = {name: [] for name in STAGES}
+        self.round_trip_us: list[float] = []
+
+    def add(self, profile: Profile, round_trip_us: float):
+        for name, stage in zip(STAGES, profile.stages):
+            self.stages[name].append(stage.last)
+        self.round_trip_us.append(round_trip_us)
+
+    def rows(self, core_clock: int) -> list[list[str]]:
+        def row(name, values, to_us):
+            mean = sum(values) / len(values)
+            return [
+                name,
+                str(min(values)),
+                f"{mean:.0f}",
+                str(percentile(values, 99)),
+                f"{min(values) * to_us:.1f}",
+                f"{mean * to_us:.1f}",
+                f"{percentile(values, 99) * to_us:.1f}",
+            ]
+
+        to_us = 1e6 / core_clock
+        rows = [row(n, v, to_us) for n, v in self.stages.items() if any(v)]
+        totals = [sum(msg) for msg in zip(*self.stages.values())]
+        rows.append(row("total", totals, to_us))
+
+        # host side time, so cycle columns do not apply
+        rt = self.round_trip_us
+        mean = sum(rt) / len(rt)
+        rows.append(
+            ["host round trip", "-", "-", "-"]
+            + [f"{min(rt):.1f}", f"{mean:.1f}", f"{percentile(rt, 99):.1f}"]
+        )
+        return rows
+
+
+def print_table(title: str, run: Run, core_clock: int):
+    columns = ["stage", "min", "mean", "p99", "min us", "mean us", "p99 us"]
+    rows = run.rows(core_clock)
+    widths = [max(len(c), *(len(r[i]) for r in rows)) for i, c in enumerate(columns)]
+
+    print(f"{title}: {len(run.round_trip_us)} messages, cycles at {core_clock} Hz")
+    print("  ".join(c.rjust(w) for c, w in zip(columns, widths)))
+    for r in rows:
+        print("  ".join(v.rjust(w) for v, w in zip(r, widths)))
+    print()
+
+
+def print_boot(boot: BootProfile):
+    """Startup timeline, with the phases deferred past the first header marked"""
+    to_us = 1e6 / boot.core_clock
+    columns = ["phase", "start us", "cycles", "us"]
+    rows = []
+    for name, phase in zip(BOOT_PHASES, boot.phases):
+        if phase.cycles == 0:
+            continue
+        deferred = boot.first_header and phase.start >= boot.first_header
+        rows.append(
+            [
+                name + (" *" if deferred else ""),
+                f"{phase.start * to_us:.1f}",
+                str(phase.cycles),
+                f"{phase.cycles * to_us:.1f}",
+            ]
+        )
+    for name, at in [("ready", boot.ready), ("first header", boot.first_header)]:
+        rows.append([name, f"{at * to_us:.1f}", "-", "-"])
+    widths = [max(len(c), *(len(r[i]) for r in rows)) for i, c in enumerate(columns)]
+
+    print(f"boot: cycles at {boot.core_clock} Hz (* after the first header)")
+    print("  ".join(c.rjust(w) for c, w in zip(columns, widths)))
+    for r in rows:
+        print("  ".join(v.rjust(w) for v, w in zip(r, widths)))
+    print()
+
+
+def print_sram(sram: SramStats):
+    """SRAM use, with the stack peak since reset (a lower bound of the worst case)"""
+    print(
+        f"sram: {sram.static_size} static, {sram.arena_size} arena,"
+        f" {sram.stack_size} stack of which {sram.stack_peak} used"
+        f" ({sram.stack_size - sram.stack_peak} untouched)"
+    )
+
+
+def profile_after(decoder: DecoderIntf, messages: int) -> Profile:
+    """Reads the profile, which must have recorded exactly one more message"""
+    profile = decoder.profile()
+    if profile.messages != messages + 1:
+        logger.warning(
+            f"Decoder recorded {profile.messages - messages} messages instead of 1,"
+            " was it reset?"
+        )
+    return profile
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(prog="ectf25.utils.perf")
+    parser.add_argument(
+        "--secrets",
+        "-s",
+        type=argparse.FileType("rb"),
+        required=True,
+        help="Path to the secrets file",
+    )
+    parser.add_argument(
+        "--port", "-p", required=True, help="Serial port to the Decoder"
+    )
+    parser.add_argument(
+        "--subscribe",
+        type=Path,
+        nargs="*",
+        default=[],
+        help="Subscription update files to send (and profile) before the frames",
+    )
+    parser.add_argument(
+        "--num-frames", "-n", type=int, default=100, help="Number of frames to send"
+    )
+    parser.add_argument(
+        "--channels",
+        "-c",
+        nargs="+",
+        type=int,
+        default=[0],
+        help="Channels to randomly chose from, all subscribed (NOTE: 0 is broadcast)",
+    )
+    parser.add_argument(
+        "--frame-size", "-f", type=int, default=64, help="Size (in bytes) of frame"
+    )
+    parser.add_argument(
+        "--boot",
+        action="store_true",
+        help="Print the startup profile first, for a Decoder that was just reset",
+    )
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+
+    encoder = Encoder(args.secrets.read())
+    decoder = DecoderIntf(args.port)
+
+    try:
+        # the first header after a reset is this query's
+        if args.boot:
+            boot = decoder.boot_profile()
+            if len(boot.phases) != len(BOOT_PHASES):
+                exit(f"Decoder has {len(boot.phases)} phases, not {len(BOOT_PHASES)}")
+            print_boot(boot)
+        profile = decoder.profile()
+    except DecoderError as e:
+        exit(f"Could not read the profile, built with DECODER_PROFILE=1? {e}")
+
+    if len(profile.stages) != len(STAGES):
+        exit(f"Decoder has {len(profile.stages)} stages, expected {len(STAGES)}")
+    core_clock = profile.core_clock
+
+    subscribe = Run()
+    for path in args.subscribe:
+        start = time.perf_counter()
+        decoder.subscribe(path.read_bytes())
+        round_trip_us = (time.perf_counter() - start) * 1e6
+        profile = profile_after(decoder, profile.messages)
+        subscribe.add(profile, round_trip_us)
+
+    decode = Run()
+    for _ in range(args.num_frames):
+        channel = random.choice(args.channels)
+        frame = random.randbytes(args.frame_size)
+        encoded = encoder.encode(channel, frame, time.time_ns() // 1000)
+
+        start = time.perf_counter()
+        decoded = decoder.decode(encoded)
+        round_trip_us = (time.perf_counter() - start) * 1e6
+        if decoded != frame:
+            logger.warning(f"Frame mismatch on channel {channel}")
+        profile = profile_after(decoder, profile.messages)
+        decode.add(profile, round_trip_us)
+
+    if args.subscribe:
+        print_table("subscribe", subscribe, core_clock)
+    if args.num_frames > 0:
+        print_table("decode", decode, core_clock)
+    print_sram(decoder.sram_stats())
+
+
+if __name__ == "__main__":
+    main()